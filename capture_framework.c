@@ -34,6 +34,7 @@
 #include <sys/wait.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <zlib.h>
 
 #ifdef HAVE_CAPABILITY
 #include <sys/capability.h>
@@ -359,6 +360,23 @@ kis_capture_handler_t *cf_handler_init(const char *in_type) {
     /* Disable daemon mode by default */
     ch->daemonize = 0;
 
+    /* Uncompressed transport until negotiated */
+    ch->transport_compress_capable = 0;
+    ch->transport_compress_pending = 0;
+    ch->transport_compress = 0;
+    ch->transport_coalesce_ms = 0;
+    ch->transport_coalesce_bytes = 0;
+    ch->transport_zstream = NULL;
+    ch->transport_buf = NULL;
+    ch->transport_buf_sz = 0;
+    ch->transport_buf_len = 0;
+    ch->transport_buf_pos = 0;
+    ch->transport_raw_bytes = 0;
+    ch->transport_wire_bytes = 0;
+    ch->transport_blocks = 0;
+    ch->transport_delay_usec = 0;
+    ch->transport_report_time = 0;
+
     /* Zero the GPS */
     ch->gps_fixed_lat = 0;
     ch->gps_fixed_lon = 0;
@@ -456,6 +474,8 @@ void cf_handler_free(kis_capture_handler_t *caph) {
     if (caph->cli_sourcedef)
         free(caph->cli_sourcedef);
 
+    cf_transport_free(caph);
+
     if (caph->tcp_fd >= 0)
         close(caph->tcp_fd);
 
@@ -742,6 +762,7 @@ int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
         { "gps-name", required_argument, 0, 9},
         { "host", required_argument, 0, 10},
         { "autodetect", optional_argument, 0, 11},
+        { "compress", no_argument, 0, 12},
         { "help", no_argument, 0, 'h'},
         { 0, 0, 0, 0 }
     };
@@ -806,6 +827,8 @@ int cf_handler_parse_opts(kis_capture_handler_t *caph, int argc, char *argv[]) {
 
             if (optarg != NULL)
                 caph->announced_uuid = strdup(optarg);
+        } else if (r == 12) {
+            caph->transport_compress_capable = 1;
         }
     }
 
@@ -894,7 +917,9 @@ void cf_print_help(kis_capture_handler_t *caph, const char *argv0) {
                 " --list                       List supported devices detected\n"
 				" --autodetect [uuid:optional] Look for a Kismet server in announcement mode, optionally \n"
 				"                              waiting for a specific server UUID to be seen.  Requires \n"
-				"                              a Kismet server configured for announcement mode.\n",
+				"                              a Kismet server configured for announcement mode.\n"
+                " --compress                   Offer to coalesce and compress captured data sent \n"
+                "                              to the remote Kismet server, for low bandwidth links.\n",
                 argv0, argv0);
     }
 
@@ -1371,6 +1396,46 @@ int cf_handle_rx_data(kis_capture_handler_t *caph) {
         cbret = 1;
         goto finish;
     } else if (strcasecmp(kds_cmd->command, "PONG") == 0) {
+        cbret = 1;
+        goto finish;
+    } else if (strcasecmp(kds_cmd->command, "KDSTRANSPORT") == 0) {
+        KismetDatasource__Transport *transport_cmd;
+
+        transport_cmd = kismet_datasource__transport__unpack(NULL, kds_cmd->content.len,
+                kds_cmd->content.data);
+
+        if (transport_cmd == NULL) {
+            fprintf(stderr, "FATAL:  Invalid frame received, unable to unpack "
+                    "KDSTRANSPORT command\n");
+            cbret = -1;
+            goto finish;
+        }
+
+        /* Switch to the compressed transport once any data already queued has
+         * been written */
+        if (transport_cmd->compression && caph->transport_compress_capable) {
+            pthread_mutex_lock(&(caph->out_ringbuf_lock));
+
+            caph->transport_compress_pending = 1;
+
+            caph->transport_coalesce_ms = 250;
+            if (transport_cmd->has_coalesce_ms && transport_cmd->coalesce_ms <= 10000)
+                caph->transport_coalesce_ms = transport_cmd->coalesce_ms;
+
+            caph->transport_coalesce_bytes = 65536;
+            if (transport_cmd->has_coalesce_bytes && transport_cmd->coalesce_bytes >= 1024 &&
+                    transport_cmd->coalesce_bytes <= KIS_EXTERNAL_ZRAW_MAX)
+                caph->transport_coalesce_bytes = transport_cmd->coalesce_bytes;
+
+            pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+
+            fprintf(stderr, "INFO - Remote server enabled compressed transport, sending "
+                    "blocks of up to %lu bytes every %ums\n",
+                    (unsigned long) caph->transport_coalesce_bytes, caph->transport_coalesce_ms);
+        }
+
+        kismet_datasource__transport__free_unpacked(transport_cmd, NULL);
+
         cbret = 1;
         goto finish;
     } else if (strcasecmp(kds_cmd->command, "KDSLISTINTERFACES") == 0) {
@@ -1774,6 +1839,9 @@ int cf_handler_remote_server(kis_capture_handler_t *caph) {
     kis_simple_ringbuf_clear(caph->in_ringbuf);
     kis_simple_ringbuf_clear(caph->out_ringbuf);
 
+    /* Transport is renegotiated on each connection */
+    cf_transport_free(caph);
+
     /* Perform a local probe on the source to see if it's valid */
     msgstr[0] = 0;
 
@@ -1957,6 +2025,9 @@ int cf_handler_remote_connect(kis_capture_handler_t *caph) {
     kis_simple_ringbuf_clear(caph->in_ringbuf);
     kis_simple_ringbuf_clear(caph->out_ringbuf);
 
+    /* Transport is renegotiated on each connection */
+    cf_transport_free(caph);
+
     /* Perform a local probe on the source to see if it's valid */
     msgstr[0] = 0;
 
@@ -2060,14 +2131,168 @@ int cf_handler_remote_connect(kis_capture_handler_t *caph) {
     return 1;
 }
 
+/* Start the compressed transport; called with the out ringbuf lock held */
+static int cf_transport_start(kis_capture_handler_t *caph) {
+    z_stream *zs;
+
+    zs = (z_stream *) malloc(sizeof(z_stream));
+
+    if (zs == NULL)
+        return -1;
+
+    memset(zs, 0, sizeof(z_stream));
+
+    if (deflateInit(zs, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        free(zs);
+        return -1;
+    }
+
+    /* The dictionary contains NULs, so use the literal size */
+    deflateSetDictionary(zs, (const Bytef *) KIS_EXTERNAL_ZDICT, 
+            sizeof(KIS_EXTERNAL_ZDICT) - 1);
+
+    /* Room for a block of incompressible data and the flush marker */
+    caph->transport_buf_sz = sizeof(kismet_external_zframe_t) + 
+        deflateBound(zs, caph->transport_coalesce_bytes) + 16;
+    caph->transport_buf = (uint8_t *) malloc(caph->transport_buf_sz);
+
+    if (caph->transport_buf == NULL) {
+        deflateEnd(zs);
+        free(zs);
+        return -1;
+    }
+
+    caph->transport_zstream = zs;
+    caph->transport_buf_len = 0;
+    caph->transport_buf_pos = 0;
+
+    caph->transport_raw_bytes = 0;
+    caph->transport_wire_bytes = 0;
+    caph->transport_blocks = 0;
+    caph->transport_delay_usec = 0;
+    caph->transport_report_time = time(NULL);
+
+    caph->transport_compress_pending = 0;
+    caph->transport_compress = 1;
+
+    return 1;
+}
+
+static void cf_transport_report(kis_capture_handler_t *caph) {
+    if (caph->transport_blocks == 0)
+        return;
+
+    fprintf(stderr, "INFO - Compressed transport sent %llu bytes of data as %llu bytes "
+            "(%.1f%%) in %llu blocks, average delay %.1fms\n",
+            (unsigned long long) caph->transport_raw_bytes,
+            (unsigned long long) caph->transport_wire_bytes,
+            caph->transport_raw_bytes == 0 ? 0 :
+                (double) caph->transport_wire_bytes * 100 / caph->transport_raw_bytes,
+            (unsigned long long) caph->transport_blocks,
+            (double) caph->transport_delay_usec / caph->transport_blocks / 1000);
+}
+
+void cf_transport_free(kis_capture_handler_t *caph) {
+    if (caph->transport_compress)
+        cf_transport_report(caph);
+
+    if (caph->transport_zstream != NULL) {
+        deflateEnd(caph->transport_zstream);
+        free(caph->transport_zstream);
+        caph->transport_zstream = NULL;
+    }
+
+    if (caph->transport_buf != NULL) {
+        free(caph->transport_buf);
+        caph->transport_buf = NULL;
+    }
+
+    caph->transport_buf_sz = 0;
+    caph->transport_buf_len = 0;
+    caph->transport_buf_pos = 0;
+
+    caph->transport_compress_pending = 0;
+    caph->transport_compress = 0;
+}
+
+/* Note when data is queued into an empty buffer, which starts the coalescing 
+ * interval; called with the out ringbuf lock held */
+static void cf_transport_mark_queued(kis_capture_handler_t *caph) {
+    if (caph->transport_compress && kis_simple_ringbuf_used(caph->out_ringbuf) == 0)
+        gettimeofday(&(caph->transport_coalesce_start), NULL);
+}
+
+/* Compress the queued data into the next block to write; called with the out 
+ * ringbuf lock held once the previous block has been written */
+static int cf_transport_compress_block(kis_capture_handler_t *caph, struct timeval *now) {
+    kismet_external_zframe_t *zframe;
+    uint8_t *peek_buf = NULL;
+    size_t peeked_sz, data_sz;
+    uint64_t delay_usec;
+    z_stream *zs = caph->transport_zstream;
+
+    peeked_sz = kis_simple_ringbuf_peek_zc(caph->out_ringbuf, (void **) &peek_buf, 
+            caph->transport_coalesce_bytes);
+
+    if (peeked_sz == 0) {
+        kis_simple_ringbuf_peek_free(caph->out_ringbuf, peek_buf);
+        return 0;
+    }
+
+    zframe = (kismet_external_zframe_t *) caph->transport_buf;
+
+    zs->next_in = peek_buf;
+    zs->avail_in = peeked_sz;
+    zs->next_out = zframe->data;
+    zs->avail_out = caph->transport_buf_sz - sizeof(kismet_external_zframe_t);
+
+    /* Flush each block so it can be decompressed on arrival, but keep the stream
+     * history so later blocks compress against the headers already sent */
+    if (deflate(zs, Z_SYNC_FLUSH) != Z_OK || zs->avail_in != 0) {
+        kis_simple_ringbuf_peek_free(caph->out_ringbuf, peek_buf);
+        fprintf(stderr, "FATAL: Unable to compress data for the remote transport\n");
+        return -1;
+    }
+
+    data_sz = (caph->transport_buf_sz - sizeof(kismet_external_zframe_t)) - zs->avail_out;
+
+    delay_usec = (now->tv_sec - caph->transport_coalesce_start.tv_sec) * 1000000L +
+        (now->tv_usec - caph->transport_coalesce_start.tv_usec);
+
+    zframe->signature = htonl(KIS_EXTERNAL_ZPROTO_SIG);
+    zframe->data_sz = htonl(data_sz);
+    zframe->raw_sz = htonl(peeked_sz);
+    zframe->delay_usec = htonl((uint32_t) delay_usec);
+    zframe->data_checksum = htonl(adler32_csum(zframe->data, data_sz));
+
+    caph->transport_buf_len = sizeof(kismet_external_zframe_t) + data_sz;
+    caph->transport_buf_pos = 0;
+
+    caph->transport_raw_bytes += peeked_sz;
+    caph->transport_blocks++;
+    caph->transport_delay_usec += delay_usec;
+
+    kis_simple_ringbuf_read(caph->out_ringbuf, NULL, peeked_sz);
+    kis_simple_ringbuf_peek_free(caph->out_ringbuf, peek_buf);
+
+    /* Anything left over starts a new interval */
+    caph->transport_coalesce_start = *now;
+
+    /* Signal to any waiting IO that the buffer has some headroom */
+    pthread_cond_signal(&(caph->out_ringbuf_flush_cond));
+
+    return 1;
+}
+
 int cf_handler_loop(kis_capture_handler_t *caph) {
     fd_set rset, wset;
     int max_fd;
     int read_fd, write_fd;
-    struct timeval tm;
+    struct timeval tm, now;
     int spindown;
     int ret;
     int rv = 0;
+    int64_t held_usec;
 
     if (caph->tcp_fd >= 0) {
         read_fd = caph->tcp_fd;
@@ -2121,10 +2346,64 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
             max_fd = read_fd;
         }
 
+        tm.tv_sec = 0;
+        tm.tv_usec = 500000;
+
         /* Inspect the write buffer - do we have data? */
         pthread_mutex_lock(&(caph->out_ringbuf_lock));
 
-        if (kis_simple_ringbuf_used(caph->out_ringbuf) != 0) {
+        /* Switch to the compressed transport once everything sent before it was
+         * negotiated has been written */
+        if (caph->transport_compress_pending && 
+                kis_simple_ringbuf_used(caph->out_ringbuf) == 0) {
+            if (cf_transport_start(caph) < 0) {
+                pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+                fprintf(stderr, "FATAL: Unable to start compressed transport\n");
+                rv = -1;
+                break;
+            }
+        }
+
+        if (caph->transport_compress) {
+            /* Coalesce queued data into a block once enough is queued, the oldest 
+             * data has been held long enough, or we're flushing for spindown */
+            if (caph->transport_buf_pos == caph->transport_buf_len &&
+                    kis_simple_ringbuf_used(caph->out_ringbuf) != 0) {
+                gettimeofday(&now, NULL);
+
+                held_usec = (now.tv_sec - caph->transport_coalesce_start.tv_sec) * 1000000L +
+                    (now.tv_usec - caph->transport_coalesce_start.tv_usec);
+
+                if (spindown != 0 || 
+                        kis_simple_ringbuf_used(caph->out_ringbuf) >= 
+                            caph->transport_coalesce_bytes ||
+                        held_usec >= (int64_t) caph->transport_coalesce_ms * 1000) {
+                    if (cf_transport_compress_block(caph, &now) < 0) {
+                        pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+                        rv = -1;
+                        break;
+                    }
+                } else if (held_usec + 500000 > (int64_t) caph->transport_coalesce_ms * 1000) {
+                    /* Wake up when the interval ends */
+                    tm.tv_usec = caph->transport_coalesce_ms * 1000 - held_usec;
+                }
+            }
+
+            if (caph->transport_buf_pos != caph->transport_buf_len) {
+                FD_SET(write_fd, &wset);
+                if (max_fd < write_fd)
+                    max_fd = write_fd;
+            } else if (spindown != 0 && kis_simple_ringbuf_used(caph->out_ringbuf) == 0) {
+                pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+                rv = 0;
+                break;
+            }
+
+            if (time(NULL) - caph->transport_report_time >= 60) {
+                cf_transport_report(caph);
+                caph->transport_report_time = time(NULL);
+            }
+        } else if (kis_simple_ringbuf_used(caph->out_ringbuf) != 0) {
             FD_SET(write_fd, &wset);
             if (max_fd < write_fd)
                 max_fd = write_fd;
@@ -2136,9 +2415,6 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
 
         pthread_mutex_unlock(&(caph->out_ringbuf_lock));
 
-        tm.tv_sec = 0;
-        tm.tv_usec = 500000;
-
         if ((ret = select(max_fd + 1, &rset, &wset, NULL, &tm)) < 0) {
             if (errno != EINTR && errno != EAGAIN) {
                 fprintf(stderr, "FATAL:  Error during select(): %s\n", strerror(errno));
@@ -2221,6 +2497,29 @@ int cf_handler_loop(kis_capture_handler_t *caph) {
 
             pthread_mutex_lock(&(caph->out_ringbuf_lock));
 
+            /* Write the current compressed block; blocks are only sent over tcp */
+            if (caph->transport_compress) {
+                written_sz = send(write_fd, caph->transport_buf + caph->transport_buf_pos,
+                        caph->transport_buf_len - caph->transport_buf_pos, MSG_DONTWAIT);
+
+                pthread_mutex_unlock(&(caph->out_ringbuf_lock));
+
+                if (written_sz < 0) {
+                    if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                        fprintf(stderr, "FATAL:  Error during write(): %s\n", strerror(errno));
+                        rv = -1;
+                        break;
+                    }
+
+                    continue;
+                }
+
+                caph->transport_buf_pos += written_sz;
+                caph->transport_wire_bytes += written_sz;
+
+                continue;
+            }
+
             peeked_sz = kis_simple_ringbuf_peek_zc(caph->out_ringbuf, (void **) &peek_buf, 0);
 
             /* Don't know how we'd get here... */
@@ -2286,6 +2585,8 @@ int cf_send_raw_bytes(kis_capture_handler_t *caph, uint8_t *data, size_t len) {
         return 0;
     }
 
+    cf_transport_mark_queued(caph);
+
     if (kis_simple_ringbuf_write(caph->out_ringbuf, data, len) != len) {
         fprintf(stderr, "FATAL: Failed to write data to buffer\n");
         pthread_mutex_unlock(&(caph->out_ringbuf_lock));
@@ -2360,6 +2661,8 @@ int cf_send_packet(kis_capture_handler_t *caph, const char *packtype,
 
     frame->data_checksum = htonl(calc_checksum);
 
+    cf_transport_mark_queued(caph);
+
     kis_simple_ringbuf_commit(caph->out_ringbuf, send_buffer, rs_sz);
 
     pthread_mutex_unlock(&(caph->out_ringbuf_lock));
@@ -2927,6 +3230,47 @@ int cf_send_json(kis_capture_handler_t *caph,
     return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
 }
 
+int cf_send_spectrum(kis_capture_handler_t *caph, struct timeval ts,
+        double start_mhz, double end_mhz, double bucket_width_hz,
+        int32_t *data, size_t n_data) {
+
+    KismetDatasource__DataReport kedata;
+    KismetDatasource__SubSpectrum kespectrum;
+
+    kismet_datasource__data_report__init(&kedata);
+    kismet_datasource__sub_spectrum__init(&kespectrum);
+
+    kespectrum.has_time_sec = 1;
+    kespectrum.time_sec = ts.tv_sec;
+    kespectrum.has_time_usec = 1;
+    kespectrum.time_usec = ts.tv_usec;
+
+    kespectrum.has_start_mhz = 1;
+    kespectrum.start_mhz = start_mhz;
+    kespectrum.has_end_mhz = 1;
+    kespectrum.end_mhz = end_mhz;
+    kespectrum.has_bucket_width_hz = 1;
+    kespectrum.bucket_width_hz = bucket_width_hz;
+
+    kespectrum.n_data = n_data;
+    kespectrum.data = data;
+
+    kedata.spectrum = &kespectrum;
+
+    uint8_t *buf;
+    size_t buf_len;
+
+    buf_len = kismet_datasource__data_report__get_packed_size(&kedata);
+    buf = (uint8_t *) malloc(buf_len);
+
+    if (buf == NULL) {
+        return -1;
+    }
+
+    kismet_datasource__data_report__pack(&kedata, buf);
+
+    return cf_send_packet(caph, "KDSDATAREPORT", buf, buf_len);
+}
 
 int cf_send_configresp(kis_capture_handler_t *caph, unsigned int seqno, 
         unsigned int success, const char *msg, const char *warning) {
@@ -3010,6 +3354,11 @@ int cf_send_newsource(kis_capture_handler_t *caph, const char *uuid) {
     if (uuid != NULL)
         kesrc.uuid = strdup(uuid);
 
+    if (caph->transport_compress_capable) {
+        kesrc.has_transport_compression = 1;
+        kesrc.transport_compression = 1;
+    }
+
     buf_len = kismet_datasource__new_source__get_packed_size(&kesrc);
     buf = (uint8_t *) malloc(buf_len);
 
@@ -3082,6 +3431,48 @@ double cf_parse_frequency(const char *freq) {
     return v;
 }
 
+void cf_replay_init(cf_replay_clock_t *clock, double speed) {
+    memset(clock, 0, sizeof(cf_replay_clock_t));
+    clock->speed = speed;
+}
+
+void cf_replay_wait(cf_replay_clock_t *clock, struct timeval ts) {
+    struct timespec now, remaining;
+    int64_t offset_usec, due_usec, elapsed_usec;
+
+    if (clock->speed <= 0)
+        return;
+
+    if (!clock->started) {
+        clock->first_ts = ts;
+        clock_gettime(CLOCK_MONOTONIC, &clock->start_tm);
+        clock->started = 1;
+        return;
+    }
+
+    offset_usec = ((int64_t) ts.tv_sec - clock->first_ts.tv_sec) * 1000000L +
+        ((int64_t) ts.tv_usec - clock->first_ts.tv_usec);
+
+    if (offset_usec <= 0)
+        return;
+
+    due_usec = (int64_t) (offset_usec / clock->speed);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    elapsed_usec = ((int64_t) now.tv_sec - clock->start_tm.tv_sec) * 1000000L +
+        ((int64_t) now.tv_nsec - clock->start_tm.tv_nsec) / 1000L;
+
+    if (due_usec - elapsed_usec < 1000)
+        return;
+
+    remaining.tv_sec = (due_usec - elapsed_usec) / 1000000L;
+    remaining.tv_nsec = ((due_usec - elapsed_usec) % 1000000L) * 1000L;
+
+    while (nanosleep(&remaining, &remaining) < 0 && errno == EINTR)
+        ;
+}
+
 int cf_drop_most_caps(kis_capture_handler_t *caph) {
     /* Modeled on the Wireshark Dumpcap priv dropping
      *
@@ -45,6 +45,7 @@
 /* According to earlier standards */
 #include <sys/time.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include <unistd.h>
 #include <errno.h>
@@ -273,6 +274,31 @@ struct kis_capture_handler {
     /* TCP connection, either server or client */
     int tcp_fd;
 
+    /* Offer a compressed transport to the remote server */
+    int transport_compress_capable;
+    /* Compressed transport negotiated by the server, pending until any uncompressed
+     * data has been written, and active */
+    int transport_compress_pending;
+    int transport_compress;
+    /* Coalescing limits from the server */
+    unsigned int transport_coalesce_ms;
+    size_t transport_coalesce_bytes;
+    /* When the oldest uncoalesced data was queued */
+    struct timeval transport_coalesce_start;
+    /* Compression state and the compressed block being written */
+    struct z_stream_s *transport_zstream;
+    uint8_t *transport_buf;
+    size_t transport_buf_sz;
+    size_t transport_buf_len;
+    size_t transport_buf_pos;
+    /* Transport counters; raw bytes of frames, bytes sent over the connection, 
+     * blocks sent, and total time data was held to coalesce it */
+    uint64_t transport_raw_bytes;
+    uint64_t transport_wire_bytes;
+    uint64_t transport_blocks;
+    uint64_t transport_delay_usec;
+    time_t transport_report_time;
+
     /* Die when we hit the end of our write buffer */
     int spindown;
 
@@ -624,6 +650,10 @@ int cf_handle_rx_data(kis_capture_handler_t *caph);
  */
 int cf_handler_remote_connect(kis_capture_handler_t *caph);
 
+/* Release the compressed transport state and return to the uncompressed transport,
+ * reporting the transport counters */
+void cf_transport_free(kis_capture_handler_t *caph);
+
 /* Launch a network server and wait for a connection, if reverse connection is
  * specified; this should not be needed by capture tools using the framework; 
  * the capture loop will be managed directly via cf_handler_remote_capture
@@ -800,6 +830,22 @@ int cf_send_json(kis_capture_handler_t *caph,
         KismetDatasource__SubGps *kv_gps,
         struct timeval ts, char *type, char *json);
 
+/* Send a DATA frame with a spectrum sweep
+ * Can be called from any thread
+ *
+ * Data holds n_data buckets of power in dBm, each bucket_width_hz wide, covering
+ * start_mhz to end_mhz.  A sweep may be sent in several segments, each covering
+ * part of the full range.
+ *
+ * Returns:
+ * -1   An error occurred
+ *  0   Insufficient space in buffer, try again
+ *  1   Success
+ */
+int cf_send_spectrum(kis_capture_handler_t *caph, struct timeval ts,
+        double start_mhz, double end_mhz, double bucket_width_hz,
+        int32_t *data, size_t n_data);
+
 /* Send a CONFIGRESP with only a success and optional message
  *
  * Returns:
@@ -849,6 +895,30 @@ double cf_parse_frequency(const char *freq);
 /* Set verbosity */
 void cf_set_verbose(kis_capture_handler_t *caph, int verbosity);
 
+/* Replay pacing for sources which play back recorded packets, such as pcapfile
+ * and kismetdb.
+ *
+ * Packets are scheduled against the start of the replay:  a packet recorded N
+ * seconds after the first packet is released N / speed seconds after the replay
+ * started.  Waiting for an absolute deadline instead of sleeping between each pair
+ * of packets keeps per-packet overhead from accumulating into drift, and packets
+ * which are due within a millisecond are released without sleeping at all.
+ *
+ * A speed of 1 replays in realtime; a speed of 0 disables pacing.
+ */
+typedef struct cf_replay_clock {
+    double speed;
+    int started;
+    struct timeval first_ts;
+    struct timespec start_tm;
+} cf_replay_clock_t;
+
+void cf_replay_init(cf_replay_clock_t *clock, double speed);
+
+/* Block until a packet with the recorded timestamp ts is due.  Timestamps which go
+ * backwards in a damaged capture are released immediately. */
+void cf_replay_wait(cf_replay_clock_t *clock, struct timeval ts);
+
 /* Simple redefinition of message flags */
 #define MSGFLAG_DEBUG   KISMET_EXTERNAL__MSGBUS_MESSAGE__MESSAGE_TYPE__DEBUG
 #define MSGFLAG_INFO    KISMET_EXTERNAL__MSGBUS_MESSAGE__MESSAGE_TYPE__INFO
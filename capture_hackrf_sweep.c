@@ -26,7 +26,23 @@
 /* capture_hackrf_sweep
  *
  * Capture binary which interfaces to the HackRF radio to gather spectrum
- * measurement which is then reported to Kismet via the SPECTRUM kv pairs.
+ * measurement which is then reported to Kismet as spectrum sweeps.
+ *
+ * The radio sweeps a single range, given by the start_mhz and end_mhz source
+ * options, in 20MHz tuning steps.  The end of the range is rounded up to a whole
+ * tuning step, and the rounded range is declared to Kismet when the source opens.
+ * The tuning blocks of a sweep arrive interleaved, so each sweep is assembled in
+ * full before it is sent.
+ *
+ * Source options:
+ *   serial=...       serial number of the hackrf, required when more than one
+ *                    hackrf is connected
+ *   start_mhz=...    start of the sweep range, default 2400
+ *   end_mhz=...      end of the sweep range, default 2500
+ *   bin_width=...    width of each power bin in Hz, default 1000000
+ *   lna_gain=...     LNA (IF) gain, 0-40dB in 8dB steps, default 16
+ *   vga_gain=...     VGA (baseband) gain, 0-62dB in 2dB steps, default 20
+ *   amp=true         enable the RX amplifier
  *
  * This binary only needs to run as root if the hackrf device is not writeable
  * by the user (as configured in udev); user access is assumed.
@@ -37,8 +53,6 @@
 #include <pthread.h>
 #include <fcntl.h>
 
-#include <sched.h>
-
 /* According to POSIX.1-2001, POSIX.1-2008 */
 #include <sys/select.h>
 
@@ -46,32 +60,25 @@
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <dirent.h>
 
 #include <unistd.h>
 #include <errno.h>
-
-#include <net/if.h>
-#include <arpa/inet.h>
-
-#include <ifaddrs.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "config.h"
-
-#include "simple_datasource_proto.h"
 #include "capture_framework.h"
 
-
 #ifndef BUILD_CAPTURE_HACKRF_SWEEP
 
-/* If the required libraries (hackrf and fftw3) are not available, build the 
+/* If the required libraries (hackrf and fftw3f) are not available, build the 
  * capture binary, but only return errors.
  */
 
-
-int open_callback(kis_capture_handler_t *, uint32_t, char *,
-        char *msg, uint32_t *, char **, simple_cap_proto_frame_t *,
-        cf_params_interface_t **, cf_params_spectrum_t **) {
+int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
+        char *msg, uint32_t *dlt, char **uuid, KismetExternal__Command *frame,
+        cf_params_interface_t **ret_interface,
+        cf_params_spectrum_t **ret_spectrum) {
 
     snprintf(msg, STATUS_MAX, "Kismet was not compiled with the hackrf libraries, "
             "cannot use hackrf_sweep; check the results of ./configure or consult "
@@ -79,9 +86,10 @@ int open_callback(kis_capture_handler_t *, uint32_t, char *,
     return -1;
 }
 
-int probe_callback(kis_capture_handler_t *, uint32_t, char *,
-        char *msg, char **, simple_cap_proto_frame_t *,
-        cf_params_interface_t **, cf_params_spectrum_t **) {
+int probe_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
+        char *msg, char **uuid, KismetExternal__Command *frame,
+        cf_params_interface_t **ret_interface,
+        cf_params_spectrum_t **ret_spectrum) {
 
     snprintf(msg, STATUS_MAX, "Kismet was not compiled with the hackrf libraries, "
             "cannot use hackrf_sweep; check the results of ./configure or consult "
@@ -89,18 +97,45 @@ int probe_callback(kis_capture_handler_t *, uint32_t, char *,
     return -1;
 }
 
-int list_callback(kis_capture_handler_t *, uint32_t,
-        char *, char ***interfaces, char ***flags) {
+int list_callback(kis_capture_handler_t *caph, uint32_t seqno,
+        char *msg, cf_params_list_interface_t ***interfaces) {
 
     *interfaces = NULL;
-    *flags = NULL;
     return 0;
 }
 
-void capture_thread(kis_capture_handler_t *) {
+void capture_thread(kis_capture_handler_t *caph) {
     return;
 }
 
+int main(int argc, char *argv[]) {
+    kis_capture_handler_t *caph = cf_handler_init("hackrf_sweep");
+
+    if (caph == NULL) {
+        fprintf(stderr, "FATAL: Could not allocate basic handler data, your system "
+                "is very low on RAM or something is wrong.\n");
+        return -1;
+    }
+
+    cf_handler_set_open_cb(caph, open_callback);
+    cf_handler_set_probe_cb(caph, probe_callback);
+    cf_handler_set_listdevices_cb(caph, list_callback);
+    cf_handler_set_capture_cb(caph, capture_thread);
+
+    if (cf_handler_parse_opts(caph, argc, argv) < 1) {
+        cf_print_help(caph, argv[0]);
+        return -1;
+    }
+
+    cf_handler_remote_capture(caph);
+
+    cf_handler_loop(caph);
+
+    cf_handler_free(caph);
+
+    return 1;
+}
+
 #else
 
 #include <libhackrf/hackrf.h>
@@ -108,226 +143,415 @@ void capture_thread(kis_capture_handler_t *) {
 #include <inttypes.h>
 #include <math.h>
 
-/* Copied directly from hackrf_sweep.c */
-#define FD_BUFFER_SIZE (8*1024)
-
+/* Sweep parameters from hackrf_sweep.c */
 #define FREQ_ONE_MHZ (1000000ull)
 
 #define FREQ_MIN_MHZ (0)    /*    0 MHz */
 #define FREQ_MAX_MHZ (7250) /* 7250 MHz */
 
 #define DEFAULT_SAMPLE_RATE_HZ (20000000) /* 20MHz default sample rate */
-#define DEFAULT_BASEBAND_FILTER_BANDWIDTH (15000000) /* 5MHz default */
+#define DEFAULT_BASEBAND_FILTER_BANDWIDTH (15000000) /* 15MHz default */
 
 #define TUNE_STEP (DEFAULT_SAMPLE_RATE_HZ / FREQ_ONE_MHZ)
 #define OFFSET 7500000
 
 #define BLOCKS_PER_TRANSFER 16
-#define THROWAWAY_BLOCKS 2
-
-#if defined _WIN32
-	#define sleep(a) Sleep( (a*1000) )
-#endif
 
-uint32_t num_samples = SAMPLES_PER_BLOCK;
-int num_ranges = 0;
-uint16_t frequencies[MAX_SWEEP_RANGES*2];
-int step_count;
-
-static float TimevalDiff(const struct timeval *a, const struct timeval *b) {
-   return (a->tv_sec - b->tv_sec) + 1e-6f * (a->tv_usec - b->tv_usec);
+/* Same limit as KIS_SPECTRUM_MAX_BINS in the server spectrum store; larger
+ * sweeps would be refused */
+#define HACKRF_MAX_SWEEP_BINS 65536
+
+/* Power reported for bins with no energy at all */
+#define HACKRF_POWER_FLOOR -150
+
+typedef struct {
+    hackrf_device *device;
+    char *serial;
+
+    /* Sweep range in MHz, with the end rounded up to a whole tuning step */
+    uint16_t frequencies[2];
+
+    uint32_t lna_gain;
+    uint32_t vga_gain;
+    int amp;
+
+    int fft_size;
+    double fft_bin_width;
+    fftwf_complex *fftw_in;
+    fftwf_complex *fftw_out;
+    fftwf_plan fftw_plan;
+    float *pwr;
+    float *window;
+
+    /* The sweep being assembled */
+    int32_t *sweep;
+    size_t sweep_bins;
+    int sweep_started;
+    struct timeval sweep_ts;
+
+    kis_capture_handler_t *caph;
+} local_hackrf_t;
+
+static float log_power(fftwf_complex in, float scale) {
+    float re = in[0] * scale;
+    float im = in[1] * scale;
+    float magsq = re * re + im * im;
+    return log2f(magsq) * 10.0f / log2(10.0f);
 }
 
-int parse_u32(char* s, uint32_t* const value) {
-	uint_fast8_t base = 10;
-	char* s_end;
-	uint64_t ulong_value;
-
-	if( strlen(s) > 2 ) {
-		if( s[0] == '0' ) {
-			if( (s[1] == 'x') || (s[1] == 'X') ) {
-				base = 16;
-				s += 2;
-			} else if( (s[1] == 'b') || (s[1] == 'B') ) {
-				base = 2;
-				s += 2;
-			}
-		}
-	}
-
-	s_end = s;
-	ulong_value = strtoul(s, &s_end, base);
-	if( (s != s_end) && (*s_end == 0) ) {
-		*value = (uint32_t)ulong_value;
-		return HACKRF_SUCCESS;
-	} else {
-		return HACKRF_ERROR_INVALID_PARAM;
-	}
+static void hackrf_uuid(const char *serial, char **uuid) {
+    char errstr[STATUS_MAX];
+    unsigned long s = 0;
+    size_t len = strlen(serial);
+
+    /* The low 64 bits of the serial are enough to tell devices apart */
+    if (len > 16)
+        serial += len - 16;
+
+    sscanf(serial, "%lx", &s);
+
+    /* Make a spoofed, but consistent, UUID based on the adler32 of the 
+     * capture name and the serial of the device */
+    snprintf(errstr, STATUS_MAX, "%08X-0000-0000-%04lX-%012lX",
+            adler32_csum((unsigned char *) "kismet_cap_hackrf_sweep", 
+                strlen("kismet_cap_hackrf_sweep")) & 0xFFFFFFFF,
+            (s >> 48) & 0xFFFF, s & 0xFFFFFFFFFFFF);
+    *uuid = strdup(errstr);
 }
 
-int parse_u32_range(char* s, uint32_t* const value_min, uint32_t* const value_max) {
-	int result;
+/* Find the serial of the device matching the definition; returns a new string
+ * or NULL with msg set */
+static char *hackrf_find_serial(char *definition, char *msg) {
+    char *placeholder = NULL;
+    int placeholder_len;
+    char *serial = NULL;
+    char *ret = NULL;
+    hackrf_device_list_t *list;
+    int x;
 
-	char *sep = strchr(s, ':');
-	if (!sep)
-		return HACKRF_ERROR_INVALID_PARAM;
+    if ((placeholder_len = cf_find_flag(&placeholder, "serial", definition)) > 0)
+        serial = strndup(placeholder, placeholder_len);
 
-	*sep = 0;
+    list = hackrf_device_list();
 
-	result = parse_u32(s, value_min);
-	if (result != HACKRF_SUCCESS)
-		return result;
-	result = parse_u32(sep + 1, value_max);
-	if (result != HACKRF_SUCCESS)
-		return result;
+    if (list == NULL || list->devicecount == 0) {
+        snprintf(msg, STATUS_MAX, "no hackrf devices found");
+    } else if (serial == NULL && list->devicecount != 1) {
+        snprintf(msg, STATUS_MAX, "multiple hackrf devices found, specify serial number");
+    } else {
+        for (x = 0; x < list->devicecount; x++) {
+            if (list->serial_numbers[x] == NULL)
+                continue;
+
+            if (serial == NULL || strcasecmp(serial, list->serial_numbers[x]) == 0) {
+                ret = strdup(list->serial_numbers[x]);
+                break;
+            }
+        }
 
-	return HACKRF_SUCCESS;
-}
+        if (ret == NULL)
+            snprintf(msg, STATUS_MAX, "no hackrf device with serial %s found", serial);
+    }
 
-volatile bool do_exit = false;
-
-FILE* fd = NULL;
-volatile uint32_t byte_count = 0;
-volatile uint64_t sweep_count = 0;
-
-struct timeval time_start;
-struct timeval t_start;
-struct timeval time_stamp;
-
-bool amp = false;
-uint32_t amp_enable;
-
-bool antenna = false;
-uint32_t antenna_enable;
-
-bool binary_output = false;
-bool ifft_output = false;
-bool one_shot = false;
-volatile bool sweep_started = false;
-
-int fftSize = 20;
-double fft_bin_width;
-fftwf_complex *fftwIn = NULL;
-fftwf_complex *fftwOut = NULL;
-fftwf_plan fftwPlan = NULL;
-fftwf_complex *ifftwIn = NULL;
-fftwf_complex *ifftwOut = NULL;
-fftwf_plan ifftwPlan = NULL;
-uint32_t ifft_idx = 0;
-float* pwr;
-float* window;
-
-float logPower(fftwf_complex in, float scale)
-{
-	float re = in[0] * scale;
-	float im = in[1] * scale;
-	float magsq = re * re + im * im;
-	return log2f(magsq) * 10.0f / log2(10.0f);
-}
+    if (list != NULL)
+        hackrf_device_list_free(list);
 
+    free(serial);
 
-int probe_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
-        char *msg, char **uuid, simple_cap_proto_frame_t *frame,
-        cf_params_interface_t **ret_interface,
-        cf_params_spectrum_t **ret_spectrum) {
+    return ret;
+}
+
+static int hackrf_is_definition(char *definition, char *msg) {
     char *placeholder = NULL;
     int placeholder_len;
-    char *interface = NULL;
-    char *serial = NULL;
-    char errstr[STATUS_MAX];
-    hackrf_device_list_t *list;
-    int x;
-
-    *ret_spectrum = cf_params_spectrum_new();
-    *ret_interface = NULL;
 
     if ((placeholder_len = cf_parse_interface(&placeholder, definition)) <= 0) {
         snprintf(msg, STATUS_MAX, "Unable to find interface in definition"); 
         return 0;
     }
 
-    interface = strndup(placeholder, placeholder_len);
-
-    // All hackrfsweeps use 'hackrf' as the interface
-    if (strcmp(interface, "hackrf") != 0) {
+    /* All hackrf sweeps use 'hackrf' as the interface */
+    if (placeholder_len != strlen("hackrf") || 
+            strncmp(placeholder, "hackrf", placeholder_len) != 0) {
         snprintf(msg, STATUS_MAX, "Doesn't look like a hackrf");
         return 0;
     }
 
+    return 1;
+}
+
+static unsigned long hackrf_flag_ul(char *definition, const char *flag, 
+        unsigned long dfl) {
+    char *placeholder = NULL;
+    int placeholder_len;
+    char buf[32];
+
+    if ((placeholder_len = cf_find_flag(&placeholder, flag, definition)) <= 0 ||
+            placeholder_len >= (int) sizeof(buf))
+        return dfl;
+
+    memcpy(buf, placeholder, placeholder_len);
+    buf[placeholder_len] = 0;
+
+    return strtoul(buf, NULL, 10);
+}
+
+static void hackrf_close_local(local_hackrf_t *local_hackrf) {
+    if (local_hackrf->device != NULL) {
+        hackrf_stop_rx(local_hackrf->device);
+        hackrf_close(local_hackrf->device);
+        local_hackrf->device = NULL;
+    }
+
+    if (local_hackrf->fftw_plan != NULL) {
+        fftwf_destroy_plan(local_hackrf->fftw_plan);
+        local_hackrf->fftw_plan = NULL;
+    }
+
+    fftwf_free(local_hackrf->fftw_in);
+    local_hackrf->fftw_in = NULL;
+    fftwf_free(local_hackrf->fftw_out);
+    local_hackrf->fftw_out = NULL;
+
+    free(local_hackrf->pwr);
+    local_hackrf->pwr = NULL;
+    free(local_hackrf->window);
+    local_hackrf->window = NULL;
+    free(local_hackrf->sweep);
+    local_hackrf->sweep = NULL;
+
+    free(local_hackrf->serial);
+    local_hackrf->serial = NULL;
+
+    local_hackrf->sweep_started = 0;
+}
+
+int probe_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
+        char *msg, char **uuid, KismetExternal__Command *frame,
+        cf_params_interface_t **ret_interface,
+        cf_params_spectrum_t **ret_spectrum) {
+    char *serial;
+
+    *ret_interface = NULL;
+    *ret_spectrum = NULL;
+    *uuid = NULL;
+
+    if (!hackrf_is_definition(definition, msg))
+        return 0;
 
     if (hackrf_init() != HACKRF_SUCCESS) {
         snprintf(msg, STATUS_MAX, "hackrf_sweep could not initialize libhackrf");
         return 0;
     }
 
-    list = hackrf_device_list();
+    serial = hackrf_find_serial(definition, msg);
+
+    hackrf_exit();
 
-    if (list == NULL) {
+    if (serial == NULL)
         return 0;
+
+    hackrf_uuid(serial, uuid);
+    free(serial);
+
+    *ret_spectrum = cf_params_spectrum_new();
+
+    return 1;
+}
+
+int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
+        char *msg, uint32_t *dlt, char **uuid, KismetExternal__Command *frame,
+        cf_params_interface_t **ret_interface,
+        cf_params_spectrum_t **ret_spectrum) {
+    local_hackrf_t *local_hackrf = (local_hackrf_t *) caph->userdata;
+
+    char *placeholder = NULL;
+    int placeholder_len;
+
+    unsigned long start_mhz, end_mhz, bin_width;
+    unsigned long step_count;
+    int r, i;
+
+    *ret_interface = cf_params_interface_new();
+    *ret_spectrum = NULL;
+    *uuid = NULL;
+    *dlt = 0;
+
+    /* Clean up any old state */
+    hackrf_close_local(local_hackrf);
+
+    if (!hackrf_is_definition(definition, msg))
+        return -1;
+
+    start_mhz = hackrf_flag_ul(definition, "start_mhz", 2400);
+    end_mhz = hackrf_flag_ul(definition, "end_mhz", 2500);
+    bin_width = hackrf_flag_ul(definition, "bin_width", 1000000);
+
+    if (start_mhz >= end_mhz || end_mhz > FREQ_MAX_MHZ) {
+        snprintf(msg, STATUS_MAX, "invalid sweep range %lu-%luMHz, the range must be "
+                "within %d-%dMHz", start_mhz, end_mhz, FREQ_MIN_MHZ, FREQ_MAX_MHZ);
+        return -1;
     }
 
-    if (list->devicecount == 0)
-        return 0;
+    /* Round the end up to a whole number of tuning steps, as hackrf_sweep does */
+    step_count = 1 + (end_mhz - start_mhz - 1) / TUNE_STEP;
+    end_mhz = start_mhz + step_count * TUNE_STEP;
 
+    if (end_mhz > FREQ_MAX_MHZ) {
+        snprintf(msg, STATUS_MAX, "sweep range %lu-%luMHz, rounded up to whole %lluMHz "
+                "tuning steps, ends above %dMHz", start_mhz, end_mhz, TUNE_STEP,
+                FREQ_MAX_MHZ);
+        return -1;
+    }
 
-    // Figure out if we have a serial #
-    if ((placeholder_len = cf_find_flag(&placeholder, "serial", definition)) > 0) {
-        serial = strndup(placeholder, placeholder_len);
-    } 
+    local_hackrf->frequencies[0] = (uint16_t) start_mhz;
+    local_hackrf->frequencies[1] = (uint16_t) end_mhz;
 
-    if (serial == NULL && list->devicecount != 1) {
-        snprintf(msg, STATUS_MAX, "multiple hackrf devices found, specify serial number");
-        hackrf_device_list_free(list);
-        hackrf_exit();
-        return 0;
+    if (bin_width == 0 || DEFAULT_SAMPLE_RATE_HZ / bin_width < 4 ||
+            DEFAULT_SAMPLE_RATE_HZ / bin_width > 8180) {
+        snprintf(msg, STATUS_MAX, "invalid bin_width %luHz, must be between %d and %dHz",
+                bin_width, DEFAULT_SAMPLE_RATE_HZ / 8180, DEFAULT_SAMPLE_RATE_HZ / 4);
+        return -1;
     }
 
-    for (x = 0; x < list->devicecount; x++) {
-        if (strcmp(serial, list->serial_numbers[x]) == 0) {
-            unsigned long s;
-            if (sscanf(serial, "%lx", &s) == 1) {
-                /* Make a spoofed, but consistent, UUID based on the adler32 of the 
-                 * capture name and the serial of the device */
-                snprintf(errstr, STATUS_MAX, "%08X-0000-0000-%04lX-%12lX",
-                        adler32_csum((unsigned char *) "kismet_cap_hackrf_sweep", 
-                            strlen("kismet_cap_hackrf_sweep")) & 0xFFFFFFFF,
-                        (s >> 48) & 0xFFFF, s & 0xFFFFFFFFFFFF);
-                *uuid = strdup(errstr);
-
-                hackrf_device_list_free(list);
-                hackrf_exit();
-
-                return 1;
-            }
+    /* The FFT size is kept at a multiple of 8 less 4 so that the quarter bands
+     * used from each FFT fall on whole bins */
+    local_hackrf->fft_size = DEFAULT_SAMPLE_RATE_HZ / bin_width;
+    while ((local_hackrf->fft_size + 4) % 8)
+        local_hackrf->fft_size++;
+
+    local_hackrf->fft_bin_width = 
+        (double) DEFAULT_SAMPLE_RATE_HZ / local_hackrf->fft_size;
+
+    /* Each 5MHz quarter band holds fft_size / 4 bins */
+    local_hackrf->sweep_bins =
+        (end_mhz - start_mhz) * FREQ_ONE_MHZ / (DEFAULT_SAMPLE_RATE_HZ / 4) * 
+        (local_hackrf->fft_size / 4);
+
+    if (local_hackrf->sweep_bins > HACKRF_MAX_SWEEP_BINS) {
+        snprintf(msg, STATUS_MAX, "sweep range %lu-%luMHz at %.0fHz per bin needs %lu bins, "
+                "more than the maximum of %d; narrow the range or increase bin_width",
+                start_mhz, end_mhz, local_hackrf->fft_bin_width, 
+                (unsigned long) local_hackrf->sweep_bins, HACKRF_MAX_SWEEP_BINS);
+        return -1;
+    }
 
-        }
+    local_hackrf->lna_gain = hackrf_flag_ul(definition, "lna_gain", 16);
+    local_hackrf->vga_gain = hackrf_flag_ul(definition, "vga_gain", 20);
+
+    /* Gains are set in fixed steps */
+    local_hackrf->lna_gain -= local_hackrf->lna_gain % 8;
+    local_hackrf->vga_gain -= local_hackrf->vga_gain % 2;
 
+    if (local_hackrf->lna_gain > 40 || local_hackrf->vga_gain > 62) {
+        snprintf(msg, STATUS_MAX, "invalid gain, lna_gain must be 0-40 and vga_gain "
+                "0-62");
+        return -1;
     }
 
-    hackrf_device_list_free(list);
-    hackrf_exit();
+    local_hackrf->amp = 0;
+    if ((placeholder_len = cf_find_flag(&placeholder, "amp", definition)) > 0) {
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0)
+            local_hackrf->amp = 1;
+    }
 
-    return 0;
-}
+    if (hackrf_init() != HACKRF_SUCCESS) {
+        snprintf(msg, STATUS_MAX, "hackrf_sweep could not initialize libhackrf");
+        return -1;
+    }
 
-int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
-        char *msg, uint32_t *dlt, char **uuid, simple_cap_proto_frame_t *frame,
-        cf_params_interface_t **ret_interface,
-        cf_params_spectrum_t **ret_spectrum) {
+    if ((local_hackrf->serial = hackrf_find_serial(definition, msg)) == NULL)
+        return -1;
 
-    return 0;
+    if ((r = hackrf_open_by_serial(local_hackrf->serial, &local_hackrf->device)) != 
+            HACKRF_SUCCESS) {
+        snprintf(msg, STATUS_MAX, "unable to open hackrf %s: %s", local_hackrf->serial,
+                hackrf_error_name((enum hackrf_error) r));
+        local_hackrf->device = NULL;
+        return -1;
+    }
+
+    if ((r = hackrf_set_sample_rate_manual(local_hackrf->device, 
+                    DEFAULT_SAMPLE_RATE_HZ, 1)) != HACKRF_SUCCESS ||
+            (r = hackrf_set_baseband_filter_bandwidth(local_hackrf->device,
+                DEFAULT_BASEBAND_FILTER_BANDWIDTH)) != HACKRF_SUCCESS ||
+            (r = hackrf_set_vga_gain(local_hackrf->device, 
+                local_hackrf->vga_gain)) != HACKRF_SUCCESS ||
+            (r = hackrf_set_lna_gain(local_hackrf->device, 
+                local_hackrf->lna_gain)) != HACKRF_SUCCESS ||
+            (r = hackrf_set_amp_enable(local_hackrf->device, 
+                local_hackrf->amp)) != HACKRF_SUCCESS) {
+        snprintf(msg, STATUS_MAX, "unable to configure hackrf %s: %s", 
+                local_hackrf->serial, hackrf_error_name((enum hackrf_error) r));
+        hackrf_close_local(local_hackrf);
+        return -1;
+    }
+
+    if ((r = hackrf_init_sweep(local_hackrf->device, local_hackrf->frequencies, 1,
+                    BYTES_PER_BLOCK, TUNE_STEP * FREQ_ONE_MHZ, OFFSET, 
+                    INTERLEAVED)) != HACKRF_SUCCESS) {
+        snprintf(msg, STATUS_MAX, "unable to configure sweep on hackrf %s: %s",
+                local_hackrf->serial, hackrf_error_name((enum hackrf_error) r));
+        hackrf_close_local(local_hackrf);
+        return -1;
+    }
+
+    local_hackrf->fftw_in = 
+        (fftwf_complex *) fftwf_malloc(sizeof(fftwf_complex) * local_hackrf->fft_size);
+    local_hackrf->fftw_out =
+        (fftwf_complex *) fftwf_malloc(sizeof(fftwf_complex) * local_hackrf->fft_size);
+    local_hackrf->pwr = (float *) malloc(sizeof(float) * local_hackrf->fft_size);
+    local_hackrf->window = (float *) malloc(sizeof(float) * local_hackrf->fft_size);
+    local_hackrf->sweep = 
+        (int32_t *) malloc(sizeof(int32_t) * local_hackrf->sweep_bins);
+
+    if (local_hackrf->fftw_in == NULL || local_hackrf->fftw_out == NULL ||
+            local_hackrf->pwr == NULL || local_hackrf->window == NULL ||
+            local_hackrf->sweep == NULL) {
+        snprintf(msg, STATUS_MAX, "unable to allocate FFT buffers");
+        hackrf_close_local(local_hackrf);
+        return -1;
+    }
+
+    local_hackrf->fftw_plan = fftwf_plan_dft_1d(local_hackrf->fft_size, 
+            local_hackrf->fftw_in, local_hackrf->fftw_out, FFTW_FORWARD, FFTW_MEASURE);
+
+    /* Hann window */
+    for (i = 0; i < local_hackrf->fft_size; i++) {
+        local_hackrf->window[i] = 
+            (float) (0.5f * (1.0f - cos(2 * M_PI * i / (local_hackrf->fft_size - 1))));
+    }
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "uuid", definition)) > 0) {
+        *uuid = strndup(placeholder, placeholder_len);
+    } else {
+        hackrf_uuid(local_hackrf->serial, uuid);
+    }
+
+    /* Declare the range; sweeps are stitched into it on the server */
+    *ret_spectrum = cf_params_spectrum_new();
+    (*ret_spectrum)->start_mhz = start_mhz;
+    (*ret_spectrum)->end_mhz = end_mhz;
+    (*ret_spectrum)->samples_per_freq = local_hackrf->fft_size;
+    (*ret_spectrum)->bin_width = (uint64_t) local_hackrf->fft_bin_width;
+    (*ret_spectrum)->amp = local_hackrf->amp;
+    (*ret_spectrum)->if_amp = local_hackrf->lna_gain;
+    (*ret_spectrum)->baseband_amp = local_hackrf->vga_gain;
+
+    snprintf(msg, STATUS_MAX, "Opened hackrf %s sweeping %lu-%luMHz in %lu %.0fHz bins",
+            local_hackrf->serial, start_mhz, end_mhz, 
+            (unsigned long) local_hackrf->sweep_bins, local_hackrf->fft_bin_width);
+
+    return 1;
 }
 
 int list_callback(kis_capture_handler_t *caph, uint32_t seqno,
-        char *msg, char ***interfaces, char ***flags) {
-
+        char *msg, cf_params_list_interface_t ***interfaces) {
     char errstr[STATUS_MAX];
     hackrf_device_list_t *list;
+    int x, num_devs = 0;
 
     *interfaces = NULL;
-    *flags = NULL;
-
-    int x = 0;
 
     if (hackrf_init() != HACKRF_SUCCESS) {
         snprintf(msg, STATUS_MAX, "hackrf_sweep could not initialize libhackrf");
@@ -336,59 +560,177 @@ int list_callback(kis_capture_handler_t *caph, uint32_t seqno,
 
     list = hackrf_device_list();
 
-    if (list == NULL) {
+    if (list == NULL || list->devicecount == 0) {
+        if (list != NULL)
+            hackrf_device_list_free(list);
+        hackrf_exit();
         return 0;
     }
 
-    if (list->devicecount == 0)
-        return 0;
-
-    *interfaces = (char **) malloc(sizeof(char *) * list->devicecount);
-    *flags = (char **) malloc(sizeof(char *) * list->devicecount);
+    *interfaces = (cf_params_list_interface_t **) 
+        malloc(sizeof(cf_params_list_interface_t *) * list->devicecount);
 
     for (x = 0; x < list->devicecount; x++) {
-        *interfaces[x] = strdup("hackrf");
+        if (list->serial_numbers[x] == NULL)
+            continue;
+
+        (*interfaces)[num_devs] = 
+            (cf_params_list_interface_t *) malloc(sizeof(cf_params_list_interface_t));
+        memset((*interfaces)[num_devs], 0, sizeof(cf_params_list_interface_t));
 
         snprintf(errstr, STATUS_MAX, "serial=%s", list->serial_numbers[x]);
-        *flags[x] = strdup(errstr);
-    }
 
-    x = list->devicecount;
+        (*interfaces)[num_devs]->interface = strdup("hackrf");
+        (*interfaces)[num_devs]->flags = strdup(errstr);
+        (*interfaces)[num_devs]->hardware = strdup("hackrf");
 
-    hackrf_device_list_free(list);
+        num_devs++;
+    }
 
+    hackrf_device_list_free(list);
     hackrf_exit();
 
-    return x;
+    return num_devs;
 }
 
-void capture_thread(kis_capture_handler_t *caph) {
+static void send_sweep(local_hackrf_t *local_hackrf) {
+    int ret;
 
+    /* Sweeps are sent from the libusb transfer thread; rather than stall the
+     * radio when the write buffer is full, drop the sweep */
+    ret = cf_send_spectrum(local_hackrf->caph, local_hackrf->sweep_ts,
+            local_hackrf->frequencies[0], local_hackrf->frequencies[1],
+            local_hackrf->fft_bin_width, local_hackrf->sweep, local_hackrf->sweep_bins);
 
+    if (ret < 0) {
+        cf_send_error(local_hackrf->caph, 0, "unable to send spectrum sweep");
+        cf_handler_spindown(local_hackrf->caph);
+    }
 }
 
-#endif
+/* Place a quarter band of FFT bins starting at freq_hz in the sweep */
+static void place_bins(local_hackrf_t *local_hackrf, uint64_t freq_hz, const float *pwr) {
+    uint64_t start_hz = local_hackrf->frequencies[0] * FREQ_ONE_MHZ;
+    size_t n = local_hackrf->fft_size / 4;
+    size_t offt, i;
+
+    if (freq_hz < start_hz)
+        return;
+
+    offt = (size_t) llround((freq_hz - start_hz) / local_hackrf->fft_bin_width);
+
+    if (offt >= local_hackrf->sweep_bins)
+        return;
+
+    if (offt + n > local_hackrf->sweep_bins)
+        n = local_hackrf->sweep_bins - offt;
+
+    for (i = 0; i < n; i++) {
+        if (isfinite(pwr[i]) && pwr[i] > HACKRF_POWER_FLOOR)
+            local_hackrf->sweep[offt + i] = (int32_t) lrintf(pwr[i]);
+        else
+            local_hackrf->sweep[offt + i] = HACKRF_POWER_FLOOR;
+    }
+}
+
+static int rx_callback(hackrf_transfer *transfer) {
+    local_hackrf_t *local_hackrf = (local_hackrf_t *) transfer->rx_ctx;
+    int fft_size = local_hackrf->fft_size;
+    int8_t *buf = (int8_t *) transfer->buffer;
+    uint8_t *ubuf;
+    uint64_t frequency;
+    size_t i;
+    int j, k;
+
+    if (local_hackrf->caph->spindown)
+        return -1;
+
+    for (j = 0; j < BLOCKS_PER_TRANSFER; j++) {
+        ubuf = (uint8_t *) buf;
+
+        /* Each block starts with a header holding the tuned frequency */
+        if (ubuf[0] != 0x7F || ubuf[1] != 0x7F) {
+            buf += BYTES_PER_BLOCK;
+            continue;
+        }
+
+        frequency = ((uint64_t) ubuf[9] << 56) | ((uint64_t) ubuf[8] << 48) |
+            ((uint64_t) ubuf[7] << 40) | ((uint64_t) ubuf[6] << 32) |
+            ((uint64_t) ubuf[5] << 24) | ((uint64_t) ubuf[4] << 16) |
+            ((uint64_t) ubuf[3] << 8) | ubuf[2];
+
+        /* Returning to the start of the range completes the previous sweep */
+        if (frequency == FREQ_ONE_MHZ * local_hackrf->frequencies[0]) {
+            if (local_hackrf->sweep_started)
+                send_sweep(local_hackrf);
+
+            local_hackrf->sweep_started = 1;
+            gettimeofday(&local_hackrf->sweep_ts, NULL);
+
+            for (i = 0; i < local_hackrf->sweep_bins; i++)
+                local_hackrf->sweep[i] = HACKRF_POWER_FLOOR;
+        }
+
+        if (!local_hackrf->sweep_started || frequency > FREQ_ONE_MHZ * FREQ_MAX_MHZ) {
+            buf += BYTES_PER_BLOCK;
+            continue;
+        }
+
+        /* Only the end of the block is used, after the tuning has settled */
+        buf += BYTES_PER_BLOCK - (fft_size * 2);
+
+        for (k = 0; k < fft_size; k++) {
+            local_hackrf->fftw_in[k][0] = buf[k * 2] * local_hackrf->window[k] * 1.0f / 128.0f;
+            local_hackrf->fftw_in[k][1] = buf[k * 2 + 1] * local_hackrf->window[k] * 1.0f / 128.0f;
+        }
+
+        buf += fft_size * 2;
+
+        fftwf_execute(local_hackrf->fftw_plan);
 
+        for (k = 0; k < fft_size; k++)
+            local_hackrf->pwr[k] = log_power(local_hackrf->fftw_out[k], 1.0f / fft_size);
+
+        /* Each tuning covers two non-adjacent quarter bands, as in hackrf_sweep */
+        place_bins(local_hackrf, frequency, 
+                &local_hackrf->pwr[1 + (fft_size * 5) / 8]);
+        place_bins(local_hackrf, frequency + DEFAULT_SAMPLE_RATE_HZ / 2,
+                &local_hackrf->pwr[1 + fft_size / 8]);
+    }
+
+    return 0;
+}
+
+void capture_thread(kis_capture_handler_t *caph) {
+    local_hackrf_t *local_hackrf = (local_hackrf_t *) caph->userdata;
+    char errstr[STATUS_MAX];
+    int r;
+
+    if ((r = hackrf_start_rx_sweep(local_hackrf->device, rx_callback, local_hackrf)) !=
+            HACKRF_SUCCESS) {
+        snprintf(errstr, STATUS_MAX, "unable to start sweep on hackrf %s: %s",
+                local_hackrf->serial, hackrf_error_name((enum hackrf_error) r));
+        cf_send_error(caph, 0, errstr);
+        cf_handler_spindown(caph);
+        return;
+    }
+
+    while (!caph->spindown && hackrf_is_streaming(local_hackrf->device) == HACKRF_TRUE)
+        sleep(1);
+
+    if (!caph->spindown) {
+        snprintf(errstr, STATUS_MAX, "hackrf %s stopped sweeping", local_hackrf->serial);
+        cf_send_error(caph, 0, errstr);
+        cf_handler_spindown(caph);
+    }
+}
 
 int main(int argc, char *argv[]) {
-#if 0
-    local_wifi_t local_wifi = {
-        .pd = NULL,
-        .interface = NULL,
-        .cap_interface = NULL,
-        .datalink_type = -1,
-        .override_dlt = -1,
-        .use_mac80211_vif = 1,
-        .use_mac80211_channels = 1,
-        .mac80211_cache = NULL,
-        .mac80211_handle = NULL,
-        .mac80211_family = NULL,
-        .seq_channel_failure = 0,
-        .reset_nm_management = 0,
-    };
-#endif
+    local_hackrf_t local_hackrf;
 
-    kis_capture_handler_t *caph = cf_handler_init("hackrfsweep");
+    memset(&local_hackrf, 0, sizeof(local_hackrf_t));
+
+    kis_capture_handler_t *caph = cf_handler_init("hackrf_sweep");
 
     if (caph == NULL) {
         fprintf(stderr, "FATAL: Could not allocate basic handler data, your system "
@@ -396,10 +738,10 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-#if 0
+    local_hackrf.caph = caph;
+
     /* Set the local data ptr */
-    cf_handler_set_userdata(caph, &local_wifi);
-#endif
+    cf_handler_set_userdata(caph, &local_hackrf);
 
     /* Set the callback for opening  */
     cf_handler_set_open_cb(caph, open_callback);
@@ -418,10 +760,17 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
+    /* Support remote capture by launching the remote loop */
+    cf_handler_remote_capture(caph);
+
     cf_handler_loop(caph);
 
+    hackrf_close_local(&local_hackrf);
+    hackrf_exit();
+
     cf_handler_free(caph);
 
     return 1;
 }
 
+#endif
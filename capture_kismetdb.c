@@ -57,8 +57,8 @@ typedef struct {
     /* Database version */
     int db_version;
 
-    int realtime;
-    struct timeval last_ts;
+    /* Realtime or accelerated replay */
+    cf_replay_clock_t replay;
 
     unsigned int pps_throttle;
 } local_pcap_t;
@@ -245,12 +245,22 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
     /* Successful open with no channel, hop, or chanset data */
     snprintf(msg, STATUS_MAX, "Opened kismetdb '%s' for playback", dbname);
 
-    if ((placeholder_len = cf_find_flag(&placeholder, "realtime", definition)) > 0) {
+    cf_replay_init(&local_pcap->replay, 0);
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "speed", definition)) > 0) {
+        double speed;
+        if (sscanf(placeholder, "%lf", &speed) == 1 && speed > 0) {
+            snprintf(errstr, 4096,
+                    "kismetdb '%s' will replay at %.2fx speed", dbname, speed);
+            cf_send_message(caph, errstr, MSGFLAG_INFO);
+            cf_replay_init(&local_pcap->replay, speed);
+        }
+    } else if ((placeholder_len = cf_find_flag(&placeholder, "realtime", definition)) > 0) {
         if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
             snprintf(errstr, 4096, 
                     "kismetdb '%s' will replay in realtime", dbname);
             cf_send_message(caph, errstr, MSGFLAG_INFO);
-            local_pcap->realtime = 1;
+            cf_replay_init(&local_pcap->replay, 1);
         }
     } else if ((placeholder_len = cf_find_flag(&placeholder, "pps", definition)) > 0) {
         unsigned int pps;
@@ -273,43 +283,21 @@ void kismetdb_dispatch_packet_cb(u_char *user, long ts_sec, long ts_usec,
     local_pcap_t *local_pcap = (local_pcap_t *) caph->userdata;
     int ret;
     unsigned long delay_usec = 0;
+    struct timeval replay_ts;
 
     KismetDatasource__SubGps kegps;
 
     kismet_datasource__sub_gps__init(&kegps);
 
-    /* If we're doing 'realtime' playback, delay accordingly based on the
-     * previous packet. 
+    /* If we're doing realtime or accelerated playback, wait until the packet is
+     * due.
      *
      * Because we're in our own thread, we can block as long as we want - this
      * simulates blocking IO for capturing from hardware, too.
      */
-    if (local_pcap->realtime) {
-        if (local_pcap->last_ts.tv_sec == 0 && local_pcap->last_ts.tv_usec == 0) {
-            delay_usec = 0;
-        } else {
-            /* Catch packets with inconsistent times */
-            if (ts_sec < local_pcap->last_ts.tv_sec) {
-                delay_usec = 0;
-            } else {
-                delay_usec = (ts_sec - local_pcap->last_ts.tv_sec) * 1000000L;
-            }
-
-            if (ts_usec < local_pcap->last_ts.tv_usec) {
-                delay_usec += (1000000L - local_pcap->last_ts.tv_usec) + ts_usec;
-            } else {
-                delay_usec += ts_usec - local_pcap->last_ts.tv_usec;
-            }
-
-        }
-
-        local_pcap->last_ts.tv_sec = ts_sec;
-        local_pcap->last_ts.tv_usec = ts_usec;
-
-        if (delay_usec != 0) {
-            usleep(delay_usec);
-        }
-    }
+    replay_ts.tv_sec = ts_sec;
+    replay_ts.tv_usec = ts_usec;
+    cf_replay_wait(&local_pcap->replay, replay_ts);
 
     /* If we're doing 'packet per second' throttling, delay accordingly */
     if (local_pcap->pps_throttle > 0) {
@@ -375,42 +363,20 @@ void kismetdb_dispatch_data_cb(u_char *user, long ts_sec, long ts_usec,
     local_pcap_t *local_pcap = (local_pcap_t *) caph->userdata;
     int ret;
     unsigned long delay_usec = 0;
+    struct timeval replay_ts;
 
     KismetDatasource__SubGps kegps;
     kismet_datasource__sub_gps__init(&kegps);
 
-    /* If we're doing 'realtime' playback, delay accordingly based on the
-     * previous packet. 
+    /* If we're doing realtime or accelerated playback, wait until the packet is
+     * due.
      *
      * Because we're in our own thread, we can block as long as we want - this
      * simulates blocking IO for capturing from hardware, too.
      */
-    if (local_pcap->realtime) {
-        if (local_pcap->last_ts.tv_sec == 0 && local_pcap->last_ts.tv_usec == 0) {
-            delay_usec = 0;
-        } else {
-            /* Catch packets with inconsistent times */
-            if (ts_sec < local_pcap->last_ts.tv_sec) {
-                delay_usec = 0;
-            } else {
-                delay_usec = (ts_sec - local_pcap->last_ts.tv_sec) * 1000000L;
-            }
-
-            if (ts_usec < local_pcap->last_ts.tv_usec) {
-                delay_usec += (1000000L - local_pcap->last_ts.tv_usec) + ts_usec;
-            } else {
-                delay_usec += ts_usec - local_pcap->last_ts.tv_usec;
-            }
-
-        }
-
-        local_pcap->last_ts.tv_sec = ts_sec;
-        local_pcap->last_ts.tv_usec = ts_usec;
-
-        if (delay_usec != 0) {
-            usleep(delay_usec);
-        }
-    }
+    replay_ts.tv_sec = ts_sec;
+    replay_ts.tv_usec = ts_usec;
+    cf_replay_wait(&local_pcap->replay, replay_ts);
 
     /* If we're doing 'packet per second' throttling, delay accordingly */
     if (local_pcap->pps_throttle > 0) {
@@ -661,9 +627,8 @@ int main(int argc, char *argv[]) {
         .dbname = NULL,
         .sub_uuid = NULL,
         .sub_dlt = 0,
-        .realtime = 0,
-        .last_ts.tv_sec = 0,
-        .last_ts.tv_usec = 0,
+        .replay.speed = 0,
+        .replay.started = 0,
         .pps_throttle = 0,
     };
 
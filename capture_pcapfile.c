@@ -74,8 +74,8 @@ typedef struct {
     int datalink_type;
     int override_dlt;
 
-    int realtime;
-    struct timeval last_ts;
+    /* Realtime or accelerated replay */
+    cf_replay_clock_t replay;
 
     unsigned int pps_throttle;
 } local_pcap_t;
@@ -218,12 +218,22 @@ int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
     /* Successful open with no channel, hop, or chanset data */
     snprintf(msg, STATUS_MAX, "Opened pcapfile '%s' for playback", pcapfname);
 
-    if ((placeholder_len = cf_find_flag(&placeholder, "realtime", definition)) > 0) {
+    cf_replay_init(&local_pcap->replay, 0);
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "speed", definition)) > 0) {
+        double speed;
+        if (sscanf(placeholder, "%lf", &speed) == 1 && speed > 0) {
+            snprintf(errstr, PCAP_ERRBUF_SIZE,
+                    "Pcapfile '%s' will replay at %.2fx speed", pcapfname, speed);
+            cf_send_message(caph, errstr, MSGFLAG_INFO);
+            cf_replay_init(&local_pcap->replay, speed);
+        }
+    } else if ((placeholder_len = cf_find_flag(&placeholder, "realtime", definition)) > 0) {
         if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
             snprintf(errstr, PCAP_ERRBUF_SIZE, 
                     "Pcapfile '%s' will replay in realtime", pcapfname);
             cf_send_message(caph, errstr, MSGFLAG_INFO);
-            local_pcap->realtime = 1;
+            cf_replay_init(&local_pcap->replay, 1);
         }
     } else if ((placeholder_len = cf_find_flag(&placeholder, "pps", definition)) > 0) {
         unsigned int pps;
@@ -245,39 +255,13 @@ void pcap_dispatch_cb(u_char *user, const struct pcap_pkthdr *header,
     int ret;
     unsigned long delay_usec = 0;
 
-    /* If we're doing 'realtime' playback, delay accordingly based on the
-     * previous packet. 
+    /* If we're doing realtime or accelerated playback, wait until the packet is
+     * due.
      *
      * Because we're in our own thread, we can block as long as we want - this
      * simulates blocking IO for capturing from hardware, too.
      */
-    if (local_pcap->realtime) {
-        if (local_pcap->last_ts.tv_sec == 0 && local_pcap->last_ts.tv_usec == 0) {
-            delay_usec = 0;
-        } else {
-            /* Catch corrupt pcaps w/ inconsistent times */
-            if (header->ts.tv_sec < local_pcap->last_ts.tv_sec) {
-                delay_usec = 0;
-            } else {
-                delay_usec = (header->ts.tv_sec - local_pcap->last_ts.tv_sec) * 1000000L;
-            }
-
-            if (header->ts.tv_usec < local_pcap->last_ts.tv_usec) {
-                delay_usec += (1000000L - local_pcap->last_ts.tv_usec) + 
-                    header->ts.tv_usec;
-            } else {
-                delay_usec += header->ts.tv_usec - local_pcap->last_ts.tv_usec;
-            }
-
-        }
-
-        local_pcap->last_ts.tv_sec = header->ts.tv_sec;
-        local_pcap->last_ts.tv_usec = header->ts.tv_usec;
-
-        if (delay_usec != 0) {
-            usleep(delay_usec);
-        }
-    }
+    cf_replay_wait(&local_pcap->replay, header->ts);
 
     /* If we're doing 'packet per second' throttling, delay accordingly */
     if (local_pcap->pps_throttle > 0) {
@@ -339,9 +323,8 @@ int main(int argc, char *argv[]) {
         .pcapfname = NULL,
         .datalink_type = -1,
         .override_dlt = -1,
-        .realtime = 0,
-        .last_ts.tv_sec = 0,
-        .last_ts.tv_usec = 0,
+        .replay.speed = 0,
+        .replay.started = 0,
         .pps_throttle = 0,
     };
 
@@ -0,0 +1,616 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* capture_rtladsb_iq
+ *
+ * Capture binary, written in pure C, which demodulates ADSB from a recording of
+ * 8-bit unsigned IQ at 2Msps on 1090MHz, such as one made with
+ *
+ *   rtl_sdr -f 1090000000 -s 2000000 recording.cu8
+ *
+ * and sends the decoded messages to the rtladsb phy as the same JSON records
+ * generated by the python rtladsb capture helper.
+ *
+ * This allows the ADSB demodulation to be tested and benchmarked without a radio.
+ * By default the recording is demodulated as fast as possible; the 'realtime'
+ * source option throttles it to the sample rate of the recording.
+ *
+ * Only files ending in .cu8 are claimed when probing; other file names must be
+ * opened with an explicit type=rtladsbiq source option.
+ *
+ * When built with librtlsdr, the same demodulator also reads live rtlsdr radios
+ * named rtladsb-<index or serial>, replacing the python helper for rtladsb
+ * sources.  The gain (tenths of a dB, negative for automatic), ppm, and biastee
+ * source options match the python helper.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <fcntl.h>
+
+/* According to POSIX.1-2001, POSIX.1-2008 */
+#include <sys/select.h>
+
+/* According to earlier standards */
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "capture_framework.h"
+#include "rtladsb_demod.h"
+
+#ifdef HAVE_LIBRTLSDR
+#include <rtl-sdr.h>
+#endif
+
+/* Same read size as the rtlsdr USB buffer used by the python helper */
+#define IQ_BLOCK_SZ     (16 * 16384)
+
+/* Same number of USB buffers as the python helper */
+#define RTL_NUM_BUFS    12
+
+#define RTL_CHANNEL     "1090.000MHz"
+
+typedef struct {
+    FILE *iqfile;
+    char *iqfname;
+
+    int realtime;
+
+    rtladsb_demod_t demod;
+    uint8_t *iqbuf;
+
+#ifdef HAVE_LIBRTLSDR
+    rtlsdr_dev_t *rtlradio;
+    int rtlnum;
+#endif
+} local_iq_t;
+
+static int iq_name_ok(const char *fname) {
+    size_t len = strlen(fname);
+
+    if (len < 4)
+        return 0;
+
+    return strcasecmp(fname + len - 4, ".cu8") == 0;
+}
+
+static void iq_uuid(const char *fname, char **uuid) {
+    char errstr[STATUS_MAX];
+
+    /* Kluge a UUID out of the name */
+    snprintf(errstr, STATUS_MAX, "%08X-0000-0000-0000-0000%08X",
+            adler32_csum((unsigned char *) "kismet_cap_rtladsb_iq",
+                strlen("kismet_cap_rtladsb_iq")) & 0xFFFFFFFF,
+            adler32_csum((unsigned char *) fname,
+                strlen(fname)) & 0xFFFFFFFF);
+    *uuid = strdup(errstr);
+}
+
+static int rtl_name_ok(const char *definition) {
+    return strncmp(definition, "rtladsb-", 8) == 0;
+}
+
+#ifdef HAVE_LIBRTLSDR
+/* Find a radio by serial number or by index; serial numbers are tried first
+ * to handle serials like 00000001 */
+static int rtl_find_device(const char *interface, int interface_len) {
+    char *selector;
+    char *end;
+    long intnum;
+
+    if (interface_len <= 8)
+        return -1;
+
+    selector = strndup(interface + 8, interface_len - 8);
+
+    intnum = rtlsdr_get_index_by_serial(selector);
+
+    if (intnum < 0) {
+        intnum = strtol(selector, &end, 10);
+
+        if (*end != '\0' || intnum < 0 || intnum >= (long) rtlsdr_get_device_count())
+            intnum = -1;
+    }
+
+    free(selector);
+
+    return (int) intnum;
+}
+
+static void rtl_uuid(int intnum, char **uuid) {
+    char manuf[256], product[256], serial[256];
+    char errstr[STATUS_MAX];
+
+    manuf[0] = product[0] = serial[0] = '\0';
+    rtlsdr_get_device_usb_strings(intnum, manuf, product, serial);
+
+    /* Hash the slot, manuf, product, and serial for a unique UUID */
+    snprintf(errstr, STATUS_MAX, "%d%s%s%s", intnum, manuf, product, serial);
+
+    iq_uuid(errstr, uuid);
+}
+
+static void rtl_channels(cf_params_interface_t *interface) {
+    interface->chanset = strdup(RTL_CHANNEL);
+    interface->channels = (char **) malloc(sizeof(char *));
+    interface->channels[0] = strdup(RTL_CHANNEL);
+    interface->channels_len = 1;
+}
+
+static int rtl_open_radio(local_iq_t *local_iq, char *definition, char *msg) {
+    char *placeholder = NULL;
+    int placeholder_len;
+    rtlsdr_dev_t *radio;
+    int gain = -1, ppm = 0, biastee = 0;
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "gain", definition)) > 0)
+        gain = atoi(placeholder);
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "ppm", definition)) > 0)
+        ppm = atoi(placeholder);
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "biastee", definition)) > 0)
+        biastee = strncasecmp(placeholder, "true", placeholder_len) == 0;
+
+    if (rtlsdr_open(&radio, local_iq->rtlnum) != 0) {
+        snprintf(msg, STATUS_MAX, "Could not open rtlsdr radio %d", local_iq->rtlnum);
+        return -1;
+    }
+
+    if (gain >= 0) {
+        if (rtlsdr_set_tuner_gain_mode(radio, 1) != 0 ||
+                rtlsdr_set_tuner_gain(radio, gain) != 0) {
+            snprintf(msg, STATUS_MAX, "Could not set rtlsdr gain %d", gain);
+            goto fail;
+        }
+    } else {
+        if (rtlsdr_set_tuner_gain_mode(radio, 0) != 0 ||
+                rtlsdr_set_agc_mode(radio, 1) != 0) {
+            snprintf(msg, STATUS_MAX, "Could not set rtlsdr automatic gain");
+            goto fail;
+        }
+    }
+
+    if (rtlsdr_set_center_freq(radio, ADSB_FREQ) != 0) {
+        snprintf(msg, STATUS_MAX, "Could not set rtlsdr frequency");
+        goto fail;
+    }
+
+    if (rtlsdr_set_sample_rate(radio, ADSB_RATE) != 0) {
+        snprintf(msg, STATUS_MAX, "Could not set rtlsdr sample rate");
+        goto fail;
+    }
+
+    if (ppm != 0 && rtlsdr_set_freq_correction(radio, ppm) != 0) {
+        snprintf(msg, STATUS_MAX, "Could not set rtlsdr PPM correction %d", ppm);
+        goto fail;
+    }
+
+    if (biastee) {
+#ifdef HAVE_RTLSDR_BIAS_TEE
+        if (rtlsdr_set_bias_tee(radio, 1) != 0) {
+            snprintf(msg, STATUS_MAX, "Could not enable rtlsdr bias-tee");
+            goto fail;
+        }
+#else
+        snprintf(msg, STATUS_MAX, "This librtlsdr does not support bias-tee control");
+        goto fail;
+#endif
+    }
+
+    if (rtlsdr_reset_buffer(radio) != 0) {
+        snprintf(msg, STATUS_MAX, "Could not reset rtlsdr buffer");
+        goto fail;
+    }
+
+    local_iq->rtlradio = radio;
+
+    return 1;
+
+fail:
+    rtlsdr_close(radio);
+    return -1;
+}
+
+int list_callback(kis_capture_handler_t *caph, uint32_t seqno,
+        char *msg, cf_params_list_interface_t ***interfaces) {
+    char manuf[256], product[256], serial[256];
+    char errstr[STATUS_MAX];
+    uint32_t x, num_devs;
+
+    *interfaces = NULL;
+
+    num_devs = rtlsdr_get_device_count();
+
+    if (num_devs == 0)
+        return 0;
+
+    *interfaces = (cf_params_list_interface_t **)
+        malloc(sizeof(cf_params_list_interface_t *) * num_devs);
+
+    for (x = 0; x < num_devs; x++) {
+        manuf[0] = product[0] = serial[0] = '\0';
+        rtlsdr_get_device_usb_strings(x, manuf, product, serial);
+
+        /* Short serials like '1' are often garbage; use the index instead */
+        if (strlen(serial) > 3)
+            snprintf(errstr, STATUS_MAX, "rtladsb-%s", serial);
+        else
+            snprintf(errstr, STATUS_MAX, "rtladsb-%u", x);
+
+        (*interfaces)[x] =
+            (cf_params_list_interface_t *) malloc(sizeof(cf_params_list_interface_t));
+        memset((*interfaces)[x], 0, sizeof(cf_params_list_interface_t));
+
+        (*interfaces)[x]->interface = strdup(errstr);
+        (*interfaces)[x]->hardware = strdup(rtlsdr_get_device_name(x));
+    }
+
+    return num_devs;
+}
+#endif
+
+int probe_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
+        char *msg, char **uuid, KismetExternal__Command *frame,
+        cf_params_interface_t **ret_interface,
+        cf_params_spectrum_t **ret_spectrum) {
+    char *placeholder = NULL;
+    int placeholder_len;
+
+    char *iqfname = NULL;
+
+    struct stat sbuf;
+
+    *uuid = NULL;
+
+    *ret_interface = cf_params_interface_new();
+    *ret_spectrum = NULL;
+
+    /* IQ recordings do not support channel ops */
+    (*ret_interface)->chanset = NULL;
+    (*ret_interface)->channels = NULL;
+    (*ret_interface)->channels_len = 0;
+
+    if ((placeholder_len = cf_parse_interface(&placeholder, definition)) <= 0) {
+        snprintf(msg, STATUS_MAX, "Unable to find IQ file name in definition");
+        return 0;
+    }
+
+    if (rtl_name_ok(placeholder)) {
+#ifdef HAVE_LIBRTLSDR
+        int intnum = rtl_find_device(placeholder, placeholder_len);
+
+        if (intnum < 0)
+            return 0;
+
+        rtl_channels(*ret_interface);
+        (*ret_interface)->hardware = strdup(rtlsdr_get_device_name(intnum));
+
+        if ((placeholder_len = cf_find_flag(&placeholder, "uuid", definition)) > 0) {
+            *uuid = strndup(placeholder, placeholder_len);
+        } else {
+            rtl_uuid(intnum, uuid);
+        }
+
+        return 1;
+#else
+        return 0;
+#endif
+    }
+
+    iqfname = strndup(placeholder, placeholder_len);
+
+    if (!iq_name_ok(iqfname) || stat(iqfname, &sbuf) < 0 || !S_ISREG(sbuf.st_mode)) {
+        free(iqfname);
+        return 0;
+    }
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "uuid", definition)) > 0) {
+        *uuid = strndup(placeholder, placeholder_len);
+    } else {
+        iq_uuid(iqfname, uuid);
+    }
+
+    free(iqfname);
+
+    return 1;
+}
+
+int open_callback(kis_capture_handler_t *caph, uint32_t seqno, char *definition,
+        char *msg, uint32_t *dlt, char **uuid, KismetExternal__Command *frame,
+        cf_params_interface_t **ret_interface,
+        cf_params_spectrum_t **ret_spectrum) {
+    char *placeholder = NULL;
+    int placeholder_len;
+
+    char *iqfname = NULL;
+
+    struct stat sbuf;
+
+    local_iq_t *local_iq = (local_iq_t *) caph->userdata;
+
+    char errstr[STATUS_MAX];
+
+    /* IQ recordings do not support channel ops */
+    *ret_interface = cf_params_interface_new();
+    *ret_spectrum = NULL;
+
+    *uuid = NULL;
+    *dlt = 0;
+
+    /* Clean up any old state */
+    if (local_iq->iqfname != NULL) {
+        free(local_iq->iqfname);
+        local_iq->iqfname = NULL;
+    }
+
+    if (local_iq->iqfile != NULL) {
+        fclose(local_iq->iqfile);
+        local_iq->iqfile = NULL;
+    }
+
+#ifdef HAVE_LIBRTLSDR
+    if (local_iq->rtlradio != NULL) {
+        rtlsdr_close(local_iq->rtlradio);
+        local_iq->rtlradio = NULL;
+    }
+#endif
+
+    rtladsb_demod_reset(&local_iq->demod);
+
+    if ((placeholder_len = cf_parse_interface(&placeholder, definition)) <= 0) {
+        snprintf(msg, STATUS_MAX, "Unable to find IQ file name in definition");
+        return -1;
+    }
+
+    if (rtl_name_ok(placeholder)) {
+#ifdef HAVE_LIBRTLSDR
+        local_iq->iqfname = strndup(placeholder, placeholder_len);
+
+        if ((local_iq->rtlnum = rtl_find_device(placeholder, placeholder_len)) < 0) {
+            snprintf(msg, STATUS_MAX, "Could not find rtlsdr device '%s'",
+                    local_iq->iqfname);
+            return -1;
+        }
+
+        if (rtl_open_radio(local_iq, definition, msg) < 0)
+            return -1;
+
+        rtl_channels(*ret_interface);
+        (*ret_interface)->hardware = strdup(rtlsdr_get_device_name(local_iq->rtlnum));
+
+        if ((placeholder_len = cf_find_flag(&placeholder, "uuid", definition)) > 0) {
+            *uuid = strndup(placeholder, placeholder_len);
+        } else {
+            rtl_uuid(local_iq->rtlnum, uuid);
+        }
+
+        snprintf(msg, STATUS_MAX, "Opened rtlsdr '%s' for ADSB on %s",
+                local_iq->iqfname, RTL_CHANNEL);
+
+        return 1;
+#else
+        snprintf(msg, STATUS_MAX, "kismet_cap_rtladsb_iq was built without librtlsdr "
+                "and can not open rtlsdr radios");
+        return -1;
+#endif
+    }
+
+    iqfname = strndup(placeholder, placeholder_len);
+
+    local_iq->iqfname = iqfname;
+
+    if (stat(iqfname, &sbuf) < 0) {
+        snprintf(msg, STATUS_MAX, "Unable to find IQ file '%s'", iqfname);
+        return -1;
+    }
+
+    if ((local_iq->iqfile = fopen(iqfname, "rb")) == NULL) {
+        snprintf(msg, STATUS_MAX, "Unable to open IQ file '%s': %s", iqfname,
+                strerror(errno));
+        return -1;
+    }
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "uuid", definition)) > 0) {
+        *uuid = strndup(placeholder, placeholder_len);
+    } else {
+        iq_uuid(iqfname, uuid);
+    }
+
+    snprintf(msg, STATUS_MAX, "Opened IQ file '%s' for ADSB playback", iqfname);
+
+    if ((placeholder_len = cf_find_flag(&placeholder, "realtime", definition)) > 0) {
+        if (strncasecmp(placeholder, "true", placeholder_len) == 0) {
+            snprintf(errstr, STATUS_MAX,
+                    "IQ file '%s' will replay in realtime", iqfname);
+            cf_send_message(caph, errstr, MSGFLAG_INFO);
+            local_iq->realtime = 1;
+        }
+    }
+
+    return 1;
+}
+
+void frame_cb(void *ctx, const uint8_t *adsb_frame) {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) ctx;
+    char json[ADSB_JSON_MAX];
+    struct timeval tv;
+    int ret;
+
+    rtladsb_msg_json(adsb_frame, json, ADSB_JSON_MAX);
+
+    gettimeofday(&tv, NULL);
+
+    /* Try repeatedly to send the record; go into a thread wait state if
+     * the write buffer is full & we'll be woken up as soon as it flushes
+     * data out in the main select() loop */
+    while (1) {
+        if ((ret = cf_send_json(caph, NULL, NULL, NULL, tv, "RTLadsb", json)) < 0) {
+            cf_send_error(caph, 0, "unable to send JSON frame");
+            cf_handler_spindown(caph);
+            break;
+        } else if (ret == 0) {
+            cf_handler_wait_ringbuffer(caph);
+            continue;
+        } else {
+            break;
+        }
+    }
+}
+
+#ifdef HAVE_LIBRTLSDR
+void rtl_data_cb(unsigned char *buf, uint32_t len, void *ctx) {
+    kis_capture_handler_t *caph = (kis_capture_handler_t *) ctx;
+    local_iq_t *local_iq = (local_iq_t *) caph->userdata;
+
+    if (caph->spindown) {
+        rtlsdr_cancel_async(local_iq->rtlradio);
+        return;
+    }
+
+    rtladsb_demod_iq(&local_iq->demod, buf, len, frame_cb, caph);
+}
+
+void rtl_capture_thread(kis_capture_handler_t *caph) {
+    local_iq_t *local_iq = (local_iq_t *) caph->userdata;
+    char errstr[STATUS_MAX];
+    int r;
+
+    r = rtlsdr_read_async(local_iq->rtlradio, rtl_data_cb, caph,
+            RTL_NUM_BUFS, IQ_BLOCK_SZ);
+
+    /* Returning ends the source; explain why unless we're already shutting down */
+    if (caph->spindown)
+        return;
+
+    snprintf(errstr, STATUS_MAX, "rtlsdr '%s' closed (%d) after %lu ADSB frames; "
+            "is the USB device plugged in and not in use by another program?",
+            local_iq->iqfname, r, local_iq->demod.frames);
+
+    cf_send_error(caph, 0, errstr);
+}
+#endif
+
+void capture_thread(kis_capture_handler_t *caph) {
+    local_iq_t *local_iq = (local_iq_t *) caph->userdata;
+    char errstr[STATUS_MAX];
+    size_t len;
+
+#ifdef HAVE_LIBRTLSDR
+    if (local_iq->rtlradio != NULL) {
+        rtl_capture_thread(caph);
+        return;
+    }
+#endif
+
+    while ((len = fread(local_iq->iqbuf, 1, IQ_BLOCK_SZ, local_iq->iqfile)) > 0) {
+        rtladsb_demod_iq(&local_iq->demod, local_iq->iqbuf, len, frame_cb, caph);
+
+        /* Each IQ pair is one sample */
+        if (local_iq->realtime)
+            usleep((len / 2) * 1000000L / ADSB_RATE);
+    }
+
+    snprintf(errstr, STATUS_MAX, "IQ file '%s' closed: %s, %lu ADSB frames",
+            local_iq->iqfname,
+            ferror(local_iq->iqfile) ? strerror(errno) : "end of file reached",
+            local_iq->demod.frames);
+
+    cf_send_message(caph, errstr, MSGFLAG_INFO);
+
+    /* Instead of dying, spin forever in a sleep loop */
+    while (1) {
+        sleep(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    local_iq_t local_iq = {
+        .iqfile = NULL,
+        .iqfname = NULL,
+        .realtime = 0,
+        .iqbuf = NULL,
+#ifdef HAVE_LIBRTLSDR
+        .rtlradio = NULL,
+        .rtlnum = -1,
+#endif
+    };
+
+    kis_capture_handler_t *caph = cf_handler_init("rtladsbiq");
+
+    if (caph == NULL) {
+        fprintf(stderr, "FATAL: Could not allocate basic handler data, your system "
+                "is very low on RAM or something is wrong.\n");
+        return -1;
+    }
+
+    local_iq.iqbuf = (uint8_t *) malloc(IQ_BLOCK_SZ);
+
+    if (local_iq.iqbuf == NULL || rtladsb_demod_init(&local_iq.demod, IQ_BLOCK_SZ) < 0) {
+        fprintf(stderr, "FATAL: Could not allocate IQ buffers, your system "
+                "is very low on RAM or something is wrong.\n");
+        return -1;
+    }
+
+    /* Set the local data ptr */
+    cf_handler_set_userdata(caph, &local_iq);
+
+    /* Set the callback for opening an IQ file */
+    cf_handler_set_open_cb(caph, open_callback);
+
+    /* Set the callback for probing an interface */
+    cf_handler_set_probe_cb(caph, probe_callback);
+
+#ifdef HAVE_LIBRTLSDR
+    /* Set the list callback for rtlsdr radios */
+    cf_handler_set_listdevices_cb(caph, list_callback);
+#endif
+
+    /* Set the capture thread */
+    cf_handler_set_capture_cb(caph, capture_thread);
+
+    if (cf_handler_parse_opts(caph, argc, argv) < 1) {
+        cf_print_help(caph, argv[0]);
+        return -1;
+    }
+
+    /* Support remote capture by launching the remote loop */
+    cf_handler_remote_capture(caph);
+
+    cf_handler_loop(caph);
+
+    cf_handler_free(caph);
+
+#ifdef HAVE_LIBRTLSDR
+    if (local_iq.rtlradio != NULL)
+        rtlsdr_close(local_iq.rtlradio);
+#endif
+
+    rtladsb_demod_free(&local_iq.demod);
+    free(local_iq.iqbuf);
+
+    return 1;
+}
+
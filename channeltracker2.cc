@@ -22,17 +22,20 @@
 #include "json_adapter.h"
 #include "devicetracker.h"
 #include "devicetracker_component.h"
-#include "devicetracker_view_workers.h"
 #include "packinfo_signal.h"
 
 channel_tracker_v2::channel_tracker_v2(global_registry *in_globalreg) :
     lifetime_global() {
 
     lock.set_name("channeltrackerv2");
+    intern_mutex.set_name("channeltrackerv2_intern");
+    for (auto& shard : activity_shards)
+        shard.mutex.set_name("channeltrackerv2_activity");
 
     // Number of seconds we consider a device to be active on a frequency 
     // after the last time we see it
     device_decay = 5;
+    last_counts_sec = 0;
 
     auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
 
@@ -43,7 +46,7 @@ channel_tracker_v2::channel_tracker_v2(global_registry *in_globalreg) :
         Globalreg::fetch_mandatory_global_as<entry_tracker>();
 
 
-    packetchain->register_handler(&packet_chain_handler, this, CHAINPOS_LOGGING, 0);
+    packetchain->register_handler(&packet_chain_handler, this, CHAINPOS_LOGGING, 0, "channeltracker");
 
 	pack_comp_device = packetchain->register_packet_component("DEVICE");
 	pack_comp_common = packetchain->register_packet_component("COMMON");
@@ -79,7 +82,7 @@ channel_tracker_v2::channel_tracker_v2(global_registry *in_globalreg) :
 
     timer_id = timetracker->register_timer(SERVER_TIMESLICES_SEC, nullptr, 1, 
             [this](int evt_id) -> int {
-                return gather_devices_event(evt_id);
+                return update_device_counts_event(evt_id);
             });
 
 }
@@ -105,88 +108,201 @@ std::shared_ptr<tracker_element_map> channel_tracker_v2::channels_endp_handler()
     return ret;
 }
 
-class channeltracker_v2_device_worker : public device_tracker_view_worker {
-public:
-    channeltracker_v2_device_worker(channel_tracker_v2 *channelv2) {
-        this->channelv2 = channelv2;
-        stime = time(0);
-    }
+std::shared_ptr<channel_tracker_v2_channel> channel_tracker_v2::intern_frequency(double in_freq,
+        unsigned int& slot) {
+    {
+        local_shared_locker l(&intern_mutex);
 
-    virtual ~channeltracker_v2_device_worker() { }
-
-    // Count all the devices.  We use a filter worker but 'match' on all
-    // and count them into our local map
-    virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override {
-        auto freq = device->get_frequency();
-        if (freq == 0)
-            return false;
-
-        auto i = device_count.find(freq);
-
-        if (i != device_count.end()) {
-            if (device->get_last_time() > (stime - channelv2->device_decay))
-                i->second++;
-        } else {
-            if (device->get_last_time() > (stime - channelv2->device_decay))
-                device_count[freq] = 1;
-            else
-                device_count[freq] = 0;
+        auto fi = freq_slot_map.find(in_freq);
+        if (fi != freq_slot_map.end()) {
+            slot = fi->second;
+            return freq_slots[slot];
         }
+    }
 
-        return false;
+    local_locker l(&intern_mutex);
+
+    // Someone else may have made it while we were acquiring the write lock
+    auto fi = freq_slot_map.find(in_freq);
+    if (fi != freq_slot_map.end()) {
+        slot = fi->second;
+        return freq_slots[slot];
     }
 
-    // Send it back to our channel tracker
-    virtual void finalize() override {
-        channelv2->update_device_counts(device_count, stime);
+    auto freq_channel =
+        entrytracker->get_shared_instance_as<channel_tracker_v2_channel>(channel_entry_id);
+    freq_channel->set_frequency(in_freq);
+
+    slot = freq_slots.size();
+    freq_slots.push_back(freq_channel);
+    freq_slot_map[in_freq] = slot;
+
+    {
+        local_locker ml(&lock);
+        frequency_map->insert(in_freq, freq_channel);
     }
 
-protected:
-    channel_tracker_v2 *channelv2;
+    return freq_channel;
+}
 
-    std::unordered_map<double, unsigned int> device_count;
+std::shared_ptr<channel_tracker_v2_channel> channel_tracker_v2::intern_channel(const kis_atom& in_channel) {
+    {
+        local_shared_locker l(&intern_mutex);
 
-    time_t stime;
-};
+        auto ci = chan_slot_map.find(in_channel);
+        if (ci != chan_slot_map.end())
+            return chan_slots[ci->second];
+    }
 
+    local_locker l(&intern_mutex);
 
-int channel_tracker_v2::gather_devices_event(int event_id __attribute__((unused))) {
-    channeltracker_v2_device_worker worker(this);
-    devicetracker->do_readonly_device_work(worker);
+    auto ci = chan_slot_map.find(in_channel);
+    if (ci != chan_slot_map.end())
+        return chan_slots[ci->second];
 
-    return 1;
+    auto chan_channel =
+        entrytracker->get_shared_instance_as<channel_tracker_v2_channel>(channel_entry_id);
+    chan_channel->set_channel(in_channel.str());
+
+    chan_slot_map[in_channel] = chan_slots.size();
+    chan_slots.push_back(chan_channel);
+
+    {
+        local_locker ml(&lock);
+        channel_map->insert(in_channel.str(), chan_channel);
+    }
+
+    return chan_channel;
 }
 
-void channel_tracker_v2::update_device_counts(std::unordered_map<double, unsigned int> in_counts, time_t ts) {
-    local_locker locker(&lock);
+void channel_tracker_v2::update_device_activity(std::shared_ptr<kis_tracked_device_base> device) {
+    double freq;
+    time_t last_time;
+    device_key key;
+
+    {
+        local_shared_locker dl(&device->device_mutex);
+        freq = device->get_frequency();
+        last_time = device->get_last_time();
+        key = device->get_key();
+    }
+
+    if (freq == 0)
+        return;
+
+    auto now = server_sec();
+
+    // Devices last seen outside the decay window are not counted
+    if (last_time <= now - device_decay)
+        return;
+
+    unsigned int slot;
+    intern_frequency(freq, slot);
+
+    auto& shard = activity_shards[std::hash<device_key>()(key) % activity_shard_count];
+
+    local_locker l(&shard.mutex);
+
+    // Read the clock again under the shard lock so the expiry queue stays in order
+    now = server_sec();
+
+    if (shard.freq_counts.size() <= slot)
+        shard.freq_counts.resize(slot + 1, 0);
+
+    auto ai = shard.devices.find(key);
+
+    if (ai == shard.devices.end()) {
+        shard.devices[key] = device_activity{slot, now};
+        shard.freq_counts[slot]++;
+        shard.expiry.push_back(std::make_pair(now, key));
+        return;
+    }
+
+    if (ai->second.freq_slot != slot) {
+        shard.freq_counts[ai->second.freq_slot]--;
+        shard.freq_counts[slot]++;
+        ai->second.freq_slot = slot;
+    }
+
+    // Queue at most one expiry per device per second
+    if (ai->second.seen_sec != now) {
+        ai->second.seen_sec = now;
+        shard.expiry.push_back(std::make_pair(now, key));
+    }
+}
 
-    for (auto i : in_counts) {
-        auto imi = frequency_map->find(i.first);
+int channel_tracker_v2::update_device_counts_event(int event_id __attribute__((unused))) {
+    auto now = server_sec();
 
+    // The clock moved backwards, as it does when a replay takes over the server clock;
+    // queued expiry times are meaningless on the new clock, so start over
+    bool rewound = now < last_counts_sec;
+    last_counts_sec = now;
+
+    std::vector<unsigned int> counts;
+
+    {
+        local_shared_locker l(&intern_mutex);
+        counts.resize(freq_slots.size(), 0);
+    }
+
+    for (auto& shard : activity_shards) {
+        local_locker l(&shard.mutex);
+
+        if (rewound) {
+            shard.devices.clear();
+            shard.expiry.clear();
+            std::fill(shard.freq_counts.begin(), shard.freq_counts.end(), 0);
+        }
+
+        // Retire devices which have gone idle; stale queue entries for devices seen
+        // again since are skipped
+        while (shard.expiry.size() > 0 && shard.expiry.front().first <= now - device_decay) {
+            auto ai = shard.devices.find(shard.expiry.front().second);
+
+            if (ai != shard.devices.end() && 
+                    ai->second.seen_sec == shard.expiry.front().first) {
+                shard.freq_counts[ai->second.freq_slot]--;
+                shard.devices.erase(ai);
+            }
+
+            shard.expiry.pop_front();
+        }
+
+        if (counts.size() < shard.freq_counts.size())
+            counts.resize(shard.freq_counts.size(), 0);
+
+        for (size_t slot = 0; slot < shard.freq_counts.size(); slot++)
+            counts[slot] += shard.freq_counts[slot];
+    }
+
+    for (size_t slot = 0; slot < counts.size(); slot++) {
         std::shared_ptr<channel_tracker_v2_channel> freq_channel;
 
-        // Make a frequency
-        if (imi == frequency_map->end()) {
-            freq_channel =
-                entrytracker->get_shared_instance_as<channel_tracker_v2_channel>(channel_entry_id);
-            freq_channel->set_frequency(i.first);
-            frequency_map->insert(i.first, freq_channel);
-        } else {
-            freq_channel = std::static_pointer_cast<channel_tracker_v2_channel>(imi->second);
+        {
+            local_shared_locker l(&intern_mutex);
+            freq_channel = freq_slots[slot];
         }
 
-        // Update the device RRD for the count
-        freq_channel->get_device_rrd()->add_sample(i.second, ts);
+        local_locker cl(&freq_channel->mutex);
+        freq_channel->get_device_rrd()->add_sample(counts[slot], now);
     }
+
+    return 1;
 }
 
 int channel_tracker_v2::packet_chain_handler(CHAINCALL_PARMS) {
     channel_tracker_v2 *cv2 = (channel_tracker_v2 *) auxdata;
 
-    local_locker locker(&(cv2->lock));
-
     auto l1info = in_pack->fetch<kis_layer1_packinfo>(cv2->pack_comp_l1data);
 	auto common = in_pack->fetch<kis_common_info>(cv2->pack_comp_common);
+    auto devinfo = in_pack->fetch<kis_tracked_device_info>(cv2->pack_comp_device);
+
+    // Update the active device counts for any devices this packet touched
+    if (devinfo != nullptr) {
+        for (const auto& d : devinfo->devrefs)
+            cv2->update_device_activity(d.second);
+    }
 
     // Nothing to do with no l1info
     if (l1info == nullptr)
@@ -197,31 +313,13 @@ int channel_tracker_v2::packet_chain_handler(CHAINCALL_PARMS) {
 
     // Find or make a frequency record if we know our frequency
     if (l1info->freq_khz != 0) {
-        auto imi = cv2->frequency_map->find(l1info->freq_khz);
-
-        if (imi == cv2->frequency_map->end()) {
-            freq_channel =
-                cv2->entrytracker->get_shared_instance_as<channel_tracker_v2_channel>(cv2->channel_entry_id);
-            freq_channel->set_frequency(l1info->freq_khz);
-            cv2->frequency_map->insert(l1info->freq_khz, freq_channel);
-        } else {
-            freq_channel = std::static_pointer_cast<channel_tracker_v2_channel>(imi->second);
-        }
+        unsigned int slot;
+        freq_channel = cv2->intern_frequency(l1info->freq_khz, slot);
     }
 
     if (common != nullptr) {
-        if (!(common->channel == "0") && !(common->channel == "")) {
-            auto smi = cv2->channel_map->find(common->channel);
-
-            if (smi == cv2->channel_map->end()) {
-                chan_channel =
-                    cv2->entrytracker->get_shared_instance_as<channel_tracker_v2_channel>(cv2->channel_entry_id);
-
-                chan_channel->set_channel(common->channel);
-                cv2->channel_map->insert(common->channel, chan_channel);
-            } else {
-                chan_channel = std::static_pointer_cast<channel_tracker_v2_channel>(smi->second);
-            }
+        if (kis_atom_channel_known(common->channel)) {
+            chan_channel = cv2->intern_channel(common->channel);
         }
     }
 
@@ -229,45 +327,29 @@ int channel_tracker_v2::packet_chain_handler(CHAINCALL_PARMS) {
     if (freq_channel == NULL && chan_channel == NULL)
         return 1;
 
-    time_t stime = time(0);
+    time_t stime = cv2->server_sec();
 
     if (freq_channel) {
+        local_locker l(&freq_channel->mutex);
+
         freq_channel->get_signal_data()->append_signal(*l1info, false, 0);
         freq_channel->get_packets_rrd()->add_sample(1, stime);
 
         if (common != NULL) {
             freq_channel->get_data_rrd()->add_sample(common->datasize, stime);
-
-            /*
-            freq_channel->seen_device_map[common->device] = true;
-            */
         }
 
     }
 
     if (chan_channel) {
+        local_locker l(&chan_channel->mutex);
+
         chan_channel->get_signal_data()->append_signal(*l1info, false, 0);
         chan_channel->get_packets_rrd()->add_sample(1, stime);
 
         if (common != NULL) {
             chan_channel->get_data_rrd()->add_sample(common->datasize, stime);
         }
-
-        /*
-        // Track unique devices
-        if (globalreg->timestamp.tv_sec != chan_channel->last_device_sec) {
-            chan_channel->last_device_sec = globalreg->timestamp.tv_sec;
-            chan_channel->seen_device_map.clear();
-        }
-        */
-
-        /*
-        chan_channel->seen_device_map[common->device] = true;
-
-        chan_channel->get_device_rrd()->add_sample(
-                chan_channel->seen_device_map.size(),
-                globalreg->timestamp.tv_sec);
-                */
     }
 
     return 1;
@@ -21,9 +21,13 @@
 
 #include "config.h"
 
+#include <array>
+#include <chrono>
+#include <deque>
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
@@ -39,30 +43,30 @@ class channel_tracker_v2_channel : public tracker_component, public shared_globa
 public:
     channel_tracker_v2_channel() :
         tracker_component() {
+        mutex.set_name("channel_tracker_v2_channel");
         register_fields();
         reserve_fields(NULL);
     }
 
     channel_tracker_v2_channel(int in_id) :
         tracker_component(in_id) { 
+        mutex.set_name("channel_tracker_v2_channel");
         register_fields();
         reserve_fields(NULL);
-
-        // last_device_sec = 0;
     }
 
     channel_tracker_v2_channel(int in_id, std::shared_ptr<tracker_element_map> e) : 
         tracker_component(in_id) {
-
+        mutex.set_name("channel_tracker_v2_channel");
         register_fields();
         reserve_fields(e);
-
-        // last_device_sec = 0;
     }
 
     channel_tracker_v2_channel(const channel_tracker_v2_channel* p) :
         tracker_component{p} {
 
+        mutex.set_name("channel_tracker_v2_channel");
+
         __ImportField(channel, p);
         __ImportField(frequency, p);
         __ImportField(packets_rrd, p);
@@ -93,16 +97,19 @@ public:
 
     __ProxyTrackable(signal_data, kis_tracked_signal_data, signal_data);
 
-    /*
-    // C++-domain map of devices we've seen in the last second for computing if we
-    // increase the RRD record
-    map<mac_addr, bool> seen_device_map;
-    time_t last_device_sec;
-    */
+    virtual void pre_serialize() override {
+        local_eol_shared_locker lock(&mutex);
+    }
+
+    virtual void post_serialize() override {
+        local_shared_unlocker lock(&mutex);
+    }
+
+    // Each channel record is locked independently; the packet path only locks the
+    // records it updates
+    kis_recursive_timed_mutex mutex;
 
 protected:
-    // Timer for updating the device list
-    int timer_id;
 
     virtual void register_fields() override {
         tracker_component::register_fields();
@@ -160,13 +167,13 @@ private:
 public:
     virtual ~channel_tracker_v2();
 
-    // Update device counts - kept public so that the worker can access it
-    int device_decay;
-    void update_device_counts(std::unordered_map<double, unsigned int> in_counts, time_t in_ts);
-
 protected:
     kis_recursive_timed_mutex lock;
 
+    // Number of seconds we consider a device to be active on a frequency after the
+    // last time we see it
+    int device_decay;
+
     std::shared_ptr<device_tracker> devicetracker;
     std::shared_ptr<time_tracker> timetracker;
     std::shared_ptr<entry_tracker> entrytracker;
@@ -188,8 +195,60 @@ protected:
 
     int pack_comp_l1data, pack_comp_devinfo, pack_comp_common, pack_comp_device;
 
+    // Frequencies and named channels are interned to small integer slots the first time
+    // they are seen.  Slots are never removed, so lookups only need the shared intern 
+    // lock, and the record is then updated under its own lock.  New records are also 
+    // published to the frequency and channel maps under the main lock.
+    kis_recursive_timed_mutex intern_mutex;
+    std::unordered_map<double, unsigned int> freq_slot_map;
+    std::unordered_map<kis_atom, unsigned int> chan_slot_map;
+    std::vector<std::shared_ptr<channel_tracker_v2_channel>> freq_slots;
+    std::vector<std::shared_ptr<channel_tracker_v2_channel>> chan_slots;
+
+    std::shared_ptr<channel_tracker_v2_channel> intern_frequency(double in_freq, unsigned int& slot);
+    std::shared_ptr<channel_tracker_v2_channel> intern_channel(const kis_atom& in_channel);
+
+    // Devices active per frequency slot, maintained as devices are seen on a frequency,
+    // move to another frequency, or go idle for longer than device_decay.  Devices are
+    // split across shards by key, each with its own lock and per-slot counts, so that
+    // packets for different devices rarely contend; the timer sums the shards.
+    //
+    // Idle time is measured on the server clock, which follows the virtual clock of a
+    // replay, from when the device was last updated rather than from packet timestamps,
+    // which are not ordered across sources; this keeps each expiry queue in order.  If
+    // the clock moves backwards, when a replay starts, the activity is discarded.
+    struct device_activity {
+        unsigned int freq_slot;
+        int64_t seen_sec;
+    };
+
+    struct activity_shard {
+        kis_recursive_timed_mutex mutex;
+        std::unordered_map<device_key, device_activity> devices;
+        std::vector<unsigned int> freq_counts;
+
+        // Activity records in the order they go idle; an entry is stale if the device
+        // has been seen again since it was queued
+        std::deque<std::pair<int64_t, device_key>> expiry;
+    };
+
+    static const unsigned int activity_shard_count = 16;
+    std::array<activity_shard, activity_shard_count> activity_shards;
+
+    // Server time of the last count update
+    int64_t last_counts_sec;
+
+    // Current server time, following the virtual clock during replay
+    int64_t server_sec() {
+        struct timeval tv;
+        timetracker->now(&tv);
+        return tv.tv_sec;
+    }
+
+    void update_device_activity(std::shared_ptr<kis_tracked_device_base> device);
+
     int timer_id;
-    int gather_devices_event(int event_id);
+    int update_device_counts_event(int event_id);
 
 
 };
@@ -117,6 +117,8 @@ class_filter_mac_addr::class_filter_mac_addr(const std::string& in_id, const std
         register_fields();
         reserve_fields(nullptr);
 
+        compiled_filters = std::make_shared<compiled_phy_map>();
+
         devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
 
         eventbus = Globalreg::fetch_mandatory_global_as<event_bus>();
@@ -223,6 +225,8 @@ void class_filter_mac_addr::set_filter(mac_addr in_mac, const std::string& in_ph
 
     // Set known phy types
     phy_mac_filter_map[phy->fetch_phy_id()][in_mac] = value;
+
+    compile_filters();
 }
 
 void class_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in_phy) {
@@ -264,6 +268,8 @@ void class_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in
 
     if (known_match != known_phy->second.end())
         known_phy->second.erase(known_match);
+
+    compile_filters();
 }
 
 void class_filter_mac_addr::update_phy_map(std::shared_ptr<eventbus_event> evt) {
@@ -294,6 +300,24 @@ void class_filter_mac_addr::update_phy_map(std::shared_ptr<eventbus_event> evt)
 
     // Purge the unknown record
     unknown_phy_mac_filter_map.erase(unknown_key);
+
+    compile_filters();
+}
+
+void class_filter_mac_addr::compile_filters() {
+    auto compiled = std::make_shared<compiled_phy_map>();
+
+    for (const auto& pi : phy_mac_filter_map) {
+        if (pi.second.size() == 0)
+            continue;
+
+        auto& matcher = (*compiled)[pi.first];
+
+        for (const auto& fi : pi.second)
+            matcher.insert(fi.first, fi.second);
+    }
+
+    std::atomic_store(&compiled_filters, compiled);
 }
 
 unsigned int class_filter_mac_addr::edit_endp_handler(std::ostream& stream, 
@@ -364,19 +388,19 @@ unsigned int class_filter_mac_addr::remove_endp_handler(std::ostream& stream,
 }
 
 bool class_filter_mac_addr::filter(mac_addr mac, unsigned int phy) {
-    local_locker l(&mutex);
+    auto compiled = std::atomic_load(&compiled_filters);
 
-    auto pi = phy_mac_filter_map.find(phy);
+    auto pi = compiled->find(phy);
 
-    if (pi == phy_mac_filter_map.end())
+    if (pi == compiled->end())
         return get_filter_default();
 
-    auto si = pi->second.find(mac);
+    auto v = pi->second.find(mac);
 
-    if (si == pi->second.end())
+    if (v == nullptr)
         return get_filter_default();
 
-    return si->second;
+    return *v;
 }
 
 std::shared_ptr<tracker_element_map> class_filter_mac_addr::self_endp_handler() {
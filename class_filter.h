@@ -18,6 +18,9 @@
 
 #include "config.h"
 
+#include <unordered_map>
+
+#include "mac_prefix_matcher.h"
 #include "packetchain.h"
 #include "packet.h"
 
@@ -136,6 +139,14 @@ protected:
 	// Internal unknown phy map for filters registered before we had a phy ID
 	std::map<std::string, std::map<mac_addr, bool>> unknown_phy_mac_filter_map;
 
+    // Known phy filters compiled for lookup; replaced whole when the filters change,
+    // and read without locking
+    using compiled_phy_map = std::unordered_map<int, mac_prefix_matcher<bool>>;
+    std::shared_ptr<compiled_phy_map> compiled_filters;
+
+    // Rebuild the compiled filters from the known phy map; mutex must be held
+    void compile_filters();
+
     // Address management endpoint keyed on path
     std::shared_ptr<kis_net_httpd_path_post_endpoint> macaddr_edit_endp;
     unsigned int edit_endp_handler(std::ostream& stream, const std::vector<std::string>& path, 
@@ -0,0 +1,90 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DATASOURCE_HACKRF_SWEEP_H__
+#define __DATASOURCE_HACKRF_SWEEP_H__
+
+#include "config.h"
+
+#include "kis_datasource.h"
+
+class kis_datasource_hackrf_sweep;
+typedef std::shared_ptr<kis_datasource_hackrf_sweep> shared_datasource_hackrf_sweep;
+
+class kis_datasource_hackrf_sweep : public kis_datasource {
+public:
+    kis_datasource_hackrf_sweep(shared_datasource_builder in_builder) :
+        kis_datasource(in_builder) {
+
+        // Set the capture binary
+        set_int_source_ipc_binary("kismet_cap_hackrf_sweep");
+        set_int_source_hardware("hackrf");
+    }
+
+    virtual ~kis_datasource_hackrf_sweep() { };
+
+    // The hackrf only reports spectrum sweeps, which go to the spectrum store of 
+    // the source; everything else is handled by the capture binary
+};
+
+class datasource_hackrf_sweep_builder : public kis_datasource_builder {
+public:
+    datasource_hackrf_sweep_builder() :
+        kis_datasource_builder() {
+        register_fields();
+        reserve_fields(NULL);
+        initialize();
+    }
+
+    datasource_hackrf_sweep_builder(int in_id) :
+        kis_datasource_builder(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+        initialize();
+    }
+
+    datasource_hackrf_sweep_builder(int in_id, std::shared_ptr<tracker_element_map> e) :
+        kis_datasource_builder(in_id, e) {
+
+        register_fields();
+        reserve_fields(e);
+        initialize();
+    }
+
+    virtual ~datasource_hackrf_sweep_builder() { }
+
+    virtual shared_datasource build_datasource(shared_datasource_builder in_sh_this) override {
+        return shared_datasource_hackrf_sweep(new kis_datasource_hackrf_sweep(in_sh_this));
+    }
+
+    virtual void initialize() override {
+        set_source_type("hackrfsweep");
+        set_source_description("HackRF spectrum sweep");
+
+        set_probe_capable(true);
+        set_list_capable(true);
+        set_local_capable(true);
+        set_remote_capable(true);
+        set_passive_capable(false);
+        set_tune_capable(false);
+        set_hop_capable(false);
+    }
+};
+
+#endif
+
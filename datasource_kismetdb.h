@@ -33,6 +33,9 @@ public:
 
         // Set the capture binary
         set_int_source_ipc_binary("kismet_cap_kismetdb");
+
+        // Replayed packet times can drive the server clock with speed=...
+        replay_capable = true;
     }
 
     virtual ~kis_datasource_kismetdb() { };
@@ -35,12 +35,12 @@ kis_datasource_linux_bluetooth::kis_datasource_linux_bluetooth(shared_datasource
     pack_comp_meta = packetchain->register_packet_component("METABLOB");
 }
 
-bool kis_datasource_linux_bluetooth::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) {
+bool kis_datasource_linux_bluetooth::dispatch_rx_packet(const kis_external_command& c) {
     if (kis_datasource::dispatch_rx_packet(c))
         return true;
 
-    if (c->command() == "LBTDATAREPORT") {
-        handle_packet_linuxbtdevice(c->seqno(), c->content());
+    if (c.command == "LBTDATAREPORT") {
+        handle_packet_linuxbtdevice(c.seqno, c.content_str());
         return true;
     }
 
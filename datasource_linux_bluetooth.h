@@ -34,7 +34,7 @@ public:
     virtual ~kis_datasource_linux_bluetooth() { };
 
 protected:
-    virtual bool dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) override;
+    virtual bool dispatch_rx_packet(const kis_external_command& c) override;
   
     virtual void handle_packet_linuxbtdevice(uint32_t in_seqno, std::string in_content);
 
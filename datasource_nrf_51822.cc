@@ -129,7 +129,7 @@ void kis_datasource_nrf51822::handle_rx_packet(kis_packet *packet) {
         radioheader->signal_type = kis_l1_signal_type_dbm;
         radioheader->signal_dbm = conv_header->signal;
         radioheader->freq_khz = (2400 + (channel)) * 1000;
-        radioheader->channel = fmt::format("{}", (channel));
+        radioheader->channel = kis_atom::from_uint((uint8_t) channel);
         packet->insert(pack_comp_radiodata, radioheader);
 
         auto decapchunk = new kis_datachunk;
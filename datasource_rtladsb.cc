@@ -21,18 +21,30 @@
 #include "datasource_rtladsb.h"
 #include "phy_rtladsb.h"
 
-kis_datasource_rtladsb::kis_datasource_rtladsb(shared_datasource_builder in_builder) :
+kis_datasource_rtladsb::kis_datasource_rtladsb(shared_datasource_builder in_builder, bool in_iq) :
     kis_datasource(in_builder) {
 
-    std::string devnum = munge_to_printable(get_definition_opt("device"));
-    if (devnum != "") {
-        set_int_source_cap_interface("rtladsbusb#" + devnum);
+    if (!in_iq) {
+        std::string devnum = munge_to_printable(get_definition_opt("device"));
+        if (devnum != "") {
+            set_int_source_cap_interface("rtladsbusb#" + devnum);
+        } else {
+            set_int_source_cap_interface("rtladsbusb");
+        }
+
+        set_int_source_hardware("rtlsdr");
+
+        // Prefer the native demodulator when it was built with librtlsdr
+#ifdef HAVE_LIBRTLSDR
+        set_int_source_ipc_binary("kismet_cap_rtladsb_iq");
+#else
+        set_int_source_ipc_binary("kismet_cap_sdr_rtladsb");
+#endif
     } else {
-        set_int_source_cap_interface("rtladsbusb");
+        set_int_source_hardware("rtlsdr-iq");
+        set_int_source_ipc_binary("kismet_cap_rtladsb_iq");
     }
 
-    set_int_source_hardware("rtlsdr");
-    set_int_source_ipc_binary("kismet_cap_sdr_rtladsb");
     suppress_gps = true;
 }
 
@@ -28,7 +28,7 @@ typedef std::shared_ptr<kis_datasource_rtladsb> shared_datasource_rtladsb;
 
 class kis_datasource_rtladsb : public kis_datasource {
 public:
-    kis_datasource_rtladsb(shared_datasource_builder in_builder);
+    kis_datasource_rtladsb(shared_datasource_builder in_builder, bool in_iq);
     virtual ~kis_datasource_rtladsb();
 
 protected:
@@ -64,7 +64,7 @@ public:
     virtual ~datasource_rtladsb_builder() { }
 
     virtual shared_datasource build_datasource(shared_datasource_builder in_sh_this) override {
-        return shared_datasource_rtladsb(new kis_datasource_rtladsb(in_sh_this));
+        return shared_datasource_rtladsb(new kis_datasource_rtladsb(in_sh_this, false));
     }
 
     virtual void initialize() override {
@@ -81,6 +81,51 @@ public:
     }
 };
 
+// Replay of recorded 1090MHz IQ, demodulated by the native capture binary
+class datasource_rtladsb_iq_builder : public kis_datasource_builder {
+public:
+    datasource_rtladsb_iq_builder() :
+        kis_datasource_builder() {
+        register_fields();
+        reserve_fields(NULL);
+        initialize();
+    }
+
+    datasource_rtladsb_iq_builder(int in_id) :
+        kis_datasource_builder(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+        initialize();
+    }
+
+    datasource_rtladsb_iq_builder(int in_id, std::shared_ptr<tracker_element_map> e) :
+        kis_datasource_builder(in_id, e) {
+
+        register_fields();
+        reserve_fields(e);
+        initialize();
+    }
+
+    virtual ~datasource_rtladsb_iq_builder() { }
+
+    virtual shared_datasource build_datasource(shared_datasource_builder in_sh_this) override {
+        return shared_datasource_rtladsb(new kis_datasource_rtladsb(in_sh_this, true));
+    }
+
+    virtual void initialize() override {
+        set_source_type("rtladsbiq");
+        set_source_description("Recorded rtlsdr IQ for ADSB");
+
+        set_probe_capable(true);
+        set_list_capable(false);
+        set_local_capable(true);
+        set_remote_capable(true);
+        set_passive_capable(false);
+        set_tune_capable(false);
+        set_hop_capable(false);
+    }
+};
+
 #endif
 
 
@@ -25,7 +25,7 @@ datasource_scan_source::datasource_scan_source(const std::string& uri, const std
         const std::string& json_component_type) :
     endpoint_uri{uri},
     virtual_source_type{source_type},
-    json_component_type{json_component_type} {
+    json_component_type{kis_atom(json_component_type)} {
 
     packetchain =
         Globalreg::fetch_mandatory_global_as<packet_chain>();
@@ -180,7 +180,9 @@ unsigned int datasource_scan_source::scan_result_endp_handler(std::ostream& stre
                 if (l1info == nullptr)
                     l1info = new kis_layer1_packinfo();
 
-                l1info->channel = r["channel"].asString();
+                // Scan reports come from remote clients; only channels which are
+                // already interned are kept
+                l1info->channel = kis_atom::find(r["channel"].asString());
             }
 
             if (l1info != nullptr)
@@ -41,7 +41,7 @@ protected:
 
     std::string endpoint_uri;
     std::string virtual_source_type;
-    std::string json_component_type;
+    kis_atom json_component_type;
 
     std::shared_ptr<datasource_tracker> datasourcetracker;
     std::shared_ptr<packet_chain> packetchain;
@@ -122,7 +122,7 @@ void kis_datasource_ubertooth_one::handle_rx_packet(kis_packet *packet) {
     radioheader->signal_type = kis_l1_signal_type_dbm;
     radioheader->signal_dbm = conv_header->signal;
     radioheader->freq_khz = (usb_rx->channel + 2402) * 1000;
-    radioheader->channel = fmt::format("{}", conv_header->monitor_channel);
+    radioheader->channel = kis_atom::from_uint(conv_header->monitor_channel);
     packet->insert(pack_comp_radiodata, radioheader);
 
     auto decapchunk = new kis_datachunk;
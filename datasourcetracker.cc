@@ -498,6 +498,13 @@ void datasource_tracker::trigger_deferred_startup() {
         remotecap_enabled = false;
     }
 
+    remotecap_compression =
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("remote_capture_compression", true);
+    remotecap_coalesce_ms =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("remote_capture_coalesce_ms", 250);
+    remotecap_coalesce_bytes =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("remote_capture_coalesce_bytes", 65536);
+
     config_defaults->set_remote_cap_listen(remotecap_listen);
     config_defaults->set_remote_cap_port(remotecap_port);
 
@@ -505,6 +512,40 @@ void datasource_tracker::trigger_deferred_startup() {
 
     httpd_pcap = std::make_shared<datasource_tracker_httpd_pcap>();
 
+    httpd_spectrum = std::make_shared<datasource_tracker_httpd_spectrum>();
+
+    spectrum_ranges_endp =
+        std::make_shared<kis_net_httpd_path_tracked_endpoint>(
+                [this](const std::vector<std::string>& path) -> bool {
+                    // /datasource/by-uuid/[uuid]/spectrum/ranges
+                    if (path.size() != 5)
+                        return false;
+
+                    if (path[0] != "datasource" || path[1] != "by-uuid" ||
+                            path[3] != "spectrum" || path[4] != "ranges")
+                        return false;
+
+                    uuid u(path[2]);
+
+                    if (u.error)
+                        return false;
+
+                    return find_datasource(u) != nullptr;
+                },
+                [this](const std::vector<std::string>& path) -> std::shared_ptr<tracker_element> {
+                    auto ds = find_datasource(uuid(path[2]));
+
+                    if (ds == nullptr)
+                        throw std::runtime_error("unknown datasource");
+
+                    auto store = ds->get_spectrum_store();
+
+                    if (store == nullptr)
+                        return std::make_shared<tracker_element_vector>();
+
+                    return store->summarize();
+                });
+
     // Register js module for UI
     std::shared_ptr<kis_httpd_registry> httpregistry = 
         Globalreg::fetch_mandatory_global_as<kis_httpd_registry>("WEBREGISTRY");
@@ -1117,6 +1158,9 @@ void datasource_tracker::open_remote_datasource(dst_incoming_remote *incoming,
         const std::string& in_type, const std::string& in_definition, const uuid& in_uuid) {
 
     shared_datasource merge_target_device;
+
+    // Only offer compression to remotes which asked for it
+    auto compress = remotecap_compression && incoming->get_transport_compression();
      
     local_locker lock(&dst_lock, "datasourcetracker::open_remote_datasource");
 
@@ -1151,7 +1195,9 @@ void datasource_tracker::open_remote_datasource(dst_incoming_remote *incoming,
         auto dup_definition(in_definition);
 
         // Merge the socket into the new device
-        incoming->handshake_rb(std::thread([this, merge_target_device, incoming, dup_definition]  {
+        incoming->handshake_rb(std::thread([this, merge_target_device, incoming, dup_definition, compress]  {
+                    merge_target_device->set_remote_compression(compress, remotecap_coalesce_ms,
+                            remotecap_coalesce_bytes);
                     merge_target_device->connect_remote(incoming->move_tcp_socket(), dup_definition, NULL);
                     calculate_source_hopping(merge_target_device);
                     }));
@@ -1172,6 +1218,7 @@ void datasource_tracker::open_remote_datasource(dst_incoming_remote *incoming,
 
             // Make a data source from the builder
             shared_datasource ds = b->build_datasource(b);
+            ds->set_remote_compression(compress, remotecap_coalesce_ms, remotecap_coalesce_bytes);
             ds->connect_remote(incoming->move_tcp_socket(), in_definition,
                 [this, ds](unsigned int, bool success, std::string msg) {
                     if (success)
@@ -1974,23 +2021,11 @@ KIS_MHD_RETURN datasource_tracker_httpd_pcap::httpd_create_stream_response(kis_n
                 kis_net_httpd_buffer_stream_aux *saux = 
                     (kis_net_httpd_buffer_stream_aux *) connection->custom_extension;
 
-                // Fetch the datasource component and compare *source numbers*, not
-                // actual UUIDs - a UUID compare is expensive, a numeric compare is not!
+                // Match on *source numbers*, not actual UUIDs - a UUID compare is 
+                // expensive, a numeric compare is not!
                 auto *psrb = new pcap_stream_packetchain(Globalreg::globalreg,
-                        saux->get_rbhandler(), 
-                        [this, dsnum] (kis_packet *packet) -> bool {
-                            packetchain_comp_datasource *datasrcinfo = 
-                                (packetchain_comp_datasource *) 
-                                packet->fetch(pack_comp_datasrc);
-                        
-                            if (datasrcinfo == NULL)
-                                return false;
-
-                            if (datasrcinfo->ref_source->get_source_number() == dsnum)
-                                return true;
-
-                        return false; 
-                        }, NULL);
+                        saux->get_rbhandler(), packet_tap_match::by_datasource(dsnum), 
+                        NULL, NULL);
 
 
                 saux->set_aux(psrb, 
@@ -2016,10 +2051,130 @@ KIS_MHD_RETURN datasource_tracker_httpd_pcap::httpd_create_stream_response(kis_n
     return MHD_YES;
 }
 
+std::shared_ptr<kis_spectrum_ring> 
+    datasource_tracker_httpd_spectrum::find_ring(const std::vector<std::string>& tokenurl) {
+
+    // /datasource/by-uuid/[uuid]/spectrum/[range]/waterfall/[rows]/[width]/[mode]
+    // /datasource/by-uuid/[uuid]/spectrum/[range]/live/[width]/[mode]
+    if (tokenurl.size() != 9 && tokenurl.size() != 10)
+        return nullptr;
+
+    if (tokenurl[1] != "datasource" || tokenurl[2] != "by-uuid" || tokenurl[4] != "spectrum")
+        return nullptr;
+
+    if (!(tokenurl.size() == 10 && tokenurl[6] == "waterfall") &&
+            !(tokenurl.size() == 9 && tokenurl[6] == "live"))
+        return nullptr;
+
+    uuid u(tokenurl[3]);
+
+    if (u.error)
+        return nullptr;
+
+    try {
+        for (unsigned int i = 7; i < tokenurl.size() - 1; i++)
+            string_to_n<unsigned int>(tokenurl[i]);
+
+        kis_spectrum_decimate_from_string(tokenurl[tokenurl.size() - 1]);
+    } catch (const std::exception& e) {
+        return nullptr;
+    }
+
+    auto datasourcetracker =
+        Globalreg::fetch_mandatory_global_as<datasource_tracker>("DATASOURCETRACKER");
+
+    auto ds = datasourcetracker->find_datasource(u);
+
+    if (ds == nullptr)
+        return nullptr;
+
+    auto store = ds->get_spectrum_store();
+
+    if (store == nullptr)
+        return nullptr;
+
+    return store->get_ring(string_to_n_dfl<unsigned int>(tokenurl[5], 0));
+}
+
+bool datasource_tracker_httpd_spectrum::httpd_verify_path(const char *path, const char *method) {
+    if (strcmp(method, "GET") != 0)
+        return false;
+
+    if (kis_net_httpd::get_suffix(path) != "bin")
+        return false;
+
+    return find_ring(str_tokenize(httpd_strip_suffix(path), "/")) != nullptr;
+}
+
+KIS_MHD_RETURN datasource_tracker_httpd_spectrum::httpd_create_stream_response(kis_net_httpd *httpd,
+        kis_net_httpd_connection *connection,
+        const char *url, const char *method, const char *upload_data,
+        size_t *upload_data_size) {
+
+    if (strcmp(method, "GET") != 0)
+        return MHD_YES;
+
+    if (!httpd->has_valid_session(connection)) {
+        connection->httpcode = 503;
+        return MHD_YES;
+    }
+
+    auto tokenurl = str_tokenize(httpd_strip_suffix(url), "/");
+    auto ring = find_ring(tokenurl);
+
+    if (ring == nullptr) {
+        connection->httpcode = 404;
+        return MHD_YES;
+    }
+
+    kis_net_httpd_buffer_stream_aux *saux = 
+        (kis_net_httpd_buffer_stream_aux *) connection->custom_extension;
+    auto rbh = saux->get_rbhandler();
+
+    auto write_cb = [rbh](const void *data, size_t len) -> bool {
+        return rbh->put_write_buffer_data((void *) data, len, true) == len;
+    };
+
+    auto mode = kis_spectrum_decimate_from_string(tokenurl[tokenurl.size() - 1]);
+
+    if (tokenurl[6] == "waterfall") {
+        ring->write_waterfall(write_cb, 0, string_to_n_dfl<unsigned int>(tokenurl[7], 0),
+                string_to_n_dfl<unsigned int>(tokenurl[8], 0), mode);
+        return MHD_YES;
+    }
+
+    // Live stream; we run in the generator thread for this connection until the
+    // client goes away
+    auto width = string_to_n_dfl<unsigned int>(tokenurl[7], 0);
+    auto header = ring->live_header(width, mode);
+
+    if (!write_cb(&header, sizeof(header)))
+        return MHD_YES;
+
+    kis_spectrum_bin_row row;
+    std::vector<uint8_t> power;
+    uint64_t seq = ring->get_seq();
+
+    while (!saux->get_in_error()) {
+        if (!ring->wait_live_row(seq, std::chrono::milliseconds(500), width, mode, row, power))
+            continue;
+
+        // Drop sweeps rather than buffering without limit for a slow client
+        if (rbh->get_write_buffer_used() > 1024 * 1024)
+            continue;
+
+        if (!write_cb(&row, sizeof(row)) || !write_cb(power.data(), power.size()))
+            break;
+    }
+
+    return MHD_YES;
+}
+
 dst_incoming_remote::dst_incoming_remote(callback_t in_cb) :
     kis_external_interface() {
 
     cb = in_cb;
+    transport_compression = false;
 
     timerid =
         timetracker->register_timer(std::chrono::seconds(10), 0,
@@ -2042,15 +2197,15 @@ dst_incoming_remote::~dst_incoming_remote() {
         handshake_thread.join();
 }
 
-bool dst_incoming_remote::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) { 
-    _MSG_INFO("(DEBUG) incoming_remote dispatch_packet {}", c->command());
+bool dst_incoming_remote::dispatch_rx_packet(const kis_external_command& c) { 
+    _MSG_INFO("(DEBUG) incoming_remote dispatch_packet {}", c.command);
 
     if (kis_external_interface::dispatch_rx_packet(c))
         return true;
 
     // Simple dispatch override, all we do is look for the new source
-    if (c->command() == "KDSNEWSOURCE") {
-        handle_packet_newsource(c->seqno(), c->content());
+    if (c.command == "KDSNEWSOURCE") {
+        handle_packet_newsource(c.seqno, c.content_str());
         return true;
     }
 
@@ -2089,6 +2244,8 @@ void dst_incoming_remote::handle_packet_newsource(uint32_t in_seqno, std::string
         return;
     }
 
+    transport_compression = c.has_transport_compression() && c.transport_compression();
+
     if (cb != NULL) {
         _MSG_INFO("(debug) newsource callback");
         cb(this, c.sourcetype(), c.definition(), c.uuid());
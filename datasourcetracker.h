@@ -292,6 +292,7 @@ protected:
 };
 
 class datasource_tracker_httpd_pcap;
+class datasource_tracker_httpd_spectrum;
 class datasource_tracker_remote_server;
 class dst_incoming_remote;
 
@@ -421,6 +422,11 @@ protected:
     unsigned int remotecap_port;
     std::string remotecap_listen;
 
+    // Compressed transport offered to remote captures which support it
+    bool remotecap_compression;
+    unsigned int remotecap_coalesce_ms;
+    unsigned int remotecap_coalesce_bytes;
+
     std::shared_ptr<datasource_tracker_remote_server> remotecap_v4;
 
     std::shared_ptr<datasource_tracker> datasourcetracker;
@@ -481,6 +487,10 @@ protected:
     // Our pcap http interface
     std::shared_ptr<datasource_tracker_httpd_pcap> httpd_pcap;
 
+    // Spectrum waterfalls
+    std::shared_ptr<datasource_tracker_httpd_spectrum> httpd_spectrum;
+    std::shared_ptr<kis_net_httpd_path_tracked_endpoint> spectrum_ranges_endp;
+
     // Datasource logging
     int database_log_timer;
     bool database_log_enabled;
@@ -531,6 +541,42 @@ protected:
     int pack_comp_datasrc;
 };
 
+/* Binary spectrum waterfalls of a datasource, decimated from its spectrum store.
+ * The ranges a source has swept, and their ids, are listed by
+ * /datasource/by-uuid/[uuid]/spectrum/ranges.json
+ *
+ * /datasource/by-uuid/[uuid]/spectrum/[range]/waterfall/[rows]/[width]/[min|max|avg].bin
+ *   The stored sweeps decimated to at most [rows] rows of [width] bins; 0 keeps
+ *   the full height or width
+ *
+ * /datasource/by-uuid/[uuid]/spectrum/[range]/live/[width]/[min|max|avg].bin
+ *   Each new sweep as it arrives, until the client disconnects
+ */
+class datasource_tracker_httpd_spectrum : public kis_net_httpd_chain_stream_handler {
+public:
+    datasource_tracker_httpd_spectrum() : kis_net_httpd_chain_stream_handler() {
+        bind_httpd_server();
+    }
+
+    virtual ~datasource_tracker_httpd_spectrum() { };
+
+    virtual bool httpd_verify_path(const char *path, const char *method) override;
+
+    virtual KIS_MHD_RETURN httpd_create_stream_response(kis_net_httpd *httpd,
+            kis_net_httpd_connection *connection,
+            const char *url, const char *method, const char *upload_data,
+            size_t *upload_data_size) override; 
+
+    virtual KIS_MHD_RETURN httpd_post_complete(kis_net_httpd_connection *con __attribute__((unused))) override {
+        return MHD_NO;
+    }
+
+protected:
+    // Find the spectrum range named by a tokenized path; nullptr if the path isn't
+    // a spectrum path or the range doesn't exist
+    std::shared_ptr<kis_spectrum_ring> find_ring(const std::vector<std::string>& tokenurl);
+};
+
 // Intermediary buffer handler which is responsible for parsing the incoming
 // simple packet protocol enough to get a NEWSOURCE command; The resulting source
 // type, definition, uuid, and rbufhandler is passed to the callback function; the cb
@@ -543,7 +589,7 @@ public:
     ~dst_incoming_remote();
 
     // Override the dispatch commands to handle the new source
-    virtual bool dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) override;
+    virtual bool dispatch_rx_packet(const kis_external_command& c) override;
 
     virtual void handle_msg_proxy(const std::string& msg, const int msgtype) override {
         _MSG(fmt::format("(Remote) - {}", msg), msgtype);
@@ -551,6 +597,11 @@ public:
 
     virtual void handle_packet_newsource(uint32_t in_seqno, std::string in_packet);
 
+    // Remote capture offered a compressed transport in the new source
+    bool get_transport_compression() {
+        return transport_compression;
+    }
+
     virtual void kill();
 
     virtual void handshake_rb(std::thread t) {
@@ -565,6 +616,8 @@ protected:
 
     callback_t cb;
 
+    bool transport_compression;
+
     std::thread handshake_thread;
 };
 
@@ -154,7 +154,7 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
 
 	// Common tracker, very early in the tracker chain
 	packetchain->register_handler(&Devicetracker_packethook_commontracker,
-											this, CHAINPOS_TRACKER, -100);
+											this, CHAINPOS_TRACKER, -100, "devicetracker_common");
 
     // Post any events related to the device generated during tracking mode
     // (like a new device being created) at the very END of tracking, so that
@@ -166,7 +166,7 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
             for (const auto& e : in_packet->process_complete_events)
                 eventbus->publish(e);
             return 1;
-        }, CHAINPOS_TRACKER, 0x7FFF'FFFF);
+        }, CHAINPOS_TRACKER, 0x7FFF'FFFF, "devicetracker_events");
 
     std::shared_ptr<time_tracker> timetracker = 
         Globalreg::fetch_mandatory_global_as<time_tracker>(globalreg, "TIMETRACKER");
@@ -443,6 +443,29 @@ device_tracker::device_tracker(global_registry *in_globalreg) :
     device_location_signal_threshold =
         Globalreg::globalreg->kismet_config->fetch_opt_as<int>("device_location_signal_threshold", 0);
 
+    // Index device locations in ~1km cells for map and area queries
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("device_location_index", true)) {
+        location_index = std::make_shared<device_tracker_location_index>(0.01f);
+
+        location_bbox_endp =
+            std::make_shared<kis_net_httpd_path_tracked_endpoint>(
+                    [this](const std::vector<std::string>& path) -> bool {
+                        return location_bbox_endp_path(path);
+                    },
+                    [this](const std::vector<std::string>& path) -> std::shared_ptr<tracker_element> {
+                        return location_bbox_endp_handler(path);
+                    });
+
+        location_radius_endp =
+            std::make_shared<kis_net_httpd_path_tracked_endpoint>(
+                    [this](const std::vector<std::string>& path) -> bool {
+                        return location_radius_endp_path(path);
+                    },
+                    [this](const std::vector<std::string>& path) -> std::shared_ptr<tracker_element> {
+                        return location_radius_endp_handler(path);
+                    });
+    }
+
     httpd->register_alias("/devices/summary/devices.json", "/devices/views/all/devices.json");
 }
 
@@ -457,6 +480,19 @@ void device_tracker::trigger_deferred_startup() {
                 [](std::shared_ptr<kis_tracked_device_base>) -> bool {
                     return true;
                 });
+
+    // Index the fields most commonly searched from the UI
+    if (Globalreg::globalreg->kismet_config->fetch_opt_bool("view_search_index", true)) {
+        all_view->enable_search_index({
+                "kismet.device.base.commonname",
+                "kismet.device.base.name",
+                "kismet.device.base.username",
+                "kismet.device.base.macaddr",
+                "kismet.device.base.manuf",
+                "dot11.device/dot11.device.last_beaconed_ssid_record/dot11.advertisedssid.ssid",
+                });
+    }
+
     add_view(all_view);
 
 }
@@ -505,7 +541,7 @@ device_tracker::~device_tracker() {
 void device_tracker::macdevice_timer_event() {
     local_locker lock(&devicelist_mutex);
 
-    time_t now = time(0);
+    time_t now = globalreg->timestamp.tv_sec;
 
     // Put the ones we still monitor into a new vector and swap
     // at the end
@@ -774,15 +810,15 @@ std::shared_ptr<kis_tracked_device_base>
     devinfo->devrefs[in_mac] = device;
 
     // Update the mod data
-    device->update_modtime();
+    device->update_modtime_held();
 
     // Raise alerts for new devices or devices which have been
     // idle and re-appeared
     // Also keep them in macdevice_flagged_vec to send devicelost alerts
-    auto k = macdevice_alert_conf_map.find(device->get_macaddr());
+    auto k = macdevice_alert_conf_map.find(device->get_macaddr_held());
     if (k != macdevice_alert_conf_map.end()) {
-        if (new_device || ((device->get_last_time() < in_pack->ts.tv_sec &&
-            in_pack->ts.tv_sec - device->get_last_time() > devicefound_timeout))) {
+        if (new_device || ((device->get_last_time_held() < in_pack->ts.tv_sec &&
+            in_pack->ts.tv_sec - device->get_last_time_held() > devicefound_timeout))) {
 
             if (k->second & 0x1) {
                 auto alrt =
@@ -800,23 +836,23 @@ std::shared_ptr<kis_tracked_device_base>
 
     }
 
-    if (device->get_last_time() < in_pack->ts.tv_sec)
-        device->set_last_time(in_pack->ts.tv_sec);
+    if (device->get_last_time_held() < in_pack->ts.tv_sec)
+        device->set_last_time_held(in_pack->ts.tv_sec);
 
     if (in_flags & UCD_UPDATE_PACKETS) {
-        device->inc_packets();
+        device->inc_packets_held();
 
         if (!ram_no_rrd)
             device->get_packets_rrd()->add_sample(1, globalreg->timestamp.tv_sec);
 
         if (pack_common != NULL) {
             if (pack_common->error)
-                device->inc_error_packets();
+                device->inc_error_packets_held();
 
             if (pack_common->type == packet_basic_data) {
                 // TODO fix directional data
-                device->inc_data_packets();
-                device->inc_datasize(pack_common->datasize);
+                device->inc_data_packets_held();
+                device->inc_datasize_held(pack_common->datasize);
 
                 if (!ram_no_rrd) {
                     device->get_data_rrd()->add_sample(pack_common->datasize,
@@ -843,7 +879,7 @@ std::shared_ptr<kis_tracked_device_base>
 
             } else if (pack_common->type == packet_basic_mgmt ||
                     pack_common->type == packet_basic_phy) {
-                device->inc_llc_packets();
+                device->inc_llc_packets_held();
             }
 
         }
@@ -851,11 +887,11 @@ std::shared_ptr<kis_tracked_device_base>
 
 	if ((in_flags & UCD_UPDATE_FREQUENCIES)) {
         if (pack_l1info != NULL) {
-            if (pack_l1info->channel != "0" && pack_l1info->channel != "") {
-                device->set_channel(pack_l1info->channel);
+            if (kis_atom_channel_known(pack_l1info->channel)) {
+                device->set_channel_held(pack_l1info->channel);
             }
             if (pack_l1info->freq_khz != 0)
-                device->set_frequency(pack_l1info->freq_khz);
+                device->set_frequency_held(pack_l1info->freq_khz);
 
             packinfo_sig_combo *sc = new packinfo_sig_combo(pack_l1info, pack_gpsinfo);
             device->get_signal_data()->append_signal(*sc, !ram_no_rrd, in_pack->ts.tv_sec);
@@ -864,11 +900,11 @@ std::shared_ptr<kis_tracked_device_base>
 
             device->inc_frequency_count((int) pack_l1info->freq_khz);
         } else if (pack_common != NULL) {
-            if (pack_common->channel != "0" && pack_common->channel != "") {
-                device->set_channel(pack_common->channel);
+            if (kis_atom_channel_known(pack_common->channel)) {
+                device->set_channel_held(pack_common->channel);
             }
             if (pack_common->freq_khz != 0)
-                device->set_frequency(pack_common->freq_khz);
+                device->set_frequency_held(pack_common->freq_khz);
             
             device->inc_frequency_count((int) pack_common->freq_khz);
         }
@@ -884,6 +920,9 @@ std::shared_ptr<kis_tracked_device_base>
                 pack_gpsinfo->alt, pack_gpsinfo->fix, pack_gpsinfo->speed,
                 pack_gpsinfo->heading);
 
+        if (location_index != nullptr && pack_gpsinfo->fix >= 2)
+            location_index->update_device(device, pack_gpsinfo->lat, pack_gpsinfo->lon);
+
         // Throttle history cloud to one update per second to prevent floods of
         // data from swamping the cloud
         if (track_history_cloud && pack_gpsinfo->fix >= 2 &&
@@ -934,7 +973,7 @@ std::shared_ptr<kis_tracked_device_base>
 	}
 
     if (pack_common != NULL)
-        device->add_basic_crypt(pack_common->basic_crypt_set);
+        device->add_basic_crypt_held(pack_common->basic_crypt_set);
 
     // Add the new device at the end once we've populated it
     if (new_device) {
@@ -1029,6 +1068,9 @@ int device_tracker::timetracker_event(int eventid) {
                         // Forget it from any views
                         remove_view_device(d);
 
+                        if (location_index != nullptr)
+                            location_index->remove_device(d);
+
                         // Forget it from the immutable vec, but keep its 
                         // position; we need to have vecpos = devid
                         auto iti = immutable_tracked_vec->begin() + d->get_kis_internal_id();
@@ -1086,6 +1128,9 @@ int device_tracker::timetracker_event(int eventid) {
                         }
                     }
 
+                    if (location_index != nullptr)
+                        location_index->remove_device(d);
+
                     // Forget it from the immutable vec, but keep its 
                     // position; we need to have vecpos = devid
                     auto iti = immutable_tracked_vec->begin() + d->get_kis_internal_id();
@@ -1219,6 +1264,13 @@ void device_tracker::add_device(std::shared_ptr<kis_tracked_device_base> device)
 
     auto mm_pair = std::make_pair(device->get_macaddr(), device);
     tracked_mac_multimap.emplace(mm_pair);
+
+    if (location_index != nullptr && device->has_location()) {
+        auto last_loc = device->get_location()->get_last_loc();
+
+        if (last_loc != nullptr && last_loc->get_fix() >= 2)
+            location_index->update_device(device, last_loc->get_lat(), last_loc->get_lon());
+    }
 }
 
 bool device_tracker::add_view(std::shared_ptr<device_tracker_view> in_view) {
@@ -1431,6 +1483,10 @@ void device_tracker::set_device_user_name(std::shared_ptr<kis_tracked_device_bas
 
     in_dev->set_username(in_username);
 
+    // The name is indexed for searching; bump the modification time so views re-index
+    // the device even if it is idle
+    in_dev->update_modtime_held();
+
     if (!database_valid()) {
         _MSG("Unable to store device name to permanent storage, the database connection "
                 "is not available", MSGFLAG_ERROR);
@@ -1492,6 +1548,9 @@ void device_tracker::set_device_tag(std::shared_ptr<kis_tracked_device_base> in_
         sm->insert(in_tag, e);
     }
 
+    // Tags are indexed for searching, as with the name above
+    in_dev->update_modtime_held();
+
     if (!database_valid()) {
         _MSG("Unable to store device name to permanent storage, the database connection "
                 "is not available", MSGFLAG_ERROR);
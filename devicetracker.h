@@ -53,6 +53,7 @@
 #include "kis_net_microhttpd.h"
 #include "devicetracker_view.h"
 #include "devicetracker_view_workers.h"
+#include "devicetracker_location_index.h"
 #include "kis_database.h"
 #include "eventbus.h"
 #include "robin_hood.h"
@@ -232,6 +233,11 @@ public:
     // Get phy views
     std::shared_ptr<device_tracker_view> get_phy_view(int in_phy);
 
+    // Get the device location index; may be null if location indexing is disabled
+    std::shared_ptr<device_tracker_location_index> get_location_index() {
+        return location_index;
+    }
+
     // Get a cached device type; use this to de-dup thousands of devices of the same types.
     std::shared_ptr<tracker_element_string> get_cached_devicetype(const std::string& type);
 
@@ -264,6 +270,15 @@ protected:
 
     std::shared_ptr<device_tracker_view> all_view;
 
+    // Spatial index of device locations, and the bbox and radius endpoints using it
+    std::shared_ptr<device_tracker_location_index> location_index;
+    std::shared_ptr<kis_net_httpd_path_tracked_endpoint> location_bbox_endp;
+    std::shared_ptr<kis_net_httpd_path_tracked_endpoint> location_radius_endp;
+    bool location_bbox_endp_path(const std::vector<std::string>& path);
+    std::shared_ptr<tracker_element> location_bbox_endp_handler(const std::vector<std::string>& path);
+    bool location_radius_endp_path(const std::vector<std::string>& path);
+    std::shared_ptr<tracker_element> location_radius_endp_handler(const std::vector<std::string>& path);
+
     // Map of seen-by views
     bool map_seenby_views;
     std::unordered_map<uuid, std::shared_ptr<device_tracker_view>> seenby_view_map;
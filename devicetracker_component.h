@@ -436,6 +436,8 @@ public:
             
             });
 
+    __ProxyGetHeld(macaddr, mac_addr, mac_addr, macaddr, device_mutex);
+
     // __Proxy(phyname, std::string, std::string, std::string, phyname);
     __ProxySwappingTrackable(phyname, tracker_element_string, phyname);
     __ProxyGet(phyname, std::string, std::string, phyname);
@@ -498,18 +500,28 @@ public:
 
     __Proxy(basic_crypt_set, uint64_t, uint64_t, uint64_t, basic_crypt_set);
     void add_basic_crypt(uint64_t in) { (*basic_crypt_set) |= in; }
+    void add_basic_crypt_held(uint64_t in) { 
+        kis_assert_lock_held(&device_mutex);
+        (*basic_crypt_set) |= in; 
+    }
 
     __Proxy(first_time, uint64_t, time_t, time_t, first_time);
     __Proxy(last_time, uint64_t, time_t, time_t, last_time);
+    __ProxyHeld(last_time, uint64_t, time_t, time_t, last_time, device_mutex);
 
     // Simple management of last modified time
     __Proxy(mod_time, uint64_t, time_t, time_t, mod_time);
     void update_modtime() {
         set_mod_time(time(0));
     }
+    __ProxySetHeld(mod_time, uint64_t, time_t, mod_time, device_mutex);
+    void update_modtime_held() {
+        set_mod_time_held(time(0));
+    }
 
     __Proxy(packets, uint64_t, uint64_t, uint64_t, packets);
     __ProxyIncDec(packets, uint64_t, uint64_t, packets);
+    __ProxyIncDecHeld(packets, uint64_t, uint64_t, packets, device_mutex);
 
     __Proxy(rx_packets, uint64_t, uint64_t, uint64_t, rx_packets);
     __ProxyIncDec(rx_packets, uint64_t, uint64_t, rx_packets);
@@ -518,12 +530,15 @@ public:
     __ProxyIncDec(tx_packets, uint64_t, uint64_t, tx_packets)
     __Proxy(llc_packets, uint64_t, uint64_t, uint64_t, llc_packets);
     __ProxyIncDec(llc_packets, uint64_t, uint64_t, llc_packets);
+    __ProxyIncDecHeld(llc_packets, uint64_t, uint64_t, llc_packets, device_mutex);
 
     __Proxy(error_packets, uint64_t, uint64_t, uint64_t, error_packets);
     __ProxyIncDec(error_packets, uint64_t, uint64_t, error_packets);
+    __ProxyIncDecHeld(error_packets, uint64_t, uint64_t, error_packets, device_mutex);
 
     __Proxy(data_packets, uint64_t, uint64_t, uint64_t, data_packets);
     __ProxyIncDec(data_packets, uint64_t, uint64_t, data_packets);
+    __ProxyIncDecHeld(data_packets, uint64_t, uint64_t, data_packets, device_mutex);
 
     __Proxy(crypt_packets, uint64_t, uint64_t, uint64_t, crypt_packets);
     __ProxyIncDec(crypt_packets, uint64_t, uint64_t, crypt_packets);
@@ -533,6 +548,7 @@ public:
 
     __Proxy(datasize, uint64_t, uint64_t, uint64_t, datasize);
     __ProxyIncDec(datasize, uint64_t, uint64_t, datasize);
+    __ProxyIncDecHeld(datasize, uint64_t, uint64_t, datasize, device_mutex);
 
     typedef kis_tracked_rrd<> rrdt;
     __ProxyDynamicTrackable(packets_rrd, rrdt, packets_rrd, packets_rrd_id);
@@ -542,8 +558,31 @@ public:
     __ProxyDynamicTrackable(location_cloud, kis_location_history, location_cloud, 
             location_cloud_id);
 
-    __Proxy(channel, std::string, std::string, std::string, channel);
+    __ProxyGet(channel, std::string, std::string, channel);
     __Proxy(frequency, double, double, double, frequency);
+    __ProxyGetHeld(channel, std::string, std::string, channel, device_mutex);
+    __ProxyHeld(frequency, double, double, double, frequency, device_mutex);
+
+    // Channels arrive as packet atoms; the string is only rewritten when the
+    // channel changes
+    void set_channel(const kis_atom& in_channel) {
+        if (in_channel == channel_atom)
+            return;
+
+        channel_atom = in_channel;
+        channel->set(in_channel.str());
+    }
+    void set_channel(const std::string& in_channel) {
+        set_channel(kis_atom(in_channel));
+    }
+    void set_channel_held(const kis_atom& in_channel) {
+        kis_assert_lock_held(&device_mutex);
+        set_channel(in_channel);
+    }
+    void set_channel_held(const std::string& in_channel) {
+        kis_assert_lock_held(&device_mutex);
+        set_channel(kis_atom(in_channel));
+    }
 
     __ProxyTrackable(manuf, tracker_element_string, manuf);
     __Proxy(manuf, std::string, std::string, std::string, manuf);
@@ -673,6 +712,8 @@ protected:
 
 	// Channel and frequency as per PHY type
     std::shared_ptr<tracker_element_string> channel;
+    // Atom of the last channel set
+    kis_atom channel_atom;
     std::shared_ptr<tracker_element_double> frequency;
 
     // Signal data
@@ -854,3 +854,62 @@ unsigned int device_tracker::multikey_dict_endp_handler(std::ostream& stream, co
     return 500;
 }
 
+
+bool device_tracker::location_bbox_endp_path(const std::vector<std::string>& path) {
+    // /devices/by-location/bbox/[min_lat]/[min_lon]/[max_lat]/[max_lon]/devices
+
+    if (path.size() != 8)
+        return false;
+
+    if (path[0] != "devices" || path[1] != "by-location" || path[2] != "bbox" || 
+            path[7] != "devices")
+        return false;
+
+    try {
+        for (unsigned int i = 3; i < 7; i++)
+            string_to_n<double>(path[i]);
+    } catch (const std::exception& e) {
+        return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<tracker_element> device_tracker::location_bbox_endp_handler(const std::vector<std::string>& path) {
+    if (path.size() != 8 || location_index == nullptr)
+        return std::make_shared<tracker_element_vector>();
+
+    return location_index->bbox_search(string_to_n_dfl<double>(path[3], 0),
+            string_to_n_dfl<double>(path[4], 0),
+            string_to_n_dfl<double>(path[5], 0),
+            string_to_n_dfl<double>(path[6], 0));
+}
+
+bool device_tracker::location_radius_endp_path(const std::vector<std::string>& path) {
+    // /devices/by-location/radius/[lat]/[lon]/[meters]/devices
+
+    if (path.size() != 7)
+        return false;
+
+    if (path[0] != "devices" || path[1] != "by-location" || path[2] != "radius" || 
+            path[6] != "devices")
+        return false;
+
+    try {
+        for (unsigned int i = 3; i < 6; i++)
+            string_to_n<double>(path[i]);
+    } catch (const std::exception& e) {
+        return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<tracker_element> device_tracker::location_radius_endp_handler(const std::vector<std::string>& path) {
+    if (path.size() != 7 || location_index == nullptr)
+        return std::make_shared<tracker_element_vector>();
+
+    return location_index->radius_search(string_to_n_dfl<double>(path[3], 0),
+            string_to_n_dfl<double>(path[4], 0),
+            string_to_n_dfl<double>(path[5], 0));
+}
@@ -69,9 +69,6 @@ KIS_MHD_RETURN device_tracker_httpd_pcap::httpd_create_stream_response(kis_net_h
         return MHD_YES;
     }
 
-    auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
-    int pack_comp_device = packetchain->register_packet_component("DEVICE");
-
     // /devices/by-key/[key]/pcap/[key].pcapng
 
     std::vector<std::string> tokenurl = str_tokenize(url, "/");
@@ -105,22 +102,7 @@ KIS_MHD_RETURN device_tracker_httpd_pcap::httpd_create_stream_response(kis_net_h
       
     // Filter based on the device key
     auto *psrb = new pcap_stream_packetchain(Globalreg::globalreg,
-            saux->get_rbhandler(), 
-            [key, pack_comp_device](kis_packet *packet) -> bool {
-                kis_tracked_device_info *devinfo = 
-                    (kis_tracked_device_info *) packet->fetch(pack_comp_device);
-
-                if (devinfo == NULL) {
-                    return false;
-                }
-
-                for (auto dri : devinfo->devrefs) {
-                    if (dri.second->get_key() == key)
-                        return true;
-                }
-
-                return false;
-            }, NULL);
+            saux->get_rbhandler(), packet_tap_match::by_device(key), NULL, NULL);
 
     auto streamtracker = Globalreg::fetch_mandatory_global_as<stream_tracker>("STREAMTRACKER");
 
@@ -0,0 +1,250 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "devicetracker_location_index.h"
+
+// Mean earth radius in meters
+static constexpr double earth_radius_m = 6371008.8;
+
+static double deg_to_rad(double deg) {
+    return deg * M_PI / 180.0f;
+}
+
+static double haversine_m(double lat1, double lon1, double lat2, double lon2) {
+    auto dlat = deg_to_rad(lat2 - lat1);
+    auto dlon = deg_to_rad(lon2 - lon1);
+
+    auto a = sin(dlat / 2) * sin(dlat / 2) +
+        cos(deg_to_rad(lat1)) * cos(deg_to_rad(lat2)) * sin(dlon / 2) * sin(dlon / 2);
+
+    return 2 * earth_radius_m * atan2(sqrt(a), sqrt(1 - a));
+}
+
+device_tracker_location_index::device_tracker_location_index(double in_cell_deg) :
+    cell_deg{in_cell_deg} {
+
+    if (cell_deg <= 0 || cell_deg > 180)
+        cell_deg = 0.01f;
+
+    n_lon_cells = (int64_t) ceil(360.0f / cell_deg);
+}
+
+int64_t device_tracker_location_index::lat_cell(double lat) {
+    auto max_c = (int64_t) ceil(180.0f / cell_deg) - 1;
+    auto c = (int64_t) floor((std::max(-90.0, std::min(90.0, lat)) + 90) / cell_deg);
+
+    return std::max<int64_t>(0, std::min(max_c, c));
+}
+
+int64_t device_tracker_location_index::lon_cell(double lon) {
+    auto c = (int64_t) floor((std::max(-180.0, std::min(180.0, lon)) + 180) / cell_deg);
+
+    return std::max<int64_t>(0, std::min(n_lon_cells - 1, c));
+}
+
+void device_tracker_location_index::remove_from_cell(entry& e) {
+    auto ci = cells.find(e.cell);
+
+    if (ci == cells.end())
+        return;
+
+    auto& vec = ci->second;
+
+    if (e.cell_pos != vec.size() - 1) {
+        vec[e.cell_pos] = vec.back();
+        vec[e.cell_pos]->cell_pos = e.cell_pos;
+    }
+
+    vec.pop_back();
+
+    if (vec.size() == 0)
+        cells.erase(ci);
+}
+
+void device_tracker_location_index::update_device(std::shared_ptr<kis_tracked_device_base> device,
+        double lat, double lon) {
+    local_locker l(&mutex);
+
+    auto key = cell_key(lat_cell(lat), lon_cell(lon));
+    auto ei = entries.find(device->get_key());
+
+    if (ei == entries.end()) {
+        auto& e = entries[device->get_key()];
+        e.device = device;
+        e.lat = lat;
+        e.lon = lon;
+        e.cell = key;
+
+        auto& cell = cells[key];
+        e.cell_pos = cell.size();
+        cell.push_back(&e);
+
+        return;
+    }
+
+    auto& e = ei->second;
+
+    e.lat = lat;
+    e.lon = lon;
+
+    if (e.cell == key)
+        return;
+
+    remove_from_cell(e);
+
+    e.cell = key;
+
+    auto& cell = cells[key];
+    e.cell_pos = cell.size();
+    cell.push_back(&e);
+}
+
+void device_tracker_location_index::remove_device(std::shared_ptr<kis_tracked_device_base> device) {
+    local_locker l(&mutex);
+
+    auto ei = entries.find(device->get_key());
+
+    if (ei == entries.end())
+        return;
+
+    remove_from_cell(ei->second);
+    entries.erase(ei);
+}
+
+size_t device_tracker_location_index::size() {
+    local_shared_locker l(&mutex);
+    return entries.size();
+}
+
+template<typename F>
+void device_tracker_location_index::collect_box(double min_lat, double min_lon,
+        double max_lat, double max_lon, F filter, tracker_element_vector::vector_t& out) {
+
+    auto r0 = lat_cell(min_lat);
+    auto r1 = lat_cell(max_lat);
+    auto c0 = lon_cell(min_lon);
+    auto c1 = lon_cell(max_lon);
+
+    auto match_cell = [&](const std::vector<entry *>& cell) {
+        for (auto e : cell) {
+            if (e->lat < min_lat || e->lat > max_lat || e->lon < min_lon || e->lon > max_lon)
+                continue;
+
+            if (filter(*e))
+                out.push_back(e->device);
+        }
+    };
+
+    // A large box over a sparse grid is cheaper to answer by walking the populated cells
+    if ((uint64_t) (r1 - r0 + 1) * (uint64_t) (c1 - c0 + 1) > cells.size()) {
+        for (const auto& ci : cells) {
+            auto r = (int64_t) (ci.first >> 32);
+            auto c = (int64_t) (ci.first & 0xFFFFFFFF);
+
+            if (r >= r0 && r <= r1 && c >= c0 && c <= c1)
+                match_cell(ci.second);
+        }
+
+        return;
+    }
+
+    for (auto r = r0; r <= r1; r++) {
+        for (auto c = c0; c <= c1; c++) {
+            auto ci = cells.find(cell_key(r, c));
+
+            if (ci != cells.end())
+                match_cell(ci->second);
+        }
+    }
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker_location_index::bbox_search(double min_lat,
+        double min_lon, double max_lat, double max_lon) {
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    if (min_lat > max_lat)
+        std::swap(min_lat, max_lat);
+
+    auto all = [](const entry&) -> bool { return true; };
+
+    local_shared_locker l(&mutex);
+
+    if (min_lon > max_lon) {
+        collect_box(min_lat, min_lon, max_lat, 180, all, ret->get());
+        collect_box(min_lat, -180, max_lat, max_lon, all, ret->get());
+    } else {
+        collect_box(min_lat, min_lon, max_lat, max_lon, all, ret->get());
+    }
+
+    return ret;
+}
+
+std::shared_ptr<tracker_element_vector> device_tracker_location_index::radius_search(double lat,
+        double lon, double radius_m) {
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    if (radius_m < 0)
+        return ret;
+
+    // Bounding box of the circle, then an exact distance check
+    auto dlat = (radius_m / earth_radius_m) * 180.0f / M_PI;
+    auto min_lat = std::max(-90.0, lat - dlat);
+    auto max_lat = std::min(90.0, lat + dlat);
+
+    auto within = [lat, lon, radius_m](const entry& e) -> bool {
+        return haversine_m(lat, lon, e.lat, e.lon) <= radius_m;
+    };
+
+    // Longitude extent of the circle; a circle containing a pole covers every longitude
+    auto dlon = 180.0;
+
+    if (min_lat > -90 && max_lat < 90) {
+        auto r = sin(radius_m / earth_radius_m) / cos(deg_to_rad(lat));
+
+        if (r < 1)
+            dlon = asin(r) * 180.0f / M_PI;
+    }
+
+    local_shared_locker l(&mutex);
+
+    if (dlon >= 180) {
+        collect_box(min_lat, -180, max_lat, 180, within, ret->get());
+        return ret;
+    }
+
+    auto min_lon = lon - dlon;
+    auto max_lon = lon + dlon;
+
+    if (min_lon < -180) {
+        collect_box(min_lat, -180, max_lat, max_lon, within, ret->get());
+        collect_box(min_lat, min_lon + 360, max_lat, 180, within, ret->get());
+    } else if (max_lon > 180) {
+        collect_box(min_lat, min_lon, max_lat, 180, within, ret->get());
+        collect_box(min_lat, -180, max_lat, max_lon - 360, within, ret->get());
+    } else {
+        collect_box(min_lat, min_lon, max_lat, max_lon, within, ret->get());
+    }
+
+    return ret;
+}
+
@@ -0,0 +1,92 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICE_LOCATION_INDEX_H__
+#define __DEVICE_LOCATION_INDEX_H__
+
+#include "config.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "kis_mutex.h"
+#include "trackedelement.h"
+#include "devicetracker_component.h"
+
+// Spatial index of the last known location of each device.
+//
+// Devices are bucketed into a grid of fixed-size lat/lon cells, so that a bounding box
+// or radius query only examines the devices in the cells overlapping the query instead
+// of every device in the tracker.  The index holds a copy of the location, so queries
+// don't need to lock the devices.
+//
+// Devices are added and moved by the device tracker as their location is updated, and
+// must be removed when the device is removed from the tracker.
+class device_tracker_location_index {
+public:
+    device_tracker_location_index(double in_cell_deg);
+
+    void update_device(std::shared_ptr<kis_tracked_device_base> device, double lat, double lon);
+    void remove_device(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Devices inside a bounding box; a box crossing the antimeridian is given with
+    // min_lon > max_lon
+    std::shared_ptr<tracker_element_vector> bbox_search(double min_lat, double min_lon,
+            double max_lat, double max_lon);
+
+    // Devices within radius_m meters of a point
+    std::shared_ptr<tracker_element_vector> radius_search(double lat, double lon, double radius_m);
+
+    size_t size();
+
+protected:
+    kis_recursive_timed_mutex mutex;
+
+    struct entry {
+        std::shared_ptr<kis_tracked_device_base> device;
+        double lat;
+        double lon;
+        uint64_t cell;
+
+        // Position in the cell vector, for constant-time removal
+        size_t cell_pos;
+    };
+
+    double cell_deg;
+    int64_t n_lon_cells;
+
+    std::unordered_map<device_key, entry> entries;
+    std::unordered_map<uint64_t, std::vector<entry *>> cells;
+
+    int64_t lat_cell(double lat);
+    int64_t lon_cell(double lon);
+    uint64_t cell_key(int64_t lat_c, int64_t lon_c) {
+        return ((uint64_t) lat_c << 32) | (uint64_t) lon_c;
+    }
+
+    void remove_from_cell(entry& e);
+
+    // Collect the devices in a non-wrapping box which pass the filter; mutex must be held
+    template<typename F>
+    void collect_box(double min_lat, double min_lon, double max_lat, double max_lon,
+            F filter, tracker_element_vector::vector_t& out);
+};
+
+#endif
+
@@ -23,8 +23,25 @@
 #include "devicetracker_component.h"
 #include "util.h"
 
+#include <exception>
+#include <thread>
+
 #include "kis_mutex.h"
 #include "kismet_algorithm.h"
+#include "configfile.h"
+
+// Number of threads to split view work across; defaults to one per core
+static unsigned int view_work_threads() {
+    auto n = Globalreg::globalreg->kismet_config->fetch_opt_uint("view_work_threads", 0);
+
+    if (n == 0)
+        n = std::thread::hardware_concurrency();
+
+    if (n == 0)
+        n = 1;
+
+    return n;
+}
 
 device_tracker_view::device_tracker_view(const std::string& in_id, const std::string& in_description, 
         new_device_cb in_new_cb, updated_device_cb in_update_cb) :
@@ -34,6 +51,8 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
 
     mutex.set_name(fmt::format("devicetracker_view({})", in_id));
 
+    work_threads = view_work_threads();
+
     devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
 
     register_fields();
@@ -72,6 +91,8 @@ device_tracker_view::device_tracker_view(const std::string& in_id, const std::st
 
     mutex.set_name(fmt::format("devicetracker_view({})", in_id));
 
+    work_threads = view_work_threads();
+
     devicetracker = Globalreg::fetch_mandatory_global_as<device_tracker>();
 
     register_fields();
@@ -151,60 +172,93 @@ std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_
     return do_readonly_device_work(worker, immutable_copy);
 }
 
-std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(device_tracker_view_worker& worker,
-        std::shared_ptr<tracker_element_vector> devices) {
+template<typename L>
+std::shared_ptr<tracker_element_vector> device_tracker_view::match_devices(device_tracker_view_worker& worker,
+        std::shared_ptr<tracker_element_vector> devices, L locked_match) {
     auto ret = std::make_shared<tracker_element_vector>();
-    ret->reserve(devices->size());
-    kis_recursive_timed_mutex ret_mutex;
 
-    std::for_each(devices->begin(), devices->end(),
-            [&](shared_tracker_element val) {
+    auto match_range = 
+        [&worker, &locked_match](tracker_element_vector::iterator begin, 
+                tracker_element_vector::iterator end, tracker_element_vector::vector_t& matches) {
+            for (auto i = begin; i != end; ++i) {
+                if (*i == nullptr)
+                    continue;
 
-            if (val == nullptr)
-                return;
+                auto dev = std::static_pointer_cast<kis_tracked_device_base>(*i);
 
-            auto dev = std::static_pointer_cast<kis_tracked_device_base>(val);
-
-            bool m;
-            {
-                local_locker devlocker(&dev->device_mutex);
-                m = worker.match_device(dev);
+                if (locked_match(dev))
+                    matches.push_back(dev);
             }
+        };
+
+    auto n_chunks = std::min<size_t>(work_threads, devices->size() / work_chunk_min);
+
+    if (n_chunks < 2 || !worker.parallel_safe()) {
+        ret->reserve(devices->size());
+        match_range(devices->begin(), devices->end(), ret->get());
+        return ret;
+    }
 
-            if (m) {
-                local_locker retl(&ret_mutex);
-                ret->push_back(dev);
+    // Each thread matches a contiguous chunk into its own vector, so no locking is needed
+    // on the results and they can be joined in the original order
+    auto chunk_sz = (devices->size() + n_chunks - 1) / n_chunks;
+    std::vector<tracker_element_vector::vector_t> chunk_matches(n_chunks);
+    std::vector<std::exception_ptr> chunk_errors(n_chunks);
+    std::vector<std::thread> chunk_threads;
+
+    for (size_t c = 0; c < n_chunks; c++) {
+        auto begin = devices->begin() + std::min(devices->size(), c * chunk_sz);
+        auto end = devices->begin() + std::min(devices->size(), (c + 1) * chunk_sz);
+
+        chunk_threads.emplace_back(std::thread([&, c, begin, end]() {
+            try {
+                match_range(begin, end, chunk_matches[c]);
+            } catch (...) {
+                chunk_errors[c] = std::current_exception();
             }
+        }));
+    }
 
-        });
+    for (auto& t : chunk_threads)
+        t.join();
 
-    worker.set_matched_devices(ret);
+    for (const auto& e : chunk_errors)
+        if (e != nullptr)
+            std::rethrow_exception(e);
 
-    worker.finalize();
+    size_t n_matched = 0;
+    for (const auto& m : chunk_matches)
+        n_matched += m.size();
+
+    ret->reserve(n_matched);
+    for (auto& m : chunk_matches)
+        ret->get().insert(ret->end(), std::make_move_iterator(m.begin()), std::make_move_iterator(m.end()));
 
     return ret;
 }
 
-std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_work(device_tracker_view_worker& worker,
+std::shared_ptr<tracker_element_vector> device_tracker_view::do_device_work(device_tracker_view_worker& worker,
         std::shared_ptr<tracker_element_vector> devices) {
-    auto ret = std::make_shared<tracker_element_vector>();
-    ret->reserve(devices->size());
-
-    std::for_each(devices->begin(), devices->end(),
-            [&](shared_tracker_element val) {
-
-            if (val == nullptr)
-                return;
+    auto ret = match_devices(worker, devices, 
+            [&worker](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
+                local_locker devlocker(&dev->device_mutex);
+                return worker.match_device(dev);
+            });
 
-            auto dev = std::static_pointer_cast<kis_tracked_device_base>(val);
-            local_shared_locker devlocker(&dev->device_mutex);
+    worker.set_matched_devices(ret);
 
-            auto m = worker.match_device(dev);
+    worker.finalize();
 
-            if (m) 
-                ret->push_back(dev);
+    return ret;
+}
 
-        });
+std::shared_ptr<tracker_element_vector> device_tracker_view::do_readonly_device_work(device_tracker_view_worker& worker,
+        std::shared_ptr<tracker_element_vector> devices) {
+    auto ret = match_devices(worker, devices, 
+            [&worker](std::shared_ptr<kis_tracked_device_base> dev) -> bool {
+                local_shared_locker devlocker(&dev->device_mutex);
+                return worker.match_device(dev);
+            });
 
     worker.set_matched_devices(ret);
 
@@ -217,16 +271,17 @@ void device_tracker_view::new_device(std::shared_ptr<kis_tracked_device_base> de
     if (new_cb != nullptr) {
         local_locker l(&mutex);
 
-        if (new_cb(device)) {
-            auto dpmi = device_presence_map.find(device->get_key());
+        if (!new_cb(device))
+            return;
 
-            if (dpmi == device_presence_map.end()) {
-                device_presence_map[device->get_key()] = true;
-                device_list->push_back(device);
-            }
+        auto dpmi = device_presence_map.find(device->get_key());
 
-            list_sz->set(device_list->size());
+        if (dpmi == device_presence_map.end()) {
+            device_presence_map[device->get_key()] = true;
+            device_list->push_back(device);
         }
+
+        list_sz->set(device_list->size());
     }
 }
 
@@ -235,9 +290,13 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
     if (update_cb == nullptr)
         return;
 
+    std::shared_ptr<device_tracker_view_search_index> index;
+    bool retain;
+
     {
         local_locker l(&mutex);
-        bool retain = update_cb(device);
+        retain = update_cb(device);
+        index = search_index;
 
         auto dpmi = device_presence_map.find(device->get_key());
 
@@ -247,7 +306,6 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
             device_list->push_back(device);
             device_presence_map[device->get_key()] = true;
             list_sz->set(device_list->size());
-            return;
         }
 
         // if we're removing the device, find it in the vector and remove it, and remove
@@ -261,14 +319,21 @@ void device_tracker_view::update_device(std::shared_ptr<kis_tracked_device_base>
             }
             device_presence_map.erase(dpmi);
             list_sz->set(device_list->size());
-            return;
         }
     }
+
+    // Rows of retained devices are re-indexed when the view is searched, not per
+    // packet; only drop the row of a removed device, outside of the view lock
+    if (index != nullptr && !retain)
+        index->remove_device(device);
 }
 
 void device_tracker_view::remove_device(std::shared_ptr<kis_tracked_device_base> device) {
     local_locker l(&mutex);
 
+    if (search_index != nullptr)
+        search_index->remove_device(device);
+
     auto di = device_presence_map.find(device->get_key());
 
     if (di != device_presence_map.end()) {
@@ -299,9 +364,20 @@ void device_tracker_view::add_device_direct(std::shared_ptr<kis_tracked_device_b
     list_sz->set(device_list->size());
 }
 
+void device_tracker_view::enable_search_index(const std::vector<std::string>& in_fields) {
+    // Devices are indexed the first time the view is searched
+    auto index = std::make_shared<device_tracker_view_search_index>(in_fields);
+
+    local_locker l(&mutex);
+    search_index = index;
+}
+
 void device_tracker_view::remove_device_direct(std::shared_ptr<kis_tracked_device_base> device) {
     local_locker l(&mutex);
 
+    if (search_index != nullptr)
+        search_index->remove_device(device);
+
     auto di = device_presence_map.find(device->get_key());
 
     if (di != device_presence_map.end()) {
@@ -617,11 +693,24 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
         next_work_vec->set(ts_vec->begin(), ts_vec->end());
     }
 
-    // Apply a string filter
+    std::shared_ptr<device_tracker_view_search_index> index;
+    {
+        local_shared_locker l(&mutex);
+        index = search_index;
+    }
+
+    // Apply a string filter, from the search index if it covers all the searched fields
     if (search_term.length() > 0 && search_paths.size() > 0) {
-        auto worker =
-            device_tracker_view_icasestringmatch_worker(search_term, search_paths);
-        auto s_vec = do_readonly_device_work(worker, next_work_vec);
+        std::shared_ptr<tracker_element_vector> s_vec;
+
+        if (index != nullptr && index->covers_paths(search_paths)) {
+            s_vec = index->icase_search(search_term, search_paths, next_work_vec);
+        } else {
+            auto worker =
+                device_tracker_view_icasestringmatch_worker(search_term, search_paths);
+            s_vec = do_readonly_device_work(worker, next_work_vec);
+        }
+
         next_work_vec->set(s_vec->begin(), s_vec->end());
     }
 
@@ -630,7 +719,13 @@ unsigned int device_tracker_view::device_endpoint_handler(std::ostream& stream,
         try {
             auto worker = 
                 device_tracker_view_regex_worker(regex);
-            auto r_vec = do_readonly_device_work(worker, next_work_vec);
+            std::shared_ptr<tracker_element_vector> r_vec;
+
+            if (index != nullptr && index->covers_regex(worker))
+                r_vec = index->regex_search(worker, next_work_vec);
+            else
+                r_vec = do_readonly_device_work(worker, next_work_vec);
+
             next_work_vec = r_vec;
             // next_work_vec->set(r_vec->begin(), r_vec->end());
         } catch (const std::exception& e) {
@@ -30,6 +30,7 @@
 #include "trackedcomponent.h"
 #include "devicetracker_component.h"
 #include "devicetracker_view_workers.h"
+#include "devicetracker_view_index.h"
 
 // Common view holder mechanism which handles view endpoints, view filtering, and so on.
 //
@@ -119,6 +120,10 @@ public:
     virtual void add_device_direct(std::shared_ptr<kis_tracked_device_base> device);
     virtual void remove_device_direct(std::shared_ptr<kis_tracked_device_base> device);
 
+    // Maintain a columnar search index of the given fields, which is used to answer
+    // string and regex searches of the view endpoint when they only touch indexed fields
+    void enable_search_index(const std::vector<std::string>& in_fields);
+
 protected:
     std::shared_ptr<device_tracker> devicetracker;
 
@@ -135,6 +140,17 @@ protected:
 
     kis_recursive_timed_mutex mutex;
 
+    // Number of threads view work is split across, and the smallest chunk of devices 
+    // worth handing to a thread; lists smaller than two chunks are processed inline
+    unsigned int work_threads;
+    static constexpr size_t work_chunk_min = 1024;
+
+    // Run the worker over the devices, splitting the list into contiguous chunks across
+    // threads when the worker allows it; matches are returned in list order
+    template<typename L>
+    std::shared_ptr<tracker_element_vector> match_devices(device_tracker_view_worker& worker,
+            std::shared_ptr<tracker_element_vector> devices, L locked_match);
+
     std::shared_ptr<tracker_element_string> view_id;
     std::shared_ptr<tracker_element_uuid> view_uuid;
     std::shared_ptr<tracker_element_string> view_description;
@@ -148,6 +164,10 @@ protected:
     // Map of device presence in our list for fast reference during updates
     std::unordered_map<device_key, bool> device_presence_map;
 
+    // Optional search index; the index has its own locking and must not be updated 
+    // while holding the view mutex
+    std::shared_ptr<device_tracker_view_search_index> search_index;
+
     // Complex endpoint and optional extended URI endpoint
     std::shared_ptr<kis_net_httpd_simple_post_endpoint> device_endp;
     std::shared_ptr<kis_net_httpd_simple_post_endpoint> device_uri_endp;
@@ -0,0 +1,609 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <ctype.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "devicetracker_view_index.h"
+#include "entrytracker.h"
+#include "util.h"
+
+// Compact a column arena once this much of it is held by replaced values
+static constexpr size_t index_compact_min = 64 * 1024;
+
+// Case-insensitive substring search, matching the std::toupper comparison used by the
+// icase string match worker.  The needle must already be upper-cased.
+static bool icase_find(const char *hay, size_t hay_len, const std::string& needle) {
+    const size_t n_len = needle.length();
+
+    if (n_len == 0)
+        return hay_len != 0;
+
+    if (n_len > hay_len)
+        return false;
+
+    const char *n = needle.data();
+    const char first_up = n[0];
+    const char first_lo = (char) tolower((unsigned char) first_up);
+    const size_t last = hay_len - n_len;
+
+    auto match_at = [&](size_t p) -> bool {
+        for (size_t k = 1; k < n_len; k++)
+            if ((char) toupper((unsigned char) hay[p + k]) != n[k])
+                return false;
+        return true;
+    };
+
+    size_t p = 0;
+
+#ifdef __SSE2__
+    // Find candidate positions 16 at a time by comparing the first character in
+    // either case, then verify the rest of the needle at each candidate
+    const __m128i v_up = _mm_set1_epi8(first_up);
+    const __m128i v_lo = _mm_set1_epi8(first_lo);
+
+    for (; p + 16 <= last + 1; p += 16) {
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + p));
+        unsigned int bits =
+            _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(h, v_up), _mm_cmpeq_epi8(h, v_lo)));
+
+        while (bits != 0) {
+            auto b = __builtin_ctz(bits);
+
+            if (match_at(p + b))
+                return true;
+
+            bits &= bits - 1;
+        }
+    }
+#endif
+
+    for (; p <= last; p++) {
+        if ((hay[p] == first_up || hay[p] == first_lo) && match_at(p))
+            return true;
+    }
+
+    return false;
+}
+
+// Can the path pass through anything other than a map, which the regex worker would
+// expand into multiple values.  Decided from the registered field types so that it is
+// known before any device is staged; aliases and unknown fields are assumed to expand.
+static bool path_may_expand(const std::vector<int>& path) {
+    for (size_t pi = 0; pi + 1 < path.size(); pi++) {
+        auto builder = Globalreg::globalreg->entrytracker->get_builder(path[pi]);
+
+        if (builder == nullptr || builder->get_type() != tracker_type::tracker_map)
+            return true;
+    }
+
+    return false;
+}
+
+device_tracker_view_search_index::device_tracker_view_search_index(const std::vector<std::string>& in_fields) :
+    removal_gen{0} {
+
+    mutex.set_name("device_tracker_view_search_index");
+
+    for (const auto& f : in_fields) {
+        column c;
+
+        c.field = f;
+        c.resolved = false;
+        c.multi = false;
+        c.stale_len = 0;
+
+        columns.push_back(std::move(c));
+    }
+
+    column_paths = std::make_shared<std::vector<std::vector<int>>>(columns.size());
+    column_gen = 0;
+
+    resolve_columns();
+}
+
+bool device_tracker_view_search_index::resolve_columns() {
+    local_locker l(&mutex);
+
+    bool changed = false;
+    auto paths = std::make_shared<std::vector<std::vector<int>>>(*column_paths);
+
+    for (size_t c = 0; c < columns.size(); c++) {
+        auto& col = columns[c];
+
+        if (col.resolved)
+            continue;
+
+        // Fields registered by phys or dynamically by components may not exist yet
+        auto resolved = tracker_element_summary(col.field).resolved_path;
+
+        if (resolved.size() == 0 || std::find(resolved.begin(), resolved.end(), -1) != resolved.end())
+            continue;
+
+        col.path = resolved;
+        col.resolved = true;
+        col.multi = col.multi || path_may_expand(resolved);
+        (*paths)[c] = resolved;
+        changed = true;
+    }
+
+    if (changed) {
+        column_paths = paths;
+        column_gen++;
+
+        // Every existing row is missing the newly resolved columns
+        for (auto& ts : row_ts)
+            ts = 0;
+    }
+
+    return changed;
+}
+
+void device_tracker_view_search_index::stage_device(std::shared_ptr<kis_tracked_device_base> device,
+        staged_row& row) {
+    std::shared_ptr<std::vector<std::vector<int>>> paths;
+
+    {
+        local_locker l(&mutex);
+        paths = column_paths;
+        row.gen = column_gen;
+    }
+
+    row.device = device;
+    row.ts = time(0);
+    row.cells.clear();
+    row.cells.resize(paths->size());
+    row.text.clear();
+    row.text.resize(paths->size());
+    row.multi.clear();
+    row.multi.resize(paths->size(), false);
+
+    local_shared_locker dl(&device->device_mutex);
+
+    for (size_t c = 0; c < paths->size(); c++) {
+        const auto& path = (*paths)[c];
+
+        if (path.size() == 0)
+            continue;
+
+        shared_tracker_element e = device;
+
+        for (size_t pi = 0; pi < path.size() && e != nullptr; pi++) {
+            if (pi > 0 && e->get_type() == tracker_type::tracker_alias)
+                e = std::static_pointer_cast<tracker_element_alias>(e)->get();
+
+            if (e == nullptr)
+                break;
+
+            // Only plain map paths can be indexed; containers along the path are
+            // expanded by the regex worker, so flag the column as unusable for regexes
+            if (e->get_type() != tracker_type::tracker_map) {
+                row.multi[c] = true;
+                e = nullptr;
+                break;
+            }
+
+            e = std::static_pointer_cast<tracker_element_map>(e)->get_sub(path[pi]);
+        }
+
+        if (e == nullptr)
+            continue;
+
+        auto& cell = row.cells[c];
+
+        switch (e->get_type()) {
+            case tracker_type::tracker_string:
+                cell.set = true;
+                cell.type = tracker_type::tracker_string;
+                row.text[c] = std::static_pointer_cast<tracker_element_string>(e)->get();
+                break;
+            case tracker_type::tracker_byte_array:
+                cell.set = true;
+                cell.type = tracker_type::tracker_byte_array;
+                row.text[c] = std::static_pointer_cast<tracker_element_byte_array>(e)->get();
+                break;
+            case tracker_type::tracker_mac_addr:
+                cell.set = true;
+                cell.type = tracker_type::tracker_mac_addr;
+                cell.mac = std::static_pointer_cast<tracker_element_mac_addr>(e)->get();
+                break;
+            case tracker_type::tracker_uuid:
+                cell.set = true;
+                cell.type = tracker_type::tracker_uuid;
+                row.text[c] = std::static_pointer_cast<tracker_element_uuid>(e)->get().uuid_to_string();
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void device_tracker_view_search_index::apply_row(staged_row& row, bool allow_create) {
+    local_locker l(&mutex);
+
+    size_t r;
+
+    auto rmi = row_map.find(row.device->get_key());
+    if (rmi != row_map.end()) {
+        r = rmi->second;
+    } else {
+        if (!allow_create)
+            return;
+
+        if (free_rows.size() > 0) {
+            r = free_rows.back();
+            free_rows.pop_back();
+        } else {
+            r = row_devices.size();
+            row_devices.push_back(nullptr);
+            row_ts.push_back(0);
+
+            for (auto& col : columns)
+                col.cells.resize(row_devices.size());
+        }
+
+        row_map[row.device->get_key()] = r;
+        row_devices[r] = row.device;
+    }
+
+    // Rows staged before a column was resolved are still missing it
+    row_ts[r] = row.gen == column_gen ? row.ts : 0;
+
+    for (size_t c = 0; c < columns.size() && c < row.cells.size(); c++) {
+        auto& col = columns[c];
+        auto& dst = col.cells[r];
+        const auto& src = row.cells[c];
+        const auto& text = row.text[c];
+
+        if (row.multi[c])
+            col.multi = true;
+
+        if (text.length() <= dst.len) {
+            // Overwrite in place when the value still fits
+            if (text.length() != 0)
+                memcpy(&col.arena[dst.offt], text.data(), text.length());
+            col.stale_len += dst.len - text.length();
+        } else {
+            col.stale_len += dst.len;
+            dst.offt = col.arena.length();
+            col.arena.append(text);
+        }
+
+        dst.len = text.length();
+        dst.set = src.set;
+        dst.type = src.type;
+        dst.mac = src.mac;
+
+        if (col.stale_len > index_compact_min && col.stale_len > col.arena.length() / 2)
+            compact_column(col);
+    }
+}
+
+void device_tracker_view_search_index::compact_column(column& col) {
+    std::string arena;
+    arena.reserve(col.arena.length() - col.stale_len);
+
+    for (auto& cell : col.cells) {
+        auto offt = arena.length();
+        arena.append(col.arena, cell.offt, cell.len);
+        cell.offt = offt;
+    }
+
+    col.arena = std::move(arena);
+    col.stale_len = 0;
+}
+
+void device_tracker_view_search_index::remove_device(std::shared_ptr<kis_tracked_device_base> device) {
+    local_locker l(&mutex);
+
+    removal_gen++;
+
+    auto rmi = row_map.find(device->get_key());
+    if (rmi == row_map.end())
+        return;
+
+    auto r = rmi->second;
+    row_map.erase(rmi);
+
+    for (auto& col : columns) {
+        col.stale_len += col.cells[r].len;
+        col.cells[r] = cell();
+    }
+
+    row_devices[r] = nullptr;
+    row_ts[r] = 0;
+    free_rows.push_back(r);
+}
+
+void device_tracker_view_search_index::refresh_devices(std::shared_ptr<tracker_element_vector> devices) {
+    resolve_columns();
+
+    // Collect the index time of every row without touching the devices; the device
+    // mutex must never be acquired while holding the index mutex
+    std::vector<time_t> row_stamps;
+    row_stamps.reserve(devices->size());
+    unsigned int snapshot_removal_gen;
+
+    {
+        local_locker l(&mutex);
+
+        snapshot_removal_gen = removal_gen;
+
+        for (const auto& d : *devices) {
+            if (d == nullptr) {
+                row_stamps.push_back(0);
+                continue;
+            }
+
+            auto dev = std::static_pointer_cast<kis_tracked_device_base>(d);
+            auto rmi = row_map.find(dev->get_key());
+
+            if (rmi == row_map.end())
+                row_stamps.push_back(0);
+            else
+                row_stamps.push_back(row_ts[rmi->second]);
+        }
+    }
+
+    // Re-stage any device modified at or after the time it was last indexed
+    std::vector<staged_row> staged;
+
+    for (size_t i = 0; i < devices->size(); i++) {
+        const auto& d = (*devices)[i];
+
+        if (d == nullptr)
+            continue;
+
+        auto dev = std::static_pointer_cast<kis_tracked_device_base>(d);
+
+        {
+            local_shared_locker dl(&dev->device_mutex);
+            if (row_stamps[i] != 0 && dev->get_mod_time() < row_stamps[i])
+                continue;
+        }
+
+        staged.push_back(staged_row());
+        stage_device(dev, staged.back());
+    }
+
+    // Don't re-create rows for devices which may have been removed from the view while
+    // they were being staged
+    bool allow_create;
+    {
+        local_locker l(&mutex);
+        allow_create = snapshot_removal_gen == removal_gen;
+    }
+
+    for (auto& s : staged)
+        apply_row(s, allow_create);
+}
+
+std::shared_ptr<tracker_element_vector>
+    device_tracker_view_search_index::collect_matched(std::shared_ptr<tracker_element_vector> devices,
+            const std::vector<uint8_t>& row_matched) {
+
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    for (const auto& d : *devices) {
+        if (d == nullptr)
+            continue;
+
+        auto dev = std::static_pointer_cast<kis_tracked_device_base>(d);
+        auto rmi = row_map.find(dev->get_key());
+
+        if (rmi == row_map.end())
+            continue;
+
+        if (row_matched[rmi->second])
+            ret->push_back(d);
+    }
+
+    return ret;
+}
+
+int device_tracker_view_search_index::find_column(const std::vector<int>& path) {
+    for (size_t c = 0; c < columns.size(); c++)
+        if (columns[c].resolved && columns[c].path == path)
+            return c;
+
+    return -1;
+}
+
+int device_tracker_view_search_index::find_column(const std::string& field) {
+    for (size_t c = 0; c < columns.size(); c++)
+        if (columns[c].resolved && columns[c].field == field)
+            return c;
+
+    return -1;
+}
+
+bool device_tracker_view_search_index::covers_paths(const std::vector<std::vector<int>>& in_paths) {
+    resolve_columns();
+
+    local_locker l(&mutex);
+
+    for (const auto& p : in_paths) {
+        if (find_column(p) >= 0)
+            continue;
+
+        // Paths which aren't indexed can still be covered if they can never match a
+        // string search; only string, byte array, and mac fields are compared
+        if (p.size() == 0 || std::find(p.begin(), p.end(), -1) != p.end())
+            continue;
+
+        auto builder = Globalreg::globalreg->entrytracker->get_builder(p.back());
+
+        if (builder == nullptr)
+            continue;
+
+        switch (builder->get_type()) {
+            case tracker_type::tracker_string:
+            case tracker_type::tracker_byte_array:
+            case tracker_type::tracker_mac_addr:
+                return false;
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+bool device_tracker_view_search_index::covers_regex(const device_tracker_view_regex_worker& worker) {
+#ifdef HAVE_LIBPCRE
+    resolve_columns();
+
+    local_locker l(&mutex);
+
+    for (const auto& f : worker.filter_vec) {
+        auto c = find_column(f->target);
+
+        if (c < 0 || columns[c].multi)
+            return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::shared_ptr<tracker_element_vector>
+    device_tracker_view_search_index::icase_search(const std::string& query,
+            const std::vector<std::vector<int>>& in_paths,
+            std::shared_ptr<tracker_element_vector> devices) {
+
+    refresh_devices(devices);
+
+    std::string upper_query;
+    upper_query.reserve(query.length());
+    for (auto ch : query)
+        upper_query.push_back((char) toupper((unsigned char) ch));
+
+    uint64_t mac_query_term;
+    unsigned int mac_query_term_len;
+    mac_addr::prepare_search_term(query, mac_query_term, mac_query_term_len);
+
+    local_locker l(&mutex);
+
+    std::vector<uint8_t> row_matched(row_devices.size(), 0);
+
+    for (const auto& p : in_paths) {
+        auto c = find_column(p);
+
+        if (c < 0)
+            continue;
+
+        const auto& col = columns[c];
+        const char *arena = col.arena.data();
+
+        for (size_t r = 0; r < col.cells.size(); r++) {
+            if (row_matched[r])
+                continue;
+
+            const auto& cell = col.cells[r];
+
+            if (!cell.set)
+                continue;
+
+            switch (cell.type) {
+                case tracker_type::tracker_string:
+                case tracker_type::tracker_byte_array:
+                    row_matched[r] = icase_find(arena + cell.offt, cell.len, upper_query);
+                    break;
+                case tracker_type::tracker_mac_addr:
+                    if (mac_query_term_len != 0)
+                        row_matched[r] = cell.mac.partial_search(mac_query_term, mac_query_term_len);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return collect_matched(devices, row_matched);
+}
+
+std::shared_ptr<tracker_element_vector>
+    device_tracker_view_search_index::regex_search(const device_tracker_view_regex_worker& worker,
+            std::shared_ptr<tracker_element_vector> devices) {
+
+    refresh_devices(devices);
+
+    local_locker l(&mutex);
+
+    std::vector<uint8_t> row_matched(row_devices.size(), 0);
+
+#ifdef HAVE_LIBPCRE
+    for (const auto& f : worker.filter_vec) {
+        auto c = find_column(f->target);
+
+        if (c < 0)
+            continue;
+
+        const auto& col = columns[c];
+        const char *arena = col.arena.data();
+        std::string mac_str;
+
+        for (size_t r = 0; r < col.cells.size(); r++) {
+            if (row_matched[r])
+                continue;
+
+            const auto& cell = col.cells[r];
+            const char *val;
+
+            if (!cell.set)
+                continue;
+
+            size_t val_len;
+
+            switch (cell.type) {
+                case tracker_type::tracker_string:
+                case tracker_type::tracker_byte_array:
+                case tracker_type::tracker_uuid:
+                    val = arena + cell.offt;
+                    val_len = cell.len;
+                    break;
+                case tracker_type::tracker_mac_addr:
+                    mac_str = cell.mac.mac_to_string();
+                    val = mac_str.data();
+                    val_len = mac_str.length();
+                    break;
+                default:
+                    continue;
+            }
+
+            int ovector[128];
+
+            if (pcre_exec(f->re, f->study, val, val_len, 0, 0, ovector, 128) >= 0)
+                row_matched[r] = 1;
+        }
+    }
+#endif
+
+    return collect_matched(devices, row_matched);
+}
+
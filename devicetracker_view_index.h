@@ -0,0 +1,159 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __DEVICE_VIEW_INDEX_H__
+#define __DEVICE_VIEW_INDEX_H__
+
+#include "config.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kis_mutex.h"
+#include "macaddr.h"
+#include "trackedelement.h"
+#include "devicetracker_component.h"
+#include "devicetracker_view_workers.h"
+
+// Columnar search index for a device view.
+//
+// Searching a view with the string and regex workers resolves every search path on
+// every device and stringifies the value at query time.  The search index instead keeps
+// a copy of a fixed set of searchable fields (names, MAC addresses, SSIDs, etc) in
+// per-field columns of contiguous memory, so that a search is a linear scan of the
+// column.
+//
+// Rows are not updated on the packet path; when the view is searched, any device
+// without a row, or modified since its row was last indexed, is re-indexed first, so
+// the cost of indexing is only paid by searches and only for devices which changed.
+// Devices removed from the view are removed from the index immediately.
+//
+// The index only answers a search when it produces the same result as the equivalent
+// worker; callers should fall back to the worker when covers_paths() or
+// covers_regex() returns false.
+class device_tracker_view_search_index {
+public:
+    device_tracker_view_search_index(const std::vector<std::string>& in_fields);
+
+    void remove_device(std::shared_ptr<kis_tracked_device_base> device);
+
+    // Can an icase string search over these resolved paths be answered from the index
+    bool covers_paths(const std::vector<std::vector<int>>& in_paths);
+
+    // Can a regex search over these targets be answered from the index
+    bool covers_regex(const device_tracker_view_regex_worker& worker);
+
+    // Equivalent of running a device_tracker_view_icasestringmatch_worker over the
+    // devices; matches are returned in the order of the input vector
+    std::shared_ptr<tracker_element_vector> icase_search(const std::string& query,
+            const std::vector<std::vector<int>>& in_paths,
+            std::shared_ptr<tracker_element_vector> devices);
+
+    // Equivalent of running the regex worker over the devices
+    std::shared_ptr<tracker_element_vector> regex_search(const device_tracker_view_regex_worker& worker,
+            std::shared_ptr<tracker_element_vector> devices);
+
+protected:
+    kis_recursive_timed_mutex mutex;
+
+    // Indexed value of a single field of a single device; text values are stored in
+    // the column arena
+    struct cell {
+        cell() :
+            offt{0},
+            len{0},
+            set{false},
+            type{tracker_type::tracker_string} { }
+
+        size_t offt;
+        size_t len;
+
+        // Does the device have a searchable value for this field
+        bool set;
+        tracker_type type;
+        mac_addr mac;
+    };
+
+    struct column {
+        std::string field;
+        std::vector<int> path;
+        bool resolved;
+
+        // Set when the path can pass through a container, which the regex worker 
+        // would expand into multiple values; decided from the field types when the
+        // column is resolved, and also set if a staged device turns out to have one
+        bool multi;
+
+        std::string arena;
+        size_t stale_len;
+        std::vector<cell> cells;
+    };
+
+    // Field values extracted from a device, held outside of the index lock
+    struct staged_row {
+        std::shared_ptr<kis_tracked_device_base> device;
+        time_t ts;
+        unsigned int gen;
+        std::vector<cell> cells;
+        std::vector<std::string> text;
+        std::vector<bool> multi;
+    };
+
+    std::vector<column> columns;
+
+    // Resolved column paths, replaced as a whole when a column is resolved so that 
+    // devices can be staged without holding the index mutex
+    std::shared_ptr<std::vector<std::vector<int>>> column_paths;
+    unsigned int column_gen;
+
+    // Incremented when a device is removed, so that a search doesn't re-add a device
+    // removed while the search was in progress
+    unsigned int removal_gen;
+
+    std::unordered_map<device_key, size_t> row_map;
+    std::vector<std::shared_ptr<kis_tracked_device_base>> row_devices;
+    std::vector<time_t> row_ts;
+    std::vector<size_t> free_rows;
+
+    // Resolve any columns which could not be resolved yet because the field had not
+    // been registered; returns true if any column changed
+    bool resolve_columns();
+
+    // Extract the indexed fields from a device.  Must not be called with the index
+    // mutex held, as it acquires the device mutex.
+    void stage_device(std::shared_ptr<kis_tracked_device_base> device, staged_row& row);
+
+    // Apply a staged row, optionally creating a row for a device not yet indexed
+    void apply_row(staged_row& row, bool allow_create);
+    void compact_column(column& col);
+
+    // Bring the rows of the devices up to date before a search
+    void refresh_devices(std::shared_ptr<tracker_element_vector> devices);
+
+    // Collect devices with matching rows, in input order; index mutex must be held
+    std::shared_ptr<tracker_element_vector> collect_matched(std::shared_ptr<tracker_element_vector> devices,
+            const std::vector<uint8_t>& row_matched);
+
+    int find_column(const std::vector<int>& path);
+    int find_column(const std::string& field);
+};
+
+#endif
+
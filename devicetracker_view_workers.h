@@ -47,6 +47,11 @@ public:
 
     virtual void finalize() { }
 
+    // Workers which only inspect the device and hold no mutable state may be run 
+    // concurrently over chunks of a view; workers which accumulate state in 
+    // match_device must leave this false.
+    virtual bool parallel_safe() const { return false; }
+
 protected:
     friend class device_tracker_view;
 
@@ -109,7 +114,11 @@ public:
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
 
+    virtual bool parallel_safe() const override { return true; }
+
 protected:
+    friend class device_tracker_view_search_index;
+
     std::vector<std::shared_ptr<device_tracker_view_regex_worker::pcre_filter>> filter_vec;
 
 };
@@ -133,6 +142,8 @@ public:
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
 
+    virtual bool parallel_safe() const override { return true; }
+
 protected:
     std::string query;
     std::vector<std::vector<int>> fieldpaths;
@@ -160,6 +171,8 @@ public:
 
     virtual bool match_device(std::shared_ptr<kis_tracked_device_base> device) override;
 
+    virtual bool parallel_safe() const override { return true; }
+
 protected:
     std::string query;
     std::vector<std::vector<int>> fieldpaths;
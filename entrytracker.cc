@@ -22,6 +22,7 @@
 #include "util.h"
 
 #include "entrytracker.h"
+#include "json_adapter.h"
 #include "messagebus.h"
 
 entry_tracker::entry_tracker() {
@@ -29,6 +30,8 @@ entry_tracker::entry_tracker() {
     serializer_mutex.set_name("entry_tracker_serializer");
 
     next_field_num = 1;
+
+    field_slabs = true;
 }
 
 entry_tracker::~entry_tracker() {
@@ -107,6 +110,7 @@ int entry_tracker::register_field(const std::string& in_name,
     definition->field_id = next_field_num++;
     definition->field_name = in_name;
     definition->field_description = in_desc;
+    definition->field_json_name = json_adapter::sanitize_string(in_name);
     definition->builder = std::move(in_builder);
     definition->builder->set_id(definition->field_id);
 
@@ -140,6 +144,7 @@ std::shared_ptr<tracker_element> entry_tracker::register_and_get_field(const std
     definition->field_id = next_field_num++;
     definition->field_name = in_name;
     definition->field_description = in_desc;
+    definition->field_json_name = json_adapter::sanitize_string(in_name);
     definition->builder = std::move(in_builder);
     definition->builder->set_id(definition->field_id);
 
@@ -197,6 +202,28 @@ std::shared_ptr<tracker_element> entry_tracker::get_shared_instance(int in_id) {
     return iter->second->builder->clone_type();
 }
 
+tracker_element *entry_tracker::get_builder(int in_id) {
+    local_shared_locker lock(&entry_mutex);
+
+    auto iter = field_id_map.find(in_id);
+
+    if (iter == field_id_map.end())
+        return nullptr;
+
+    return iter->second->builder.get();
+}
+
+const std::string *entry_tracker::get_field_json_name(int in_id) {
+    local_shared_locker lock(&entry_mutex);
+
+    auto iter = field_id_map.find(in_id);
+
+    if (iter == field_id_map.end())
+        return nullptr;
+
+    return &(iter->second->field_json_name);
+}
+
 std::shared_ptr<tracker_element> entry_tracker::get_shared_instance(const std::string& in_name) {
     local_demand_locker lock(&entry_mutex, "entrytracker::get_shared_instance (name)");
 
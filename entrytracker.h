@@ -102,6 +102,23 @@ public:
     }
     std::shared_ptr<tracker_element> get_shared_instance(int in_id);
 
+    // Get the builder instance for a field, or nullptr if the field is not registered.
+    // Builders are never removed once registered, so the pointer remains valid for the 
+    // lifetime of the entry tracker; this is used to construct fields in place when 
+    // packing component slabs.
+    tracker_element *get_builder(int in_id);
+
+    // Get the JSON-sanitized name of a field, or nullptr if the field is not registered.
+    // Like builders, the name is immutable once registered, so serializers may cache
+    // the pointer for the duration of a serialization pass.
+    const std::string *get_field_json_name(int in_id);
+
+    // Pack the fixed fields of new components into one slab allocation per component
+    // (see tracker_component::reserve_fields).  Set from tracker_field_slabs at startup,
+    // before any components are built.
+    void set_field_slabs(bool in_slabs) { field_slabs = in_slabs; }
+    bool get_field_slabs() const { return field_slabs; }
+
     // Register a serializer for auto-serialization based on type
     void register_serializer(const std::string& type, std::shared_ptr<tracker_element_serializer> in_ser);
     void remove_serializer(const std::string& type);
@@ -115,6 +132,8 @@ protected:
 
     int next_field_num;
 
+    bool field_slabs;
+
     struct reserved_field {
         // ID we assigned
         int field_id;
@@ -123,6 +142,9 @@ protected:
         std::string field_name;
         std::string field_description;
 
+        // Field name pre-sanitized for JSON output
+        std::string field_json_name;
+
         // Builder instance
         std::unique_ptr<tracker_element> builder;
     };
@@ -76,9 +76,9 @@ class kis_net_httpd;
 // in future code
 #define _ALERT(x, y, z, a)	Globalreg::globalreg->alertracker->raise_alert((x), (y), \
 	(z)->bssid_mac, (z)->source_mac, (z)->dest_mac, (z)->other_mac, \
-	(z)->channel, (a))
+	(z)->channel.str(), (a))
 #define _COMMONALERT(t, p, c, b, a)  Globalreg::globalreg->alertracker->raise_alert((t), (p), \
-	(b), (c)->source, (c)->dest, mac_addr(0), (c)->channel, (a))
+	(b), (c)->source, (c)->dest, mac_addr(0), (c)->channel.str(), (a))
 
 // Send a msg via gloablreg msgbus
 #define _MSG(x, y)	Globalreg::globalreg->messagebus->inject_message((x), (y))
@@ -28,6 +28,7 @@
 
 kis_gps_gpsd_v3::kis_gps_gpsd_v3(shared_gps_builder in_builder) : 
     kis_gps(in_builder),
+    strand{Globalreg::globalreg->io},
     resolver{Globalreg::globalreg->io},
     socket{Globalreg::globalreg->io} {
 
@@ -114,9 +115,9 @@ void kis_gps_gpsd_v3::start_connect(std::shared_ptr<kis_gps_gpsd_v3> ref,
         set_int_device_connected(false);
     } else {
         asio::async_connect(socket, endpoints,
-                [this, ref](const asio::error_code& ec, tcp::resolver::iterator endpoint) {
+                strand.wrap([this, ref](const asio::error_code& ec, tcp::resolver::iterator endpoint) {
                     handle_connect(ref, ec, endpoint);
-                });
+                }));
     }
 }
 
@@ -146,8 +147,11 @@ void kis_gps_gpsd_v3::write_gpsd(std::shared_ptr<kis_gps_gpsd_v3> ref, const std
     if (stopped)
         return;
 
-    asio::async_write(socket, asio::buffer(data),
-            [this](const asio::error_code& error, std::size_t) {
+    // The command is often a temporary; keep a copy until the write completes
+    auto buf = std::make_shared<std::string>(data);
+
+    asio::async_write(socket, asio::buffer(*buf),
+            strand.wrap([this, buf](const asio::error_code& error, std::size_t) {
                 if (error) {
                     if (error.value() == asio::error::operation_aborted)
                         return;
@@ -155,14 +159,14 @@ void kis_gps_gpsd_v3::write_gpsd(std::shared_ptr<kis_gps_gpsd_v3> ref, const std
                     _MSG_ERROR("(GPS) Error writing GPSD command: {}", error.message());
                     close();
                 }
-            });
+            }));
 }
 
 void kis_gps_gpsd_v3::start_read(std::shared_ptr<kis_gps_gpsd_v3> ref) {
     asio::async_read_until(socket, in_buf, '\n',
-            [this, ref](const asio::error_code& error, std::size_t t) {
+            strand.wrap([this, ref](const asio::error_code& error, std::size_t t) {
                 handle_read(ref, error, t);
-            });
+            }));
 
 }
 
@@ -671,9 +675,9 @@ bool kis_gps_gpsd_v3::open_gps(std::string in_opts) {
     _MSG_INFO("(GPS) Connecting to GPSD on {}:{}", host, port);
 
     resolver.async_resolve(tcp::resolver::query(host.c_str(), port.c_str()),
-            [this](const asio::error_code& error, tcp::resolver::iterator endp) {
+            strand.wrap([this](const asio::error_code& error, tcp::resolver::iterator endp) {
                 start_connect(shared_from_this(), error, endp);
-            });
+            }));
 
     return 1;
 }
@@ -54,6 +54,9 @@ protected:
 
     std::atomic<bool> stopped;
 
+    // Serializes the handlers of this connection when the io service runs multiple threads
+    asio::io_service::strand strand;
+
     tcp::resolver resolver;
     tcp::socket socket;
 
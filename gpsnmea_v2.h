@@ -36,6 +36,7 @@ class kis_gps_nmea_v2 : public kis_gps, public std::enable_shared_from_this<kis_
 public:
     kis_gps_nmea_v2(shared_gps_builder in_builder) :
         kis_gps(in_builder),
+        strand(Globalreg::globalreg->io),
         last_heading_time(time(0)),
 		last_data_time(time(0)) { }
 
@@ -49,6 +50,9 @@ protected:
     virtual void handle_read(std::shared_ptr<kis_gps_nmea_v2> ref,
             const asio::error_code& error, std::size_t sz);
 
+    // Serializes the handlers of this device when the io service runs multiple threads
+    asio::io_service::strand strand;
+
     asio::streambuf in_buf;
     std::atomic<bool> stopped;
 
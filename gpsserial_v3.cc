@@ -108,9 +108,9 @@ void kis_gps_serial_v3::close() {
 
 void kis_gps_serial_v3::start_read_impl() {
     asio::async_read_until(serialport, in_buf, '\n',
-            [this](const asio::error_code& error, std::size_t t) {
+            strand.wrap([this](const asio::error_code& error, std::size_t t) {
                 handle_read(shared_from_this(), error, t);
-            });
+            }));
 
 }
 
@@ -98,9 +98,9 @@ void kis_gps_tcp_v2::close() {
 
 void kis_gps_tcp_v2::start_read_impl() {
     asio::async_read_until(socket, in_buf, '\n',
-            [this](const asio::error_code& error, std::size_t t) {
+            strand.wrap([this](const asio::error_code& error, std::size_t t) {
                 handle_read(shared_from_this(), error, t);
-            });
+            }));
 
 }
 
@@ -112,9 +112,9 @@ void kis_gps_tcp_v2::start_connect(std::shared_ptr<kis_gps_tcp_v2> ref,
         set_int_device_connected(false);
     } else {
         asio::async_connect(socket, endpoints,
-                [this, ref](const asio::error_code& ec, tcp::resolver::iterator endpoint) {
+                strand.wrap([this, ref](const asio::error_code& ec, tcp::resolver::iterator endpoint) {
                     handle_connect(ref, ec, endpoint);
-                });
+                }));
     }
 }
 
@@ -184,10 +184,10 @@ bool kis_gps_tcp_v2::open_gps(std::string in_opts) {
     _MSG_INFO("(GPS) Connecting to TCP GPS on {}:{}", host, port);
 
     resolver.async_resolve(tcp::resolver::query(host.c_str(), port.c_str()),
-            [this](const asio::error_code& error, tcp::resolver::iterator endp) {
+            strand.wrap([this](const asio::error_code& error, tcp::resolver::iterator endp) {
                 start_connect(std::static_pointer_cast<kis_gps_tcp_v2>(shared_from_this()), 
                         error, endp);
-            });
+            }));
 
     return 1;
 }
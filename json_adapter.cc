@@ -28,6 +28,10 @@
 #include <math.h>
 #include <cmath>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "globalregistry.h"
 #include "trackedelement.h"
 #include "macaddr.h"
@@ -162,463 +166,623 @@ std::string json_adapter::sanitize_string(const std::string& s) noexcept {
     return result;
 }
 
-void json_adapter::pack(std::ostream &stream, shared_tracker_element e, 
-        std::shared_ptr<tracker_element_serializer::rename_map> name_map,
-        bool prettyprint, unsigned int depth,
-        std::function<std::string (const std::string&)> name_permuter) {
+void json_adapter::sanitize_string_append(std::string& out, const std::string& s) {
+    const char *data = s.data();
+    const size_t len = s.length();
+    size_t run = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+#ifdef __SSE2__
+        // Skip over blocks of 16 bytes which contain nothing needing escaping; any
+        // quote, backslash, or control character (0x00-0x1f) ends the fast scan
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i bslash = _mm_set1_epi8('\\');
+        const __m128i ctrl_mask = _mm_set1_epi8((char) 0xE0);
+        const __m128i zero = _mm_setzero_si128();
+
+        while (pos + 16 <= len) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+            __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                    _mm_cmpeq_epi8(_mm_and_si128(v, ctrl_mask), zero));
+            int bits = _mm_movemask_epi8(m);
+
+            if (bits != 0) {
+                pos += __builtin_ctz(bits);
+                break;
+            }
 
-    std::string indent;
-    std::string ppendl;
+            pos += 16;
+        }
 
-    if (e == nullptr) {
-        return;
-    }
-    
-    if (prettyprint) {
-        indent = std::string(depth, ' ');
-        ppendl = "\r\n";
-    }
+        if (pos >= len)
+            break;
+#endif
 
-    serializer_scope s(e, name_map);
-    
-    uuid euuid;
+        const unsigned char c = data[pos];
 
-    std::string tname;
+        if (c != '"' && c != '\\' && c > 0x1f) {
+            pos++;
+            continue;
+        }
 
-    bool prepend_comma;
+        out.append(data + run, pos - run);
 
-    bool as_vector, as_key_vector;
+        switch (c) {
+            case '"':
+                out.append("\\\"", 2);
+                break;
+            case '\\':
+                out.append("\\\\", 2);
+                break;
+            case '\b':
+                out.append("\\b", 2);
+                break;
+            case '\f':
+                out.append("\\f", 2);
+                break;
+            case '\n':
+                out.append("\\n", 2);
+                break;
+            case '\r':
+                out.append("\\r", 2);
+                break;
+            case '\t':
+                out.append("\\t", 2);
+                break;
+            default:
+                {
+                    static const char hex[] = "0123456789abcdef";
+                    char u[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+                    out.append(u, 6);
+                }
+                break;
+        }
 
-    // If we're serializing an alias, remap as the aliased element
-    if (e->get_type() == tracker_type::tracker_alias) {
-        e = std::static_pointer_cast<tracker_element_alias>(e)->get();
-        if (e == nullptr) {
-            return;
+        pos++;
+        run = pos;
+    }
+
+    out.append(data + run, len - run);
+}
+
+// The JSON packer assembles output in a contiguous buffer and hands it to the stream in
+// large blocks, rather than through many small operator<< calls; scalars are formatted
+// directly into the buffer instead of through intermediate strings.
+namespace {
+
+// Size at which the pack buffer is handed off to the output stream
+constexpr size_t json_pack_flush_len = 64 * 1024;
+
+struct json_pack_context {
+    json_pack_context(std::ostream& in_stream, 
+            std::shared_ptr<tracker_element_serializer::rename_map> in_name_map,
+            bool in_prettyprint,
+            const std::function<std::string (const std::string&)>& in_name_permuter) :
+        stream{in_stream},
+        name_map{in_name_map},
+        prettyprint{in_prettyprint},
+        name_permuter{in_name_permuter},
+        precision{in_stream.precision()} { 
+            buf.reserve(json_pack_flush_len + 4096);
         }
+
+    ~json_pack_context() {
+        flush();
     }
 
-    if (e->is_stringable()) {
-        if (e->needs_quotes())
-            stream << "\"" << sanitize_string(e->as_string()) << "\"";
-        else
-            stream << sanitize_string(e->as_string());
-    } else {
-        switch (e->get_type()) {
-            case tracker_type::tracker_vector:
-                stream << ppendl << indent << "[" << ppendl;
+    void flush() {
+        if (buf.length() == 0)
+            return;
 
-                prepend_comma = false;
+        stream.write(buf.data(), buf.length());
+        buf.clear();
+    }
 
-                for (auto i : *(std::static_pointer_cast<tracker_element_vector>(e))) {
-                    if (i == NULL)
-                        continue;
+    void flush_if_full() {
+        if (buf.length() >= json_pack_flush_len)
+            flush();
+    }
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+    void indent(unsigned int depth) {
+        if (prettyprint)
+            buf.append(depth, ' ');
+    }
 
-                    if (prettyprint)
-                        stream << indent;
+    void endl() {
+        if (prettyprint)
+            buf.append("\r\n", 2);
+    }
 
-                    json_adapter::pack(stream, i, name_map, prettyprint, depth + 1, name_permuter);
-                }
-                stream << ppendl << indent << "]";
-                break;
-            case tracker_type::tracker_vector_double:
-                stream << ppendl << indent << "[" << ppendl;
+    // Sanitized field names are immutable once registered, so look them up from the
+    // entrytracker once per pack instead of once per field per record
+    const std::string *field_name(int id) {
+        if (id < 0)
+            return nullptr;
 
-                prepend_comma = false;
+        if ((size_t) id >= field_names.size())
+            field_names.resize(id + 1, nullptr);
 
-                for (auto i : *(std::static_pointer_cast<tracker_element_vector_double>(e))) {
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+        if (field_names[id] == nullptr)
+            field_names[id] = Globalreg::globalreg->entrytracker->get_field_json_name(id);
 
-                    if (prettyprint)
-                        stream << indent;
+        return field_names[id];
+    }
 
-                    if (std::isnan(i) || std::isinf(i))
-                        stream << "0";
+    std::ostream& stream;
+    std::string buf;
 
-                    if (floor(i) == i)
-                        stream << fmt::format("{}", (long long) i);
-                    else
-                        stream << fmt::format("{:f}", i);
-                }
-                stream << ppendl << indent << "]";
-                break;
-            case tracker_type::tracker_vector_string:
-                stream << ppendl << indent << "[" << ppendl;
+    std::shared_ptr<tracker_element_serializer::rename_map> name_map;
+    bool prettyprint;
+    const std::function<std::string (const std::string&)>& name_permuter;
 
-                prepend_comma = false;
+    // Precision of the output stream, used for the fixed-point map keys
+    std::streamsize precision;
 
-                for (auto i : *(std::static_pointer_cast<tracker_element_vector_string>(e))) {
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+    std::vector<const std::string *> field_names;
+};
 
-                    if (prettyprint)
-                        stream << indent;
+template<typename T>
+void json_pack_int(std::string& buf, T v) {
+    fmt::format_int f(v);
+    buf.append(f.data(), f.size());
+}
 
-                    stream << i;
-                }
-                stream << ppendl << indent << "]";
-                break;
-            case tracker_type::tracker_map:
-                as_vector = std::static_pointer_cast<tracker_element_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_map>(e)->as_key_vector();
+// Matches float_numerical_string
+void json_pack_float(std::string& buf, double v) {
+    if (std::isnan(v) || std::isinf(v)) {
+        buf.push_back('0');
+        return;
+    }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+    if (floor(v) == v)
+        json_pack_int(buf, (long long) v);
+    else
+        fmt::format_to(std::back_inserter(buf), "{:f}", v);
+}
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_map>(e))) {
-                    if (i.second == NULL)
-                        continue;
+// Doubles held directly in vectors and maps
+void json_pack_double_value(std::string& buf, double v) {
+    if (std::isnan(v) || std::isinf(v))
+        buf.push_back('0');
 
-                    if (prepend_comma) {
-                        stream << "," << ppendl;
+    if (floor(v) == v)
+        json_pack_int(buf, (long long) v);
+    else
+        fmt::format_to(std::back_inserter(buf), "{:f}", v);
+}
 
-                        if (prettyprint)
-                            stream << ppendl;
-                    }
+// Doubles used as map keys are formatted as fixed-point using the stream precision
+void json_pack_double_key(json_pack_context& ctx, double k, bool integral_as_long) {
+    if (std::isnan(k) || std::isinf(k)) {
+        ctx.buf.append("\"0\"", 3);
+    } else if (floor(k) == k) {
+        ctx.buf.push_back('"');
+        if (integral_as_long)
+            json_pack_int(ctx.buf, (long) k);
+        else
+            fmt::format_to(std::back_inserter(ctx.buf), "{:.0f}", k);
+        ctx.buf.push_back('"');
+    } else {
+        ctx.buf.push_back('"');
+        fmt::format_to(std::back_inserter(ctx.buf), "{:.{}f}", k, (int) ctx.precision);
+        ctx.buf.push_back('"');
+    }
+}
 
-                    prepend_comma = true;
+void json_pack_elem(json_pack_context& ctx, const shared_tracker_element& in_e, 
+        unsigned int depth);
 
-                    if (!as_vector) {
-                        bool named = false;
+void json_pack_map_open(json_pack_context& ctx, unsigned int depth, bool as_vector) {
+    ctx.endl();
+    ctx.indent(depth);
+    ctx.buf.push_back(as_vector ? '[' : '{');
+    ctx.endl();
+}
 
-                        if (name_map != NULL) {
-                            tracker_element_serializer::rename_map::iterator nmi = name_map->find(i.second);
-                            if (nmi != name_map->end() && nmi->second->rename.length() != 0) {
-                                tname = nmi->second->rename;
-                                named = true;
-                            }
-                        }
+void json_pack_map_close(json_pack_context& ctx, unsigned int depth, bool as_vector) {
+    ctx.endl();
+    ctx.indent(depth);
+    ctx.buf.push_back(as_vector ? ']' : '}');
+}
 
-                        if (!named) {
-                            if (i.second == NULL) {
-                                tname = Globalreg::globalreg->entrytracker->get_field_name(i.first);
-                            } else {
-                                if ((tname = i.second->get_local_name()) == "")
-                                    tname = Globalreg::globalreg->entrytracker->get_field_name(i.first);
-                            }
-                        }
+// Generic packing of the keyed maps which all share the same layout; the key is
+// written by the provided function
+template<typename MT, typename KF>
+void json_pack_keyed_map(json_pack_context& ctx, MT *m, unsigned int depth, KF key_writer) {
+    bool as_vector = m->as_vector();
+    bool as_key_vector = m->as_key_vector();
+    bool prepend_comma = false;
 
-                        tname = json_adapter::sanitize_string(name_permuter(tname));
-
-                        if (prettyprint) {
-                            stream << indent << "\"description." << tname << "\": ";
-                            stream << "\"";
-                            if (i.second != nullptr) {
-                                stream << sanitize_string(i.second->get_type_as_string());
-                                stream << ", ";
-                            }
-                            stream << sanitize_string(Globalreg::globalreg->entrytracker->get_field_description(i.first));
-                            stream << "\"," << ppendl;
-                        }
+    json_pack_map_open(ctx, depth, as_vector || as_key_vector);
 
-                        stream << indent << "\"" << tname << "\": ";
-                    }
+    for (const auto& i : *m) {
+        if (i.second == nullptr && !as_key_vector)
+            continue;
 
-                    json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+        if (prepend_comma) {
+            ctx.buf.push_back(',');
+            ctx.endl();
+        }
+        prepend_comma = true;
 
-                }
+        if (!as_vector) {
+            ctx.indent(depth);
+            key_writer(i.first);
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << ppendl << indent << "}";
+            if (!as_key_vector)
+                ctx.buf.append(": ", 2);
+        }
 
-                break;
-            case tracker_type::tracker_int_map:
-                as_vector = std::static_pointer_cast<tracker_element_int_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_int_map>(e)->as_key_vector();
+        if (!as_key_vector)
+            json_pack_elem(ctx, i.second, depth + 1);
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+        ctx.flush_if_full();
+    }
+}
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_int_map>(e))) {
-                    if (i.second == nullptr && !as_key_vector)
-                        continue;
+void json_pack_elem(json_pack_context& ctx, const shared_tracker_element& in_e, 
+        unsigned int depth) {
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+    if (in_e == nullptr) 
+        return;
 
-                    if (!as_vector) {
-                        // Integer dictionary keys in json are still quoted as strings
-                        stream << indent << "\"" << i.first << "\"";
+    serializer_scope s(in_e, ctx.name_map);
 
-                        if (!as_key_vector)
-                            stream << ": ";
-                    }
+    tracker_element *e = in_e.get();
 
-                    if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
-                    }
-                }
+    // If we're serializing an alias, remap as the aliased element
+    shared_tracker_element aliased;
+    if (e->get_type() == tracker_type::tracker_alias) {
+        aliased = static_cast<tracker_element_alias *>(e)->get();
+        if (aliased == nullptr)
+            return;
+        e = aliased.get();
+    }
 
-                if (as_vector || as_key_vector)
-                    stream << indent << "]" << ppendl;
-                else
-                    stream << indent << "}" << ppendl;
+    auto& buf = ctx.buf;
+    bool prepend_comma;
 
-                break;
-            case tracker_type::tracker_mac_map:
-                as_vector = std::static_pointer_cast<tracker_element_mac_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_mac_map>(e)->as_key_vector();
+    switch (e->get_type()) {
+        case tracker_type::tracker_string:
+            buf.push_back('"');
+            json_adapter::sanitize_string_append(buf, static_cast<tracker_element_string *>(e)->get());
+            buf.push_back('"');
+            return;
+        case tracker_type::tracker_int8:
+            json_pack_int(buf, (int) static_cast<tracker_element_int8 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint8:
+            json_pack_int(buf, (unsigned int) static_cast<tracker_element_uint8 *>(e)->get());
+            return;
+        case tracker_type::tracker_int16:
+            json_pack_int(buf, (int) static_cast<tracker_element_int16 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint16:
+            json_pack_int(buf, (unsigned int) static_cast<tracker_element_uint16 *>(e)->get());
+            return;
+        case tracker_type::tracker_int32:
+            json_pack_int(buf, static_cast<tracker_element_int32 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint32:
+            json_pack_int(buf, static_cast<tracker_element_uint32 *>(e)->get());
+            return;
+        case tracker_type::tracker_int64:
+            json_pack_int(buf, (long long) static_cast<tracker_element_int64 *>(e)->get());
+            return;
+        case tracker_type::tracker_uint64:
+            json_pack_int(buf, (unsigned long long) static_cast<tracker_element_uint64 *>(e)->get());
+            return;
+        case tracker_type::tracker_float:
+            json_pack_float(buf, static_cast<tracker_element_float *>(e)->get());
+            return;
+        case tracker_type::tracker_double:
+            json_pack_float(buf, static_cast<tracker_element_double *>(e)->get());
+            return;
+        default:
+            break;
+    }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+    if (e->is_stringable()) {
+        if (e->needs_quotes()) {
+            buf.push_back('"');
+            json_adapter::sanitize_string_append(buf, e->as_string());
+            buf.push_back('"');
+        } else {
+            json_adapter::sanitize_string_append(buf, e->as_string());
+        }
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_mac_map>(e))) {
-                    if (i.second == nullptr && !as_key_vector)
-                        continue;
+        return;
+    }
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+    switch (e->get_type()) {
+        case tracker_type::tracker_vector:
+            json_pack_map_open(ctx, depth, true);
 
-                    if (!as_vector) {
-                        // Mac keys are strings and we push only the mac not the mask */
-                        stream << indent << "\"" << i.first << "\"";
+            prepend_comma = false;
 
-                        if (!as_key_vector)
-                            stream << ": ";
-                    }
+            for (const auto& i : *static_cast<tracker_element_vector *>(e)) {
+                if (i == nullptr)
+                    continue;
 
-                    if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
-                    }
+                if (prepend_comma) {
+                    buf.push_back(',');
+                    ctx.endl();
                 }
+                prepend_comma = true;
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << ppendl << indent << "}";
+                ctx.indent(depth);
 
-                break;
-            case tracker_type::tracker_string_map:
-                as_vector = std::static_pointer_cast<tracker_element_string_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_string_map>(e)->as_key_vector();
+                json_pack_elem(ctx, i, depth + 1);
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+                ctx.flush_if_full();
+            }
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_string_map>(e))) {
-                    if (i.second == nullptr && !as_key_vector)
-                        continue;
+            json_pack_map_close(ctx, depth, true);
+            break;
+        case tracker_type::tracker_vector_double:
+            json_pack_map_open(ctx, depth, true);
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+            prepend_comma = false;
 
-                    if (!as_vector) {
-                        stream << indent << "\"" << json_adapter::sanitize_string(i.first) << "\"";
+            for (const auto& i : *static_cast<tracker_element_vector_double *>(e)) {
+                if (prepend_comma) {
+                    buf.push_back(',');
+                    ctx.endl();
+                }
+                prepend_comma = true;
 
-                        if (!as_key_vector)
-                            stream << ": ";
-                    }
+                ctx.indent(depth);
 
-                    if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
-                    }
+                json_pack_double_value(buf, i);
+            }
+
+            json_pack_map_close(ctx, depth, true);
+            break;
+        case tracker_type::tracker_vector_string:
+            json_pack_map_open(ctx, depth, true);
+
+            prepend_comma = false;
+
+            for (const auto& i : *static_cast<tracker_element_vector_string *>(e)) {
+                if (prepend_comma) {
+                    buf.push_back(',');
+                    ctx.endl();
                 }
+                prepend_comma = true;
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << ppendl << indent << "}";
+                ctx.indent(depth);
 
-                break;
-            case tracker_type::tracker_double_map:
-                as_vector = std::static_pointer_cast<tracker_element_double_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_double_map>(e)->as_key_vector();
+                buf.append(i);
+            }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+            json_pack_map_close(ctx, depth, true);
+            break;
+        case tracker_type::tracker_map: {
+            auto m = static_cast<tracker_element_map *>(e);
+            bool as_vector = m->as_vector();
+            bool as_key_vector = m->as_key_vector();
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_double_map>(e))) {
-                    if (i.second == nullptr && !as_key_vector)
-                        continue;
+            json_pack_map_open(ctx, depth, as_vector || as_key_vector);
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+            prepend_comma = false;
 
-                    if (!as_vector) {
-                        // Double keys are handled as strings in json
-                        if (std::isnan(i.first) || std::isinf(i.first)) {
-                            stream << indent << "\"0\"";
-                        } else if (floor(i.first) == i.first)  {
-                            auto prec = stream.precision(0);
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                            stream.precision(prec);
-                        } else {
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                        }
+            for (const auto& i : *m) {
+                if (i.second == nullptr)
+                    continue;
 
-                        if (!as_key_vector)
-                            stream << ": ";
-                    }
+                if (prepend_comma) {
+                    buf.push_back(',');
+                    ctx.endl();
 
-                    if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
-                    }
+                    ctx.endl();
                 }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << indent << "}";
+                prepend_comma = true;
 
-                break;
-            case tracker_type::tracker_hashkey_map:
-                as_vector = std::static_pointer_cast<tracker_element_hashkey_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_hashkey_map>(e)->as_key_vector();
+                if (!as_vector) {
+                    const std::string *tname = nullptr;
+                    std::string tname_s;
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+                    if (ctx.name_map != nullptr) {
+                        auto nmi = ctx.name_map->find(i.second);
+                        if (nmi != ctx.name_map->end() && nmi->second->rename.length() != 0) {
+                            tname_s = nmi->second->rename;
+                            tname = &tname_s;
+                        }
+                    }
+
+                    if (tname == nullptr) {
+                        tname_s = i.second->get_local_name();
+                        if (tname_s.length() != 0)
+                            tname = &tname_s;
+                    }
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_hashkey_map>(e))) {
-                    if (i.second == nullptr && !as_key_vector)
-                        continue;
+                    if (tname == nullptr && !ctx.name_permuter) {
+                        // Common case; use the pre-sanitized registered name
+                        tname = ctx.field_name(i.first);
+                    } else {
+                        if (tname == nullptr)
+                            tname_s = Globalreg::globalreg->entrytracker->get_field_name(i.first);
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+                        if (ctx.name_permuter)
+                            tname_s = ctx.name_permuter(tname_s);
 
-                    if (!as_vector) {
-                        // Double keys are handled as strings in json
-                        if (std::isnan(i.first) || std::isinf(i.first)) {
-                            stream << indent << "\"0\"";
-                        } else if (floor(i.first) == i.first)  {
-                            stream << indent << "\"" << (long) i.first << "\"";
-                        } else {
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                        }
+                        tname_s = json_adapter::sanitize_string(tname_s);
+                        tname = &tname_s;
+                    }
 
-                        if (!as_key_vector)
-                            stream << ": ";
+                    if (tname == nullptr) {
+                        tname_s = "field.unknown.not.registered";
+                        tname = &tname_s;
                     }
 
-                    if (!as_key_vector) {
-                        json_adapter::pack(stream, i.second, name_map, prettyprint, depth + 1, name_permuter);
+                    if (ctx.prettyprint) {
+                        ctx.indent(depth);
+                        buf.append("\"description.", 13);
+                        buf.append(*tname);
+                        buf.append("\": \"", 4);
+                        json_adapter::sanitize_string_append(buf, i.second->get_type_as_string());
+                        buf.append(", ", 2);
+                        json_adapter::sanitize_string_append(buf, 
+                                Globalreg::globalreg->entrytracker->get_field_description(i.first));
+                        buf.append("\",", 2);
+                        ctx.endl();
                     }
+
+                    ctx.indent(depth);
+                    buf.push_back('"');
+                    buf.append(*tname);
+                    buf.append("\": ", 3);
                 }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << ppendl << indent << "}";
+                json_pack_elem(ctx, i.second, depth + 1);
 
-                break;
-            case tracker_type::tracker_double_map_double:
-                as_vector = std::static_pointer_cast<tracker_element_double_map_double>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_double_map_double>(e)->as_key_vector();
+                ctx.flush_if_full();
+            }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+            json_pack_map_close(ctx, depth, as_vector || as_key_vector);
+            break;
+        }
+        case tracker_type::tracker_int_map: {
+            auto m = static_cast<tracker_element_int_map *>(e);
+            bool as_vector = m->as_vector() || m->as_key_vector();
+
+            json_pack_keyed_map(ctx, m, depth, 
+                    [&buf](int k) {
+                        // Integer dictionary keys in json are still quoted as strings
+                        buf.push_back('"');
+                        json_pack_int(buf, k);
+                        buf.push_back('"');
+                    });
+
+            // Int maps close without a leading newline
+            ctx.indent(depth);
+            buf.push_back(as_vector ? ']' : '}');
+            ctx.endl();
+            break;
+        }
+        case tracker_type::tracker_mac_map: {
+            auto m = static_cast<tracker_element_mac_map *>(e);
+
+            json_pack_keyed_map(ctx, m, depth, 
+                    [&buf](const mac_addr& k) {
+                        // Mac keys are strings and we push only the mac not the mask 
+                        buf.push_back('"');
+                        buf.append(k.mac_to_string());
+                        buf.push_back('"');
+                    });
+
+            json_pack_map_close(ctx, depth, m->as_vector() || m->as_key_vector());
+            break;
+        }
+        case tracker_type::tracker_string_map: {
+            auto m = static_cast<tracker_element_string_map *>(e);
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_double_map_double>(e))) {
-                    if (prepend_comma)
-                        stream << "," << ppendl;
+            json_pack_keyed_map(ctx, m, depth, 
+                    [&buf](const std::string& k) {
+                        buf.push_back('"');
+                        json_adapter::sanitize_string_append(buf, k);
+                        buf.push_back('"');
+                    });
 
-                    prepend_comma = true;
+            json_pack_map_close(ctx, depth, m->as_vector() || m->as_key_vector());
+            break;
+        }
+        case tracker_type::tracker_double_map: {
+            auto m = static_cast<tracker_element_double_map *>(e);
+            bool as_vector = m->as_vector() || m->as_key_vector();
 
-                    if (!as_vector) {
+            json_pack_keyed_map(ctx, m, depth, 
+                    [&ctx](double k) {
                         // Double keys are handled as strings in json
-                        if (std::isnan(i.first) || std::isinf(i.first)) {
-                            stream << indent << "\"0\"";
-                        } else if (floor(i.first) == i.first)  {
-                            stream << indent << "\"" << (long) i.first << "\"";
-                        } else {
-                            stream << indent << "\"" << std::fixed << i.first << "\"";
-                        }
+                        json_pack_double_key(ctx, k, false);
+                    });
 
-                        if (!as_key_vector)
-                            stream << ": ";
-                    }
+            // Double maps close objects without a leading newline
+            if (as_vector) {
+                json_pack_map_close(ctx, depth, true);
+            } else {
+                ctx.indent(depth);
+                buf.push_back('}');
+            }
+            break;
+        }
+        case tracker_type::tracker_hashkey_map: {
+            auto m = static_cast<tracker_element_hashkey_map *>(e);
+
+            json_pack_keyed_map(ctx, m, depth, 
+                    [&buf](size_t k) {
+                        // Hash keys are handled as strings in json
+                        buf.push_back('"');
+                        json_pack_int(buf, (long) k);
+                        buf.push_back('"');
+                    });
+
+            json_pack_map_close(ctx, depth, m->as_vector() || m->as_key_vector());
+            break;
+        }
+        case tracker_type::tracker_double_map_double: {
+            auto m = static_cast<tracker_element_double_map_double *>(e);
+            bool as_vector = m->as_vector();
+            bool as_key_vector = m->as_key_vector();
 
-                    if (!as_key_vector) {
-                        if (std::isnan(i.second) || std::isinf(i.second))
-                            stream << "0";
+            json_pack_map_open(ctx, depth, as_vector || as_key_vector);
 
-                        if (floor(i.second) == i.second)
-                            stream << fmt::format("{}", (long long) i.second);
-                        else
-                            stream << fmt::format("{:f}", i.second);
-                    }
+            prepend_comma = false;
+
+            for (const auto& i : *m) {
+                if (prepend_comma) {
+                    buf.push_back(',');
+                    ctx.endl();
                 }
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << ppendl << indent << "}";
+                prepend_comma = true;
 
-                break;
-            case tracker_type::tracker_key_map:
-                as_vector = std::static_pointer_cast<tracker_element_device_key_map>(e)->as_vector();
-                as_key_vector = std::static_pointer_cast<tracker_element_device_key_map>(e)->as_key_vector();
+                if (!as_vector) {
+                    // Double keys are handled as strings in json
+                    ctx.indent(depth);
+                    json_pack_double_key(ctx, i.first, true);
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "[" << ppendl;
-                else
-                    stream << ppendl << indent << "{" << ppendl;
+                    if (!as_key_vector)
+                        buf.append(": ", 2);
+                }
 
-                prepend_comma = false;
-                for (auto i : *(std::static_pointer_cast<tracker_element_device_key_map>(e))) {
-                    if (i.second == nullptr && !as_key_vector)
-                        continue;
+                if (!as_key_vector) 
+                    json_pack_double_value(buf, i.second);
+            }
 
-                    if (prepend_comma)
-                        stream << "," << ppendl;
-                    prepend_comma = true;
+            json_pack_map_close(ctx, depth, as_vector || as_key_vector);
+            break;
+        }
+        case tracker_type::tracker_key_map: {
+            auto m = static_cast<tracker_element_device_key_map *>(e);
 
-                    if (!as_vector) {
+            json_pack_keyed_map(ctx, m, depth, 
+                    [&buf](const device_key& k) {
                         // Keymap keys are handled as strings
-                        stream << indent << "\"" << i.first << "\"";
+                        buf.push_back('"');
+                        buf.append(k.as_string());
+                        buf.push_back('"');
+                    });
 
-                        if (!as_key_vector)
-                            stream << ": ";
-                    }
+            json_pack_map_close(ctx, depth, m->as_vector() || m->as_key_vector());
+            break;
+        }
+        default:
+            break;
+    }
+}
 
-                    if (!as_key_vector) {
-                        json_adapter::pack(stream,i.second, name_map, prettyprint, depth + 1, name_permuter);
-                    }
-                }
+}
 
-                if (as_vector || as_key_vector)
-                    stream << ppendl << indent << "]";
-                else
-                    stream << ppendl << indent << "}";
+void json_adapter::pack(std::ostream &stream, shared_tracker_element e, 
+        std::shared_ptr<tracker_element_serializer::rename_map> name_map,
+        bool prettyprint, unsigned int depth,
+        std::function<std::string (const std::string&)> name_permuter) {
 
-                break;
-            default:
-                break;
-        }
-    }
+    json_pack_context ctx(stream, name_map, prettyprint, name_permuter);
+    json_pack_elem(ctx, e, depth);
 }
 
 // An unfortunate duplication of code but overloading the json/prettyjson to also do
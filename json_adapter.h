@@ -31,16 +31,19 @@
 namespace json_adapter {
 
 // Basic packer with some defaulted options - prettyprint and depth used for
-// recursive indenting and prettifying the output
+// recursive indenting and prettifying the output.  An empty name_permuter leaves
+// field names untouched.
 void pack(std::ostream &stream, shared_tracker_element e,
         std::shared_ptr<tracker_element_serializer::rename_map> name_map = nullptr,
         bool prettyprint = false, unsigned int depth = 0,
-        std::function<std::string (const std::string&)> name_permuter = 
-            [](const std::string& s) -> std::string { return s; });
+        std::function<std::string (const std::string&)> name_permuter = nullptr);
 
 std::string sanitize_string(const std::string& in) noexcept;
 std::size_t sanitize_extra_space(const std::string& in) noexcept;
 
+// Append the sanitized form of a string directly to an output buffer
+void sanitize_string_append(std::string& out, const std::string& in);
+
 class serializer : public tracker_element_serializer {
 public:
     serializer() :
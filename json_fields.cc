@@ -0,0 +1,662 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <limits>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fmt.h"
+#include "json_fields.h"
+
+kis_json_fields::key_set::key_set(std::initializer_list<std::string> in_keys) {
+    for (const auto& k : in_keys) {
+        if (k.length() > 0 && k[k.length() - 1] == '*') {
+            prefixes.push_back(k.substr(0, k.length() - 1));
+            continue;
+        }
+
+        if (k.length() >= by_len.size())
+            by_len.resize(k.length() + 1);
+
+        by_len[k.length()].push_back(keys.size());
+        keys.push_back(k);
+    }
+}
+
+int kis_json_fields::key_set::find(const char *in_key, size_t in_len) const {
+    if (in_len >= by_len.size())
+        return -1;
+
+    for (auto i : by_len[in_len]) {
+        if (memcmp(keys[i].data(), in_key, in_len) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+bool kis_json_fields::key_set::match_prefix(const char *in_key, size_t in_len) const {
+    for (const auto& p : prefixes) {
+        if (in_len >= p.length() && memcmp(p.data(), in_key, p.length()) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+// Single-pass scanner over JSON text
+struct kis_json_scanner {
+    kis_json_scanner(const char *in_text, size_t in_len) :
+        start{in_text},
+        pos{in_text},
+        end{in_text + in_len} { }
+
+    const char *start;
+    const char *pos;
+    const char *end;
+
+    [[noreturn]] void fail(const char *in_what) {
+        throw std::runtime_error(fmt::format("invalid JSON at offset {}: {}",
+                    pos - start, in_what));
+    }
+
+    void skip_ws() {
+        while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r'))
+            ++pos;
+    }
+
+    char peek() {
+        if (pos >= end)
+            fail("unexpected end of input");
+        return *pos;
+    }
+
+    void expect(char in_c) {
+        if (peek() != in_c)
+            fail(fmt::format("expected '{}'", in_c).c_str());
+        ++pos;
+    }
+
+    unsigned int hex4() {
+        unsigned int r = 0;
+
+        if (end - pos < 4)
+            fail("truncated unicode escape");
+
+        for (unsigned int i = 0; i < 4; i++) {
+            char c = *pos++;
+            r <<= 4;
+
+            if (c >= '0' && c <= '9')
+                r |= c - '0';
+            else if (c >= 'a' && c <= 'f')
+                r |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')
+                r |= c - 'A' + 10;
+            else
+                fail("invalid unicode escape");
+        }
+
+        return r;
+    }
+
+    void append_utf8(std::string& out, unsigned int cp) {
+        if (cp < 0x80) {
+            out += (char) cp;
+        } else if (cp < 0x800) {
+            out += (char) (0xC0 | (cp >> 6));
+            out += (char) (0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += (char) (0xE0 | (cp >> 12));
+            out += (char) (0x80 | ((cp >> 6) & 0x3F));
+            out += (char) (0x80 | (cp & 0x3F));
+        } else {
+            out += (char) (0xF0 | (cp >> 18));
+            out += (char) (0x80 | ((cp >> 12) & 0x3F));
+            out += (char) (0x80 | ((cp >> 6) & 0x3F));
+            out += (char) (0x80 | (cp & 0x3F));
+        }
+    }
+
+    // Scan a string; unescaped strings are returned as a span of the source, strings
+    // with escapes are decoded into out_decoded.  Returns true if the string was decoded.
+    bool scan_string(const char *& out_text, size_t& out_len, std::string& out_decoded) {
+        expect('"');
+
+        const char *s = pos;
+
+        while (pos < end && *pos != '"' && *pos != '\\')
+            ++pos;
+
+        if (pos >= end)
+            fail("unterminated string");
+
+        if (*pos == '"') {
+            out_text = s;
+            out_len = pos - s;
+            ++pos;
+            return false;
+        }
+
+        out_decoded.assign(s, pos - s);
+
+        while (true) {
+            char c = peek();
+            ++pos;
+
+            if (c == '"')
+                break;
+
+            if (c != '\\') {
+                out_decoded += c;
+                continue;
+            }
+
+            c = peek();
+            ++pos;
+
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/':
+                    out_decoded += c;
+                    break;
+                case 'b':
+                    out_decoded += '\b';
+                    break;
+                case 'f':
+                    out_decoded += '\f';
+                    break;
+                case 'n':
+                    out_decoded += '\n';
+                    break;
+                case 'r':
+                    out_decoded += '\r';
+                    break;
+                case 't':
+                    out_decoded += '\t';
+                    break;
+                case 'u': {
+                    auto cp = hex4();
+
+                    if (cp >= 0xD800 && cp <= 0xDBFF) {
+                        if (end - pos < 6 || pos[0] != '\\' || pos[1] != 'u')
+                            fail("unpaired surrogate in unicode escape");
+                        pos += 2;
+
+                        auto lo = hex4();
+                        if (lo < 0xDC00 || lo > 0xDFFF)
+                            fail("invalid surrogate in unicode escape");
+
+                        cp = 0x10000 + ((cp & 0x3FF) << 10) + (lo & 0x3FF);
+                    }
+
+                    append_utf8(out_decoded, cp);
+                    break;
+                }
+                default:
+                    fail("invalid escape in string");
+            }
+        }
+
+        out_text = out_decoded.data();
+        out_len = out_decoded.length();
+
+        return true;
+    }
+
+    void skip_string() {
+        expect('"');
+
+        while (true) {
+            char c = peek();
+            ++pos;
+
+            if (c == '"')
+                return;
+
+            if (c == '\\') {
+                peek();
+                ++pos;
+            }
+        }
+    }
+
+    // Skip an object or array, only checking that the nesting is balanced
+    void skip_container() {
+        unsigned int depth = 0;
+
+        while (true) {
+            char c = peek();
+
+            if (c == '"') {
+                skip_string();
+                continue;
+            }
+
+            ++pos;
+
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0)
+                    return;
+            }
+        }
+    }
+
+    void scan_literal(const char *in_lit, size_t in_len) {
+        if ((size_t) (end - pos) < in_len || memcmp(pos, in_lit, in_len) != 0)
+            fail("invalid literal");
+        pos += in_len;
+    }
+
+    void scan_digits() {
+        if (pos >= end || *pos < '0' || *pos > '9')
+            fail("invalid number");
+
+        while (pos < end && *pos >= '0' && *pos <= '9')
+            ++pos;
+    }
+
+    void scan_number(kis_json_fields::value& v) {
+        typedef kis_json_fields::value::value_type vt;
+
+        const char *s = pos;
+        bool negative = false;
+        bool real = false;
+
+        if (*pos == '-') {
+            negative = true;
+            ++pos;
+        }
+
+        const char *digits = pos;
+        scan_digits();
+        const char *digits_end = pos;
+
+        if (pos < end && *pos == '.') {
+            real = true;
+            ++pos;
+            scan_digits();
+        }
+
+        if (pos < end && (*pos == 'e' || *pos == 'E')) {
+            real = true;
+            ++pos;
+
+            if (pos < end && (*pos == '+' || *pos == '-'))
+                ++pos;
+
+            scan_digits();
+        }
+
+        v.text = s;
+        v.len = pos - s;
+
+        if (!real) {
+            uint64_t mag = 0;
+            bool overflow = false;
+
+            for (auto d = digits; d < digits_end; ++d) {
+                unsigned int dv = *d - '0';
+
+                if (mag > (std::numeric_limits<uint64_t>::max() - dv) / 10) {
+                    overflow = true;
+                    break;
+                }
+
+                mag = mag * 10 + dv;
+            }
+
+            // Same integer classification as the jsoncpp reader; out of range
+            // integers fall back to a real
+            if (!overflow) {
+                if (negative && mag <= (uint64_t) std::numeric_limits<int64_t>::max() + 1) {
+                    v.type = vt::int_value;
+                    v.num_i = (int64_t) (0 - mag);
+                    return;
+                } else if (!negative && mag <= (uint64_t) std::numeric_limits<int64_t>::max()) {
+                    v.type = vt::int_value;
+                    v.num_i = (int64_t) mag;
+                    return;
+                } else if (!negative) {
+                    v.type = vt::uint_value;
+                    v.num_u = mag;
+                    return;
+                }
+            }
+        }
+
+        // Copy the token so strtod can't consume anything past it
+        v.type = vt::real_value;
+        v.num_d = strtod(std::string(s, pos - s).c_str(), nullptr);
+    }
+
+    void scan_value(kis_json_fields::value& v) {
+        typedef kis_json_fields::value::value_type vt;
+
+        v.present = true;
+
+        switch (peek()) {
+            case '"':
+                v.type = vt::string_value;
+                v.escaped = scan_string(v.text, v.len, v.decoded);
+                return;
+            case '{':
+            case '[':
+                v.type = *pos == '{' ? vt::object_value : vt::array_value;
+                v.text = pos;
+                skip_container();
+                v.len = pos - v.text;
+                return;
+            case 't':
+                scan_literal("true", 4);
+                v.type = vt::bool_value;
+                v.b = true;
+                return;
+            case 'f':
+                scan_literal("false", 5);
+                v.type = vt::bool_value;
+                v.b = false;
+                return;
+            case 'n':
+                scan_literal("null", 4);
+                v.type = vt::null_value;
+                return;
+            default:
+                if (*pos == '-' || (*pos >= '0' && *pos <= '9')) {
+                    scan_number(v);
+                    return;
+                }
+
+                fail("unexpected character");
+        }
+    }
+
+    void skip_value() {
+        switch (peek()) {
+            case '"':
+                skip_string();
+                return;
+            case '{':
+            case '[':
+                skip_container();
+                return;
+            default: {
+                kis_json_fields::value discard;
+                scan_value(discard);
+            }
+        }
+    }
+
+    // Walk the members of an object; cb is called with the key and must consume the
+    // value
+    template<typename CB>
+    void scan_object(CB cb) {
+        skip_ws();
+        expect('{');
+        skip_ws();
+
+        if (peek() == '}') {
+            ++pos;
+            return;
+        }
+
+        std::string key_decoded;
+
+        while (true) {
+            const char *key;
+            size_t key_len;
+
+            skip_ws();
+            scan_string(key, key_len, key_decoded);
+            skip_ws();
+            expect(':');
+            skip_ws();
+
+            cb(key, key_len);
+
+            skip_ws();
+
+            char c = peek();
+            ++pos;
+
+            if (c == '}')
+                return;
+
+            if (c != ',')
+                fail("expected ',' or '}' in object");
+        }
+    }
+};
+
+bool kis_json_fields::value::isInt() const {
+    switch (type) {
+        case value_type::int_value:
+            return num_i >= std::numeric_limits<int>::min() &&
+                num_i <= std::numeric_limits<int>::max();
+        case value_type::uint_value:
+            return false;
+        case value_type::real_value:
+            return num_d >= std::numeric_limits<int>::min() &&
+                num_d <= std::numeric_limits<int>::max() &&
+                num_d == (double) (int64_t) num_d;
+        default:
+            return false;
+    }
+}
+
+bool kis_json_fields::value::isUInt() const {
+    switch (type) {
+        case value_type::int_value:
+            return num_i >= 0 && num_i <= std::numeric_limits<unsigned int>::max();
+        case value_type::uint_value:
+            return num_u <= std::numeric_limits<unsigned int>::max();
+        case value_type::real_value:
+            return num_d >= 0 && num_d <= std::numeric_limits<unsigned int>::max() &&
+                num_d == (double) (int64_t) num_d;
+        default:
+            return false;
+    }
+}
+
+std::string kis_json_fields::value::asString() const {
+    switch (type) {
+        case value_type::null_value:
+            return "";
+        case value_type::bool_value:
+            return b ? "true" : "false";
+        case value_type::int_value:
+            return std::to_string(num_i);
+        case value_type::uint_value:
+            return std::to_string(num_u);
+        case value_type::real_value:
+            return std::string(text, len);
+        case value_type::string_value:
+            if (escaped)
+                return decoded;
+            return std::string(text, len);
+        default:
+            throw std::runtime_error("JSON value is not convertible to string");
+    }
+}
+
+int kis_json_fields::value::asInt() const {
+    auto v = asInt64();
+
+    if (v < std::numeric_limits<int>::min() || v > std::numeric_limits<int>::max())
+        throw std::runtime_error("JSON value out of int range");
+
+    return (int) v;
+}
+
+unsigned int kis_json_fields::value::asUInt() const {
+    auto v = asUInt64();
+
+    if (v > std::numeric_limits<unsigned int>::max())
+        throw std::runtime_error("JSON value out of unsigned int range");
+
+    return (unsigned int) v;
+}
+
+int64_t kis_json_fields::value::asInt64() const {
+    switch (type) {
+        case value_type::null_value:
+            return 0;
+        case value_type::bool_value:
+            return b ? 1 : 0;
+        case value_type::int_value:
+            return num_i;
+        case value_type::uint_value:
+            if (num_u > (uint64_t) std::numeric_limits<int64_t>::max())
+                throw std::runtime_error("JSON value out of int64 range");
+            return (int64_t) num_u;
+        case value_type::real_value:
+            if (!(num_d >= (double) std::numeric_limits<int64_t>::min() &&
+                        num_d < (double) std::numeric_limits<int64_t>::max()))
+                throw std::runtime_error("JSON value out of int64 range");
+            return (int64_t) num_d;
+        default:
+            throw std::runtime_error("JSON value is not convertible to int");
+    }
+}
+
+uint64_t kis_json_fields::value::asUInt64() const {
+    switch (type) {
+        case value_type::null_value:
+            return 0;
+        case value_type::bool_value:
+            return b ? 1 : 0;
+        case value_type::int_value:
+            if (num_i < 0)
+                throw std::runtime_error("JSON value out of uint64 range");
+            return (uint64_t) num_i;
+        case value_type::uint_value:
+            return num_u;
+        case value_type::real_value:
+            if (!(num_d >= 0 && num_d < (double) std::numeric_limits<uint64_t>::max()))
+                throw std::runtime_error("JSON value out of uint64 range");
+            return (uint64_t) num_d;
+        default:
+            throw std::runtime_error("JSON value is not convertible to uint");
+    }
+}
+
+double kis_json_fields::value::asDouble() const {
+    switch (type) {
+        case value_type::null_value:
+            return 0.0f;
+        case value_type::bool_value:
+            return b ? 1.0f : 0.0f;
+        case value_type::int_value:
+            return (double) num_i;
+        case value_type::uint_value:
+            return (double) num_u;
+        case value_type::real_value:
+            return num_d;
+        default:
+            throw std::runtime_error("JSON value is not convertible to double");
+    }
+}
+
+bool kis_json_fields::value::asBool() const {
+    switch (type) {
+        case value_type::null_value:
+            return false;
+        case value_type::bool_value:
+            return b;
+        case value_type::int_value:
+            return num_i != 0;
+        case value_type::uint_value:
+            return num_u != 0;
+        case value_type::real_value:
+            return num_d != 0;
+        default:
+            throw std::runtime_error("JSON value is not convertible to bool");
+    }
+}
+
+std::vector<std::pair<std::string, kis_json_fields::value>> kis_json_fields::value::members() const {
+    if (type != value_type::object_value)
+        throw std::runtime_error("JSON value is not an object");
+
+    std::vector<std::pair<std::string, value>> ret;
+    kis_json_scanner scanner(text, len);
+
+    scanner.scan_object([&](const char *key, size_t key_len) {
+            ret.emplace_back(std::string(key, key_len), value());
+            scanner.scan_value(ret.back().second);
+        });
+
+    return ret;
+}
+
+kis_json_fields::kis_json_fields(const std::string& in_json, const key_set& in_keys) :
+    keys{in_keys},
+    values(in_keys.size()) {
+
+    kis_json_scanner scanner(in_json.data(), in_json.length());
+
+    scanner.scan_object([&](const char *key, size_t key_len) {
+            auto i = keys.find(key, key_len);
+
+            if (i >= 0) {
+                // Repeated keys take the last value, as jsoncpp does
+                values[i] = value();
+                scanner.scan_value(values[i]);
+            } else if (keys.match_prefix(key, key_len)) {
+                prefixed.emplace_back(std::string(key, key_len), value());
+                scanner.scan_value(prefixed.back().second);
+            } else {
+                scanner.skip_value();
+            }
+        });
+}
+
+const kis_json_fields::value *kis_json_fields::find(const char *in_key, size_t in_len) const {
+    static const value null_value;
+
+    auto i = keys.find(in_key, in_len);
+
+    if (i >= 0)
+        return &values[i];
+
+    for (auto p = prefixed.rbegin(); p != prefixed.rend(); ++p) {
+        if (p->first.length() == in_len && memcmp(p->first.data(), in_key, in_len) == 0)
+            return &p->second;
+    }
+
+    return &null_value;
+}
+
+const kis_json_fields::value& kis_json_fields::operator[](const std::string& in_key) const {
+    return *find(in_key.data(), in_key.length());
+}
+
+const kis_json_fields::value& kis_json_fields::operator[](const char *in_key) const {
+    return *find(in_key, strlen(in_key));
+}
+
+bool kis_json_fields::isMember(const std::string& in_key) const {
+    return find(in_key.data(), in_key.length())->present;
+}
+
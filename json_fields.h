@@ -0,0 +1,155 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __JSON_FIELDS_H__
+#define __JSON_FIELDS_H__
+
+#include "config.h"
+
+#include <initializer_list>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+// One-pass extraction of selected fields from a JSON object.
+//
+// The JSON-carrying phys (rtl433, rtlamr, rtladsb, and the scan report classifiers)
+// only ever look at a fixed handful of top-level keys of each record.  Instead of
+// building a full jsoncpp DOM for every packet, kis_json_fields scans the record once
+// and keeps only the values of the keys declared in a key_set; every other member is
+// skipped without being decoded.
+//
+// Values are exposed with the subset of the Json::Value API the phys use, with the
+// same conversion rules, so existing json["key"] probing code is unchanged.
+//
+// String, object, and array values reference the source text, which must outlive the
+// kis_json_fields object.
+//
+// Malformed JSON in the record structure or in an extracted value throws
+// std::runtime_error; skipped values are only checked for balanced nesting.
+class kis_json_fields {
+public:
+    // Set of top-level keys to extract.  A key ending in '*' matches every key with
+    // that prefix, for records with numbered fields ("switch0", "switch1", ...).
+    class key_set {
+    public:
+        key_set(std::initializer_list<std::string> in_keys);
+
+        // Index of a key, or -1 if the key was not declared
+        int find(const char *in_key, size_t in_len) const;
+        bool match_prefix(const char *in_key, size_t in_len) const;
+
+        size_t size() const { return keys.size(); }
+
+    protected:
+        std::vector<std::string> keys;
+        std::vector<std::string> prefixes;
+
+        // Key indexes bucketed by key length
+        std::vector<std::vector<int>> by_len;
+    };
+
+    class value {
+    public:
+        enum class value_type {
+            null_value, bool_value, int_value, uint_value, real_value,
+            string_value, object_value, array_value
+        };
+
+        value() :
+            type{value_type::null_value},
+            present{false},
+            escaped{false},
+            text{nullptr},
+            len{0},
+            num_i{0} { }
+
+        bool isNull() const { return type == value_type::null_value; }
+        bool isBool() const { return type == value_type::bool_value; }
+        bool isString() const { return type == value_type::string_value; }
+        bool isObject() const { return type == value_type::object_value; }
+        bool isArray() const { return type == value_type::array_value; }
+        bool isNumeric() const {
+            return type == value_type::int_value || type == value_type::uint_value ||
+                type == value_type::real_value;
+        }
+        bool isDouble() const { return isNumeric(); }
+        bool isInt() const;
+        bool isUInt() const;
+
+        // Real numbers convert to their original JSON text
+        std::string asString() const;
+        int asInt() const;
+        unsigned int asUInt() const;
+        int64_t asInt64() const;
+        uint64_t asUInt64() const;
+        double asDouble() const;
+        bool asBool() const;
+
+        // Decode the members of an object value, in record order
+        std::vector<std::pair<std::string, value>> members() const;
+
+        friend class kis_json_fields;
+        friend struct kis_json_scanner;
+
+    protected:
+        value_type type;
+
+        // Was the key present in the record; a present JSON null is still isNull()
+        bool present;
+
+        // String contained escapes and was decoded
+        bool escaped;
+
+        // Source text of an unescaped string, object, array, or number
+        const char *text;
+        size_t len;
+
+        // Decoded form of a string containing escapes
+        std::string decoded;
+
+        union {
+            int64_t num_i;
+            uint64_t num_u;
+            double num_d;
+            bool b;
+        };
+    };
+
+    kis_json_fields(const std::string& in_json, const key_set& in_keys);
+
+    // Undeclared and missing keys return a null value
+    const value& operator[](const std::string& in_key) const;
+    const value& operator[](const char *in_key) const;
+
+    bool isMember(const std::string& in_key) const;
+
+protected:
+    const key_set& keys;
+
+    std::vector<value> values;
+
+    // Members matched by a prefix key
+    std::vector<std::pair<std::string, value>> prefixed;
+
+    const value *find(const char *in_key, size_t in_len) const;
+};
+
+#endif
+
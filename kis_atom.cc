@@ -0,0 +1,115 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include "kis_atom.h"
+
+kis_atom_table& kis_atom_table::get() {
+    // Never destroyed, so atoms held by other static objects stay valid at exit
+    static kis_atom_table *table = new kis_atom_table();
+    return *table;
+}
+
+kis_atom_table::kis_atom_table() {
+    slots.reset(new std::atomic<uint32_t>[hash_sz]);
+    for (uint32_t i = 0; i < hash_sz; i++)
+        slots[i].store(0);
+
+    chunks.reset(new std::atomic<std::string *>[KIS_ATOM_MAX / chunk_sz]);
+    for (uint32_t i = 0; i < KIS_ATOM_MAX / chunk_sz; i++)
+        chunks[i].store(nullptr);
+
+    // Atom 0 is the empty string, and is never in the index
+    chunks[0].store(new std::string[chunk_sz]);
+    n_atoms.store(1);
+
+    // Small numbers follow in order, for kis_atom::from_uint
+    for (unsigned int n = 0; n < 256; n++) {
+        auto ns = std::to_string(n);
+        intern(ns.data(), ns.length());
+    }
+}
+
+uint32_t kis_atom_table::lookup(const char *s, size_t len, uint32_t& pos) const {
+    auto h = hash(s, len);
+    auto tag = h & 0xFFFF0000;
+
+    for (pos = h % hash_sz; ; pos = (pos + 1) % hash_sz) {
+        auto v = slots[pos].load(std::memory_order_acquire);
+
+        if (v == 0)
+            return 0;
+
+        if ((v & 0xFFFF0000) != tag)
+            continue;
+
+        const auto& as = str((v & 0xFFFF) - 1);
+
+        if (as.length() == len && memcmp(as.data(), s, len) == 0)
+            return v & 0xFFFF;
+    }
+}
+
+uint32_t kis_atom_table::find(const char *s, size_t len) const {
+    if (len == 0)
+        return 0;
+
+    uint32_t pos;
+    auto v = lookup(s, len, pos);
+
+    return v == 0 ? 0 : v - 1;
+}
+
+uint32_t kis_atom_table::intern(const char *s, size_t len) {
+    if (len == 0)
+        return 0;
+
+    uint32_t pos;
+    uint32_t v;
+
+    if ((v = lookup(s, len, pos)) != 0)
+        return v - 1;
+
+    std::lock_guard<std::mutex> lk(insert_mutex);
+
+    // Someone else may have added it while we were acquiring the lock
+    if ((v = lookup(s, len, pos)) != 0)
+        return v - 1;
+
+    auto id = n_atoms.load(std::memory_order_relaxed);
+
+    if (id >= KIS_ATOM_MAX)
+        return 0;
+
+    auto chunk = chunks[id / chunk_sz].load(std::memory_order_relaxed);
+
+    if (chunk == nullptr) {
+        chunk = new std::string[chunk_sz];
+        chunks[id / chunk_sz].store(chunk, std::memory_order_release);
+    }
+
+    chunk[id % chunk_sz].assign(s, len);
+
+    n_atoms.store(id + 1, std::memory_order_release);
+
+    // The index is at most half full, so there is always an empty slot
+    slots[pos].store((hash(s, len) & 0xFFFF0000) | (id + 1), std::memory_order_release);
+
+    return id;
+}
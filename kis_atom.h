@@ -0,0 +1,180 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_ATOM_H__
+#define __KIS_ATOM_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include <stdint.h>
+#include <string.h>
+
+// Interned strings for the low-cardinality values carried in every packet, such as
+// channel names, 802.11 rate names, and JSON record types.
+//
+// An atom is a small integer naming a string in a process-wide table.  Atoms are
+// copied and compared as integers, and the string of an atom never moves or changes,
+// so components can hold atoms instead of building and comparing strings for every
+// packet.
+//
+// Looking up a string which is already interned takes no locks; interning a new
+// string takes the table insert lock.  Strings are never removed from the table, so
+// only strings from a bounded set (fixed names, or the channels a source declared)
+// may be interned; values which arrive in packets or remote reports are matched with
+// kis_atom::find(), which never adds to the table.
+
+// Maximum number of distinct strings; once the table is full, new strings intern
+// as the empty atom
+#define KIS_ATOM_MAX            16384
+
+// Longest string which is worth looking up as an atom; channel names and record types
+// are far shorter, so anything longer is rejected before touching the table
+#define KIS_ATOM_MAX_LEN        64
+
+class kis_atom_table {
+public:
+    static kis_atom_table& get();
+
+    // Find or add a string; returns the atom id
+    uint32_t intern(const char *s, size_t len);
+
+    // Find a string without adding it; returns the atom id, or 0 if it is not interned
+    uint32_t find(const char *s, size_t len) const;
+
+    const std::string& str(uint32_t id) const {
+        return chunks[id / chunk_sz].load(std::memory_order_acquire)[id % chunk_sz];
+    }
+
+    size_t size() const {
+        return n_atoms.load(std::memory_order_acquire);
+    }
+
+protected:
+    kis_atom_table();
+
+    static constexpr uint32_t chunk_sz = 1024;
+    static constexpr uint32_t hash_sz = KIS_ATOM_MAX * 2;
+
+    static uint32_t hash(const char *s, size_t len) {
+        // FNV-1a
+        uint32_t h = 2166136261U;
+
+        for (size_t i = 0; i < len; i++) {
+            h ^= (uint8_t) s[i];
+            h *= 16777619U;
+        }
+
+        return h;
+    }
+
+    // Index position of a string, or of the empty slot it would go in; returns the
+    // atom id + 1, or 0 if the string is not in the table
+    uint32_t lookup(const char *s, size_t len, uint32_t& pos) const;
+
+    std::mutex insert_mutex;
+
+    std::atomic<uint32_t> n_atoms;
+
+    // Open-addressed index of the strings; each slot holds the upper 16 bits of the
+    // string hash and the atom id + 1, or 0 if the slot is empty.  Slots are only
+    // written under the insert lock, after the string is in place.
+    std::unique_ptr<std::atomic<uint32_t>[]> slots;
+
+    // Strings, in chunks of chunk_sz allocated as the table grows
+    std::unique_ptr<std::atomic<std::string *>[]> chunks;
+};
+
+class kis_atom {
+public:
+    // The empty string
+    kis_atom() :
+        id{0} { }
+
+    explicit kis_atom(const std::string& s) :
+        id{kis_atom_table::get().intern(s.data(), s.length())} { }
+
+    explicit kis_atom(const char *s) :
+        id{kis_atom_table::get().intern(s, strlen(s))} { }
+
+    // Atom of a string which is already interned, or the empty atom; used for values
+    // from packets and remote sources, which must not grow the table
+    static kis_atom find(const std::string& s) {
+        if (s.length() > KIS_ATOM_MAX_LEN)
+            return kis_atom();
+
+        return from_id(kis_atom_table::get().find(s.data(), s.length()));
+    }
+
+    // Atom of a decimal number; 0 to 255 are interned in order when the table is
+    // created, and don't need a lookup
+    static kis_atom from_uint(unsigned int n) {
+        if (n < 256)
+            return from_id(n + 1);
+
+        return kis_atom(std::to_string(n));
+    }
+
+    uint32_t get_id() const { return id; }
+
+    const std::string& str() const {
+        return kis_atom_table::get().str(id);
+    }
+
+    bool empty() const { return id == 0; }
+
+    bool operator==(const kis_atom& a) const { return id == a.id; }
+    bool operator!=(const kis_atom& a) const { return id != a.id; }
+    bool operator<(const kis_atom& a) const { return id < a.id; }
+
+protected:
+    static kis_atom from_id(uint32_t in_id) {
+        kis_atom a;
+        a.id = in_id;
+        return a;
+    }
+
+    uint32_t id;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const kis_atom& a) {
+    return os << a.str();
+}
+
+namespace std {
+    template<> struct hash<kis_atom> {
+        std::size_t operator()(const kis_atom& a) const {
+            return std::hash<uint32_t>()(a.get_id());
+        }
+    };
+}
+
+// A channel atom which names a real channel; sources use an empty channel or "0"
+// for an unknown channel
+inline bool kis_atom_channel_known(const kis_atom& a) {
+    return !a.empty() && a != kis_atom::from_uint(0);
+}
+
+#endif
+
@@ -0,0 +1,166 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_DATABASE_INDEX_H__
+#define __KIS_DATABASE_INDEX_H__
+
+#include "config.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "fmt.h"
+
+// Secondary indexes of a kismetdb log, shared by the kismetdb logfile and the
+// kismetdb_index tool.
+//
+// A kismetdb log is written without indexes, so that inserts stay cheap while
+// capturing; the indexes turn the time, MAC, and datasource filters used by the log
+// tools and the pcap endpoint into range scans.  Indexes are never part of the
+// logical schema and may be added to any log at any time.
+//
+// Columns which the pcap endpoint and log tools match with LIKE are indexed with
+// NOCASE collation, which SQLite requires before it will use an index for LIKE; the
+// queries are prepared with sqlite3_prepare_v2 (see sqlite3_cpp11.h) so that SQLite
+// can use the index for a bound LIKE pattern.
+
+struct kis_database_index_def {
+    // Logical table; for a partitioned log this is the view, and every partition
+    // table of the view gets the index
+    const char *table;
+    // Index name suffix
+    const char *name;
+    // Indexed columns
+    const char *columns;
+};
+
+static const kis_database_index_def kis_database_indexes[] = {
+    { "packets", "ts", "ts_sec, ts_usec" },
+    { "packets", "sourcemac", "sourcemac COLLATE NOCASE" },
+    { "packets", "destmac", "destmac COLLATE NOCASE" },
+    { "packets", "datasource", "datasource COLLATE NOCASE" },
+    { "packets", "devkey", "devkey COLLATE NOCASE" },
+
+    { "data", "ts", "ts_sec, ts_usec" },
+    { "data", "devmac", "devmac" },
+    { "data", "datasource", "datasource" },
+
+    { "devices", "devmac", "devmac" },
+    { "devices", "last_time", "last_time" },
+
+    { "alerts", "ts", "ts_sec" },
+    { "messages", "ts", "ts_sec" },
+    { "snapshots", "ts", "ts_sec" },
+};
+
+// Real tables holding the rows of a logical table:  the partitions of a view, the
+// table itself, or nothing if the table does not exist in this log
+inline std::vector<std::string> kis_database_index_tables(sqlite3 *db, const std::string& table) {
+    std::vector<std::string> ret;
+    sqlite3_stmt *stmt = nullptr;
+
+    auto sql = "SELECT type FROM sqlite_master WHERE name = ?";
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        return ret;
+
+    sqlite3_bind_text(stmt, 1, table.c_str(), table.length(), SQLITE_TRANSIENT);
+
+    std::string type;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        type = std::string((const char *) sqlite3_column_text(stmt, 0));
+
+    sqlite3_finalize(stmt);
+
+    if (type == "table") {
+        ret.push_back(table);
+        return ret;
+    }
+
+    if (type != "view")
+        return ret;
+
+    sql = "SELECT tablename FROM segments WHERE viewname = ? ORDER BY start_ts";
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        return ret;
+
+    sqlite3_bind_text(stmt, 1, table.c_str(), table.length(), SQLITE_TRANSIENT);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        ret.push_back(std::string((const char *) sqlite3_column_text(stmt, 0)));
+
+    sqlite3_finalize(stmt);
+
+    return ret;
+}
+
+// Create the indexes of one logical table on a single real table
+inline int kis_database_index_table(sqlite3 *db, const std::string& logical,
+        const std::string& table, std::string& errstr) {
+    for (const auto& i : kis_database_indexes) {
+        if (logical != i.table)
+            continue;
+
+        auto sql = fmt::format("CREATE INDEX IF NOT EXISTS \"idx_{}_{}\" ON \"{}\" ({})",
+                table, i.name, table, i.columns);
+
+        char *err = nullptr;
+        int r = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &err);
+
+        if (r != SQLITE_OK) {
+            errstr = fmt::format("unable to index {}: {}", table, err != nullptr ? err : "");
+            sqlite3_free(err);
+            return r;
+        }
+    }
+
+    return SQLITE_OK;
+}
+
+// Create every index in a log; progress is called with each real table before it is
+// indexed
+inline int kis_database_create_indexes(sqlite3 *db, std::string& errstr,
+        std::function<void (const std::string&)> progress = nullptr) {
+    std::vector<std::string> logical;
+
+    for (const auto& i : kis_database_indexes) {
+        if (logical.size() == 0 || logical.back() != i.table)
+            logical.push_back(i.table);
+    }
+
+    for (const auto& l : logical) {
+        for (const auto& t : kis_database_index_tables(db, l)) {
+            if (progress != nullptr)
+                progress(t);
+
+            int r = kis_database_index_table(db, l, t, errstr);
+
+            if (r != SQLITE_OK)
+                return r;
+        }
+    }
+
+    return SQLITE_OK;
+}
+
+#endif
+
@@ -29,6 +29,79 @@
 #include "packetchain.h"
 #include "sqlite3_cpp11.h"
 
+// Columns of the packets and data tables, and of their partitions
+static const char *packet_columns =
+        "ts_sec INT, " // Timestamps
+        "ts_usec INT, "
+
+        "phyname TEXT, " // Packet phy
+
+        "sourcemac TEXT, " // Source, dest, and network addresses
+        "destmac TEXT, "
+        "transmac TEXT, "
+
+        "frequency REAL, " // Freq in khz
+
+        "devkey TEXT, " // Device key
+
+        "lat REAL, " // location
+        "lon REAL, "
+        "alt REAL, "
+        "speed REAL, "
+        "heading REAL, "
+
+        "packet_len INT, " // Packet length
+
+        "signal INT, " // Signal level
+
+        "datasource TEXT, " // UUID of data source
+
+        "dlt INT, " // pcap data - datalinktype and packet bin
+        "packet BLOB, "
+
+        "error INT, " // Packet was flagged as invalid
+
+        "tags TEXT"; // Arbitrary packet tags
+
+static const char *packet_insert_sql =
+        "INSERT INTO {} "
+        "(ts_sec, ts_usec, phyname, "
+        "sourcemac, destmac, transmac, devkey, frequency, " 
+        "lat, lon, alt, speed, heading, "
+        "packet_len, signal, "
+        "datasource, "
+        "dlt, packet, "
+        "error, tags) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
+static const char *data_columns =
+        "ts_sec INT, " // Timestamps
+        "ts_usec INT, "
+
+        "phyname TEXT, " // Packet name and phy
+        "devmac TEXT, "
+
+        "lat REAL, " // Location
+        "lon REAL, "
+        "alt REAL, "
+        "speed REAL, "
+        "heading REAL, "
+
+        "datasource TEXT, " // UUID of data source
+
+        "type TEXT, " // Type of arbitrary record
+
+        "json BLOB "; // Arbitrary JSON record
+
+static const char *data_insert_sql =
+        "INSERT INTO {} "
+        "(ts_sec, ts_usec, "
+        "phyname, devmac, "
+        "lat, lon, alt, speed, heading, "
+        "datasource, "
+        "type, json) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+
 kis_database_logfile::kis_database_logfile():
     kis_logfile(shared_log_builder(NULL)), 
     kis_database(Globalreg::globalreg, "kismetlog"),
@@ -73,6 +146,25 @@ kis_database_logfile::kis_database_logfile():
     snapshot_stmt = NULL;
     snapshot_pz = NULL;
 
+    partition_sec = 0;
+    partition_max = 0;
+
+    index_mode = log_index_mode::none;
+    indexes_built = false;
+    index_timer = -1;
+
+    packet_partitions.name = "packets";
+    packet_partitions.columns = packet_columns;
+    packet_partitions.insert_sql = packet_insert_sql;
+    packet_partitions.warned_future = false;
+    packet_partitions.warned_max = false;
+
+    data_partitions.name = "data";
+    data_partitions.columns = data_columns;
+    data_partitions.insert_sql = data_insert_sql;
+    data_partitions.warned_future = false;
+    data_partitions.warned_max = false;
+
     devicetracker =
         Globalreg::fetch_mandatory_global_as<device_tracker>();
 
@@ -113,6 +205,11 @@ bool kis_database_logfile::open_log(std::string in_path) {
         return false;
     }
 
+    partition_sec =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_partition_sec", 0);
+    partition_max =
+        Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_partition_max", 1000);
+
     dbr = database_upgrade_db();
 
     if (!dbr) {
@@ -138,7 +235,7 @@ bool kis_database_logfile::open_log(std::string in_path) {
             Globalreg::fetch_mandatory_global_as<packet_chain>("PACKETCHAIN");
 
         packetchain->register_handler(&kis_database_logfile::packet_handler, this, 
-                CHAINPOS_LOGGING, -100);
+                CHAINPOS_LOGGING, -100, "kismetdb_log");
     } else {
         _MSG_INFO("Packets will not be saved to the Kismet database log.");
     }
@@ -146,7 +243,24 @@ bool kis_database_logfile::open_log(std::string in_path) {
     packet_timeout =
         Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_packet_timeout", 0);
 
-    if (packet_timeout != 0) {
+    if (packet_timeout != 0 && partition_sec != 0) {
+        _MSG_INFO("Packets and data older than {} seconds will be dropped from the "
+                "Kismet database log, {} seconds at a time.", packet_timeout, partition_sec);
+
+        packet_timeout_timer = 
+            timetracker->register_timer(SERVER_TIMESLICES_SEC * 15, NULL, 1,
+                    [this](int) -> int {
+                    local_locker dblock(&ds_mutex);
+
+                    if (!db_enabled)
+                        return 1;
+
+                    drop_partitions_before(packet_partitions, time(0) - packet_timeout, false);
+                    drop_partitions_before(data_partitions, time(0) - packet_timeout, false);
+
+                    return 1;
+                    });
+    } else if (packet_timeout != 0) {
         packet_timeout_timer = 
             timetracker->register_timer(SERVER_TIMESLICES_SEC * 15, NULL, 1,
                     [this](int) -> int {
@@ -247,6 +361,36 @@ bool kis_database_logfile::open_log(std::string in_path) {
         snapshot_timeout_timer = -1;
     }
 
+    auto index_opt = 
+        str_lower(Globalreg::globalreg->kismet_config->fetch_opt_dfl("kis_log_index", "none"));
+
+    if (index_opt == "deferred") {
+        index_mode = log_index_mode::deferred;
+
+        auto index_delay =
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("kis_log_index_delay", 300);
+
+        index_timer =
+            timetracker->register_timer(SERVER_TIMESLICES_SEC * index_delay, NULL, 0,
+                    [this](int) -> int {
+                    local_locker dblock(&ds_mutex);
+
+                    if (db_enabled)
+                        build_indexes();
+
+                    index_timer = -1;
+                    return 0;
+                    });
+    } else if (index_opt == "close") {
+        index_mode = log_index_mode::close;
+    } else {
+        if (index_opt != "none")
+            _MSG_ERROR("Unknown kis_log_index option '{}', expected none, close, or "
+                    "deferred; the Kismet database log will not be indexed.", index_opt);
+
+        index_mode = log_index_mode::none;
+    }
+
     packet_drop_endp =
         std::make_shared<kis_net_httpd_simple_post_endpoint>("/logging/kismetdb/pcap/drop", 
                 [this](std::ostream& stream, const std::string& uri,
@@ -419,6 +563,10 @@ void kis_database_logfile::close_log() {
         timetracker->remove_timer(device_timeout_timer);
         timetracker->remove_timer(message_timeout_timer);
         timetracker->remove_timer(snapshot_timeout_timer);
+
+        if (index_timer >= 0)
+            timetracker->remove_timer(index_timer);
+        index_timer = -1;
     }
 
     // End the transaction
@@ -457,6 +605,15 @@ void kis_database_logfile::close_log() {
         data_stmt = NULL;
     }
 
+    close_partition_set(packet_partitions);
+    close_partition_set(data_partitions);
+
+    if (db != NULL && index_mode != log_index_mode::none && !indexes_built) {
+        sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+        build_indexes();
+        sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
+    }
+
     { 
         if (alert_stmt != NULL)
             sqlite3_finalize(alert_stmt);
@@ -482,6 +639,229 @@ void kis_database_logfile::close_log() {
     database_close();
 }
 
+int kis_database_logfile::create_partition_set(log_partition_set& set) {
+    // The template is never written to; it keeps the view valid, and gives the 
+    // view its columns, before the first partition exists
+    auto sql = fmt::format("CREATE TABLE {}_template ({})", set.name, set.columns);
+
+    int r = sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+
+    if (r != SQLITE_OK)
+        return r;
+
+    r = sqlite3_exec(db, 
+            "CREATE TABLE IF NOT EXISTS segments ("
+            "tablename TEXT UNIQUE, " // Partition table
+            "viewname TEXT, " // View which includes the partition
+            "start_ts INT, " // First second of the partition
+            "end_ts INT)", // First second after the partition
+            NULL, NULL, NULL);
+
+    if (r != SQLITE_OK)
+        return r;
+
+    return rebuild_partition_view(set);
+}
+
+int kis_database_logfile::rebuild_partition_view(log_partition_set& set) {
+    // SQLite limits a compound select to 500 terms, so long captures are unioned
+    // in nested groups
+    const size_t group_sz = 200;
+
+    std::vector<std::string> terms;
+    terms.push_back(fmt::format("SELECT * FROM {}_template", set.name));
+
+    for (const auto& p : set.partitions)
+        terms.push_back(fmt::format("SELECT * FROM {}_{}", set.name, p.first));
+
+    while (terms.size() > group_sz) {
+        std::vector<std::string> groups;
+
+        for (size_t i = 0; i < terms.size(); i += group_sz) {
+            std::stringstream ss;
+
+            for (size_t j = i; j < terms.size() && j < i + group_sz; j++) {
+                if (j != i)
+                    ss << " UNION ALL ";
+                ss << terms[j];
+            }
+
+            groups.push_back(fmt::format("SELECT * FROM ({})", ss.str()));
+        }
+
+        terms = groups;
+    }
+
+    std::stringstream ss;
+
+    for (size_t i = 0; i < terms.size(); i++) {
+        if (i != 0)
+            ss << " UNION ALL ";
+        ss << terms[i];
+    }
+
+    auto sql = fmt::format("DROP VIEW IF EXISTS {}", set.name);
+    int r = sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+
+    if (r != SQLITE_OK)
+        return r;
+
+    sql = fmt::format("CREATE VIEW {} AS {}", set.name, ss.str());
+    return sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+}
+
+sqlite3_stmt *kis_database_logfile::partition_insert_stmt(log_partition_set& set, time_t ts) {
+    // Records from before the epoch (such as from a remote capture with a bad clock)
+    // go into the first partition, so the table name never holds a negative number
+    if (ts < 0)
+        ts = 0;
+
+    // Records from more than a day in the future go into the current partition
+    auto now = time(0);
+    if (ts > now + 86400) {
+        if (!set.warned_future) {
+            _MSG_ERROR("Kismet log received {} records timestamped in the future ({}); "
+                    "they will be logged in the current partition.  Check the clock of "
+                    "the data sources.", set.name, ts);
+            set.warned_future = true;
+        }
+
+        ts = now;
+    }
+
+    auto start = ts - (ts % partition_sec);
+
+    auto pi = set.partitions.find(start);
+    if (pi != set.partitions.end())
+        return pi->second;
+
+    // Past the partition limit, use the nearest existing partition
+    if (partition_max != 0 && set.partitions.size() >= partition_max) {
+        if (!set.warned_max) {
+            _MSG_ERROR("Kismet log has reached the limit of {} {} partitions "
+                    "(kis_log_partition_max); records which need a new partition will be "
+                    "logged in the nearest existing partition.", partition_max, set.name);
+            set.warned_max = true;
+        }
+
+        pi = set.partitions.lower_bound(start);
+
+        if (pi == set.partitions.end())
+            return std::prev(pi)->second;
+
+        if (pi != set.partitions.begin() && start - std::prev(pi)->first < pi->first - start)
+            return std::prev(pi)->second;
+
+        return pi->second;
+    }
+
+    auto tablename = fmt::format("{}_{}", set.name, start);
+
+    auto sql = fmt::format("CREATE TABLE IF NOT EXISTS {} ({})", tablename, set.columns);
+
+    if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to create partition {} in {}: {}", 
+                tablename, ds_dbfile, sqlite3_errmsg(db));
+        return nullptr;
+    }
+
+    sql = fmt::format("INSERT OR REPLACE INTO segments (tablename, viewname, start_ts, end_ts) "
+            "VALUES ('{}', '{}', {}, {})", tablename, set.name, start, start + partition_sec);
+
+    if (sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL) != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to record partition {} in {}: {}", 
+                tablename, ds_dbfile, sqlite3_errmsg(db));
+        return nullptr;
+    }
+
+    sqlite3_stmt *stmt = nullptr;
+    const char *pz = nullptr;
+
+    sql = fmt::format(set.insert_sql, tablename);
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &stmt, &pz) != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to prepare database insert for {} in {}: {}", 
+                tablename, ds_dbfile, sqlite3_errmsg(db));
+        return nullptr;
+    }
+
+    set.partitions[start] = stmt;
+
+    if (indexes_built) {
+        std::string errstr;
+
+        if (kis_database_index_table(db, set.name, tablename, errstr) != SQLITE_OK)
+            _MSG_ERROR("Kismet log was unable to index partition {} in {}: {}",
+                    tablename, ds_dbfile, errstr);
+    }
+
+    // Replacing the view is a schema change, which makes open readers re-prepare their
+    // statements; it only happens once per new partition
+    if (rebuild_partition_view(set) != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to update the {} view in {}: {}",
+                set.name, ds_dbfile, sqlite3_errmsg(db));
+        return nullptr;
+    }
+
+    return stmt;
+}
+
+void kis_database_logfile::drop_partitions_before(log_partition_set& set, time_t cutoff,
+        bool trim) {
+    bool dropped = false;
+
+    for (auto pi = set.partitions.begin(); pi != set.partitions.end(); ) {
+        auto tablename = fmt::format("{}_{}", set.name, pi->first);
+
+        if (pi->first + (time_t) partition_sec > cutoff) {
+            // Partition spans the cutoff; everything after it is newer
+            if (trim && pi->first < cutoff) {
+                auto sql = fmt::format("DELETE FROM {} WHERE ts_sec < {}", tablename, cutoff);
+                sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+            }
+
+            break;
+        }
+
+        sqlite3_finalize(pi->second);
+
+        auto sql = fmt::format("DROP TABLE IF EXISTS {}", tablename);
+        sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+
+        sql = fmt::format("DELETE FROM segments WHERE tablename = '{}'", tablename);
+        sqlite3_exec(db, sql.c_str(), NULL, NULL, NULL);
+
+        pi = set.partitions.erase(pi);
+        dropped = true;
+    }
+
+    if (dropped)
+        rebuild_partition_view(set);
+}
+
+void kis_database_logfile::build_indexes() {
+    std::string errstr;
+
+    _MSG_INFO("Indexing Kismet database log '{}'", ds_dbfile);
+
+    if (kis_database_create_indexes(db, errstr) != SQLITE_OK) {
+        _MSG_ERROR("Kismet log was unable to create indexes in {}: {}", ds_dbfile, errstr);
+        return;
+    }
+
+    // Give the query planner the statistics to choose between the indexes
+    sqlite3_exec(db, "ANALYZE", NULL, NULL, NULL);
+
+    indexes_built = true;
+}
+
+void kis_database_logfile::close_partition_set(log_partition_set& set) {
+    for (const auto& p : set.partitions)
+        sqlite3_finalize(p.second);
+
+    set.partitions.clear();
+}
+
 int kis_database_logfile::database_upgrade_db() {
     local_locker dblock(&ds_mutex);
 
@@ -531,80 +911,34 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
-    sql =
-        "CREATE TABLE packets ("
+    if (partition_sec == 0) {
+        sql = fmt::format("CREATE TABLE packets ({})", packet_columns);
 
-        "ts_sec INT, " // Timestamps
-        "ts_usec INT, "
-
-        "phyname TEXT, " // Packet phy
-
-        "sourcemac TEXT, " // Source, dest, and network addresses
-        "destmac TEXT, "
-        "transmac TEXT, "
-
-        "frequency REAL, " // Freq in khz
-
-        "devkey TEXT, " // Device key
-
-        "lat REAL, " // location
-        "lon REAL, "
-        "alt REAL, "
-        "speed REAL, "
-        "heading REAL, "
-
-        "packet_len INT, " // Packet length
-
-        "signal INT, " // Signal level
-
-        "datasource TEXT, " // UUID of data source
-
-        "dlt INT, " // pcap data - datalinktype and packet bin
-        "packet BLOB, "
-
-        "error INT, " // Packet was flagged as invalid
-
-        "tags TEXT" // Arbitrary packet tags
-        ")";
-
-    r = sqlite3_exec(db, sql.c_str(),
-            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+    } else {
+        r = create_partition_set(packet_partitions);
+    }
 
     if (r != SQLITE_OK) {
         _MSG("Kismet log was unable to create packet table in " + ds_dbfile + ": " +
-                std::string(sErrMsg), MSGFLAG_ERROR);
+                std::string(sErrMsg != NULL ? sErrMsg : sqlite3_errmsg(db)), MSGFLAG_ERROR);
         close_log();
         return -1;
     }
 
-    sql =
-        "CREATE TABLE data ("
-
-        "ts_sec INT, " // Timestamps
-        "ts_usec INT, "
-
-        "phyname TEXT, " // Packet name and phy
-        "devmac TEXT, "
-
-        "lat REAL, " // Location
-        "lon REAL, "
-        "alt REAL, "
-        "speed REAL, "
-        "heading REAL, "
-
-        "datasource TEXT, " // UUID of data source
-
-        "type TEXT, " // Type of arbitrary record
-
-        "json BLOB " // Arbitrary JSON record
-        ")";
+    if (partition_sec == 0) {
+        sql = fmt::format("CREATE TABLE data ({})", data_columns);
 
-    r = sqlite3_exec(db, sql.c_str(),
-            [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+        r = sqlite3_exec(db, sql.c_str(),
+                [] (void *, int, char **, char **) -> int { return 0; }, NULL, &sErrMsg);
+    } else {
+        r = create_partition_set(data_partitions);
+    }
 
     if (r != SQLITE_OK) {
         _MSG("Kismet log was unable to create data table in " + ds_dbfile + ": " +
-                std::string(sErrMsg), MSGFLAG_ERROR);
+                std::string(sErrMsg != NULL ? sErrMsg : sqlite3_errmsg(db)), MSGFLAG_ERROR);
         close_log();
         return -1;
     }
@@ -721,7 +1055,7 @@ int kis_database_logfile::database_upgrade_db() {
         "bytes_data, type, device) "
         "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &device_stmt, &device_pz);
+    r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &device_stmt, &device_pz);
 
     if (r != SQLITE_OK) {
         _MSG("kis_database_logfile unable to prepare database insert for devices in " +
@@ -730,42 +1064,32 @@ int kis_database_logfile::database_upgrade_db() {
         return -1;
     }
 
-    sql =
-        "INSERT INTO packets "
-        "(ts_sec, ts_usec, phyname, "
-        "sourcemac, destmac, transmac, devkey, frequency, " 
-        "lat, lon, alt, speed, heading, "
-        "packet_len, signal, "
-        "datasource, "
-        "dlt, packet, "
-        "error, tags) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    // Partitioned logs prepare an insert per partition as it is created
+    if (partition_sec == 0) {
+        sql = fmt::format(packet_insert_sql, "packets");
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &packet_stmt, &packet_pz);
+        r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &packet_stmt, &packet_pz);
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for packets in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for packets in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
     }
 
-    sql =
-        "INSERT INTO data "
-        "(ts_sec, ts_usec, "
-        "phyname, devmac, "
-        "lat, lon, alt, speed, heading, "
-        "datasource, "
-        "type, json) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)";
+    // Partitioned logs prepare an insert per partition as it is created
+    if (partition_sec == 0) {
+        sql = fmt::format(data_insert_sql, "data");
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &data_stmt, &data_pz);
+        r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &data_stmt, &data_pz);
 
-    if (r != SQLITE_OK) {
-        _MSG("kis_database_logfile unable to prepare database insert for data in " +
-                ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
-        close_log();
-        return -1;
+        if (r != SQLITE_OK) {
+            _MSG("kis_database_logfile unable to prepare database insert for data in " +
+                    ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
+            close_log();
+            return -1;
+        }
     }
 
     sql =
@@ -776,7 +1100,7 @@ int kis_database_logfile::database_upgrade_db() {
         "json) "
         "VALUES (?, ?, ?, ?, ?, ?)";
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &datasource_stmt, &datasource_pz);
+    r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &datasource_stmt, &datasource_pz);
 
     if (r != SQLITE_OK) {
         _MSG("kis_database_logfile unable to prepare database insert for datasources in " +
@@ -793,7 +1117,7 @@ int kis_database_logfile::database_upgrade_db() {
         "json) "
         "VALUES (?, ?, ?, ?, ?, ?, ?, ?)";
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &alert_stmt, &alert_pz);
+    r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &alert_stmt, &alert_pz);
 
     if (r != SQLITE_OK) {
         _MSG("kis_database_logfile unable to prepare database insert for alerts in " +
@@ -809,7 +1133,7 @@ int kis_database_logfile::database_upgrade_db() {
         "msgtype, message) "
         "VALUES (?, ?, ?, ?, ?)";
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &msg_stmt, &msg_pz);
+    r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &msg_stmt, &msg_pz);
 
     if (r != SQLITE_OK) {
         _MSG("kis_database_logfile unable to prepare database insert for messages in " +
@@ -825,7 +1149,7 @@ int kis_database_logfile::database_upgrade_db() {
         "snaptype, json) "
         "VALUES (?, ?, ?, ?, ?, ?)";
 
-    r = sqlite3_prepare(db, sql.c_str(), sql.length(), &snapshot_stmt, &snapshot_pz);
+    r = sqlite3_prepare_v2(db, sql.c_str(), sql.length(), &snapshot_stmt, &snapshot_pz);
 
     if (r != SQLITE_OK) {
         _MSG("kis_database_logfile unable to prepare database insert for snapshots in " +
@@ -1053,49 +1377,57 @@ int kis_database_logfile::log_packet(kis_packet *in_pack) {
         local_demand_locker dblock(&ds_mutex);
         db_lock_with_sync_check(dblock, return -1);
 
-        sqlite3_reset(packet_stmt);
+        auto stmt = partition_sec == 0 ? packet_stmt :
+            partition_insert_stmt(packet_partitions, in_pack->ts.tv_sec);
+
+        if (stmt == nullptr) {
+            close_log();
+            return -1;
+        }
+
+        sqlite3_reset(stmt);
 
         int sql_pos = 1;
 
-        sqlite3_bind_int64(packet_stmt, sql_pos++, in_pack->ts.tv_sec);
-        sqlite3_bind_int64(packet_stmt, sql_pos++, in_pack->ts.tv_usec);
+        sqlite3_bind_int64(stmt, sql_pos++, in_pack->ts.tv_sec);
+        sqlite3_bind_int64(stmt, sql_pos++, in_pack->ts.tv_usec);
 
-        sqlite3_bind_text(packet_stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, deststring.c_str(), deststring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, transstring.c_str(), transstring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(packet_stmt, sql_pos++, keystring.c_str(), keystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_double(packet_stmt, sql_pos++, frequency);
+        sqlite3_bind_text(stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, deststring.c_str(), deststring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, transstring.c_str(), transstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, keystring.c_str(), keystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_double(stmt, sql_pos++, frequency);
 
         if (gpsdata != NULL) {
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->lat);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->lon);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->alt);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->speed);
-            sqlite3_bind_double(packet_stmt, sql_pos++, gpsdata->heading);
+            sqlite3_bind_double(stmt, sql_pos++, gpsdata->lat);
+            sqlite3_bind_double(stmt, sql_pos++, gpsdata->lon);
+            sqlite3_bind_double(stmt, sql_pos++, gpsdata->alt);
+            sqlite3_bind_double(stmt, sql_pos++, gpsdata->speed);
+            sqlite3_bind_double(stmt, sql_pos++, gpsdata->heading);
         } else {
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
-            sqlite3_bind_double(packet_stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
         }
 
-        sqlite3_bind_int64(packet_stmt, sql_pos++, chunk->length);
+        sqlite3_bind_int64(stmt, sql_pos++, chunk->length);
 
         if (radioinfo != nullptr) {
-            sqlite3_bind_int(packet_stmt, sql_pos++, radioinfo->signal_dbm);
+            sqlite3_bind_int(stmt, sql_pos++, radioinfo->signal_dbm);
         } else {
-            sqlite3_bind_int(packet_stmt, sql_pos++, 0);
+            sqlite3_bind_int(stmt, sql_pos++, 0);
         }
 
-        sqlite3_bind_text(packet_stmt, sql_pos++, sourceuuidstring.c_str(), 
+        sqlite3_bind_text(stmt, sql_pos++, sourceuuidstring.c_str(), 
                 sourceuuidstring.length(), SQLITE_TRANSIENT);
 
-        sqlite3_bind_int(packet_stmt, sql_pos++, chunk->dlt);
-        sqlite3_bind_blob(packet_stmt, sql_pos++, (const char *) chunk->data, chunk->length, 0);
+        sqlite3_bind_int(stmt, sql_pos++, chunk->dlt);
+        sqlite3_bind_blob(stmt, sql_pos++, (const char *) chunk->data, chunk->length, 0);
 
-        sqlite3_bind_int(packet_stmt, sql_pos++, in_pack->error);
+        sqlite3_bind_int(stmt, sql_pos++, in_pack->error);
 
         std::stringstream tagstream;
         bool space_needed = false;
@@ -1108,9 +1440,9 @@ int kis_database_logfile::log_packet(kis_packet *in_pack) {
         }
 
         auto str = tagstream.str();
-        sqlite3_bind_text(packet_stmt, sql_pos++, str.c_str(), tagstream.str().length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, str.c_str(), tagstream.str().length(), SQLITE_TRANSIENT);
 
-        if (sqlite3_step(packet_stmt) != SQLITE_DONE) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
             _MSG("kis_database_logfile unable to insert packet in " +
                     ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
             close_log();
@@ -1151,36 +1483,44 @@ int kis_database_logfile::log_data(kis_gps_packinfo *gps, struct timeval tv,
         local_demand_locker dblock(&ds_mutex);
         db_lock_with_sync_check(dblock, return -1);
 
-        sqlite3_reset(data_stmt);
+        auto stmt = partition_sec == 0 ? data_stmt :
+            partition_insert_stmt(data_partitions, tv.tv_sec);
+
+        if (stmt == nullptr) {
+            close_log();
+            return -1;
+        }
+
+        sqlite3_reset(stmt);
 
         int sql_pos = 1;
 
-        sqlite3_bind_int64(data_stmt, sql_pos++, tv.tv_sec);
-        sqlite3_bind_int64(data_stmt, sql_pos++, tv.tv_usec);
+        sqlite3_bind_int64(stmt, sql_pos++, tv.tv_sec);
+        sqlite3_bind_int64(stmt, sql_pos++, tv.tv_usec);
 
-        sqlite3_bind_text(data_stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(data_stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, phystring.c_str(), phystring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, macstring.c_str(), macstring.length(), SQLITE_TRANSIENT);
 
         if (gps != NULL) {
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->lat);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->lon);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->alt);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->speed);
-            sqlite3_bind_double(data_stmt, sql_pos++, gps->heading);
+            sqlite3_bind_double(stmt, sql_pos++, gps->lat);
+            sqlite3_bind_double(stmt, sql_pos++, gps->lon);
+            sqlite3_bind_double(stmt, sql_pos++, gps->alt);
+            sqlite3_bind_double(stmt, sql_pos++, gps->speed);
+            sqlite3_bind_double(stmt, sql_pos++, gps->heading);
         } else {
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
-            sqlite3_bind_double(data_stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
+            sqlite3_bind_double(stmt, sql_pos++, 0);
         }
 
-        sqlite3_bind_text(data_stmt, sql_pos++, uuidstring.c_str(), uuidstring.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, uuidstring.c_str(), uuidstring.length(), SQLITE_TRANSIENT);
 
-        sqlite3_bind_text(data_stmt, sql_pos++, type.data(), type.length(), SQLITE_TRANSIENT);
-        sqlite3_bind_text(data_stmt, sql_pos++, json.data(), json.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, type.data(), type.length(), SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, sql_pos++, json.data(), json.length(), SQLITE_TRANSIENT);
 
-        if (sqlite3_step(data_stmt) != SQLITE_DONE) {
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
             _MSG("kis_database_logfile unable to insert data in " +
                     ds_dbfile + ":" + std::string(sqlite3_errmsg(db)), MSGFLAG_ERROR);
             close_log();
@@ -1752,8 +2092,15 @@ unsigned int kis_database_logfile::packet_drop_endpoint_handler(std::ostream& os
     }
 
     try {
-        auto drop_query = 
-            _DELETE(db, "packets", _WHERE("ts_sec", LE, json["drop_before"].asUInt64()));
+        auto drop_before = json["drop_before"].asUInt64();
+
+        if (partition_sec != 0) {
+            local_locker dblock(&ds_mutex);
+            drop_partitions_before(packet_partitions, drop_before + 1, true);
+        } else {
+            auto drop_query = 
+                _DELETE(db, "packets", _WHERE("ts_sec", LE, drop_before));
+        }
 
     } catch (const std::exception& e) {
         ostream << e.what() << "\n";
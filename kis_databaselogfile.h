@@ -38,12 +38,14 @@
 #include "config.h"
 
 #include <atomic>
+#include <map>
 #include <memory>
 #include <string>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
 #include "kis_database.h"
+#include "kis_database_index.h"
 #include "devicetracker.h"
 #include "alertracker.h"
 #include "logtracker.h"
@@ -201,6 +203,47 @@ protected:
     sqlite3_stmt *snapshot_stmt;
     const char *snapshot_pz;
 
+    // Time-partitioned packet and data logging.  When kis_log_partition_sec is set, 
+    // rows are written to a table per partition of their timestamp (packets_1600000000, 
+    // etc), and the packets and data tables become views which union the partitions, 
+    // so anything reading the log still sees a single table.  Partitions are listed in
+    // the segments table, and time limits drop whole partitions instead of deleting 
+    // rows from a single large table.
+    struct log_partition_set {
+        // Name of the view, and the prefix of the partition tables
+        std::string name;
+        // Column definitions for creating a partition
+        std::string columns;
+        // Insert statement, formatted with the partition table name
+        std::string insert_sql;
+
+        // Prepared inserts, by partition start time
+        std::map<time_t, sqlite3_stmt *> partitions;
+
+        // Records have been redirected from a future or over-limit partition
+        bool warned_future;
+        bool warned_max;
+    };
+
+    unsigned int partition_sec;
+    // Maximum partitions per set, 0 for no limit
+    unsigned int partition_max;
+    log_partition_set packet_partitions;
+    log_partition_set data_partitions;
+
+    // Create the empty template partition and the view over it
+    int create_partition_set(log_partition_set& set);
+    // Find or create the partition for a timestamp; returns the insert statement, or
+    // nullptr if the partition could not be created.  Timestamps in the future and 
+    // partitions beyond partition_max are redirected to an existing partition, so
+    // bad timestamps can't create unbounded tables.  ds_mutex must be held.
+    sqlite3_stmt *partition_insert_stmt(log_partition_set& set, time_t ts);
+    int rebuild_partition_view(log_partition_set& set);
+    // Drop partitions which end before the cutoff; if trim is set, rows before the 
+    // cutoff are also deleted from the partition which spans it
+    void drop_partitions_before(log_partition_set& set, time_t cutoff, bool trim);
+    void close_partition_set(log_partition_set& set);
+
     static int packet_handler(CHAINCALL_PARMS);
 
     // Keep track of our commit cycles; to avoid thrashing the filesystem with
@@ -228,6 +271,17 @@ protected:
     unsigned int alert_timeout;
     int alert_timeout_timer;
 
+    // Secondary indexes (kis_database_index.h), built when the log closes or after a
+    // delay once the log is open; once built, new partitions are indexed as they are
+    // created
+    enum class log_index_mode { none, close, deferred };
+    log_index_mode index_mode;
+    bool indexes_built;
+    int index_timer;
+
+    // Build the indexes; ds_mutex must be held
+    void build_indexes();
+
     // Packet clearing API
     std::shared_ptr<kis_net_httpd_simple_post_endpoint> packet_drop_endp;
     unsigned int packet_drop_endpoint_handler(std::ostream& stream, const std::string& uri,
@@ -62,9 +62,19 @@ kis_datasource::kis_datasource(shared_datasource_builder in_builder) :
 
     suppress_gps = false;
 
+    replay_capable = false;
+    replay_speed = 0;
+    replay_clock = false;
+
     error_timer_id = -1;
     ping_timer_id = -1;
 
+    queue_priority = 1;
+
+    remote_compress = false;
+    remote_coalesce_ms = 0;
+    remote_coalesce_bytes = 0;
+
     mode_probing = false;
     mode_listing = false;
 
@@ -85,6 +95,12 @@ kis_datasource::~kis_datasource() {
     timetracker->remove_timer(error_timer_id);
     timetracker->remove_timer(ping_timer_id);
 
+    if (replay_clock)
+        timetracker->end_virtual_time();
+
+    if (packetchain != nullptr && get_source_number() != 0)
+        packetchain->remove_source_queue(get_source_number());
+
     cancel_all_commands("source deleted");
 
     command_ack_map.clear();
@@ -390,11 +406,70 @@ void kis_datasource::connect_remote(tcp::socket socket,
     // Connect the buffer
     attach_tcp_socket(socket);
 
+    // Negotiate the transport before the source starts sending data
+    if (remote_compress)
+        send_transport();
 
     // Send an opensource
     send_open_source(in_definition, 0, in_cb);
 }
 
+void kis_datasource::set_remote_compression(bool in_compress, unsigned int in_coalesce_ms,
+        unsigned int in_coalesce_bytes) {
+    local_locker lock(&ext_mutex, "datasource::set_remote_compression");
+
+    remote_compress = in_compress;
+    remote_coalesce_ms = in_coalesce_ms;
+    remote_coalesce_bytes = in_coalesce_bytes;
+}
+
+unsigned int kis_datasource::send_transport() {
+    local_locker lock(&ext_mutex, "datasource::send_transport");
+
+    std::shared_ptr<KismetExternal::Command> c(new KismetExternal::Command());
+
+    c->set_command("KDSTRANSPORT");
+
+    KismetDatasource::Transport t;
+    t.set_compression(remote_compress);
+    t.set_coalesce_ms(remote_coalesce_ms);
+    t.set_coalesce_bytes(remote_coalesce_bytes);
+
+    c->set_content(t.SerializeAsString());
+
+    return send_packet(c);
+}
+
+void kis_datasource::handle_transport_stats() {
+    if (!get_source_remote_held())
+        return;
+
+    source_transport_compressed->set(zin_active);
+    source_transport_wire_bytes->set(transport_wire_bytes);
+    source_transport_data_bytes->set(transport_raw_bytes);
+    source_transport_blocks->set(transport_blocks);
+
+    if (transport_blocks > 0)
+        source_transport_avg_delay->set(transport_delay_usec / transport_blocks);
+}
+
+void kis_datasource::update_queue_stats() {
+    packet_chain::source_queue_stats stats;
+
+    // Source 0 is the queue of packets with no datasource
+    if (get_source_number() == 0)
+        return;
+
+    if (!packetchain->fetch_source_queue_stats(get_source_number(), stats))
+        return;
+
+    local_locker lock(&ext_mutex, "datasource::update_queue_stats");
+
+    source_queue_priority->set(stats.priority);
+    source_queue_depth->set(stats.depth);
+    source_queue_dropped->set(stats.dropped);
+}
+
 void kis_datasource::close_source() {
     local_locker lock(&ext_mutex, "datasource::close_source");
 
@@ -411,6 +486,15 @@ void kis_datasource::close_source() {
 
     set_int_source_running(false);
 
+    if (replay_clock) {
+        timetracker->end_virtual_time();
+        replay_clock = false;
+    }
+
+    // Source 0 is the queue of packets with no datasource
+    if (get_source_number() != 0)
+        packetchain->remove_source_queue(get_source_number());
+
     close_external();
 }
 
@@ -557,12 +641,26 @@ bool kis_datasource::parse_interface_definition(std::string in_definition) {
     clobber_timestamp = get_definition_opt_bool("timestamp", 
             datasourcetracker->get_config_defaults()->get_remote_cap_timestamp());
 
+    if (replay_capable)
+        replay_speed = get_definition_opt_double("speed", 0);
+    else
+        replay_speed = 0;
+
     set_source_info_antenna_type(get_definition_opt("info_antenna_type"));
     set_source_info_antenna_gain(get_definition_opt_double("info_antenna_gain", 0.0f));
     set_source_info_antenna_orientation(get_definition_opt_double("info_antenna_orientation", 0.0f));
     set_source_info_antenna_beamwidth(get_definition_opt_double("info_antenna_beamwidth", 0.0f));
     set_source_info_amp_type(get_definition_opt("info_amp_type"));
     set_source_info_amp_gain(get_definition_opt_double("info_amp_gain", 0.0f));
+
+    auto priority = get_definition_opt_double("priority", 1);
+    if (priority < 1 || priority > 100) {
+        _MSG_ERROR("Source '{}' packet queue priority must be between 1 and 100; using 1",
+                get_source_name());
+        priority = 1;
+    }
+    queue_priority = (unsigned int) priority;
+    source_queue_priority->set(queue_priority);
    
     return true;
 }
@@ -633,7 +731,14 @@ void kis_datasource::cancel_all_commands(std::string in_error) {
     command_ack_map.clear();
 }
 
-bool kis_datasource::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) {
+bool kis_datasource::dispatch_rx_packet(const kis_external_command& c) {
+    // Data reports are nearly all of the traffic; check them first, and parse them
+    // directly from the receive buffer
+    if (c.command == "KDSDATAREPORT") {
+        handle_packet_data_report(c.seqno, c.content);
+        return true;
+    }
+
     // Handle all the default options first; ping, pong, message, etc are all
     // handled for us by the overhead of the KismetExternal protocol, we only need
     // to worry about our specific ones
@@ -641,28 +746,25 @@ bool kis_datasource::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command>
         return true;
 
     // Handle all the KisDataSource sub-protocols
-    if (c->command() == "KDSCONFIGUREREPORT") {
-        handle_packet_configure_report(c->seqno(), c->content());
+    if (c.command == "KDSCONFIGUREREPORT") {
+        handle_packet_configure_report(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "KDSDATAREPORT") {
-        handle_packet_data_report(c->seqno(), c->content());
+    } else if (c.command == "KDSERRORREPORT") {
+        handle_packet_error_report(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "KDSERRORREPORT") {
-        handle_packet_error_report(c->seqno(), c->content());
-        return true;
-    } else if (c->command() == "KDSINTERFACESREPORT") {
+    } else if (c.command == "KDSINTERFACESREPORT") {
         quiet_errors = true;
-        handle_packet_interfaces_report(c->seqno(), c->content());
+        handle_packet_interfaces_report(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "KDSOPENSOURCEREPORT") {
-        handle_packet_opensource_report(c->seqno(), c->content());
+    } else if (c.command == "KDSOPENSOURCEREPORT") {
+        handle_packet_opensource_report(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "KDSPROBESOURCEREPORT") {
+    } else if (c.command == "KDSPROBESOURCEREPORT") {
         quiet_errors = true;
-        handle_packet_probesource_report(c->seqno(), c->content());
+        handle_packet_probesource_report(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "KDSWARNINGREPORT") {
-        handle_packet_warning_report(c->seqno(), c->content());
+    } else if (c.command == "KDSWARNINGREPORT") {
+        handle_packet_warning_report(c.seqno, c.content_str());
         return true;
     }
 
@@ -770,6 +872,18 @@ void kis_datasource::handle_packet_opensource_report(uint32_t in_seqno,
         set_int_source_channel(report.channel().channel());
     }
 
+    // Spectrum sources declare the full range they sweep, which their sweep segments
+    // are stitched into
+    if (report.has_spectrum() && report.spectrum().has_start_mhz() &&
+            report.spectrum().has_end_mhz() && report.spectrum().has_bucket_width_hz()) {
+        lock.lock();
+        spectrum_store_held()->set_sweep_range(
+                (uint64_t) (report.spectrum().start_mhz() * 1000000),
+                (uint64_t) (report.spectrum().end_mhz() * 1000000),
+                report.spectrum().bucket_width_hz());
+        lock.unlock();
+    }
+
     if (report.has_hop_config()) {
 
         // Set the basics, if we got them we're being overridden by the remote
@@ -1113,18 +1227,35 @@ void kis_datasource::handle_packet_configure_report(uint32_t in_seqno, const std
 
 }
 
-void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::string& in_content) {
-    // If we're paused, throw away this packet
+void kis_datasource::handle_packet_data_report(uint32_t in_seqno, fmt::string_view in_content) {
+    bool clobber_remote_ts;
+    uint32_t override_linktype;
+    double replay;
+
+    // Grab everything we need from the source state under a single lock; if we're
+    // paused, throw away this packet
     {
         local_locker lock(&ext_mutex, "datasource::handle_packet_data_report");
 
-        if (get_source_paused())
+        if (get_source_paused_held())
             return;
+
+        clobber_remote_ts = clobber_timestamp && get_source_remote_held();
+        override_linktype = get_source_override_linktype_held();
+
+        replay = clobber_remote_ts ? 0 : replay_speed;
+
+        if (replay > 0 && !replay_clock) {
+            timetracker->begin_virtual_time();
+            replay_clock = true;
+        }
     }
 
-    KismetDatasource::DataReport report;
+    // Reports are only received from the read handler, one at a time; reusing the
+    // report keeps the allocated sub-messages and string capacity between reports
+    auto& report = rx_data_report;
 
-    if (!report.ParseFromString(in_content)) {
+    if (!report.ParseFromArray(in_content.data(), in_content.size())) {
         _MSG(std::string("Kismet datasource driver ") + get_source_builder()->get_source_type() + 
                 std::string(" could not parse the data report, something is wrong with "
                     "the remote capture tool"), MSGFLAG_ERROR);
@@ -1138,13 +1269,34 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
     if (report.has_warning())
         set_int_source_warning(report.warning());
 
+    // Spectrum sweeps go to the spectrum store instead of the packet chain; a report
+    // carrying only a sweep doesn't generate a packet, but the location and signal of
+    // a sweep are still reported
+    if (report.has_spectrum()) {
+        handle_sub_spectrum(report.spectrum());
+
+        if (!report.has_packet() && !report.has_json() && !report.has_buffer() &&
+                !report.has_gps() && !report.has_signal())
+            return;
+    }
+
     kis_packet *packet = packetchain->generate_packet();
 
+    // A packet with no frame, JSON, or buffer takes the time of the sweep
+    if (report.has_spectrum()) {
+        if (clobber_remote_ts || !report.spectrum().has_time_sec()) {
+            gettimeofday(&(packet->ts), NULL);
+        } else {
+            packet->ts.tv_sec = report.spectrum().time_sec();
+            packet->ts.tv_usec = report.spectrum().time_usec();
+        }
+    }
+
     // Process the data chunk
     if (report.has_packet()) {
         kis_datachunk *datachunk = new kis_datachunk();
 
-        if (clobber_timestamp && get_source_remote()) {
+        if (clobber_remote_ts) {
             gettimeofday(&(packet->ts), NULL);
         } else {
             packet->ts.tv_sec = report.packet().time_sec();
@@ -1152,8 +1304,8 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
         }
 
         // Override the DLT if we have one
-        if (get_source_override_linktype()) {
-            datachunk->dlt = get_source_override_linktype();
+        if (override_linktype) {
+            datachunk->dlt = override_linktype;
         } else {
             datachunk->dlt = report.packet().dlt();
         }
@@ -1161,8 +1313,6 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
         datachunk->copy_data((const uint8_t *) report.packet().data().data(), 
                 report.packet().data().length());
 
-        get_source_packet_size_rrd()->add_sample(report.packet().data().length(), time(0));
-
 
         packet->insert(pack_comp_linkframe, datachunk);
     }
@@ -1172,14 +1322,16 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
         // fprintf(stderr, "debug - got JSON report- %s\n", report.json().json().c_str());
         kis_json_packinfo *jsoninfo = new kis_json_packinfo();
       
-        if (clobber_timestamp && get_source_remote()) {
+        if (clobber_remote_ts) {
             gettimeofday(&(packet->ts), NULL);
         } else {
             packet->ts.tv_sec = report.json().time_sec();
             packet->ts.tv_usec = report.json().time_usec();
         }
 
-        jsoninfo->type = report.json().type();
+        // Only types a phy handler has registered can match, so unknown types are
+        // never interned
+        jsoninfo->type = kis_atom::find(report.json().type());
         jsoninfo->json_string = report.json().json();
 
         packet->insert(pack_comp_json, jsoninfo);
@@ -1189,7 +1341,7 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
     if (report.has_buffer()) {
         kis_protobuf_packinfo *bufinfo = new kis_protobuf_packinfo();
 
-        if (clobber_timestamp && get_source_remote()) {
+        if (clobber_remote_ts) {
             gettimeofday(&(packet->ts), NULL);
         } else {
             packet->ts.tv_sec = report.buffer().time_sec();
@@ -1219,15 +1371,33 @@ void kis_datasource::handle_packet_data_report(uint32_t in_seqno, const std::str
         packet->insert(pack_comp_no_gps, nogpsinfo);
     }
 
-    // TODO handle spectrum
-   
     packetchain_comp_datasource *datasrcinfo = new packetchain_comp_datasource();
     datasrcinfo->ref_source = this;
 
+    // Replayed capture time drives the server clock, and the source history
+    time_t sample_time;
+
+    if (replay > 0) {
+        struct timeval replay_tm;
+
+        timetracker->advance_virtual_time(packet->ts, replay);
+        timetracker->now(&replay_tm);
+
+        sample_time = replay_tm.tv_sec;
+    } else {
+        sample_time = time(0);
+    }
+
+    if (report.has_packet())
+        get_source_packet_size_rrd()->add_sample(report.packet().data().length(), sample_time);
+
     packet->insert(pack_comp_datasrc, datasrcinfo);
 
-    inc_source_num_packets(1);
-    get_source_packet_rrd()->add_sample(1, time(0));
+    {
+        local_locker lock(&ext_mutex, "datasource::handle_packet_data_report");
+        inc_source_num_packets_held(1);
+        get_source_packet_rrd()->add_sample(1, sample_time);
+    }
 
     handle_rx_packet(packet);
 }
@@ -1254,7 +1424,7 @@ void kis_datasource::handle_packet_warning_report(uint32_t in_seqno, const std::
     set_int_source_warning(report.warning());
 }
 
-kis_layer1_packinfo *kis_datasource::handle_sub_signal(KismetDatasource::SubSignal in_sig) {
+kis_layer1_packinfo *kis_datasource::handle_sub_signal(const KismetDatasource::SubSignal& in_sig) {
     // Extract l1 info from a KV pair so we can add it to a packet
     
     kis_layer1_packinfo *siginfo = new kis_layer1_packinfo();
@@ -1283,7 +1453,7 @@ kis_layer1_packinfo *kis_datasource::handle_sub_signal(KismetDatasource::SubSign
         siginfo->freq_khz = in_sig.freq_khz();
 
     if (in_sig.has_channel())
-        siginfo->channel = in_sig.channel();
+        siginfo->channel = declared_channel_atom(in_sig.channel());
 
     if (in_sig.has_datarate()) 
         siginfo->datarate = in_sig.datarate();
@@ -1291,7 +1461,65 @@ kis_layer1_packinfo *kis_datasource::handle_sub_signal(KismetDatasource::SubSign
     return siginfo;
 }
 
-kis_gps_packinfo *kis_datasource::handle_sub_gps(KismetDatasource::SubGps in_gps) {
+std::shared_ptr<kis_spectrum_store> kis_datasource::spectrum_store_held() {
+    if (spectrum_store == nullptr) {
+        auto rows = 
+            Globalreg::globalreg->kismet_config->fetch_opt_uint("spectrum_waterfall_rows", 512);
+        spectrum_store = std::make_shared<kis_spectrum_store>(rows);
+    }
+
+    return spectrum_store;
+}
+
+kis_atom kis_datasource::declared_channel_atom(const std::string& in_channel) {
+    auto a = kis_atom::find(in_channel);
+
+    if (!a.empty() || in_channel.length() == 0 || in_channel.length() > KIS_ATOM_MAX_LEN)
+        return a;
+
+    // Channel names come from the remote end; only the current channel and the channels
+    // the source declared when it was opened are interned, so a source can't fill the 
+    // atom table
+    local_shared_locker lock(&ext_mutex, "datasource::declared_channel_atom");
+
+    if (source_channel->get() == in_channel)
+        return kis_atom(in_channel);
+
+    for (const auto& c : *source_channels_vec) {
+        if (get_tracker_value<std::string>(c) == in_channel)
+            return kis_atom(in_channel);
+    }
+
+    return kis_atom();
+}
+
+void kis_datasource::handle_sub_spectrum(const KismetDatasource::SubSpectrum& in_spec) {
+    if (!in_spec.has_start_mhz() || !in_spec.has_end_mhz() || in_spec.data_size() == 0)
+        return;
+
+    std::shared_ptr<kis_spectrum_store> store;
+
+    {
+        local_locker lock(&ext_mutex, "datasource::handle_sub_spectrum");
+        store = spectrum_store_held();
+    }
+
+    uint64_t ts_sec = in_spec.time_sec();
+    uint64_t ts_usec = in_spec.time_usec();
+
+    if (!in_spec.has_time_sec() || (clobber_timestamp && get_source_remote())) {
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        ts_sec = tv.tv_sec;
+        ts_usec = tv.tv_usec;
+    }
+
+    store->add_sweep(ts_sec, ts_usec,
+            (uint64_t) (in_spec.start_mhz() * 1000000), (uint64_t) (in_spec.end_mhz() * 1000000),
+            in_spec.bucket_width_hz(), in_spec.data().data(), in_spec.data_size());
+}
+
+kis_gps_packinfo *kis_datasource::handle_sub_gps(const KismetDatasource::SubGps& in_gps) {
     // Extract a GPS record from a packet and turn it into a packinfo gps log
     kis_gps_packinfo *gpsinfo = new kis_gps_packinfo();
 
@@ -1514,6 +1742,26 @@ void kis_datasource::register_fields() {
     register_field("kismet.datasource.remote", 
             "capture is connected from a remote server", &source_remote);
 
+    register_field("kismet.datasource.transport.compressed",
+            "remote capture is sending compressed data", &source_transport_compressed);
+    register_field("kismet.datasource.transport.wire_bytes",
+            "bytes received from the remote capture connection", &source_transport_wire_bytes);
+    register_field("kismet.datasource.transport.data_bytes",
+            "bytes of data received from the remote capture, once decompressed", 
+            &source_transport_data_bytes);
+    register_field("kismet.datasource.transport.blocks",
+            "compressed blocks received from the remote capture", &source_transport_blocks);
+    register_field("kismet.datasource.transport.avg_delay_usec",
+            "average time the remote capture held data to coalesce it (in microseconds)",
+            &source_transport_avg_delay);
+
+    register_field("kismet.datasource.queue.priority",
+            "packet queue scheduling priority", &source_queue_priority);
+    register_field("kismet.datasource.queue.depth",
+            "packets waiting in the packet queue", &source_queue_depth);
+    register_field("kismet.datasource.queue.dropped",
+            "packets dropped from the packet queue", &source_queue_dropped);
+
     register_field("kismet.datasource.passive", 
             "capture is a post-able passive capture", &source_passive);
 
@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <atomic>
 #include <functional>
 
 #include "globalregistry.h"
@@ -33,6 +34,7 @@
 #include "entrytracker.h"
 #include "kis_external.h"
 #include "timetracker.h"
+#include "kis_spectrum_store.h"
 
 #include "protobuf_cpp/kismet.pb.h"
 #include "protobuf_cpp/datasource.pb.h"
@@ -283,6 +285,18 @@ public:
     virtual void connect_remote(tcp::socket tcpsocket,
             std::string in_definition, open_callback_t in_cb);
 
+    // Ask the next remote connection to coalesce and compress the data it sends, 
+    // sending a block at least every coalesce_ms or when coalesce_bytes are queued
+    virtual void set_remote_compression(bool in_compress, unsigned int in_coalesce_ms,
+            unsigned int in_coalesce_bytes);
+
+    // Spectrum sweeps received from this source, or nullptr if the source has not
+    // sent any
+    std::shared_ptr<kis_spectrum_store> get_spectrum_store() {
+        local_shared_locker l(&ext_mutex);
+        return spectrum_store;
+    }
+
 
     // close the source
     // Cancels any current activity (probe, open, pending commands) and sends a
@@ -345,10 +359,12 @@ public:
     __ProxyGetM(source_running, uint8_t, bool, source_running, ext_mutex);
 
     __ProxyGetM(source_remote, uint8_t, bool, source_remote, ext_mutex);
+    __ProxyGetHeld(source_remote, uint8_t, bool, source_remote, ext_mutex);
     __ProxyGetM(source_passive, uint8_t, bool, source_passive, ext_mutex);
 
     __ProxyM(source_num_packets, uint64_t, uint64_t, uint64_t, source_num_packets, ext_mutex);
     __ProxyIncDecM(source_num_packets, uint64_t, uint64_t, source_num_packets, ext_mutex);
+    __ProxyIncDecHeld(source_num_packets, uint64_t, uint64_t, source_num_packets, ext_mutex);
 
     __ProxyM(source_num_error_packets, uint64_t, uint64_t, uint64_t, source_num_error_packets, ext_mutex);
     __ProxyIncDecM(Msource_num_error_packets, uint64_t, uint64_t, source_num_error_packets, ext_mutex);
@@ -371,7 +387,11 @@ public:
 
     __Proxy(source_number, uint64_t, uint64_t, uint64_t, source_number);
 
+    // Packet queue scheduling weight; read by the packetchain for every packet
+    unsigned int get_queue_priority() { return queue_priority; }
+
     __ProxyM(source_paused, uint8_t, bool, bool, source_paused, ext_mutex);
+    __ProxyGetHeld(source_paused, uint8_t, bool, source_paused, ext_mutex);
 
 
     // Random metadata
@@ -385,6 +405,8 @@ public:
     // Overridden linktype
     __ProxyPrivSplitM(source_override_linktype, unsigned int, unsigned int, uint32_t, 
             source_override_linktype, ext_mutex);
+    __ProxyGetHeld(source_override_linktype, unsigned int, uint32_t, 
+            source_override_linktype, ext_mutex);
 
     
     // Perform a checksum on a packet after it's decapsulated; this is always
@@ -399,6 +421,7 @@ public:
     virtual void checksum_packet(kis_packet *in_pack __attribute__((unused))) { return; }
 
     virtual void pre_serialize() override {
+        update_queue_stats();
         local_eol_shared_locker l(&ext_mutex, "datasource::pre_serialize");
     }
 
@@ -497,12 +520,12 @@ protected:
 
 
     // Central packet dispatch override to add the datasource commands
-    virtual bool dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) override;
+    virtual bool dispatch_rx_packet(const kis_external_command& c) override;
 
     virtual void handle_msg_proxy(const std::string& msg, const int type) override;
 
     virtual void handle_packet_configure_report(uint32_t in_seqno, const std::string& in_packet);
-    virtual void handle_packet_data_report(uint32_t in_seqno, const std::string& in_packet);
+    virtual void handle_packet_data_report(uint32_t in_seqno, fmt::string_view in_packet);
     virtual void handle_packet_error_report(uint32_t in_seqno, const std::string& in_packet);
     virtual void handle_packet_interfaces_report(uint32_t in_seqno, const std::string& in_packet);
     virtual void handle_packet_opensource_report(uint32_t in_seqno, const std::string& in_packet);
@@ -513,6 +536,15 @@ protected:
     // and processed.  Subclasses can override this to manipulate packet content.
     virtual void handle_rx_packet(kis_packet *packet);
 
+    // Compressed transport requested for remote connections
+    bool remote_compress;
+    unsigned int remote_coalesce_ms;
+    unsigned int remote_coalesce_bytes;
+
+    virtual unsigned int send_transport();
+
+    virtual void handle_transport_stats() override;
+
     virtual unsigned int send_configure_channel(std::string in_channel, unsigned int in_transaction,
             configure_callback_t in_cb);
     virtual unsigned int send_configure_channel_hop(double in_rate,
@@ -527,8 +559,16 @@ protected:
 
     // Break out packet generation sub-functions so that custom datasources can easily
     // piggyback onto the decoders
-    virtual kis_gps_packinfo *handle_sub_gps(KismetDatasource::SubGps in_gps);
-    virtual kis_layer1_packinfo *handle_sub_signal(KismetDatasource::SubSignal in_signal);
+    virtual kis_gps_packinfo *handle_sub_gps(const KismetDatasource::SubGps& in_gps);
+    virtual kis_layer1_packinfo *handle_sub_signal(const KismetDatasource::SubSignal& in_signal);
+    virtual void handle_sub_spectrum(const KismetDatasource::SubSpectrum& in_spec);
+
+    // Atom of a channel reported in a packet; channels are only interned if the source
+    // declared them, any other channel is reported as unknown
+    kis_atom declared_channel_atom(const std::string& in_channel);
+
+    // Spectrum store of this source, created on first use; ext_mutex must be held
+    std::shared_ptr<kis_spectrum_store> spectrum_store_held();
 
 
     // Launch the IPC binary
@@ -630,6 +670,15 @@ protected:
     // etc.  DST maps this to unique UUIDs after an Open
     std::shared_ptr<tracker_element_uint64> source_number;
 
+    // Packet queue priority and the state of our queue in the packetchain
+    std::atomic<unsigned int> queue_priority;
+    std::shared_ptr<tracker_element_uint32> source_queue_priority;
+    std::shared_ptr<tracker_element_uint64> source_queue_depth;
+    std::shared_ptr<tracker_element_uint64> source_queue_dropped;
+
+    // Copy our queue state from the packetchain
+    void update_queue_stats();
+
     // Is the source paused?  If so, we throw out packets from it for now
     std::shared_ptr<tracker_element_uint8> source_paused;
 
@@ -685,9 +734,22 @@ protected:
     // Do we clobber the remote timestamp?
     bool clobber_timestamp;
 
+    // Sources which replay recorded packets set replay_capable; when one is opened with
+    // a replay speed, its packet timestamps drive the virtual server clock
+    bool replay_capable;
+    double replay_speed;
+    bool replay_clock;
+
     __ProxySetM(int_source_remote, uint8_t, bool, source_remote, ext_mutex);
     std::shared_ptr<tracker_element_uint8> source_remote;
 
+    // Remote transport counters
+    std::shared_ptr<tracker_element_uint8> source_transport_compressed;
+    std::shared_ptr<tracker_element_uint64> source_transport_wire_bytes;
+    std::shared_ptr<tracker_element_uint64> source_transport_data_bytes;
+    std::shared_ptr<tracker_element_uint64> source_transport_blocks;
+    std::shared_ptr<tracker_element_uint64> source_transport_avg_delay;
+
     __ProxySetM(int_source_passive, uint8_t, bool, source_passive, ext_mutex);
     std::shared_ptr<tracker_element_uint8> source_passive;
 
@@ -725,6 +787,12 @@ protected:
     int pack_comp_linkframe, pack_comp_l1info, pack_comp_gps, pack_comp_no_gps,
         pack_comp_datasrc, pack_comp_json, pack_comp_protobuf;
 
+    // Data report reused for every received report
+    KismetDatasource::DataReport rx_data_report;
+
+    // Quantized spectrum sweeps, created on the first sweep
+    std::shared_ptr<kis_spectrum_store> spectrum_store;
+
 };
 
 typedef std::shared_ptr<kis_datasource> shared_datasource;
@@ -86,7 +86,7 @@ kis_dissector_ip_data::kis_dissector_ip_data(global_registry *in_globalreg) {
 	globalreg->insert_global("DISSECTOR_IPDATA", std::shared_ptr<kis_dissector_ip_data>(this));
 
 	globalreg->packetchain->register_handler(&ipdata_packethook, this,
-		 									CHAINPOS_DATADISSECT, -100);
+		 									CHAINPOS_DATADISSECT, -100, "ipdata_dissector");
 
 	pack_comp_basicdata = 
 		globalreg->packetchain->register_packet_component("BASICDATA");
@@ -399,7 +399,7 @@ int kis_dissector_ip_data::handle_packet(kis_packet *in_pack) {
 					case iapp_pdu_channel:
 						if (pdu_len != 1)
 							break;
-						packinfo->channel = (int) pdu[3];
+						packinfo->channel = kis_atom::from_uint(pdu[3]);
 						break;
 					case iapp_pdu_beaconint:
 						if (pdu_len != 2)
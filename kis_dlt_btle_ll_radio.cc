@@ -101,22 +101,22 @@ int kis_dlt_btle_ll_radio::handle_packet(kis_packet *in_pack) {
         radioheader->noise_dbm = rf_ll->noise;
 
     if (rf_ll->monitor_channel == 37) {
-        radioheader->channel = "37";
+        radioheader->channel = kis_atom::from_uint(37);
         radioheader->freq_khz = (2402 * 1000);
     } else if (rf_ll->monitor_channel == 38) {
-        radioheader->channel = "38";
+        radioheader->channel = kis_atom::from_uint(38);
         radioheader->freq_khz = (2426 * 1000);
     } else if (rf_ll->monitor_channel == 39) {
-        radioheader->channel = "39";
+        radioheader->channel = kis_atom::from_uint(39);
         radioheader->freq_khz = (2480 * 1000);
     }  else if (rf_ll->monitor_channel <= 10) {
-        radioheader->channel = fmt::format("{}", rf_ll->monitor_channel);
+        radioheader->channel = kis_atom::from_uint(rf_ll->monitor_channel);
         radioheader->freq_khz = (2404 + (rf_ll->monitor_channel * 2)) * 1000;
     } else if (rf_ll->monitor_channel <= 36) {
-        radioheader->channel = fmt::format("{}", rf_ll->monitor_channel);
+        radioheader->channel = kis_atom::from_uint(rf_ll->monitor_channel);
         radioheader->freq_khz = (2428 + ((rf_ll->monitor_channel - 11) * 2)) * 1000;
     } else {
-        radioheader->channel = "0";
+        radioheader->channel = kis_atom::from_uint(0);
         radioheader->freq_khz = 0;
     }
 
@@ -44,6 +44,17 @@ kis_external_interface::kis_external_interface() :
     seqno{0},
     last_pong{0},
     ping_timer_id{-1},
+    in_buf(16384),
+    in_buf_start{0},
+    in_buf_end{0},
+    zin_active{false},
+    zraw_start{0},
+    zraw_end{0},
+    transport_wire_bytes{0},
+    transport_raw_bytes{0},
+    transport_blocks{0},
+    transport_delay_usec{0},
+    strand{Globalreg::globalreg->io},
     ipc_in{Globalreg::globalreg->io},
     ipc_out{Globalreg::globalreg->io},
     tcpsocket{Globalreg::globalreg->io},
@@ -56,13 +67,16 @@ kis_external_interface::kis_external_interface() :
 
 kis_external_interface::~kis_external_interface() {
     close_external();
+
+    reset_transport();
 }
 
 bool kis_external_interface::attach_tcp_socket(tcp::socket& socket) {
     local_locker l(&ext_mutex, "kei:attach_tcp_socket");
 
     stopped = true;
-    in_buf.consume(in_buf.size());
+    reset_in_buf();
+    reset_transport();
 
     if (ipc.pid > 0) {
         _MSG_ERROR("Tried to attach a TCP socket to an external endpoint that already has "
@@ -111,6 +125,8 @@ void kis_external_interface::close_external() {
             ;
         }
     }
+
+    out_bufs.clear();
 };
 
 void kis_external_interface::ipc_soft_kill() {
@@ -184,24 +200,22 @@ void kis_external_interface::start_ipc_read(std::shared_ptr<kis_external_interfa
     if (stopped)
         return;
 
-    asio::async_read(ipc_in, in_buf,
-            asio::transfer_at_least(sizeof(kismet_external_frame_t)),
-            [this, ref](const asio::error_code& ec, std::size_t t) {
+    ipc_in.async_read_some(in_buf_space(),
+            strand.wrap([this, ref](const asio::error_code& ec, std::size_t t) {
             if (handle_read(ref, ec, t) > 0)
                 start_ipc_read(ref);
-            });
+            }));
 }
 
 void kis_external_interface::start_tcp_read(std::shared_ptr<kis_external_interface> ref) {
     if (stopped)
         return;
 
-    asio::async_read(tcpsocket, in_buf,
-            asio::transfer_at_least(sizeof(kismet_external_frame_t)),
-            [this, ref](const asio::error_code& ec, std::size_t t) {
+    tcpsocket.async_read_some(in_buf_space(),
+            strand.wrap([this, ref](const asio::error_code& ec, std::size_t t) {
             if (handle_read(ref, ec, t) >= 0)
                 start_tcp_read(ref);
-            });
+            }));
 }
 
 int kis_external_interface::handle_read(std::shared_ptr<kis_external_interface> ref, 
@@ -231,20 +245,119 @@ int kis_external_interface::handle_read(std::shared_ptr<kis_external_interface>
     local_demand_locker lock(&ext_mutex, "kei::handle_read");
     lock.lock();
 
+    in_buf_end += in_amt;
+    transport_wire_bytes += in_amt;
+
+    const kismet_external_zframe_t *zframe;
+    uint32_t zframe_sz, zdata_sz, raw_sz;
+    uint32_t data_checksum;
+    int r;
+
+    // Consume everything in the buffer that we can
+    while (1) {
+        r = dispatch_frames(lock, in_buf, in_buf_start, in_buf_end);
+
+        if (r <= 0)
+            return r;
+
+        if (r == 1)
+            break;
+
+        // A compressed block from a remote capture is at the head of the buffer
+        if (in_buf_end - in_buf_start < sizeof(kismet_external_zframe_t))
+            break;
+
+        zframe = reinterpret_cast<const kismet_external_zframe_t *>(in_buf.data() + in_buf_start);
+
+        zdata_sz = kis_ntoh32(zframe->data_sz);
+        raw_sz = kis_ntoh32(zframe->raw_sz);
+        zframe_sz = zdata_sz + sizeof(kismet_external_zframe_t);
+
+        if (zdata_sz > KIS_EXTERNAL_ZFRAME_MAX || raw_sz > KIS_EXTERNAL_ZRAW_MAX) {
+            _MSG_ERROR("Kismet external interface got a compressed block which is too large "
+                    "to be processed ({}/{}); the block is malformed.", zdata_sz, raw_sz);
+            trigger_error("Compressed block too large for buffer");
+            return -1;
+        }
+
+        // Blocks may be larger than any uncompressed frame; grow the buffer so the 
+        // rest of the block can be read after the partial block is moved to the front
+        if (zframe_sz > in_buf.size())
+            in_buf.resize(zframe_sz);
+
+        if (zframe_sz > in_buf_end - in_buf_start)
+            break;
+
+        zframe = reinterpret_cast<const kismet_external_zframe_t *>(in_buf.data() + in_buf_start);
+
+        data_checksum = adler32_checksum((const char *) zframe->data, zdata_sz);
+
+        if (data_checksum != kis_ntoh32(zframe->data_checksum)) {
+            _MSG_ERROR("Kismet external interface got a compressed block with an invalid "
+                    "checksum; either the block is malformed or a network error occurred.");
+            trigger_error("compressed block has invalid checksum");
+            return -1;
+        }
+
+        if (!inflate_block(zframe->data, zdata_sz, raw_sz)) {
+            _MSG_ERROR("Kismet external interface could not decompress a compressed block; "
+                    "either the block is malformed or a network error occurred.");
+            trigger_error("unable to decompress block");
+            return -1;
+        }
+
+        transport_blocks++;
+        transport_delay_usec += kis_ntoh32(zframe->delay_usec);
+
+        in_buf_start += zframe_sz;
+
+        // Frames may span blocks, so anything left over is kept for the next block
+        r = dispatch_frames(lock, zraw_buf, zraw_start, zraw_end);
+
+        if (r <= 0)
+            return r;
+
+        if (r == 2) {
+            _MSG_ERROR("Kismet external interface got a compressed block inside a compressed "
+                    "block; the block is malformed.");
+            trigger_error("nested compressed block");
+            return -1;
+        }
+    }
+
+    // Move any partial frame to the front of the buffer for the next read
+    if (in_buf_start == in_buf_end) {
+        reset_in_buf();
+    } else if (in_buf_start != 0) {
+        memmove(in_buf.data(), in_buf.data() + in_buf_start, in_buf_end - in_buf_start);
+        in_buf_end -= in_buf_start;
+        in_buf_start = 0;
+    }
+
+    handle_transport_stats();
+
+    return 1;
+}
+
+int kis_external_interface::dispatch_frames(local_demand_locker& lock, std::vector<uint8_t>& buf,
+        size_t& start, size_t& end) {
     const kismet_external_frame_t *frame;
     uint32_t frame_sz, data_sz;
     uint32_t data_checksum;
+    kis_external_command cmd;
 
-    // Consume everything in the buffer that we can
     while (1) {
         // See if we have enough to get a frame header
-        size_t buffamt = in_buf.size();
+        size_t buffamt = end - start;
 
-        if (buffamt < sizeof(kismet_external_frame_t)) {
+        if (buffamt < sizeof(kismet_external_frame_t))
             return 1;
-        }
 
-        frame = asio::buffer_cast<const kismet_external_frame_t *>(in_buf.data());
+        frame = reinterpret_cast<const kismet_external_frame_t *>(buf.data() + start);
+
+        // Compressed blocks are handled by the caller
+        if (kis_ntoh32(frame->signature) == KIS_EXTERNAL_ZPROTO_SIG)
+            return 2;
 
         // Check the frame signature
         if (kis_ntoh32(frame->signature) != KIS_EXTERNAL_PROTO_SIG) {
@@ -268,9 +381,8 @@ int kis_external_interface::handle_read(std::shared_ptr<kis_external_interface>
         }
 
         // If we don't have the whole buffer available, bail on this read
-        if (frame_sz > buffamt) {
+        if (frame_sz > buffamt)
             return 1;
-        }
 
         // We have a complete payload, checksum 
         data_checksum = adler32_checksum((const char *) frame->data, data_sz);
@@ -283,10 +395,8 @@ int kis_external_interface::handle_read(std::shared_ptr<kis_external_interface>
             return -1;
         }
 
-        // Process the data payload as a protobuf frame
-        std::shared_ptr<KismetExternal::Command> cmd(new KismetExternal::Command());
-
-        if (!cmd->ParseFromArray(frame->data, data_sz)) {
+        // Decode the command in place; the content stays in the buffer until dispatch is done
+        if (!cmd.parse(frame->data, data_sz)) {
             _MSG_ERROR("Kismet external interface could not interpret the payload of the "
                     "command frame; either the frame is malformed, a network error occurred, or "
                     "an unsupported tool is connected to the external interface API");
@@ -294,14 +404,155 @@ int kis_external_interface::handle_read(std::shared_ptr<kis_external_interface>
             return -1;
         }
 
-        in_buf.consume(frame_sz);
+        transport_raw_bytes += frame_sz;
 
         // Unlock before processing, individual commands will lock as needed
         lock.unlock();
 
         // Dispatch the received command
         dispatch_rx_packet(cmd);
+
+        lock.lock();
+
+        // The interface may have been closed or restarted during dispatch, resetting the buffer
+        if (stopped || end - start < frame_sz)
+            return 0;
+
+        start += frame_sz;
+
+        if (start == end)
+            start = end = 0;
+    }
+}
+
+bool kis_external_interface::inflate_block(const uint8_t *data, size_t data_sz, size_t raw_sz) {
+    int r;
+
+    if (!zin_active) {
+        memset(&zin, 0, sizeof(zin));
+
+        if (inflateInit(&zin) != Z_OK)
+            return false;
+
+        zin_active = true;
+    }
+
+    // Make room for the block after any partial frame left from the previous block
+    if (zraw_start != 0) {
+        memmove(zraw_buf.data(), zraw_buf.data() + zraw_start, zraw_end - zraw_start);
+        zraw_end -= zraw_start;
+        zraw_start = 0;
+    }
+
+    // Leave a spare byte of output so that the flush marker is always consumed
+    if (zraw_end + raw_sz + 1 > zraw_buf.size())
+        zraw_buf.resize(zraw_end + raw_sz + 1);
+
+    zin.next_in = const_cast<Bytef *>(data);
+    zin.avail_in = data_sz;
+    zin.next_out = zraw_buf.data() + zraw_end;
+    zin.avail_out = raw_sz + 1;
+
+    r = inflate(&zin, Z_SYNC_FLUSH);
+
+    // The sender primes the stream with the shared dictionary
+    if (r == Z_NEED_DICT) {
+        if (inflateSetDictionary(&zin, (const Bytef *) KIS_EXTERNAL_ZDICT, 
+                    sizeof(KIS_EXTERNAL_ZDICT) - 1) != Z_OK)
+            return false;
+
+        r = inflate(&zin, Z_SYNC_FLUSH);
+    }
+
+    if (r != Z_OK || zin.avail_in != 0 || zin.avail_out != 1)
+        return false;
+
+    zraw_end += raw_sz;
+
+    return true;
+}
+
+void kis_external_interface::reset_transport() {
+    if (zin_active) {
+        inflateEnd(&zin);
+        zin_active = false;
+    }
+
+    zraw_start = zraw_end = 0;
+}
+
+bool kis_external_command::parse(const uint8_t *data, size_t len) {
+    const uint8_t *pos = data;
+    const uint8_t *end = data + len;
+
+    bool have_command = false, have_seqno = false, have_content = false;
+
+    auto read_varint = [&pos, end](uint64_t& v) -> bool {
+        v = 0;
+
+        for (unsigned int shift = 0; shift < 64 && pos < end; shift += 7) {
+            uint8_t b = *pos++;
+
+            v |= (uint64_t) (b & 0x7F) << shift;
+
+            if ((b & 0x80) == 0)
+                return true;
+        }
+
+        return false;
+    };
+
+    while (pos < end) {
+        uint64_t tag, v;
+
+        if (!read_varint(tag))
+            return false;
+
+        auto field = tag >> 3;
+        auto wiretype = tag & 0x07;
+
+        switch (wiretype) {
+            case 0:
+                if (!read_varint(v))
+                    return false;
+
+                if (field == 2) {
+                    seqno = (uint32_t) v;
+                    have_seqno = true;
+                }
+
+                break;
+            case 1:
+                if (end - pos < 8)
+                    return false;
+                pos += 8;
+                break;
+            case 2:
+                if (!read_varint(v) || v > (uint64_t) (end - pos))
+                    return false;
+
+                if (field == 1) {
+                    command = fmt::string_view((const char *) pos, v);
+                    have_command = true;
+                } else if (field == 3) {
+                    content = fmt::string_view((const char *) pos, v);
+                    have_content = true;
+                }
+
+                pos += v;
+                break;
+            case 5:
+                if (end - pos < 4)
+                    return false;
+                pos += 4;
+                break;
+            default:
+                // Groups are not used by any external protocol
+                return false;
+        }
     }
+
+    return have_command && have_seqno && have_content;
 }
 
 bool kis_external_interface::check_ipc(const std::string& in_binary) {
@@ -337,7 +588,8 @@ bool kis_external_interface::run_ipc() {
     struct stat fstat;
 
     stopped = true;
-    in_buf.consume(in_buf.size());
+    reset_in_buf();
+    reset_transport();
 
     if (external_binary == "") {
         _MSG("Kismet external interface did not have an IPC binary to launch", MSGFLAG_ERROR);
@@ -532,9 +784,9 @@ unsigned int kis_external_interface::send_packet(std::shared_ptr<KismetExternal:
     // Calc frame size
     ssize_t frame_sz = sizeof(kismet_external_frame_t) + content_sz;
 
-    // Our actual frame
-    char frame_buf[frame_sz];
-    kismet_external_frame_t *frame = reinterpret_cast<kismet_external_frame_t *>(frame_buf);
+    // Our actual frame; queued frames are held until the write completes
+    auto frame_buf = std::make_shared<std::string>(frame_sz, 0);
+    kismet_external_frame_t *frame = reinterpret_cast<kismet_external_frame_t *>(&(*frame_buf)[0]);
 
     // Fill in the headers
     frame->signature = kis_hton32(KIS_EXTERNAL_PROTO_SIG);
@@ -547,65 +799,79 @@ unsigned int kis_external_interface::send_packet(std::shared_ptr<KismetExternal:
     data_csum = adler32_checksum((const char *) frame->data, content_sz); 
     frame->data_checksum = kis_hton32(data_csum);
 
-    if (ipc_out.is_open())
-        asio::async_write(ipc_out, asio::buffer(frame_buf, frame_sz),
-                [this](const asio::error_code& ec, std::size_t) {
-                if (ec) {
-                    if (ec.value() == asio::error::operation_aborted)
-                        return;
-
-                    _MSG_ERROR("Kismet external interface got an error writing a packet to an "
-                            "IPC interface: {}", ec.message());
-                    trigger_error("write failure");
-                    return;
-                }
-                });
-    else if (tcpsocket.is_open()) 
-        asio::async_write(tcpsocket, asio::buffer(frame_buf, frame_sz),
-                [this](const asio::error_code& ec, std::size_t) {
-                if (ec) {
-                    if (ec.value() == asio::error::operation_aborted)
-                        return;
-
-                    _MSG_ERROR("Kismet external interface got an error writing a packet to a "
-                            "TCP interface: {}", ec.message());
-                    trigger_error("write failure");
-                    return;
-                }
-                });
+    // Only one write may be outstanding on a stream; packets sent while a write is 
+    // in flight are written in order as it completes
+    out_bufs.push_back(frame_buf);
+
+    if (out_bufs.size() == 1)
+        start_write();
 
     return c->seqno();
 }
 
-bool kis_external_interface::dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c) {
+void kis_external_interface::start_write() {
+    // Called with ext_mutex held and a packet at the head of the queue
+    auto buf = out_bufs.front();
+
+    auto handler = [this, buf](const asio::error_code& ec, std::size_t) {
+        if (ec) {
+            if (ec.value() == asio::error::operation_aborted)
+                return;
+
+            _MSG_ERROR("Kismet external interface got an error writing a packet to an "
+                    "external interface: {}", ec.message());
+            trigger_error("write failure");
+            return;
+        }
+
+        local_locker lock(&ext_mutex, "kei::start_write");
+
+        if (out_bufs.size() == 0 || out_bufs.front() != buf)
+            return;
+
+        out_bufs.pop_front();
+
+        if (out_bufs.size() > 0 && !stopped)
+            start_write();
+    };
+
+    if (ipc_out.is_open())
+        asio::async_write(ipc_out, asio::buffer(*buf), strand.wrap(handler));
+    else if (tcpsocket.is_open()) 
+        asio::async_write(tcpsocket, asio::buffer(*buf), strand.wrap(handler));
+    else
+        out_bufs.clear();
+}
+
+bool kis_external_interface::dispatch_rx_packet(const kis_external_command& c) {
     // Simple dispatcher; this should be called by child implementations who
     // add their own commands
-    if (c->command() == "MESSAGE") {
-        handle_packet_message(c->seqno(), c->content());
+    if (c.command == "MESSAGE") {
+        handle_packet_message(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "PING") {
-        handle_packet_ping(c->seqno(), c->content());
+    } else if (c.command == "PING") {
+        handle_packet_ping(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "PONG") {
-        handle_packet_pong(c->seqno(), c->content());
+    } else if (c.command == "PONG") {
+        handle_packet_pong(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "SHUTDOWN") {
-        handle_packet_shutdown(c->seqno(), c->content());
+    } else if (c.command == "SHUTDOWN") {
+        handle_packet_shutdown(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "HTTPREGISTERURI") {
-        handle_packet_http_register(c->seqno(), c->content());
+    } else if (c.command == "HTTPREGISTERURI") {
+        handle_packet_http_register(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "HTTPRESPONSE") {
-        handle_packet_http_response(c->seqno(), c->content());
+    } else if (c.command == "HTTPRESPONSE") {
+        handle_packet_http_response(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "HTTPAUTHREQ") {
-        handle_packet_http_auth_request(c->seqno(), c->content());
+    } else if (c.command == "HTTPAUTHREQ") {
+        handle_packet_http_auth_request(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "EVENTBUSREGISTER") {
-        handle_packet_eventbus_register(c->seqno(), c->content());
+    } else if (c.command == "EVENTBUSREGISTER") {
+        handle_packet_eventbus_register(c.seqno, c.content_str());
         return true;
-    } else if (c->command() == "EVENTBUSPUBLISH") {
-        handle_packet_eventbus_publish(c->seqno(), c->content());
+    } else if (c.command == "EVENTBUSPUBLISH") {
+        handle_packet_eventbus_publish(c.seqno, c.content_str());
         return true;
     }
 
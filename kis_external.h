@@ -33,8 +33,13 @@
 #include "config.h"
 
 #include <functional>
+#include <deque>
+#include <vector>
+
+#include <zlib.h>
 
 #include <eventbus.h>
+#include "fmt.h"
 #include "globalregistry.h"
 #include "ipctracker_v2.h"
 #include "kis_net_microhttpd.h"
@@ -49,6 +54,23 @@ namespace KismetExternal {
     class Command;
 };
 
+// Command received from an external tool.  The command and content reference the
+// frame in the receive buffer and are only valid for the duration of the dispatch;
+// handlers which keep the content must copy it.
+struct kis_external_command {
+    uint32_t seqno;
+    fmt::string_view command;
+    fmt::string_view content;
+
+    // Decode a KismetExternal::Command in place from the protobuf wire format; fails if
+    // the data is malformed or a required field is missing
+    bool parse(const uint8_t *data, size_t len);
+
+    std::string content_str() const {
+        return std::string(content.data(), content.size());
+    }
+};
+
 struct kis_external_http_session {
     kis_net_httpd_connection *connection; 
     std::shared_ptr<conditional_locker<int> > locker;
@@ -139,7 +161,7 @@ protected:
     virtual unsigned int send_packet(std::shared_ptr<KismetExternal::Command> c);
 
     // Central packet dispatch handler
-    virtual bool dispatch_rx_packet(std::shared_ptr<KismetExternal::Command> c);
+    virtual bool dispatch_rx_packet(const kis_external_command& c);
 
     // Generic msg proxy
     virtual void handle_msg_proxy(const std::string& msg, const int msgtype); 
@@ -169,10 +191,56 @@ protected:
 
     int ping_timer_id;
 
-    // Input buffer
-    asio::streambuf in_buf;
+    // Input buffer; frames are limited to 8k, so a fixed buffer compacted after each read
+    // always has room for the rest of a partial frame.  Frames are decoded in place and
+    // are not consumed until they have been dispatched.
+    std::vector<uint8_t> in_buf;
+    size_t in_buf_start, in_buf_end;
+
+    void reset_in_buf() {
+        in_buf_start = in_buf_end = 0;
+    }
+
+    asio::mutable_buffers_1 in_buf_space() {
+        return asio::buffer(in_buf.data() + in_buf_end, in_buf.size() - in_buf_end);
+    }
+
     int handle_read(std::shared_ptr<kis_external_interface> ref, const asio::error_code& ec, size_t sz);
 
+    // Dispatch the complete frames at the head of a buffer; returns -1 on error, 0 if the
+    // interface was closed during dispatch, 1 when more data is needed, and 2 when a 
+    // compressed block is at the head of the buffer
+    int dispatch_frames(local_demand_locker& lock, std::vector<uint8_t>& buf, 
+            size_t& start, size_t& end);
+
+    // Compressed transport from remote captures; blocks are decompressed into zraw_buf,
+    // which holds any partial frame until the next block arrives
+    bool zin_active;
+    z_stream zin;
+    std::vector<uint8_t> zraw_buf;
+    size_t zraw_start, zraw_end;
+
+    bool inflate_block(const uint8_t *data, size_t data_sz, size_t raw_sz);
+    void reset_transport();
+
+    // Transport counters; bytes read from the connection, bytes of frames once 
+    // decompressed, compressed blocks, and the total time the sender held the blocks
+    uint64_t transport_wire_bytes;
+    uint64_t transport_raw_bytes;
+    uint64_t transport_blocks;
+    uint64_t transport_delay_usec;
+
+    // Called with ext_mutex held after each read, to publish the transport counters
+    virtual void handle_transport_stats() { }
+
+    // Serializes the read and write handlers of this interface when the io service 
+    // runs multiple threads
+    asio::io_service::strand strand;
+
+    // Outbound frames; the head of the queue is being written
+    std::deque<std::shared_ptr<std::string>> out_bufs;
+    void start_write();
+
     // Pipe IPC
     std::string external_binary;
     std::vector<std::string> external_binary_args;
@@ -44,5 +44,45 @@ struct kismet_external_frame {
 } __attribute__((packed));
 typedef struct kismet_external_frame kismet_external_frame_t;
 
+/* Remote captures may negotiate a compressed transport, where the frames sent by the
+ * capture are coalesced and sent as compressed blocks.  The frames are treated as a 
+ * single byte stream which is compressed with zlib, primed with a dictionary of 
+ * common frame content and flushed at the end of each block; a frame may span
+ * multiple blocks.
+ */
+#define KIS_EXTERNAL_ZPROTO_SIG   0xDECAFBAE
+
+/* Largest compressed block and largest uncompressed content of a block */
+#define KIS_EXTERNAL_ZFRAME_MAX   (256 * 1024)
+#define KIS_EXTERNAL_ZRAW_MAX     (1024 * 1024)
+
+/* Compression dictionary shared by both ends; the most common content is last */
+#define KIS_EXTERNAL_ZDICT \
+    "KDSWARNINGREPORTKDSERRORREPORTKDSCONFIGUREREPORTKDSPROBESOURCEREPORT" \
+    "KDSOPENSOURCEREPORTKDSINTERFACESREPORTMESSAGEPONGPING" \
+    "{\"model\": \"\", \"id\": , \"channel\": \"\", \"time\": \"\", \"mic\": \"CRC\"" \
+    "\"icao\": \"\", \"adsb_msg\": \"\", \"RTL433\"\"RTLadsb\"\"RTLamr\"" \
+    "\x00\x00\x12\x00\x2e\x48\x00\x00\x00\x02\x6c\x09\xa0\x00" \
+    "\x80\x00\x00\x00\xff\xff\xff\xff\xff\xff\x64\x00\x11\x04\x00" \
+    "\x00\x00\x00\x00\x00\x08\x00\x00\x00\x00\x00\x00\x00\x00" \
+    "KDSDATAREPORT"
+
+/* Compressed block wrapper */
+struct kismet_external_zframe {
+    /* Fixed Start-of-packet signature, big endian */
+    uint32_t signature;
+    /* Basic adler32 checksum of the compressed data */
+    uint32_t data_checksum;
+    /* Size of compressed data */
+    uint32_t data_sz;
+    /* Size of the frame content once decompressed */
+    uint32_t raw_sz;
+    /* How long the oldest content in the block was held by the sender, in usec */
+    uint32_t delay_usec;
+    /* Compressed frame content */
+    uint8_t data[0];
+} __attribute__((packed));
+typedef struct kismet_external_zframe kismet_external_zframe_t;
+
 #endif
 
@@ -0,0 +1,248 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "fmt.h"
+#include "kis_mutex.h"
+
+std::atomic<bool> kis_lock_profiling {false};
+
+namespace {
+    struct lock_counters {
+        uint64_t count = 0;
+        uint64_t contended = 0;
+        uint64_t wait_ns = 0;
+        uint64_t max_wait_ns = 0;
+        uint64_t hold_ns = 0;
+        uint64_t max_hold_ns = 0;
+
+        void merge(const lock_counters& c) {
+            count += c.count;
+            contended += c.contended;
+            wait_ns += c.wait_ns;
+            max_wait_ns = std::max(max_wait_ns, c.max_wait_ns);
+            hold_ns += c.hold_ns;
+            max_hold_ns = std::max(max_hold_ns, c.max_hold_ns);
+        }
+    };
+
+    // Counters of one thread; the mutex is only contended while the profile is
+    // being collected or reset
+    struct thread_lock_profile {
+        std::mutex mutex;
+
+        // Mutex profiling name -> locker name -> [exclusive, shared]
+        std::unordered_map<const char *,
+            std::unordered_map<std::string, std::pair<lock_counters, lock_counters>>> counters;
+    };
+
+    void merge_profile(thread_lock_profile& dst, const thread_lock_profile& src) {
+        for (const auto& mi : src.counters) {
+            auto& lockers = dst.counters[mi.first];
+
+            for (const auto& li : mi.second) {
+                auto& c = lockers[li.first];
+                c.first.merge(li.second.first);
+                c.second.merge(li.second.second);
+            }
+        }
+    }
+
+    // Profiles of every live thread which has recorded a lock, and the merged counters
+    // of threads which have exited.  Both, and the intern table, are created on first
+    // use and never freed, because mutexes are named and locked during static 
+    // construction and destruction.
+    std::mutex& profile_list_mutex() {
+        static auto m = new std::mutex();
+        return *m;
+    }
+
+    std::vector<thread_lock_profile *>& profile_list() {
+        static auto l = new std::vector<thread_lock_profile *>();
+        return *l;
+    }
+
+    thread_lock_profile& retired_profile() {
+        static auto p = new thread_lock_profile();
+        return *p;
+    }
+
+    // Set once the profile of this thread has been retired; locks recorded by later
+    // thread_local destructors go straight to the retired profile
+    thread_local bool thread_profile_retired = false;
+
+    // Owns the profile of a thread; when the thread exits, its counters are folded 
+    // into the retired profile and it leaves the list, so short-lived threads such as
+    // the per-connection httpd threads are still counted without growing the list
+    struct thread_profile_holder {
+        std::unique_ptr<thread_lock_profile> profile;
+
+        ~thread_profile_holder() {
+            if (profile == nullptr)
+                return;
+
+            std::lock_guard<std::mutex> lk(profile_list_mutex());
+
+            auto& l = profile_list();
+            l.erase(std::remove(l.begin(), l.end(), profile.get()), l.end());
+
+            std::lock_guard<std::mutex> rlk(retired_profile().mutex);
+            std::lock_guard<std::mutex> plk(profile->mutex);
+            merge_profile(retired_profile(), *profile);
+
+            thread_profile_retired = true;
+        }
+    };
+
+    thread_lock_profile *this_thread_profile() {
+        if (thread_profile_retired)
+            return &retired_profile();
+
+        thread_local thread_profile_holder holder;
+
+        if (holder.profile == nullptr) {
+            holder.profile.reset(new thread_lock_profile());
+
+            std::lock_guard<std::mutex> lk(profile_list_mutex());
+            profile_list().push_back(holder.profile.get());
+        }
+
+        return holder.profile.get();
+    }
+}
+
+const char *kis_lock_profile_name(const std::string& in_name) {
+    static auto m = new std::mutex();
+    static auto names = new std::unordered_set<std::string>();
+
+    std::lock_guard<std::mutex> lk(*m);
+    return names->insert(in_name.substr(0, in_name.find('('))).first->c_str();
+}
+
+void kis_lock_profile_record(const char *in_mutex_name, const std::string& in_locker_name,
+        bool in_shared, uint64_t in_wait_ns, uint64_t in_hold_ns) {
+    auto profile = this_thread_profile();
+
+    std::lock_guard<std::mutex> lk(profile->mutex);
+
+    auto& lockers = profile->counters[in_mutex_name];
+
+    auto li = lockers.find(in_locker_name);
+    if (li == lockers.end())
+        li = lockers.emplace(in_locker_name, std::make_pair(lock_counters(), lock_counters())).first;
+
+    auto& c = in_shared ? li->second.second : li->second.first;
+
+    c.count++;
+
+    if (in_wait_ns >= KIS_LOCK_CONTENDED_NS)
+        c.contended++;
+
+    c.wait_ns += in_wait_ns;
+    c.max_wait_ns = std::max(c.max_wait_ns, in_wait_ns);
+    c.hold_ns += in_hold_ns;
+    c.max_hold_ns = std::max(c.max_hold_ns, in_hold_ns);
+}
+
+std::vector<kis_lock_profile_stats> kis_lock_profile_collect() {
+    std::map<std::tuple<std::string, std::string, bool>, lock_counters> merged;
+
+    {
+        std::lock_guard<std::mutex> lk(profile_list_mutex());
+
+        auto profiles = profile_list();
+        profiles.push_back(&retired_profile());
+
+        for (const auto& p : profiles) {
+            std::lock_guard<std::mutex> plk(p->mutex);
+
+            for (const auto& mi : p->counters) {
+                for (const auto& li : mi.second) {
+                    if (li.second.first.count > 0)
+                        merged[std::make_tuple(mi.first, li.first, false)].merge(li.second.first);
+                    if (li.second.second.count > 0)
+                        merged[std::make_tuple(mi.first, li.first, true)].merge(li.second.second);
+                }
+            }
+        }
+    }
+
+    std::vector<kis_lock_profile_stats> ret;
+    ret.reserve(merged.size());
+
+    for (const auto& mi : merged) {
+        ret.push_back(kis_lock_profile_stats{std::get<0>(mi.first), std::get<1>(mi.first),
+                std::get<2>(mi.first), mi.second.count, mi.second.contended,
+                mi.second.wait_ns, mi.second.max_wait_ns,
+                mi.second.hold_ns, mi.second.max_hold_ns});
+    }
+
+    std::stable_sort(ret.begin(), ret.end(),
+            [](const kis_lock_profile_stats& a, const kis_lock_profile_stats& b) {
+                return a.wait_ns > b.wait_ns;
+            });
+
+    return ret;
+}
+
+void kis_lock_profile_reset() {
+    std::lock_guard<std::mutex> lk(profile_list_mutex());
+
+    for (const auto& p : profile_list()) {
+        std::lock_guard<std::mutex> plk(p->mutex);
+        p->counters.clear();
+    }
+
+    std::lock_guard<std::mutex> rlk(retired_profile().mutex);
+    retired_profile().counters.clear();
+}
+
+std::string kis_lock_profile_report(size_t in_max) {
+    auto stats = kis_lock_profile_collect();
+
+    std::string ret = fmt::format("Lock contention profile ({}), {} mutex/locker pairs\n",
+            kis_lock_profiling ? "enabled" : "disabled", stats.size());
+
+    if (stats.size() == 0)
+        return ret;
+
+    ret += fmt::format("{:<24} {:<32} {:<4} {:>10} {:>10} {:>12} {:>12} {:>12} {:>12}\n",
+            "mutex", "locker", "mode", "locks", "contended", "wait ms", "max wait us",
+            "hold ms", "max hold us");
+
+    size_t n = 0;
+    for (const auto& s : stats) {
+        if (n++ >= in_max)
+            break;
+
+        ret += fmt::format("{:<24} {:<32} {:<4} {:>10} {:>10} {:>12.3f} {:>12.1f} {:>12.3f} {:>12.1f}\n",
+                s.mutex_name, s.locker_name, s.shared ? "ro" : "rw", s.count, s.contended,
+                s.wait_ns / 1000000.0f, s.max_wait_ns / 1000.0f,
+                s.hold_ns / 1000000.0f, s.max_hold_ns / 1000.0f);
+    }
+
+    return ret;
+}
+
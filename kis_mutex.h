@@ -32,10 +32,13 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
 
 #ifdef HAVE_CXX14
 #include <shared_mutex>
@@ -54,6 +57,57 @@
 // Optionally force the custom c++ workaround mutex
 #define ALWAYS_USE_KISMET_MUTEX         0
 
+// Optionally verify that lock-elided accessors (the __Proxy*Held family in 
+// trackedcomponent.h) are only called while the calling thread holds the owning 
+// mutex; this adds a state check to every elided access, so it is intended for 
+// debug builds (-DKIS_ASSERT_ELIDED_LOCKS=1)
+#ifndef KIS_ASSERT_ELIDED_LOCKS
+#define KIS_ASSERT_ELIDED_LOCKS         0
+#endif
+
+// Lock contention profiling.  When enabled (lock_profiling=true in the config, or at
+// runtime), the scoped lockers record how long they waited for and held each mutex,
+// aggregated per mutex name and per locker name (the call site name passed to the
+// locker).  Counts are kept per thread and merged when they are read, so recording
+// does not itself contend; the counts of a thread are folded into a single retired
+// record when it exits.  Profiling is off by default and costs a single atomic
+// load per lock when off.
+extern std::atomic<bool> kis_lock_profiling;
+
+// Waits at least this long are counted as contended
+#define KIS_LOCK_CONTENDED_NS           1000
+
+struct kis_lock_profile_stats {
+    std::string mutex_name;
+    std::string locker_name;
+    bool shared;
+
+    uint64_t count;
+    uint64_t contended;
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t hold_ns;
+    uint64_t max_hold_ns;
+};
+
+// Profiling name of a mutex named at runtime.  Names are grouped by the part before
+// any '(', so that per-instance names such as kis_tracked_device(key) are profiled
+// together, and interned so that the returned string lives for the life of the process.
+// Only called while profiling is enabled; mutexes named at runtime before profiling 
+// was enabled are profiled as unnamed.
+const char *kis_lock_profile_name(const std::string& in_name);
+
+void kis_lock_profile_record(const char *in_mutex_name, const std::string& in_locker_name,
+        bool in_shared, uint64_t in_wait_ns, uint64_t in_hold_ns);
+
+// Merged profile of all threads, most total wait first
+std::vector<kis_lock_profile_stats> kis_lock_profile_collect();
+
+void kis_lock_profile_reset();
+
+// Text report of the top in_max entries, for dumping to the console
+std::string kis_lock_profile_report(size_t in_max);
+
 // Some compilers (older openwrt CC images, Ubuntu 14.04) are still in use and have a broken
 // std::recursive_timed_mutex implementation which uses the wrong precision for the timer leading
 // to an instant timer failure;  Optionally re-implement a std::mutex using C pthread 
@@ -104,25 +158,43 @@ private:
 };
 
 // C++14 defines a shared_mutex, and a timed shared mutex, but not a recursive, timed,
-// shared mutex; implement our own thread ID 
-class kis_recursive_timed_mutex {
+// shared mutex; implement our own thread ID.  This is the original implementation, 
+// which serializes every lock and unlock through a state mutex; it is kept for
+// comparison (see kismet_bench --locks) and can be selected with KIS_USE_LEGACY_MUTEX
+class kis_legacy_recursive_timed_mutex {
 public:
-    kis_recursive_timed_mutex() :
+    kis_legacy_recursive_timed_mutex() :
 #ifdef DEBUG_MUTEX_NAME
         mutex_name {"unnamed"},
 #endif
+        profile_name {"unnamed"},
         owner {std::thread::id()},
         owner_count {0},
         shared_owner_count {0} { }
 
 #ifdef DEBUG_MUTEX_NAME
     std::string mutex_name;
-    void set_name(const std::string& name) {
+#endif
+
+    // Mutexes named with a string literal keep the literal as their profiling name, 
+    // which costs nothing
+    void set_name(const char *name) {
+#ifdef DEBUG_MUTEX_NAME
         mutex_name = name;
+#endif
+        profile_name = name;
     }
-#else
-    void set_name(const std::string& name) { }
+
+    void set_name(const std::string& name) {
+#ifdef DEBUG_MUTEX_NAME
+        mutex_name = name;
 #endif
+        if (kis_lock_profiling.load(std::memory_order_relaxed))
+            profile_name = kis_lock_profile_name(name);
+    }
+
+    // Name for lock profiling; a string literal or an interned name
+    const char *profile_name;
 
     // Write operation; allow recursion through the owner TID, but do not
     // allow a write lock if ANY thread holds a RO lock
@@ -370,6 +442,18 @@ public:
         state_mutex.unlock();
     }
 
+    // Is this mutex held by the calling thread?  Write owners are tracked per thread,
+    // but shared holders are only counted, so any shared hold is accepted.  Used to
+    // validate lock-elided accessors, not for making locking decisions.
+    bool held_by_this_thread() {
+        std::lock_guard<std::mutex> lk(state_mutex);
+
+        if (owner_count > 0)
+            return owner == std::this_thread::get_id();
+
+        return shared_owner_count > 0;
+    }
+
 private:
     // Recursive write lock
     std::thread::id owner;
@@ -394,14 +478,327 @@ private:
 };
 
 
+// Opaque per-thread token used to identify the owner of a kis_recursive_shared_mutex;
+// cheaper to fetch and compare than std::this_thread::get_id()
+inline uintptr_t kis_mutex_thread_token() {
+    thread_local char token;
+    return reinterpret_cast<uintptr_t>(&token);
+}
+
+// Recursive shared/exclusive mutex with an atomic fast path.
+//
+// The lock state is a single atomic word:  0 when free, the number of shared holders
+// when shared, or exclusive_held when held for writing.  An uncontended lock or unlock
+// is one atomic operation, and recursive exclusive locks by the owning thread only
+// touch thread-local state.  Threads only block, and only pay for the deadlock timeout,
+// when the lock is contended.
+//
+// Semantics match kis_legacy_recursive_timed_mutex:
+//  - the exclusive owner may re-lock exclusive or shared, recursively
+//  - any number of threads may hold it shared, recursively
+//  - new shared locks are not blocked by a waiting writer, because a thread already 
+//    holding it shared may re-lock it and must not deadlock behind the writer
+//  - a thread holding it shared may not upgrade to exclusive
+class kis_recursive_shared_mutex {
+public:
+    kis_recursive_shared_mutex() :
+#ifdef DEBUG_MUTEX_NAME
+        mutex_name {"unnamed"},
+#endif
+        profile_name {"unnamed"},
+        state {0},
+        owner {0},
+        owner_count {0},
+        waiters {0} { }
+
+    kis_recursive_shared_mutex(const kis_recursive_shared_mutex&) = delete;
+    kis_recursive_shared_mutex& operator=(const kis_recursive_shared_mutex&) = delete;
+
+#ifdef DEBUG_MUTEX_NAME
+    std::string mutex_name;
+#endif
+
+    // Mutexes named with a string literal keep the literal as their profiling name, 
+    // which costs nothing
+    void set_name(const char *name) {
+#ifdef DEBUG_MUTEX_NAME
+        mutex_name = name;
+#endif
+        profile_name = name;
+    }
+
+    void set_name(const std::string& name) {
+#ifdef DEBUG_MUTEX_NAME
+        mutex_name = name;
+#endif
+        if (kis_lock_profiling.load(std::memory_order_relaxed))
+            profile_name = kis_lock_profile_name(name);
+    }
+
+    // Name for lock profiling; a string literal or an interned name
+    const char *profile_name;
+
+    bool try_lock_for(const std::chrono::seconds& d, const std::string& agent_name = "UNKNOWN") {
+        if (lock_fast())
+            return true;
+
+        auto deadline = std::chrono::steady_clock::now() + d;
+
+        if (!lock_slow(false, &deadline, agent_name)) {
+#ifdef DEBUG_MUTEX_NAME
+            throw(std::runtime_error(fmt::format("deadlock: shared mutex {} lock not available within {} (claiming write, held by {}, wanted by {})", mutex_name, d.count(), lock_name, agent_name)));
+#else
+            throw(std::runtime_error(fmt::format("deadlock: shared mutex lock not available within {} (claiming write)", d.count())));
+#endif
+        }
+
+        return true;
+    }
+
+    bool try_lock_shared_for(const std::chrono::seconds& d, const std::string& agent_name = "UNKNOWN") {
+        if (lock_shared_fast())
+            return true;
+
+        auto deadline = std::chrono::steady_clock::now() + d;
+
+        if (!lock_slow(true, &deadline, agent_name)) {
+#ifdef DEBUG_MUTEX_NAME
+            throw(std::runtime_error(fmt::format("deadlock: shared mutex {} lock not available within {} (write held by {}, wanted by {})", mutex_name, d.count(), lock_name, agent_name)));
+#else
+            throw(std::runtime_error(fmt::format("deadlock: shared mutex lock not available within {} (write held)", d.count())));
+#endif
+        }
+
+        return true;
+    }
+
+    void lock(const std::string& agent_name = "UNKNOWN") {
+        if (!lock_fast())
+            lock_slow(false, nullptr, agent_name);
+    }
+
+    void lock_shared(const std::string& agent_name = "UNKNOWN") {
+        if (!lock_shared_fast())
+            lock_slow(true, nullptr, agent_name);
+    }
+
+    void unlock() {
+        // Unlocking a lock we don't own is ignored, as in the legacy mutex
+        if (owner.load(std::memory_order_relaxed) != kis_mutex_thread_token())
+            return;
+
+        if (--owner_count > 0)
+            return;
+
+        owner.store(0, std::memory_order_relaxed);
+        state.store(0, std::memory_order_seq_cst);
+
+        wake_waiters();
+    }
+
+    void unlock_shared() {
+        // A shared unlock by the exclusive owner releases one level of its recursion
+        if (owner.load(std::memory_order_relaxed) == kis_mutex_thread_token()) {
+            unlock();
+            return;
+        }
+
+        auto s = state.load(std::memory_order_relaxed);
+
+        do {
+            // Not held shared; ignored, as in the legacy mutex
+            if (s == 0 || s == exclusive_held)
+                return;
+        } while (!state.compare_exchange_weak(s, s - 1, std::memory_order_seq_cst,
+                    std::memory_order_relaxed));
+
+        if (s == 1)
+            wake_waiters();
+    }
+
+    // Is this mutex held by the calling thread?  As with the legacy mutex, shared 
+    // holders are only counted, so any shared hold is accepted.
+    bool held_by_this_thread() {
+        auto s = state.load(std::memory_order_acquire);
+
+        if (s == exclusive_held)
+            return owner.load(std::memory_order_relaxed) == kis_mutex_thread_token();
+
+        return s > 0;
+    }
+
+private:
+    static const uint64_t exclusive_held = ~((uint64_t) 0);
+
+    bool lock_fast() {
+        auto self = kis_mutex_thread_token();
+
+        // Only this thread can have stored its own token, so a relaxed read is enough
+        // to detect recursion
+        if (owner.load(std::memory_order_relaxed) == self) {
+            owner_count++;
+            return true;
+        }
+
+        uint64_t expected = 0;
+        if (state.compare_exchange_strong(expected, exclusive_held, std::memory_order_acquire,
+                    std::memory_order_relaxed)) {
+            owner.store(self, std::memory_order_relaxed);
+            owner_count = 1;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool lock_shared_fast() {
+        auto s = state.load(std::memory_order_relaxed);
+
+        while (s != exclusive_held) {
+            if (state.compare_exchange_weak(s, s + 1, std::memory_order_acquire,
+                        std::memory_order_relaxed))
+                return true;
+        }
+
+        // A shared lock by the exclusive owner is another level of recursion
+        if (owner.load(std::memory_order_relaxed) == kis_mutex_thread_token()) {
+            owner_count++;
+            return true;
+        }
+
+        return false;
+    }
+
+    // Block until the lock is acquired, or until the deadline if one is given; returns
+    // false on timeout
+    bool lock_slow(bool shared, const std::chrono::steady_clock::time_point *deadline,
+            const std::string& agent_name) {
+        // Registering as a waiter before re-checking the state pairs with the unlocker
+        // releasing the state before checking for waiters; one of the two always sees
+        // the other
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+
+        std::unique_lock<std::mutex> lk(wait_mutex);
+
+        while (!(shared ? lock_shared_fast() : lock_fast())) {
+            if (deadline == nullptr) {
+                wait_cv.wait(lk);
+            } else if (wait_cv.wait_until(lk, *deadline) == std::cv_status::timeout) {
+                if (shared ? lock_shared_fast() : lock_fast())
+                    break;
+
+                waiters.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+        }
+
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+
+#ifdef DEBUG_MUTEX_NAME
+        lock_name = agent_name;
+#endif
+
+        return true;
+    }
+
+    void wake_waiters() {
+        if (waiters.load(std::memory_order_seq_cst) == 0)
+            return;
+
+        std::lock_guard<std::mutex> lk(wait_mutex);
+        wait_cv.notify_all();
+    }
+
+    std::atomic<uint64_t> state;
+
+    // Exclusive owner token and recursion depth; the count is only touched by the owner
+    std::atomic<uintptr_t> owner;
+    unsigned int owner_count;
+
+    // Contended path
+    std::atomic<unsigned int> waiters;
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+
+#ifdef DEBUG_MUTEX_NAME
+    // Last agent to acquire the lock through the slow path, for deadlock diagnostics
+    std::string lock_name;
+#endif
+};
+
+// Select the mutex implementation used by Kismet
+#ifndef KIS_USE_LEGACY_MUTEX
+#define KIS_USE_LEGACY_MUTEX            0
+#endif
+
+#if KIS_USE_LEGACY_MUTEX
+typedef kis_legacy_recursive_timed_mutex kis_recursive_timed_mutex;
+#else
+typedef kis_recursive_shared_mutex kis_recursive_timed_mutex;
+#endif
+
+// Times a single hold of a mutex by a locker, when lock profiling is enabled
+class kis_lock_profile_timer {
+public:
+    kis_lock_profile_timer() :
+        profiling {false} { }
+
+    // Call before acquiring the lock
+    void start() {
+        profiling = kis_lock_profiling.load(std::memory_order_relaxed);
+
+        if (profiling)
+            start_tm = std::chrono::steady_clock::now();
+    }
+
+    // Call once the lock is held
+    void acquired() {
+        if (profiling)
+            acquired_tm = std::chrono::steady_clock::now();
+    }
+
+    // Call when the lock is released
+    void released(const char *in_mutex_name, const std::string& in_locker_name,
+            bool in_shared) {
+        if (!profiling)
+            return;
+
+        profiling = false;
+
+        auto now = std::chrono::steady_clock::now();
+
+        kis_lock_profile_record(in_mutex_name, in_locker_name, in_shared,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(acquired_tm - start_tm).count(),
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - acquired_tm).count());
+    }
+
+protected:
+    bool profiling;
+    std::chrono::steady_clock::time_point start_tm, acquired_tm;
+};
+
+// Assert that a mutex is held by the current thread when lock assertions are enabled;
+// compiles away entirely otherwise
+#if KIS_ASSERT_ELIDED_LOCKS
+#define kis_assert_lock_held(m) \
+    do { \
+        if (!(m)->held_by_this_thread()) \
+            throw(std::runtime_error(fmt::format("threading failure: lock-elided access " \
+                            "without holding mutex at {}:{}", __FILE__, __LINE__))); \
+    } while (0)
+#else
+#define kis_assert_lock_held(m) do { } while (0)
+#endif
+
 // A scoped locker like std::lock_guard that provides RAII scoped locking of a kismet mutex;
 // unless disabled in ./configure use a timed lock mutex and throw an exception if unable
 // to acquire the lock within KIS_THREAD_DEADLOCK_TIMEOUT seconds, it's better to crash
 // than to hang; we allow a short-cut unlock to unlock before the end of scope, in which case
 // we no longer unlock AGAIN at descope
-class local_locker {
+template<typename M>
+class kis_basic_local_locker {
 public:
-    local_locker(kis_recursive_timed_mutex *in, const std::string& ln = "UNKNOWN") : 
+    kis_basic_local_locker(M *in, const std::string& ln = "UNKNOWN") : 
         lock_name {ln},
         cpplock {in},
         s_cpplock {nullptr},
@@ -410,6 +807,8 @@ public:
         if (in == nullptr)
             throw(std::runtime_error("threading failure: mutex is null"));
 
+        profile.start();
+
 #ifdef DISABLE_MUTEX_TIMEOUT
         cpplock->lock();
 #else
@@ -423,9 +822,11 @@ public:
 #endif
         }
 #endif
+
+        profile.acquired();
     }
 
-    local_locker(std::shared_ptr<kis_recursive_timed_mutex> in, const std::string& ln = "UNKNOWN") :
+    kis_basic_local_locker(std::shared_ptr<M> in, const std::string& ln = "UNKNOWN") :
         lock_name {ln},
         cpplock {nullptr},
         s_cpplock {in},
@@ -434,6 +835,8 @@ public:
         if (in == nullptr)
             throw(std::runtime_error("threading failure: mutex is null"));
 
+        profile.start();
+
 #ifdef DISABLE_MUTEX_TIMEOUT
         s_cpplock->lock();
 #else
@@ -448,40 +851,45 @@ public:
         }
 #endif
 
+        profile.acquired();
     }
 
-    local_locker() = delete;
+    kis_basic_local_locker() = delete;
 
     void unlock() {
         hold_lock = false;
 
-        if (cpplock)
+        if (cpplock) {
+            profile.released(cpplock->profile_name, lock_name, false);
             cpplock->unlock();
-        if (s_cpplock)
+        }
+        if (s_cpplock) {
+            profile.released(s_cpplock->profile_name, lock_name, false);
             s_cpplock->unlock();
+        }
     }
 
-    ~local_locker() {
-        if (hold_lock) {
-            if (cpplock)
-                cpplock->unlock();
-            if (s_cpplock)
-                s_cpplock->unlock();
-        }
+    ~kis_basic_local_locker() {
+        if (hold_lock)
+            unlock();
     }
 
 protected:
     std::string lock_name;
-    kis_recursive_timed_mutex *cpplock;
-    std::shared_ptr<kis_recursive_timed_mutex> s_cpplock;
+    M *cpplock;
+    std::shared_ptr<M> s_cpplock;
     std::atomic<bool> hold_lock;
+    kis_lock_profile_timer profile;
 };
 
+typedef kis_basic_local_locker<kis_recursive_timed_mutex> local_locker;
+
 // A local RAII locker for READ ONLY access, allows us to optimize the read-only mutexes
 // if we're on C++14 and above, acts like a normal mutex locker if we're on older compilers.
-class local_shared_locker {
+template<typename M>
+class kis_basic_local_shared_locker {
 public:
-    local_shared_locker(kis_recursive_timed_mutex *in, const std::string& ln = "UNKNOWN") : 
+    kis_basic_local_shared_locker(M *in, const std::string& ln = "UNKNOWN") : 
         lock_name {ln},
         hold_lock {true},
         cpplock {in},
@@ -490,6 +898,8 @@ public:
         if (in == nullptr)
             throw(std::runtime_error("threading failure: mutex is null"));
 
+        profile.start();
+
 #ifdef DISABLE_MUTEX_TIMEOUT
         cpplock->lock_shared();
 #else
@@ -503,9 +913,11 @@ public:
 #endif
         }
 #endif
+
+        profile.acquired();
     }
 
-    local_shared_locker(std::shared_ptr<kis_recursive_timed_mutex> in, const std::string& ln = "UNKNOWN") :
+    kis_basic_local_shared_locker(std::shared_ptr<M> in, const std::string& ln = "UNKNOWN") :
         lock_name {ln},
         hold_lock {true},
         cpplock {nullptr},
@@ -514,6 +926,8 @@ public:
         if (in == nullptr)
             throw(std::runtime_error("threading failure: mutex is null"));
 
+        profile.start();
+
 #ifdef DISABLE_MUTEX_TIMEOUT
         s_cpplock->lock_shared();
 #else
@@ -527,45 +941,51 @@ public:
 #endif
         }
 #endif
+
+        profile.acquired();
     }
 
-    local_shared_locker() = delete;
+    kis_basic_local_shared_locker() = delete;
 
     void unlock() {
         hold_lock = false;
-        if (cpplock)
+        if (cpplock) {
+            profile.released(cpplock->profile_name, lock_name, true);
             cpplock->unlock_shared();
-        if (s_cpplock)
+        }
+        if (s_cpplock) {
+            profile.released(s_cpplock->profile_name, lock_name, true);
             s_cpplock->unlock_shared();
+        }
     }
 
-    ~local_shared_locker() {
-        if (hold_lock) {
-            if (cpplock)
-                cpplock->unlock_shared();
-            if (s_cpplock)
-                s_cpplock->unlock_shared();
-        }
+    ~kis_basic_local_shared_locker() {
+        if (hold_lock)
+            unlock();
     }
 
 protected:
     std::string lock_name;
     std::atomic<bool> hold_lock;
-    kis_recursive_timed_mutex *cpplock;
-    std::shared_ptr<kis_recursive_timed_mutex> s_cpplock;
+    M *cpplock;
+    std::shared_ptr<M> s_cpplock;
+    kis_lock_profile_timer profile;
 };
 
+typedef kis_basic_local_shared_locker<kis_recursive_timed_mutex> local_shared_locker;
+
 
 // RAII-style scoped locker, but only locks on demand, not creation
-class local_demand_locker {
+template<typename M>
+class kis_basic_local_demand_locker {
 public:
-    local_demand_locker(kis_recursive_timed_mutex *in, const std::string& ln = "UNKNOWN") : 
+    kis_basic_local_demand_locker(M *in, const std::string& ln = "UNKNOWN") : 
         lock_name {ln},
         hold_lock {false},
         cpplock {in},
         s_cpplock {nullptr} { }
 
-    local_demand_locker(std::shared_ptr<kis_recursive_timed_mutex> in, const std::string& ln = "UNKNOWN") :
+    kis_basic_local_demand_locker(std::shared_ptr<M> in, const std::string& ln = "UNKNOWN") :
         lock_name {ln},
         hold_lock {false},
         cpplock {nullptr},
@@ -577,10 +997,14 @@ public:
 
         hold_lock = false;
 
-        if (cpplock)
+        if (cpplock) {
+            profile.released(cpplock->profile_name, lock_name, false);
             cpplock->unlock();
-        if (s_cpplock)
+        }
+        if (s_cpplock) {
+            profile.released(s_cpplock->profile_name, lock_name, false);
             s_cpplock->unlock();
+        }
     }
 
     void lock() {
@@ -590,6 +1014,8 @@ public:
 
         hold_lock = true;
 
+        profile.start();
+
 #ifdef DISABLE_MUTEX_TIMEOUT
         if (cpplock)
             cpplock->lock();
@@ -619,29 +1045,35 @@ public:
         }
 
 #endif
+
+        profile.acquired();
     }
 
-    ~local_demand_locker() {
+    ~kis_basic_local_demand_locker() {
         unlock();
     }
 
 protected:
     std::string lock_name;
     std::atomic<bool> hold_lock;
-    kis_recursive_timed_mutex *cpplock;
-    std::shared_ptr<kis_recursive_timed_mutex> s_cpplock;
+    M *cpplock;
+    std::shared_ptr<M> s_cpplock;
+    kis_lock_profile_timer profile;
 };
 
+typedef kis_basic_local_demand_locker<kis_recursive_timed_mutex> local_demand_locker;
+
 // RAII-style scoped locker, but only locks on demand, not creation, with shared mutex
-class local_shared_demand_locker {
+template<typename M>
+class kis_basic_local_shared_demand_locker {
 public:
-    local_shared_demand_locker(kis_recursive_timed_mutex *in, const std::string& ln) : 
+    kis_basic_local_shared_demand_locker(M *in, const std::string& ln) : 
         lock_name {ln},
         hold_lock {false},
         cpplock {in},
         s_cpplock {nullptr} { }
 
-    local_shared_demand_locker(std::shared_ptr<kis_recursive_timed_mutex> in, const std::string& ln) :
+    kis_basic_local_shared_demand_locker(std::shared_ptr<M> in, const std::string& ln) :
         lock_name {ln},
         hold_lock {false},
         cpplock {nullptr},
@@ -653,10 +1085,14 @@ public:
 
         hold_lock = false;
 
-        if (cpplock)
+        if (cpplock) {
+            profile.released(cpplock->profile_name, lock_name, true);
             cpplock->unlock_shared();
-        if (s_cpplock)
+        }
+        if (s_cpplock) {
+            profile.released(s_cpplock->profile_name, lock_name, true);
             s_cpplock->unlock_shared();
+        }
     }
 
     void lock() {
@@ -666,6 +1102,8 @@ public:
 
         hold_lock = true;
 
+        profile.start();
+
 #ifdef DISABLE_MUTEX_TIMEOUT
         if (cpplock)
             cpplock->lock_shared();
@@ -694,19 +1132,24 @@ public:
             }
         }
 #endif
+
+        profile.acquired();
     }
 
-    ~local_shared_demand_locker() {
+    ~kis_basic_local_shared_demand_locker() {
         unlock();
     }
 
 protected:
     std::string lock_name;
     std::atomic<bool> hold_lock;
-    kis_recursive_timed_mutex *cpplock;
-    std::shared_ptr<kis_recursive_timed_mutex> s_cpplock;
+    M *cpplock;
+    std::shared_ptr<M> s_cpplock;
+    kis_lock_profile_timer profile;
 };
 
+typedef kis_basic_local_shared_demand_locker<kis_recursive_timed_mutex> local_shared_demand_locker;
+
 // Act as a scoped locker on a mutex that never expires; used for performing
 // end-of-life mutex maintenance
 class local_eol_locker {
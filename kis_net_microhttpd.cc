@@ -181,6 +181,7 @@ kis_net_httpd::kis_net_httpd() {
     register_mime_type("ekjson", "application/json");
     register_mime_type("itjson", "application/json");
     register_mime_type("pcap", "application/vnd.tcpdump.pcap");
+    register_mime_type("bin", "application/octet-stream");
 
     std::vector<std::string> mimeopts = Globalreg::globalreg->kismet_config->fetch_opt_vec("httpd_mime");
     for (unsigned int i = 0; i < mimeopts.size(); i++) {
@@ -94,7 +94,8 @@ bool kis_ppi_logfile::open_log(std::string in_path) {
 
     set_int_log_open(true);
 
-	packetchain->register_handler(&kis_ppi_logfile::packet_handler, this, CHAINPOS_LOGGING, -100);
+	packetchain->register_handler(&kis_ppi_logfile::packet_handler, this, CHAINPOS_LOGGING, -100,
+            "ppi_log");
 
     return true;
 }
@@ -0,0 +1,644 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "endian_magic.h"
+#include "kis_spectrum_store.h"
+#include "util.h"
+
+// Quantize dBm to bytes above the floor, saturating at both ends
+static void quantize_row(const int32_t *dbm, size_t n, uint8_t *out) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i v_floor = _mm_set1_epi32(KIS_SPECTRUM_FLOOR_DBM);
+
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dbm + i)), v_floor);
+        auto b = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dbm + i + 4)), v_floor);
+        auto c = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dbm + i + 8)), v_floor);
+        auto d = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(dbm + i + 12)), v_floor);
+
+        // Signed saturation to 16 bits, then unsigned saturation to 0-255
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+    }
+#endif
+
+    for (; i < n; i++) {
+        auto v = (int64_t) dbm[i] - KIS_SPECTRUM_FLOOR_DBM;
+        out[i] = (uint8_t) std::max<int64_t>(0, std::min<int64_t>(255, v));
+    }
+}
+
+static void combine_min(uint8_t *acc, const uint8_t *src, size_t n) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_min_epu8(a, s));
+    }
+#endif
+
+    for (; i < n; i++)
+        acc[i] = std::min(acc[i], src[i]);
+}
+
+static void combine_max(uint8_t *acc, const uint8_t *src, size_t n) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    for (; i + 16 <= n; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + i));
+        auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i), _mm_max_epu8(a, s));
+    }
+#endif
+
+    for (; i < n; i++)
+        acc[i] = std::max(acc[i], src[i]);
+}
+
+static void combine_sum(uint32_t *sum, const uint8_t *src, size_t n) {
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= n; i += 16) {
+        auto s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        auto lo = _mm_unpacklo_epi8(s, zero);
+        auto hi = _mm_unpackhi_epi8(s, zero);
+
+        __m128i *d = reinterpret_cast<__m128i *>(sum + i);
+
+        _mm_storeu_si128(d, _mm_add_epi32(_mm_loadu_si128(d), _mm_unpacklo_epi16(lo, zero)));
+        _mm_storeu_si128(d + 1, _mm_add_epi32(_mm_loadu_si128(d + 1), _mm_unpackhi_epi16(lo, zero)));
+        _mm_storeu_si128(d + 2, _mm_add_epi32(_mm_loadu_si128(d + 2), _mm_unpacklo_epi16(hi, zero)));
+        _mm_storeu_si128(d + 3, _mm_add_epi32(_mm_loadu_si128(d + 3), _mm_unpackhi_epi16(hi, zero)));
+    }
+#endif
+
+    for (; i < n; i++)
+        sum[i] += src[i];
+}
+
+static uint8_t run_min(const uint8_t *p, size_t n) {
+    uint8_t r = 0xFF;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    if (n >= 16) {
+        auto m = _mm_set1_epi8((char) 0xFF);
+
+        for (; i + 16 <= n; i += 16)
+            m = _mm_min_epu8(m, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)));
+
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 8));
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 4));
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 2));
+        m = _mm_min_epu8(m, _mm_srli_si128(m, 1));
+
+        r = (uint8_t) (_mm_cvtsi128_si32(m) & 0xFF);
+    }
+#endif
+
+    for (; i < n; i++)
+        r = std::min(r, p[i]);
+
+    return r;
+}
+
+static uint8_t run_max(const uint8_t *p, size_t n) {
+    uint8_t r = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    if (n >= 16) {
+        auto m = _mm_setzero_si128();
+
+        for (; i + 16 <= n; i += 16)
+            m = _mm_max_epu8(m, _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)));
+
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+        m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+
+        r = (uint8_t) (_mm_cvtsi128_si32(m) & 0xFF);
+    }
+#endif
+
+    for (; i < n; i++)
+        r = std::max(r, p[i]);
+
+    return r;
+}
+
+static uint32_t run_sum(const uint8_t *p, size_t n) {
+    uint32_t r = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    if (n >= 16) {
+        // Sum of absolute differences against zero adds each half of the vector
+        // into a 64 bit lane
+        auto zero = _mm_setzero_si128();
+        auto s = _mm_setzero_si128();
+
+        for (; i + 16 <= n; i += 16)
+            s = _mm_add_epi64(s, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i)), zero));
+
+        r = (uint32_t) _mm_cvtsi128_si32(s) + (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+    }
+#endif
+
+    for (; i < n; i++)
+        r += p[i];
+
+    return r;
+}
+
+kis_spectrum_decimate kis_spectrum_decimate_from_string(const std::string& name) {
+    auto lname = str_lower(name);
+
+    if (lname == "min")
+        return kis_spectrum_decimate::min;
+    if (lname == "max")
+        return kis_spectrum_decimate::max;
+    if (lname == "avg")
+        return kis_spectrum_decimate::avg;
+
+    throw std::runtime_error("unknown spectrum decimation, expected min, max, or avg");
+}
+
+kis_tracked_spectrum_range::kis_tracked_spectrum_range() :
+    tracker_component() {
+    register_fields();
+    reserve_fields(NULL);
+}
+
+kis_tracked_spectrum_range::kis_tracked_spectrum_range(int in_id) :
+    tracker_component(in_id) {
+    register_fields();
+    reserve_fields(NULL);
+}
+
+kis_tracked_spectrum_range::kis_tracked_spectrum_range(int in_id,
+        std::shared_ptr<tracker_element_map> e) :
+    tracker_component(in_id) {
+    register_fields();
+    reserve_fields(e);
+}
+
+kis_tracked_spectrum_range::kis_tracked_spectrum_range(const kis_tracked_spectrum_range *p) :
+    tracker_component{p} {
+    __ImportField(range_id, p);
+    __ImportField(start_hz, p);
+    __ImportField(end_hz, p);
+    __ImportField(bin_hz, p);
+    __ImportField(bins, p);
+    __ImportField(rows, p);
+    __ImportField(max_rows, p);
+    __ImportField(sweeps, p);
+    __ImportField(last_time, p);
+    reserve_fields(nullptr);
+}
+
+void kis_tracked_spectrum_range::register_fields() {
+    tracker_component::register_fields();
+
+    register_field("kismet.spectrum.range.id", "range id, for waterfall requests", &range_id);
+    register_field("kismet.spectrum.range.start_hz", "start of range (Hz)", &start_hz);
+    register_field("kismet.spectrum.range.end_hz", "end of range (Hz)", &end_hz);
+    register_field("kismet.spectrum.range.bin_hz", "width of each bin (Hz)", &bin_hz);
+    register_field("kismet.spectrum.range.bins", "number of bins per sweep", &bins);
+    register_field("kismet.spectrum.range.rows", "sweeps held in the waterfall", &rows);
+    register_field("kismet.spectrum.range.max_rows", "maximum sweeps held in the waterfall",
+            &max_rows);
+    register_field("kismet.spectrum.range.sweeps", "total sweeps of this range", &sweeps);
+    register_field("kismet.spectrum.range.last_time", "time of last sweep", &last_time);
+}
+
+kis_spectrum_ring::kis_spectrum_ring(uint32_t in_id, uint64_t in_start_hz, uint64_t in_end_hz,
+        double in_bin_hz, size_t in_bins, size_t in_max_rows) :
+    id{in_id},
+    start_hz{in_start_hz},
+    end_hz{in_end_hz},
+    bin_hz{in_bin_hz},
+    bins{in_bins},
+    max_rows{std::max<size_t>(1, in_max_rows)},
+    seq{0},
+    last_time{0},
+    segment_meta{0, 0},
+    segment_pending{false},
+    segment_offt{0} {
+
+    power.resize(max_rows * bins);
+    meta.resize(max_rows);
+}
+
+void kis_spectrum_ring::add_sweep(uint64_t ts_sec, uint64_t ts_usec, const int32_t *dbm) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        auto row = seq % max_rows;
+
+        quantize_row(dbm, bins, &power[row * bins]);
+
+        meta[row].ts_sec = ts_sec;
+        meta[row].ts_usec = ts_usec;
+
+        seq++;
+        last_time = time(0);
+    }
+
+    sweep_cv.notify_all();
+}
+
+void kis_spectrum_ring::add_segment(uint64_t ts_sec, uint64_t ts_usec, size_t offt,
+        const int32_t *dbm, size_t n) {
+    bool committed = false;
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        if (offt >= bins || n == 0)
+            return;
+
+        n = std::min(n, bins - offt);
+
+        if (segment_pending && offt <= segment_offt) {
+            commit_segments();
+            committed = true;
+        }
+
+        if (!segment_pending) {
+            segment_row.assign(bins, 0);
+            segment_pending = true;
+        }
+
+        quantize_row(dbm, n, &segment_row[offt]);
+
+        segment_meta.ts_sec = ts_sec;
+        segment_meta.ts_usec = ts_usec;
+        segment_offt = offt;
+
+        if (offt + n >= bins) {
+            commit_segments();
+            committed = true;
+        }
+    }
+
+    if (committed)
+        sweep_cv.notify_all();
+}
+
+void kis_spectrum_ring::commit_segments() {
+    auto row = seq % max_rows;
+
+    memcpy(&power[row * bins], segment_row.data(), bins);
+    meta[row] = segment_meta;
+
+    seq++;
+    last_time = time(0);
+
+    segment_pending = false;
+}
+
+uint64_t kis_spectrum_ring::get_seq() {
+    std::lock_guard<std::mutex> lk(mutex);
+    return seq;
+}
+
+std::shared_ptr<kis_tracked_spectrum_range> kis_spectrum_ring::summarize() {
+    auto r = std::make_shared<kis_tracked_spectrum_range>();
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    r->set_range_id(id);
+    r->set_start_hz(start_hz);
+    r->set_end_hz(end_hz);
+    r->set_bin_hz(bin_hz);
+    r->set_bins(bins);
+    r->set_rows(std::min<uint64_t>(seq, max_rows));
+    r->set_max_rows(max_rows);
+    r->set_sweeps(seq);
+    r->set_last_time(last_time);
+
+    return r;
+}
+
+kis_spectrum_bin_header kis_spectrum_ring::make_header(size_t width, size_t n_rows,
+        kis_spectrum_decimate mode) const {
+    kis_spectrum_bin_header h;
+
+    memset(&h, 0, sizeof(h));
+
+    h.signature = kis_htole32(KIS_SPECTRUM_BIN_SIG);
+    h.version = kis_htole16(KIS_SPECTRUM_BIN_VERSION);
+    h.header_len = kis_htole16(sizeof(kis_spectrum_bin_header));
+    h.start_hz = kis_htole64(start_hz);
+    h.end_hz = kis_htole64(end_hz);
+    h.bins = kis_htole32((uint32_t) width);
+    h.rows = kis_htole32((uint32_t) n_rows);
+    h.floor_dbm = (int16_t) kis_htole16((uint16_t) KIS_SPECTRUM_FLOOR_DBM);
+    h.mode = (uint8_t) mode;
+
+    return h;
+}
+
+kis_spectrum_bin_header kis_spectrum_ring::live_header(size_t width, kis_spectrum_decimate mode) {
+    return make_header(clamp_width(width), 0, mode);
+}
+
+void kis_spectrum_ring::reduce_bins(const uint8_t *src, size_t width,
+        kis_spectrum_decimate mode, uint8_t *out) const {
+
+    if (width == bins) {
+        memcpy(out, src, bins);
+        return;
+    }
+
+    // Output bin j covers source bins [j * bins / width, (j + 1) * bins / width); width
+    // is never more than bins, so every run has at least one bin
+    for (size_t j = 0; j < width; j++) {
+        auto b0 = j * bins / width;
+        auto b1 = (j + 1) * bins / width;
+        auto n = b1 - b0;
+
+        switch (mode) {
+            case kis_spectrum_decimate::min:
+                out[j] = run_min(src + b0, n);
+                break;
+            case kis_spectrum_decimate::max:
+                out[j] = run_max(src + b0, n);
+                break;
+            case kis_spectrum_decimate::avg:
+                out[j] = (uint8_t) ((run_sum(src + b0, n) + n / 2) / n);
+                break;
+        }
+    }
+}
+
+ssize_t kis_spectrum_ring::write_waterfall(std::function<bool (const void *, size_t)> write_cb,
+        size_t in_max_rows, size_t out_rows, size_t width, kis_spectrum_decimate mode) {
+
+    std::lock_guard<std::mutex> lk(mutex);
+
+    size_t n_src = std::min<uint64_t>(seq, max_rows);
+
+    if (in_max_rows != 0)
+        n_src = std::min(n_src, in_max_rows);
+
+    if (out_rows == 0 || out_rows > n_src)
+        out_rows = n_src;
+
+    width = clamp_width(width);
+
+    auto header = make_header(width, out_rows, mode);
+
+    if (!write_cb(&header, sizeof(header)))
+        return -1;
+
+    ssize_t written = sizeof(header);
+
+    std::vector<uint8_t> combined(bins);
+    std::vector<uint32_t> sum;
+    std::vector<uint8_t> out(width);
+
+    if (mode == kis_spectrum_decimate::avg)
+        sum.resize(bins);
+
+    auto first_seq = seq - n_src + 1;
+
+    for (size_t r = 0; r < out_rows; r++) {
+        // Output row r merges sweeps [g0, g1)
+        auto g0 = first_seq + r * n_src / out_rows;
+        auto g1 = first_seq + (r + 1) * n_src / out_rows;
+        auto n = g1 - g0;
+
+        const uint8_t *src = row_power(g0);
+
+        if (n > 1) {
+            if (mode == kis_spectrum_decimate::avg) {
+                std::fill(sum.begin(), sum.end(), 0);
+
+                for (auto g = g0; g < g1; g++)
+                    combine_sum(sum.data(), row_power(g), bins);
+
+                for (size_t b = 0; b < bins; b++)
+                    combined[b] = (uint8_t) ((sum[b] + n / 2) / n);
+            } else {
+                memcpy(combined.data(), src, bins);
+
+                for (auto g = g0 + 1; g < g1; g++) {
+                    if (mode == kis_spectrum_decimate::min)
+                        combine_min(combined.data(), row_power(g), bins);
+                    else
+                        combine_max(combined.data(), row_power(g), bins);
+                }
+            }
+
+            src = combined.data();
+        }
+
+        reduce_bins(src, width, mode, out.data());
+
+        const auto& m = meta[(g1 - 2) % max_rows];
+
+        kis_spectrum_bin_row row;
+        row.ts_sec = kis_htole64(m.ts_sec);
+        row.ts_usec = kis_htole32(m.ts_usec);
+        row.sweeps = kis_htole32((uint32_t) n);
+
+        if (!write_cb(&row, sizeof(row)) || !write_cb(out.data(), width))
+            return -1;
+
+        written += sizeof(row) + width;
+    }
+
+    return written;
+}
+
+bool kis_spectrum_ring::wait_live_row(uint64_t& in_seq, std::chrono::milliseconds timeout,
+        size_t width, kis_spectrum_decimate mode,
+        kis_spectrum_bin_row& row, std::vector<uint8_t>& out) {
+
+    std::unique_lock<std::mutex> lk(mutex);
+
+    if (!sweep_cv.wait_for(lk, timeout, [this, &in_seq] { return seq > in_seq; }))
+        return false;
+
+    // Skip sweeps which have already been overwritten
+    if (seq - in_seq > max_rows)
+        in_seq = seq - max_rows;
+
+    in_seq++;
+
+    width = clamp_width(width);
+    out.resize(width);
+
+    reduce_bins(row_power(in_seq), width, mode, out.data());
+
+    const auto& m = meta[(in_seq - 1) % max_rows];
+
+    row.ts_sec = kis_htole64(m.ts_sec);
+    row.ts_usec = kis_htole32(m.ts_usec);
+    row.sweeps = kis_htole32(1);
+
+    return true;
+}
+
+kis_spectrum_store::kis_spectrum_store(size_t in_max_rows) :
+    max_rows{in_max_rows},
+    next_id{0},
+    sweep_counter{0} {
+
+    mutex.set_name("kis_spectrum_store");
+}
+
+void kis_spectrum_store::add_sweep(uint64_t ts_sec, uint64_t ts_usec, uint64_t start_hz,
+        uint64_t end_hz, double bin_hz, const int32_t *dbm, size_t n) {
+
+    if (n == 0 || n > KIS_SPECTRUM_MAX_BINS || end_hz <= start_hz)
+        return;
+
+    std::shared_ptr<kis_spectrum_ring> ring;
+
+    {
+        local_locker l(&mutex, "kis_spectrum_store::add_sweep");
+
+        // Segments overlapping the declared range are stitched into its sweep, clipped
+        // to the range; segments whose bins don't line up with the declared bins are
+        // kept as their own range
+        if (sweep_ring != nullptr && start_hz < sweep_ring->get_end_hz() &&
+                end_hz > sweep_ring->get_start_hz() &&
+                std::fabs(bin_hz - sweep_ring->get_bin_hz()) <= sweep_ring->get_bin_hz() / 100) {
+            ring = sweep_ring;
+        }
+    }
+
+    if (ring != nullptr) {
+        auto offt = std::llround(((double) start_hz - (double) ring->get_start_hz()) / 
+                ring->get_bin_hz());
+
+        if (offt < 0) {
+            if ((size_t) -offt >= n)
+                return;
+
+            dbm += -offt;
+            n -= -offt;
+            offt = 0;
+        }
+
+        ring->add_segment(ts_sec, ts_usec, (size_t) offt, dbm, n);
+        return;
+    }
+
+    {
+        local_locker l(&mutex, "kis_spectrum_store::add_sweep");
+
+        sweep_counter++;
+
+        for (auto& r : rings) {
+            if (r.ring->matches(start_hz, end_hz, n)) {
+                r.last_use = sweep_counter;
+                ring = r.ring;
+                break;
+            }
+        }
+
+        if (ring == nullptr) {
+            if (rings.size() >= KIS_SPECTRUM_MAX_RANGES) {
+                auto oldest = std::min_element(rings.begin(), rings.end(),
+                        [](const ring_entry& a, const ring_entry& b) -> bool {
+                            return a.last_use < b.last_use;
+                        });
+                rings.erase(oldest);
+            }
+
+            ring = std::make_shared<kis_spectrum_ring>(next_id++, start_hz, end_hz,
+                    bin_hz, n, max_rows);
+            rings.push_back(ring_entry{ring, sweep_counter});
+        }
+    }
+
+    ring->add_sweep(ts_sec, ts_usec, dbm);
+}
+
+void kis_spectrum_store::set_sweep_range(uint64_t start_hz, uint64_t end_hz, double bin_hz) {
+    if (end_hz <= start_hz || bin_hz <= 0)
+        return;
+
+    auto n = (size_t) std::llround((end_hz - start_hz) / bin_hz);
+
+    if (n == 0 || n > KIS_SPECTRUM_MAX_BINS)
+        return;
+
+    local_locker l(&mutex, "kis_spectrum_store::set_sweep_range");
+
+    // Re-opening a source with the same range keeps the waterfall
+    if (sweep_ring != nullptr && sweep_ring->matches(start_hz, end_hz, n))
+        return;
+
+    sweep_ring = std::make_shared<kis_spectrum_ring>(next_id++, start_hz, end_hz, bin_hz,
+            n, max_rows);
+}
+
+std::shared_ptr<kis_spectrum_ring> kis_spectrum_store::get_ring(uint32_t in_id) {
+    local_shared_locker l(&mutex);
+
+    if (sweep_ring != nullptr && sweep_ring->get_id() == in_id)
+        return sweep_ring;
+
+    for (const auto& r : rings) {
+        if (r.ring->get_id() == in_id)
+            return r.ring;
+    }
+
+    return nullptr;
+}
+
+std::shared_ptr<tracker_element_vector> kis_spectrum_store::summarize() {
+    auto ret = std::make_shared<tracker_element_vector>();
+
+    local_shared_locker l(&mutex);
+
+    if (sweep_ring != nullptr)
+        ret->push_back(sweep_ring->summarize());
+
+    for (const auto& r : rings)
+        ret->push_back(r.ring->summarize());
+
+    return ret;
+}
+
@@ -0,0 +1,279 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KIS_SPECTRUM_STORE_H__
+#define __KIS_SPECTRUM_STORE_H__
+
+#include "config.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "kis_mutex.h"
+#include "trackedelement.h"
+#include "trackedcomponent.h"
+
+// Compact storage of spectrum sweeps for waterfall displays.
+//
+// Each frequency range swept by a source gets a ring of rows; a row is one sweep of
+// the range, with the power of each bin quantized to a byte in 1dB steps above
+// KIS_SPECTRUM_FLOOR_DBM.  Rows have a fixed width, so the ring is a single flat
+// allocation and no tracked element is created per bin or per sweep.
+//
+// Sources such as hackrf_sweep send each sweep in many segments; when a source
+// declares the range it sweeps, segments inside that range are stitched into one
+// row per sweep of the declared range.
+//
+// Zoomed-out views are decimated from the ring in two passes:  the rows merged into
+// each output row are combined bin by bin, then each run of bins in the combined row
+// is reduced to one output bin.  Both passes use SSE2 where available.
+
+// Power of the lowest quantized bin; a stored value of 0 is this power or less, and
+// 255 is KIS_SPECTRUM_FLOOR_DBM + 255 or more
+#define KIS_SPECTRUM_FLOOR_DBM      -150
+
+// Largest sweep accepted, in bins
+#define KIS_SPECTRUM_MAX_BINS       65536
+
+// Number of distinct frequency ranges kept per source, not counting the declared
+// sweep range; the least recently swept range is dropped to make room for a new one
+#define KIS_SPECTRUM_MAX_RANGES     16
+
+// Binary waterfall stream, all fields little endian:
+//   kis_spectrum_bin_header
+//   for each row:  kis_spectrum_bin_row followed by [bins] bytes of quantized power
+//
+// Live streams send rows with no row count in the header, until the client
+// disconnects.
+#define KIS_SPECTRUM_BIN_SIG        0x5753494B
+#define KIS_SPECTRUM_BIN_VERSION    1
+
+struct kis_spectrum_bin_header {
+    uint32_t signature;
+    uint16_t version;
+    uint16_t header_len;
+    uint64_t start_hz;
+    uint64_t end_hz;
+    uint32_t bins;
+    // Number of rows which follow, or 0 for a live stream
+    uint32_t rows;
+    int16_t floor_dbm;
+    // kis_spectrum_decimate used to reduce the rows
+    uint8_t mode;
+    uint8_t reserved;
+    uint32_t reserved2;
+} __attribute__((packed));
+
+struct kis_spectrum_bin_row {
+    // Time of the newest sweep merged into the row
+    uint64_t ts_sec;
+    uint32_t ts_usec;
+    // Number of sweeps merged into the row
+    uint32_t sweeps;
+} __attribute__((packed));
+
+enum class kis_spectrum_decimate {
+    min = 0, max = 1, avg = 2
+};
+
+// Parse a decimation mode name; throws std::runtime_error on an unknown name
+kis_spectrum_decimate kis_spectrum_decimate_from_string(const std::string& name);
+
+// Summary of a stored range, for the range list endpoint
+class kis_tracked_spectrum_range : public tracker_component {
+public:
+    kis_tracked_spectrum_range();
+    kis_tracked_spectrum_range(int in_id);
+    kis_tracked_spectrum_range(int in_id, std::shared_ptr<tracker_element_map> e);
+    kis_tracked_spectrum_range(const kis_tracked_spectrum_range *p);
+
+    virtual std::unique_ptr<tracker_element> clone_type() override {
+        using this_t = std::remove_pointer<decltype(this)>::type;
+        auto dup = std::unique_ptr<this_t>(new this_t(this));
+        return std::move(dup);
+    }
+
+    __Proxy(range_id, uint32_t, uint32_t, uint32_t, range_id);
+    __Proxy(start_hz, uint64_t, uint64_t, uint64_t, start_hz);
+    __Proxy(end_hz, uint64_t, uint64_t, uint64_t, end_hz);
+    __Proxy(bin_hz, double, double, double, bin_hz);
+    __Proxy(bins, uint32_t, uint32_t, uint32_t, bins);
+    __Proxy(rows, uint32_t, uint32_t, uint32_t, rows);
+    __Proxy(max_rows, uint32_t, uint32_t, uint32_t, max_rows);
+    __Proxy(sweeps, uint64_t, uint64_t, uint64_t, sweeps);
+    __Proxy(last_time, uint64_t, uint64_t, uint64_t, last_time);
+
+protected:
+    virtual void register_fields() override;
+
+    std::shared_ptr<tracker_element_uint32> range_id;
+    std::shared_ptr<tracker_element_uint64> start_hz;
+    std::shared_ptr<tracker_element_uint64> end_hz;
+    std::shared_ptr<tracker_element_double> bin_hz;
+    std::shared_ptr<tracker_element_uint32> bins;
+    std::shared_ptr<tracker_element_uint32> rows;
+    std::shared_ptr<tracker_element_uint32> max_rows;
+    std::shared_ptr<tracker_element_uint64> sweeps;
+    std::shared_ptr<tracker_element_uint64> last_time;
+};
+
+// Ring of quantized sweeps of a single frequency range
+class kis_spectrum_ring {
+public:
+    kis_spectrum_ring(uint32_t in_id, uint64_t in_start_hz, uint64_t in_end_hz,
+            double in_bin_hz, size_t in_bins, size_t in_max_rows);
+
+    uint32_t get_id() const { return id; }
+    uint64_t get_start_hz() const { return start_hz; }
+    uint64_t get_end_hz() const { return end_hz; }
+    size_t get_bins() const { return bins; }
+    double get_bin_hz() const { return bin_hz; }
+
+    bool matches(uint64_t in_start_hz, uint64_t in_end_hz, size_t in_bins) const {
+        return start_hz == in_start_hz && end_hz == in_end_hz && bins == in_bins;
+    }
+
+    // Quantize a sweep of get_bins() power values, in dBm, into the next row
+    void add_sweep(uint64_t ts_sec, uint64_t ts_usec, const int32_t *dbm);
+
+    // Quantize a segment of n power values starting at bin offt into the sweep being
+    // assembled.  The sweep becomes the next row when a segment reaches the last bin,
+    // or when a segment starts at or below the previous one, which begins a new sweep;
+    // bins no segment covered are left at the floor.
+    void add_segment(uint64_t ts_sec, uint64_t ts_usec, size_t offt, const int32_t *dbm,
+            size_t n);
+
+    // Sequence number of the newest sweep; 0 if no sweeps have been added
+    uint64_t get_seq();
+
+    std::shared_ptr<kis_tracked_spectrum_range> summarize();
+
+    // Decimate up to max_rows of the newest sweeps into at most out_rows rows of at
+    // most width bins, oldest first, and write them as a binary waterfall.
+    //
+    // Returns the number of bytes written, or -1 if writing failed.
+    ssize_t write_waterfall(std::function<bool (const void *, size_t)> write_cb,
+            size_t max_rows, size_t out_rows, size_t width, kis_spectrum_decimate mode);
+
+    // Header for a live stream of this range, decimated to width bins
+    kis_spectrum_bin_header live_header(size_t width, kis_spectrum_decimate mode);
+
+    // Wait up to timeout for a sweep newer than seq, and decimate it into row and
+    // power.  seq is advanced to the sweep returned; when the reader has fallen
+    // behind the ring, older sweeps are skipped.
+    //
+    // Returns false if no new sweep arrived.
+    bool wait_live_row(uint64_t& seq, std::chrono::milliseconds timeout,
+            size_t width, kis_spectrum_decimate mode,
+            kis_spectrum_bin_row& row, std::vector<uint8_t>& power);
+
+protected:
+    std::mutex mutex;
+    std::condition_variable sweep_cv;
+
+    uint32_t id;
+    uint64_t start_hz, end_hz;
+    double bin_hz;
+    size_t bins;
+    size_t max_rows;
+
+    // max_rows * bins quantized power values; row n of the ring is at n * bins
+    std::vector<uint8_t> power;
+
+    struct row_meta {
+        uint64_t ts_sec;
+        uint32_t ts_usec;
+    };
+    std::vector<row_meta> meta;
+
+    // Total sweeps added; sweep seq (1 based) is in ring row (seq - 1) % max_rows
+    uint64_t seq;
+    time_t last_time;
+
+    // Sweep being assembled from segments; it is only copied into the ring once it
+    // is complete, so readers never see a partial sweep
+    std::vector<uint8_t> segment_row;
+    row_meta segment_meta;
+    bool segment_pending;
+    size_t segment_offt;
+
+    // Add the assembled sweep as the next row; called with the mutex held
+    void commit_segments();
+
+    const uint8_t *row_power(uint64_t row_seq) const {
+        return &power[((row_seq - 1) % max_rows) * bins];
+    }
+
+    size_t clamp_width(size_t width) const {
+        return (width == 0 || width > bins) ? bins : width;
+    }
+
+    kis_spectrum_bin_header make_header(size_t width, size_t n_rows,
+            kis_spectrum_decimate mode) const;
+
+    // Reduce a row of bins to width output bins
+    void reduce_bins(const uint8_t *src, size_t width, kis_spectrum_decimate mode,
+            uint8_t *out) const;
+};
+
+// Spectrum store of a single source, holding one ring per swept range
+class kis_spectrum_store {
+public:
+    kis_spectrum_store(size_t in_max_rows);
+
+    // Add a sweep of n power values, in dBm, covering start_hz to end_hz; a segment
+    // inside the declared sweep range is merged into the sweep of that range
+    void add_sweep(uint64_t ts_sec, uint64_t ts_usec, uint64_t start_hz,
+            uint64_t end_hz, double bin_hz, const int32_t *dbm, size_t n);
+
+    // Set the full range the source sweeps, as declared when it was opened
+    void set_sweep_range(uint64_t start_hz, uint64_t end_hz, double bin_hz);
+
+    std::shared_ptr<kis_spectrum_ring> get_ring(uint32_t in_id);
+
+    std::shared_ptr<tracker_element_vector> summarize();
+
+protected:
+    kis_recursive_timed_mutex mutex;
+
+    size_t max_rows;
+    uint32_t next_id;
+
+    // Ring and the store-wide count of sweeps when it was last swept, for dropping
+    // the least recently swept range
+    struct ring_entry {
+        std::shared_ptr<kis_spectrum_ring> ring;
+        uint64_t last_use;
+    };
+    std::vector<ring_entry> rings;
+    uint64_t sweep_counter;
+
+    // Ring of the declared sweep range, which is never dropped; nullptr if the source
+    // didn't declare one
+    std::shared_ptr<kis_spectrum_ring> sweep_ring;
+};
+
+#endif
+
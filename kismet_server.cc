@@ -70,6 +70,7 @@
 #include "datasource_rtl433.h"
 #include "datasource_rtlamr.h"
 #include "datasource_rtladsb.h"
+#include "datasource_hackrf_sweep.h"
 #include "datasource_freaklabs_zigbee.h"
 #include "datasource_nrf_mousejack.h"
 #include "datasource_ti_cc_2540.h"
@@ -85,6 +86,7 @@
 #include "kis_ppilogfile.h"
 #include "kis_databaselogfile.h"
 #include "kis_pcapnglogfile.h"
+#include "packet_tap.h"
 
 #include "timetracker.h"
 #include "alertracker.h"
@@ -455,6 +457,11 @@ void signal_thread_handler() {
                 // Flag that we need to do a waitpid to reap child processes
                 Globalreg::globalreg->reap_child_procs = true;
                 break;
+
+            case SIGUSR1:
+                // Dump the lock contention profile
+                fprintf(stderr, "%s", kis_lock_profile_report(50).c_str());
+                break;
         }
     }
 
@@ -547,6 +554,7 @@ int main(int argc, char *argv[], char *envp[]) {
     sigaddset(&core_signal_mask, SIGCHLD);
     sigaddset(&core_signal_mask, SIGSEGV);
     sigaddset(&core_signal_mask, SIGPIPE);
+    sigaddset(&core_signal_mask, SIGUSR1);
 
     // Set thread mask for all new threads
     pthread_sigmask(SIG_BLOCK, &core_signal_mask, nullptr);
@@ -809,6 +817,14 @@ int main(int argc, char *argv[], char *envp[]) {
         globalregistry->servername = munge_to_printable(conf->fetch_opt("servername"));
     }
 
+    entrytracker->set_field_slabs(conf->fetch_opt_bool("tracker_field_slabs", true));
+
+    if (conf->fetch_opt_bool("lock_profiling", false)) {
+        _MSG_INFO("Lock contention profiling enabled; send SIGUSR1 to dump the profile, or "
+                "see /system/lock_contention");
+        kis_lock_profiling = true;
+    }
+
     // Create the IPC handler
     ipc_tracker_v2::create_ipctracker();
 
@@ -845,6 +861,9 @@ int main(int argc, char *argv[], char *envp[]) {
     if (globalregistry->fatal_condition)
         SpindownKismet();
 
+    // Create the shared packet tap for pcap streams
+    packet_tap::create_packettap();
+
     // Create the DLT tracker
     auto dlttracker = dlt_tracker::create_dltt();
 
@@ -912,6 +931,8 @@ int main(int argc, char *argv[], char *envp[]) {
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtl433_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtlamr_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtladsb_builder()));
+    datasourcetracker->register_datasource(shared_datasource_builder(new datasource_rtladsb_iq_builder()));
+    datasourcetracker->register_datasource(shared_datasource_builder(new datasource_hackrf_sweep_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_freaklabs_zigbee_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_nrf_mousejack_builder()));
     datasourcetracker->register_datasource(shared_datasource_builder(new datasource_ticc2540_builder()));
@@ -1009,10 +1030,24 @@ int main(int argc, char *argv[], char *envp[]) {
     // Independent time and select threads, which has had problems with timing conflicts
     timetracker->spawn_timetracker_thread();
 
-    auto asio_thread = std::thread([]() {
-            asio::io_service::work work(Globalreg::globalreg->io);
-            Globalreg::globalreg->io.run();
-            });
+    // Run the network IO (remote capture, external helpers, and gps) across a pool of 
+    // threads; each connection serializes its own handlers with a strand, so independent
+    // sources are read and decoded concurrently
+    auto n_io_threads = globalreg->kismet_config->fetch_opt_uint("io_threads", 0);
+
+    if (n_io_threads == 0)
+        n_io_threads = std::max(1U, std::min(4U, std::thread::hardware_concurrency()));
+
+    _MSG_INFO("Running network IO on {} thread(s)", n_io_threads);
+
+    asio::io_service::work io_work(Globalreg::globalreg->io);
+    std::vector<std::thread> io_threads;
+
+    for (unsigned int t = 0; t < n_io_threads; t++) {
+        io_threads.push_back(std::thread([]() {
+                Globalreg::globalreg->io.run();
+                }));
+    }
 
     while (true) {
         if (Globalreg::globalreg->spindown || Globalreg::globalreg->fatal_condition) 
@@ -1021,6 +1056,7 @@ int main(int argc, char *argv[], char *envp[]) {
         usleep(500000);
     }
 
-    asio_thread.join();
+    for (auto& t : io_threads)
+        t.join();
 }
 
@@ -0,0 +1,173 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <string>
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <sqlite3.h>
+
+#include "getopt.h"
+#include "fmt.h"
+#include "kis_database_index.h"
+
+void print_help(char *argv) {
+    printf("Kismetdb Index\n");
+    printf("Adds the secondary indexes used for time, MAC, and datasource filtering to an\n"
+           "existing KismetDB log, so that the other log tools can use range scans\n");
+    printf("usage: %s [OPTION]\n", argv);
+    printf(" -i, --in [filename]          Input kismetdb file\n"
+           " -v, --verbose                Verbose output\n"
+           " -d, --drop                   Remove the indexes instead of adding them\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option longopt[] = {
+        { "in", required_argument, 0, 'i' },
+        { "verbose", no_argument, 0, 'v' },
+        { "drop", no_argument, 0, 'd' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+
+    int option_idx = 0;
+    optind = 0;
+    opterr = 0;
+
+    std::string in_fname;
+    bool verbose = false;
+    bool drop = false;
+
+    int sql_r = 0;
+    char *sql_errmsg = NULL;
+    sqlite3 *db = NULL;
+
+    struct stat statbuf;
+
+    while (1) {
+        int r = getopt_long(argc, argv,
+                            "-hi:vd", longopt, &option_idx);
+        if (r < 0) break;
+
+        if (r == 'h') {
+            print_help(argv[0]);
+            exit(1);
+        } else if (r == 'i') {
+            in_fname = std::string(optarg);
+        } else if (r == 'v') {
+            verbose = true;
+        } else if (r == 'd') {
+            drop = true;
+        }
+    }
+
+    if (in_fname == "") {
+        fmt::print(stderr, "ERROR: Expected --in [kismetdb file]\n");
+        exit(1);
+    }
+
+    if (stat(in_fname.c_str(), &statbuf) < 0) {
+        if (errno == ENOENT)
+            fmt::print(stderr, "ERROR:  Input file '{}' does not exist.\n", in_fname);
+        else
+            fmt::print(stderr, "ERROR:  Unexpected problem checking input "
+                    "file '{}': {}\n", in_fname, strerror(errno));
+
+        exit(1);
+    }
+
+    sql_r = sqlite3_open(in_fname.c_str(), &db);
+
+    if (sql_r) {
+        fmt::print(stderr, "ERROR:  Unable to open '{}': {}\n", in_fname, sqlite3_errmsg(db));
+        exit(1);
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+
+    if (drop) {
+        for (const auto& i : kis_database_indexes) {
+            for (const auto& t : kis_database_index_tables(db, i.table)) {
+                auto sql = fmt::format("DROP INDEX IF EXISTS \"idx_{}_{}\"", t, i.name);
+
+                if (verbose)
+                    fmt::print(stderr, "* Dropping index idx_{}_{}\n", t, i.name);
+
+                sql_r = sqlite3_exec(db, sql.c_str(), NULL, NULL, &sql_errmsg);
+
+                if (sql_r != SQLITE_OK) {
+                    fmt::print(stderr, "ERROR:  Unable to drop index: {}\n", sql_errmsg);
+                    sqlite3_close(db);
+                    exit(1);
+                }
+            }
+        }
+    } else {
+        std::string errstr;
+
+        fmt::print(stderr, "* Indexing database '{}'...\n", in_fname);
+
+        sql_r = kis_database_create_indexes(db, errstr,
+                [verbose](const std::string& table) {
+                    if (verbose)
+                        fmt::print(stderr, "* Indexing table {}\n", table);
+                });
+
+        if (sql_r != SQLITE_OK) {
+            fmt::print(stderr, "ERROR:  Unable to index database: {}\n", errstr);
+            sqlite3_close(db);
+            exit(1);
+        }
+
+        if (verbose)
+            fmt::print(stderr, "* Analyzing indexes...\n");
+
+        sql_r = sqlite3_exec(db, "ANALYZE", NULL, NULL, &sql_errmsg);
+
+        if (sql_r != SQLITE_OK) {
+            fmt::print(stderr, "ERROR:  Unable to analyze database: {}\n", sql_errmsg);
+            sqlite3_close(db);
+            exit(1);
+        }
+    }
+
+    sql_r = sqlite3_exec(db, "END TRANSACTION", NULL, NULL, &sql_errmsg);
+
+    if (sql_r != SQLITE_OK) {
+        fmt::print(stderr, "ERROR:  Unable to commit database changes: {}\n", sql_errmsg);
+        sqlite3_close(db);
+        exit(1);
+    }
+
+    sqlite3_close(db);
+
+    if (verbose)
+        fmt::print(stderr, "* Done!\n");
+
+    return 0;
+}
+
@@ -0,0 +1,127 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "fmt.h"
+#include "kismetdb_reader.h"
+
+static void split_table(sqlite3 *db, const std::string& table, int64_t range_sz,
+        std::vector<kismetdb_row_range>& ranges) {
+    sqlite3_stmt *stmt = nullptr;
+
+    auto sql = fmt::format("SELECT min(rowid), max(rowid) FROM \"{}\"", table);
+
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error(fmt::format("unable to read rows of {}: {}",
+                    table, sqlite3_errmsg(db)));
+
+    if (sqlite3_step(stmt) != SQLITE_ROW || sqlite3_column_type(stmt, 0) == SQLITE_NULL) {
+        // Empty table
+        sqlite3_finalize(stmt);
+        return;
+    }
+
+    auto min_row = sqlite3_column_int64(stmt, 0);
+    auto max_row = sqlite3_column_int64(stmt, 1);
+
+    sqlite3_finalize(stmt);
+
+    for (int64_t start = min_row; start <= max_row; start += range_sz)
+        ranges.push_back(kismetdb_row_range{table, start, std::min<int64_t>(start + range_sz, max_row + 1)});
+}
+
+std::vector<kismetdb_row_range> kismetdb_split_ranges(sqlite3 *db, const std::string& table,
+        int64_t range_sz) {
+    std::vector<kismetdb_row_range> ranges;
+    sqlite3_stmt *stmt = nullptr;
+
+    if (range_sz <= 0)
+        range_sz = 1;
+
+    if (sqlite3_prepare_v2(db, "SELECT type FROM sqlite_master WHERE name = ?",
+                -1, &stmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error(fmt::format("unable to read schema: {}", sqlite3_errmsg(db)));
+
+    sqlite3_bind_text(stmt, 1, table.c_str(), table.length(), SQLITE_TRANSIENT);
+
+    std::string type;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        type = std::string((const char *) sqlite3_column_text(stmt, 0));
+
+    sqlite3_finalize(stmt);
+
+    if (type == "table") {
+        split_table(db, table, range_sz, ranges);
+        return ranges;
+    }
+
+    if (type != "view")
+        throw std::runtime_error(fmt::format("no {} table in log", table));
+
+    // Time-partitioned log; views have no rowid, so split each partition
+    std::vector<std::string> partitions;
+
+    if (sqlite3_prepare_v2(db,
+                "SELECT tablename FROM segments WHERE viewname = ? ORDER BY start_ts",
+                -1, &stmt, nullptr) != SQLITE_OK)
+        throw std::runtime_error(fmt::format("unable to read partitions of {}: {}",
+                    table, sqlite3_errmsg(db)));
+
+    sqlite3_bind_text(stmt, 1, table.c_str(), table.length(), SQLITE_TRANSIENT);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        partitions.push_back(std::string((const char *) sqlite3_column_text(stmt, 0)));
+
+    sqlite3_finalize(stmt);
+
+    for (const auto& p : partitions)
+        split_table(db, p, range_sz, ranges);
+
+    return ranges;
+}
+
+sqlite3 *kismetdb_open_reader(const std::string& fname) {
+    sqlite3 *db = nullptr;
+
+    if (sqlite3_open_v2(fname.c_str(), &db,
+                SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK) {
+        auto err = fmt::format("unable to open '{}': {}", fname,
+                db != nullptr ? sqlite3_errmsg(db) : "out of memory");
+
+        if (db != nullptr)
+            sqlite3_close(db);
+
+        throw std::runtime_error(err);
+    }
+
+    return db;
+}
+
+unsigned int kismetdb_default_threads() {
+    auto n = std::thread::hardware_concurrency();
+
+    if (n == 0)
+        return 1;
+
+    return n;
+}
+
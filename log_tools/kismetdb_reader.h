@@ -0,0 +1,241 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __KISMETDB_READER_H__
+#define __KISMETDB_READER_H__
+
+/* Shared reading code for the kismetdb log tools.
+ *
+ * Large tables are read by splitting them into ranges of rowids - or, for a
+ * time-partitioned log, ranges of each partition table - and reading the ranges on
+ * a pool of threads, each with its own read-only database connection.  The results
+ * of each range are handed back to the calling thread in range order, so output
+ * is written in the same order as a single-threaded read, and only a few ranges
+ * per thread are held in memory at once.
+ */
+
+#include "config.h"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sqlite3.h>
+
+// A range of rows of a single real table, by rowid; end is exclusive
+struct kismetdb_row_range {
+    std::string table;
+    int64_t start;
+    int64_t end;
+};
+
+// Split a logical table into ranges of about range_sz rows.  A time-partitioned
+// log is split per partition table.  Throws std::runtime_error on a database error.
+std::vector<kismetdb_row_range> kismetdb_split_ranges(sqlite3 *db, const std::string& table,
+        int64_t range_sz);
+
+// Open a read-only connection for a reader thread; throws std::runtime_error
+sqlite3 *kismetdb_open_reader(const std::string& fname);
+
+// Number of reader threads to use when none is specified
+unsigned int kismetdb_default_threads();
+
+// Map each range to a result on n_threads reader threads, and merge the results in
+// range order on the calling thread.  At most 2 * n_threads results are held
+// before they are merged.  An exception thrown by map_fn or merge_fn stops the
+// readers and is rethrown.
+template<typename R>
+void kismetdb_parallel_map(const std::string& fname,
+        const std::vector<kismetdb_row_range>& ranges, unsigned int n_threads,
+        std::function<R (sqlite3 *, const kismetdb_row_range&)> map_fn,
+        std::function<void (R&)> merge_fn) {
+
+    if (n_threads == 0)
+        n_threads = 1;
+
+    const size_t window = n_threads * 2;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    size_t next = 0;
+    size_t merged = 0;
+    bool abort = false;
+    std::exception_ptr error;
+    std::map<size_t, R> done;
+
+    auto worker = [&]() {
+        sqlite3 *db = nullptr;
+
+        try {
+            db = kismetdb_open_reader(fname);
+
+            while (true) {
+                size_t idx;
+
+                {
+                    std::unique_lock<std::mutex> lk(mutex);
+
+                    cv.wait(lk, [&]() {
+                            return abort || next >= ranges.size() || next < merged + window;
+                            });
+
+                    if (abort || next >= ranges.size())
+                        break;
+
+                    idx = next++;
+                }
+
+                auto r = map_fn(db, ranges[idx]);
+
+                {
+                    std::lock_guard<std::mutex> lk(mutex);
+                    done.emplace(idx, std::move(r));
+                }
+
+                cv.notify_all();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(mutex);
+
+            if (error == nullptr)
+                error = std::current_exception();
+            abort = true;
+            cv.notify_all();
+        }
+
+        if (db != nullptr)
+            sqlite3_close(db);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < n_threads; i++)
+        threads.push_back(std::thread(worker));
+
+    try {
+        while (true) {
+            R r;
+
+            {
+                std::unique_lock<std::mutex> lk(mutex);
+
+                cv.wait(lk, [&]() {
+                        return abort || merged >= ranges.size() || done.find(merged) != done.end();
+                        });
+
+                if (abort || merged >= ranges.size())
+                    break;
+
+                auto di = done.find(merged);
+                r = std::move(di->second);
+                done.erase(di);
+            }
+
+            merge_fn(r);
+
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                merged++;
+            }
+
+            cv.notify_all();
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        if (error == nullptr)
+            error = std::current_exception();
+        abort = true;
+        cv.notify_all();
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    if (error != nullptr)
+        std::rethrow_exception(error);
+}
+
+// Least-recently-used cache, safe to share between reader threads
+template<typename K, typename V>
+class kismetdb_lru_cache {
+public:
+    kismetdb_lru_cache(size_t in_max) :
+        max_sz{in_max > 0 ? in_max : 1} { }
+
+    // Copy the cached value into ret and mark it recently used; returns false if the
+    // key is not cached
+    bool get(const K& key, V& ret) {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        auto mi = index.find(key);
+
+        if (mi == index.end())
+            return false;
+
+        entries.splice(entries.begin(), entries, mi->second);
+        ret = mi->second->second;
+
+        return true;
+    }
+
+    // Add or replace a value, evicting the least recently used value if the cache is
+    // full
+    void put(const K& key, const V& value) {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        auto mi = index.find(key);
+
+        if (mi != index.end()) {
+            mi->second->second = value;
+            entries.splice(entries.begin(), entries, mi->second);
+            return;
+        }
+
+        if (entries.size() >= max_sz) {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+
+        entries.emplace_front(key, value);
+        index[key] = entries.begin();
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lk(mutex);
+        return entries.size();
+    }
+
+protected:
+    std::mutex mutex;
+    size_t max_sz;
+
+    // Most recently used first
+    std::list<std::pair<K, V>> entries;
+    std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> index;
+};
+
+#endif
+
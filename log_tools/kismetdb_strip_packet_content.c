@@ -46,6 +46,30 @@ void print_help(char *argv) {
            " -f, --force                  Force writing to the target file, even if it exists.\n");
 }
 
+static int strip_count_cb(void *aux, int argc, char **argv, char **colnames) {
+    (*(int *) aux)++;
+    return 0;
+}
+
+static int strip_partition_cb(void *aux, int argc, char **argv, char **colnames) {
+    sqlite3 *db = (sqlite3 *) aux;
+    char *sql;
+    int r;
+
+    if (argc < 1 || argv[0] == NULL)
+        return 0;
+
+    sql = sqlite3_mprintf("UPDATE \"%w\" SET packet = '';", argv[0]);
+
+    if (sql == NULL)
+        return 1;
+
+    r = sqlite3_exec(db, sql, NULL, NULL, NULL);
+    sqlite3_free(sql);
+
+    return r != SQLITE_OK;
+}
+
 int main(int argc, char *argv[]) {
     static struct option longopt[] = {
         { "in", required_argument, 0, 'i' },
@@ -67,6 +91,7 @@ int main(int argc, char *argv[]) {
     int sql_r = 0;
     char *sql_errmsg = NULL;
     sqlite3 *db = NULL;
+    int partitioned = 0;
 
     FILE *ifile = NULL, *ofile = NULL;
     char copybuf[4096];
@@ -207,7 +232,26 @@ int main(int argc, char *argv[]) {
         exit(1);
     }
 
-    sql_r = sqlite3_exec(db, "UPDATE packets SET packet = '';", NULL, NULL, &sql_errmsg);
+    /* Time-partitioned logs present packets as a view, which can't be updated;
+     * clear each partition table instead */
+    sql_r = sqlite3_exec(db,
+            "SELECT 1 FROM sqlite_master WHERE type = 'view' AND name = 'packets'",
+            strip_count_cb, &partitioned, &sql_errmsg);
+
+    if (sql_r != SQLITE_OK) {
+        fprintf(stderr, "ERROR:  Unable to read database schema: %s\n",
+                sql_errmsg);
+        sqlite3_close(db);
+        exit(1);
+    }
+
+    if (partitioned) {
+        sql_r = sqlite3_exec(db,
+                "SELECT tablename FROM segments WHERE viewname = 'packets'",
+                strip_partition_cb, db, &sql_errmsg);
+    } else {
+        sql_r = sqlite3_exec(db, "UPDATE packets SET packet = '';", NULL, NULL, &sql_errmsg);
+    }
 
     if (sql_r != SQLITE_OK) {
         fprintf(stderr, "ERROR:  Unable to clear packet data: %s\n",
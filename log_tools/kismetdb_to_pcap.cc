@@ -43,6 +43,7 @@
 #include "fmt.h"
 #include "getopt.h"
 #include "json/json.h"
+#include "kismetdb_reader.h"
 #include "packet_ieee80211.h"
 #include "pcapng.h"
 #include "sqlite3_cpp11.h"
@@ -392,6 +393,8 @@ void print_help(char *argv) {
            " -f, --force                    Overwrite any existing output files\n"
            " -v, --verbose                  Verbose output\n"
            " -s, --skip-clean               Don't clean (sql vacuum) input database\n"
+           " -j, --threads [threads]        Number of threads reading the log, defaults to the\n"
+           "                                number of CPUs\n"
            "     --old-pcap                 Create a traditional pcap file\n"
            "                                Traditional PCAP files cannot have multiple link types.\n"
            "     --dlt [linktype #]         Limit pcap to a single DLT (link type); necessary when\n"
@@ -434,6 +437,7 @@ int main(int argc, char *argv[]) {
         { "help", no_argument, 0, 'h' },
         { "skip-clean", no_argument, 0, 's' },
         { "force", no_argument, 0, 'f' },
+        { "threads", required_argument, 0, 'j' },
         { "old-pcap", no_argument, 0, OPT_OLD_PCAP },
         { "list-datasources", no_argument, 0, OPT_LIST },
         { "datasource", required_argument, 0, OPT_INTERFACE },
@@ -459,6 +463,7 @@ int main(int argc, char *argv[]) {
     bool split_interface = false;
     std::vector<std::string> raw_interface_vec;
     int dlt = -1;
+    unsigned int n_threads = kismetdb_default_threads();
 
     int sql_r = 0;
     char *sql_errmsg = NULL;
@@ -476,7 +481,7 @@ int main(int argc, char *argv[]) {
 
     while (1) {
         int r = getopt_long(argc, argv, 
-                            "-hi:o:vhsnf", 
+                            "-hi:o:j:vhsnf", 
                             longopt, &option_idx);
         if (r < 0) break;
 
@@ -493,6 +498,11 @@ int main(int argc, char *argv[]) {
             force = true;
         } else if (r == 's') {
             skipclean = true;
+        } else if (r == 'j') {
+            if (sscanf(optarg, "%u", &n_threads) != 1 || n_threads == 0) {
+                fmt::print(stderr, "ERROR:  Expected --threads [number]\n");
+                exit(1);
+            }
         } else if (r == OPT_SPLIT_PKTS) {
             if (sscanf(optarg, "%u", &split_packets) != 1) {
                 fmt::print(stderr, "ERROR:  Expected --split-packets [number]\n");
@@ -736,18 +746,50 @@ int main(int argc, char *argv[]) {
         packet_filter_q = _WHERE(packet_filter_q, AND, uuid_clause);
     }
 
-    auto packets_q = _SELECT(db, "packets", 
-            {"ts_sec", "ts_usec", "dlt", "datasource", "packet", "tags"},
-            packet_filter_q);
+    struct pcap_row {
+        unsigned long ts_sec;
+        unsigned long ts_usec;
+        unsigned int dlt;
+        std::string datasource;
+        std::string bytes;
+        std::string tags;
+    };
+
+    // Packets are read in ranges on the reader threads, and written in log order on
+    // this thread, which owns all the output files
+    auto read_range = [&](sqlite3 *rdb, const kismetdb_row_range& range) -> std::vector<pcap_row> {
+        std::vector<pcap_row> rows;
+
+        auto range_q = packet_filter_q;
+        range_q = _WHERE(range_q, AND, "rowid", GE, (long int) range.start);
+        range_q = _WHERE(range_q, AND, "rowid", LT, (long int) range.end);
+
+        auto packets_q = _SELECT(rdb, range.table, 
+                {"ts_sec", "ts_usec", "dlt", "datasource", "packet", "tags"},
+                range_q,
+                ORDERBY, "rowid");
 
-    try {
         for (auto pkt : packets_q) {
-            auto ts_sec = sqlite3_column_as<unsigned long>(pkt, 0);
-            auto ts_usec = sqlite3_column_as<unsigned long>(pkt, 1);
-            auto pkt_dlt = sqlite3_column_as<unsigned int>(pkt, 2);
-            auto datasource = sqlite3_column_as<std::string>(pkt, 3);
-            auto bytes = sqlite3_column_as<std::string>(pkt, 4);
-            auto tags = sqlite3_column_as<std::string>(pkt, 5);
+            rows.push_back(pcap_row{
+                    sqlite3_column_as<unsigned long>(pkt, 0),
+                    sqlite3_column_as<unsigned long>(pkt, 1),
+                    sqlite3_column_as<unsigned int>(pkt, 2),
+                    sqlite3_column_as<std::string>(pkt, 3),
+                    sqlite3_column_as<std::string>(pkt, 4),
+                    sqlite3_column_as<std::string>(pkt, 5)});
+        }
+
+        return rows;
+    };
+
+    auto write_rows = [&](std::vector<pcap_row>& rows) {
+        for (const auto& pkt : rows) {
+            auto ts_sec = pkt.ts_sec;
+            auto ts_usec = pkt.ts_usec;
+            auto pkt_dlt = pkt.dlt;
+            const auto& datasource = pkt.datasource;
+            const auto& bytes = pkt.bytes;
+            const auto& tags = pkt.tags;
 
             if (!pcapng) {
                 std::shared_ptr<log_file> log_interface;
@@ -903,6 +945,15 @@ int main(int argc, char *argv[]) {
             }
 
         }
+    };
+
+    try {
+        // Packets carry their content, so keep the ranges small to bound the rows held
+        // in memory
+        auto ranges = kismetdb_split_ranges(db, "packets", 2000);
+
+        kismetdb_parallel_map<std::vector<pcap_row>>(in_fname, ranges, n_threads, 
+                read_range, write_rows);
     } catch (const std::exception& e) {
         fmt::print(stderr, "*ERROR: Failed to extract and write packets: {}\n", e.what());
         exit(0);
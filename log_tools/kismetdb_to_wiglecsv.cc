@@ -28,6 +28,7 @@
 #include <ctime>
 #include <iostream>
 #include <tuple>
+#include <unordered_map>
 
 #include <string.h>
 #include <stdio.h>
@@ -44,6 +45,7 @@
 #include "json/json.h"
 #include "sqlite3_cpp11.h"
 #include "fmt.h"
+#include "kismetdb_reader.h"
 #include "packet_ieee80211.h"
 
 // Aggressive additional mangle of text to handle converting ',' and '"' to
@@ -165,6 +167,8 @@ void print_help(char *argv) {
            " -r, --rate-limit [rate]      Limit updated records to one update per [rate] seconds\n"
            "                              per device\n"
            " -c, --cache-limit [limit]    Maximum number of device to cache, defaults to 1000.\n"
+           " -j, --threads [threads]      Number of threads reading the log, defaults to the\n"
+           "                              number of CPUs\n"
            " -v, --verbose                Verbose output\n"
            " -s, --skip-clean             Don't clean (sql vacuum) input database\n"
            " -e, --exclude lat,lon,dist   Exclude records within 'dist' *meters* of the lat,lon\n"
@@ -183,6 +187,7 @@ int main(int argc, char *argv[]) {
         { "rate-limit", required_argument, 0, 'r'},
         { "cache-limit", required_argument, 0, 'c'},
         { "exclude", required_argument, 0, 'e'},
+        { "threads", required_argument, 0, 'j'},
         { 0, 0, 0, 0 }
     };
 
@@ -207,10 +212,11 @@ int main(int argc, char *argv[]) {
 
     unsigned int rate_limit = 0;
     unsigned int cache_limit = 1000;
+    unsigned int n_threads = kismetdb_default_threads();
 
     while (1) {
         int r = getopt_long(argc, argv, 
-                            "-hi:o:r:c:e:vfs", 
+                            "-hi:o:r:c:e:j:vfs", 
                             longopt, &option_idx);
         if (r < 0) break;
 
@@ -237,6 +243,11 @@ int main(int argc, char *argv[]) {
                 fmt::print(stderr, "ERROR:  Expected a cache limit number.\n");
                 exit(1);
             }
+        } else if (r == 'j') {
+            if (sscanf(optarg, "%u", &n_threads) != 1 || n_threads == 0) {
+                fmt::print(stderr, "ERROR:  Expected a number of threads.\n");
+                exit(1);
+            }
         } else if (r == 'e') {
             double lat, lon, distance;
 
@@ -370,26 +381,34 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    // Define a simple cache; we don't need to use a proper kismet macaddr here, just operate
-    // on it as a string
-    class cache_obj {
-    public:
-        cache_obj(std::string t, std::string s, std::string c) :
-            first_time{t},
-            name{s},
-            crypto{c},
-            last_time_sec{0} { }
-
+    // Device summaries are shared by the reader threads; devices which aren't exported
+    // are cached as nullptr so they aren't looked up again
+    struct wigle_device {
         std::string first_time;
         std::string name;
         std::string crypto;
-        uint64_t last_time_sec;
     };
 
-    std::map<std::string, cache_obj *> device_cache_map;
+    kismetdb_lru_cache<std::string, std::shared_ptr<wigle_device>> device_cache(cache_limit);
+
+    struct wigle_record {
+        uint64_t ts;
+        std::string sourcemac;
+        std::shared_ptr<wigle_device> device;
+        int channel;
+        int signal;
+        float lat, lon, alt;
+    };
+
+    struct wigle_batch {
+        std::vector<wigle_record> records;
+        unsigned long n_logs = 0;
+        unsigned long n_discarded_zones = 0;
+    };
 
     if (verbose) 
-        fmt::print(stderr, "* Starting to process file, max device cache {}\n", cache_limit);
+        fmt::print(stderr, "* Starting to process file with {} threads, max device cache {}\n", 
+                n_threads, cache_limit);
 
     // CSV headers
     fmt::print(ofile, "WigleWifi-1.4,appRelease=20190201,model=Kismet,release=2019.02.01.{},"
@@ -406,81 +425,125 @@ int main(int argc, char *argv[]) {
         packet_fields = std::list<std::string>{"ts_sec", "sourcemac", "phyname", "lat", "lon", "signal", "frequency", "alt", "speed"};
     }
 
-    auto query = _SELECT(db, "packets", packet_fields,
-            _WHERE("sourcemac", NEQ, "00:00:00:00:00:00", 
-                AND, 
-                "lat", NEQ, 0,
-                AND,
-                "lon", NEQ, 0));
+    auto fetch_device = [&](sqlite3 *rdb, const std::string& sourcemac, 
+            const std::string& phy) -> std::shared_ptr<wigle_device> {
+        auto key = fmt::format("{}/{}", phy, sourcemac);
+        std::shared_ptr<wigle_device> cached;
 
-    unsigned long n_logs = 0;
-    unsigned long n_saved = 0;
-    unsigned long n_discarded_logs_rate = 0;
-    unsigned long n_discarded_logs_zones = 0;
-    unsigned long n_division = (n_packets_db / 20);
-
-    if (n_division <= 0)
-        n_division = 1;
+        if (device_cache.get(key, cached))
+            return cached;
 
-    for (auto p : query) {
-        // Brute-force cache maintenance; if we're full at the start of the 
-        // processing loop, nuke the ENTIRE cache and rebuild it; this is
-        // cleaner than constantly re-sorting it.
-        if (device_cache_map.size() >= cache_limit) {
-            if (verbose)
-                fmt::print(stderr, "* Cleaning cache...\n");
+        auto dev_query = _SELECT(rdb, "devices", {"device"},
+                _WHERE("devmac", EQ, sourcemac,
+                    AND,
+                    "phyname", EQ, phy));
 
-            for (auto i : device_cache_map) {
-                delete(i.second);
-            }
+        auto dev = dev_query.begin();
 
-            device_cache_map.clear();
+        if (dev == dev_query.end()) {
+            device_cache.put(key, nullptr);
+            return nullptr;
         }
 
-        n_logs++;
-        if (n_logs % n_division == 0 && verbose)
-            std::cerr << 
-                fmt::format("* {}%% processed {} records, {} discarded from rate limiting, {} discarded from exclusion zones, {} cached",
-                    (int) (((float) n_logs / (float) n_packets_db) * 100) + 1, 
-                    n_logs, n_discarded_logs_rate, n_discarded_logs_zones, device_cache_map.size()) << std::endl;
+        Json::Value json;
+        std::stringstream ss(sqlite3_column_as<std::string>(*dev, 0));
 
-        auto ts = sqlite3_column_as<std::uint64_t>(p, 0);
-        auto sourcemac = sqlite3_column_as<std::string>(p, 1);
-        auto phy = sqlite3_column_as<std::string>(p, 2);
+        try {
+            ss >> json;
 
-        auto lat = 0.0f, lon = 0.0f, alt = 0.0f;
+            auto timestamp = json["kismet.device.base.first_time"].asUInt64();
+            auto name = std::string{""};
+            auto crypt = std::string{""};
+            auto type = json["kismet.device.base.type"].asString();
 
-        auto signal = sqlite3_column_as<int>(p, 5);
-        auto channel = sqlite3_column_as<double>(p, 6);
+            if (phy == "IEEE802.11") {
+                if (type != "Wi-Fi AP") {
+                    device_cache.put(key, nullptr);
+                    return nullptr;
+                }
 
-        auto crypt = std::string{""};
+                if (json["dot11.device"]["dot11.device.last_beaconed_ssid"].isString()) {
+                    name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid"].asString());
+                } else if (json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].isString()) {
+                    name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].asString());
+                } else {
+                    name = "";
+                }
 
-        // Handle the different versions
-        if (db_version < 5) {
-            lat = sqlite3_column_as<double>(p, 3) / 100000;
-            lon = sqlite3_column_as<double>(p, 4) / 100000;
-        } else {
-            lat = sqlite3_column_as<double>(p, 3);
-            lon = sqlite3_column_as<double>(p, 4);
-            alt = sqlite3_column_as<double>(p, 7);
-        }
+                // Handle the aliased ssid_record for modern info
+                if (!json["dot11.device"]["dot11.device.last_beaconed_ssid_record"].isNull()) {
+                    crypt = WifiCryptToString(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.crypt_set"].asUInt64());
+                } else {
+                    auto last_ssid_key = 
+                        json["dot11.device"]["dot11.device.last_beaconed_ssid_checksum"].asUInt64();
+                    std::stringstream ss;
 
-        auto ci = device_cache_map.find(sourcemac);
-        cache_obj *cached = nullptr;
+                    ss << last_ssid_key;
 
-        if (ci != device_cache_map.end()) {
-            cached = ci->second;
-        } else {
-            auto dev_query = _SELECT(db, "devices", {"device"},
-                    _WHERE("devmac", EQ, sourcemac,
-                        AND,
-                        "phyname", EQ, phy));
+                    crypt = WifiCryptToString(json["dot11.device"]["dot11.device.advertised_ssid_map"][ss.str()]["dot11.advertisedssid.crypt_set"].asUInt64());
+                }
 
-            auto dev = dev_query.begin();
+                crypt += "[ESS]";
 
-            if (dev == dev_query.end()) {
-                // printf("Could not find device record for %s\n", sqlite3_column_as<std::string>(p, 0).c_str());
-                continue;
+            }
+
+            std::time_t timet(timestamp);
+            std::tm tm;
+            std::stringstream ts;
+
+            gmtime_r(&timet, &tm);
+
+            ts << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+
+            cached = std::make_shared<wigle_device>(wigle_device{ts.str(), name, crypt});
+        } catch (const std::exception& e) {
+            fmt::print(stderr, "WARNING:  Could not process device info for {}/{}, skipping\n", 
+                    sourcemac, phy);
+            cached = nullptr;
+        }
+
+        device_cache.put(key, cached);
+
+        return cached;
+    };
+
+    // Decode each range of packets and check them against the exclusion zones on the
+    // reader threads
+    auto read_range = [&](sqlite3 *rdb, const kismetdb_row_range& range) -> wigle_batch {
+        wigle_batch batch;
+
+        auto query = _SELECT(rdb, range.table, packet_fields,
+                _WHERE("rowid", GE, (long int) range.start,
+                    AND,
+                    "rowid", LT, (long int) range.end,
+                    AND,
+                    "sourcemac", NEQ, "00:00:00:00:00:00", 
+                    AND, 
+                    "lat", NEQ, 0,
+                    AND,
+                    "lon", NEQ, 0),
+                ORDERBY, "rowid");
+
+        for (auto p : query) {
+            batch.n_logs++;
+
+            auto ts = sqlite3_column_as<std::uint64_t>(p, 0);
+            auto sourcemac = sqlite3_column_as<std::string>(p, 1);
+            auto phy = sqlite3_column_as<std::string>(p, 2);
+
+            auto lat = 0.0f, lon = 0.0f, alt = 0.0f;
+
+            auto signal = sqlite3_column_as<int>(p, 5);
+            auto channel = sqlite3_column_as<double>(p, 6);
+
+            // Handle the different versions
+            if (db_version < 5) {
+                lat = sqlite3_column_as<double>(p, 3) / 100000;
+                lon = sqlite3_column_as<double>(p, 4) / 100000;
+            } else {
+                lat = sqlite3_column_as<double>(p, 3);
+                lon = sqlite3_column_as<double>(p, 4);
+                alt = sqlite3_column_as<double>(p, 7);
             }
 
             // Check to see if we lie in any exclusion zones
@@ -493,103 +556,92 @@ int main(int argc, char *argv[]) {
             }
 
             if (violates_exclusion) {
-                n_discarded_logs_zones++;
+                batch.n_discarded_zones++;
                 continue;
             }
 
-            Json::Value json;
-            std::stringstream ss(sqlite3_column_as<std::string>(*dev, 0));
-
-            try {
-                ss >> json;
-
-                auto timestamp = json["kismet.device.base.first_time"].asUInt64();
-                auto name = std::string{""};
-                auto crypt = std::string{""};
-                auto type = json["kismet.device.base.type"].asString();
-
-                if (phy == "IEEE802.11") {
-                    if (type != "Wi-Fi AP")
-                        continue;
-
-                    if (json["dot11.device"]["dot11.device.last_beaconed_ssid"].isString()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid"].asString());
-                    } else if (!json["dot11.device"]["dot11.device.last_beaconed_ssid_record"].isNull()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].asString());
-                    } else {
-                        name = "";
-                    }
-                    if (json["dot11.device"]["dot11.device.last_beaconed_ssid"].isString()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid"].asString());
-                    } else if (json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].isString()) {
-                        name = MungeForCSV(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.ssid"].asString());
-                    } else {
-                        name = "";
-                    }
-
-                    // Handle the aliased ssid_record for modern info
-                    if (!json["dot11.device"]["dot11.device.last_beaconed_ssid_record"].isNull()) {
-                        crypt = WifiCryptToString(json["dot11.device"]["dot11.device.last_beaconed_ssid_record"]["dot11.advertisedssid.crypt_set"].asUInt64());
-                    } else {
-                        auto last_ssid_key = 
-                            json["dot11.device"]["dot11.device.last_beaconed_ssid_checksum"].asUInt64();
-                        std::stringstream ss;
-
-                        ss << last_ssid_key;
-
-                        crypt = WifiCryptToString(json["dot11.device"]["dot11.device.advertised_ssid_map"][ss.str()]["dot11.advertisedssid.crypt_set"].asUInt64());
-                    }
-
-                    crypt += "[ESS]";
+            auto device = fetch_device(rdb, sourcemac, phy);
 
-                }
+            if (device == nullptr)
+                continue;
 
-                std::time_t timet(timestamp);
-                std::tm tm;
-                std::stringstream ts;
+            if (phy == "IEEE802.11")
+                channel = FrequencyToWifiChannel(channel);
 
-                gmtime_r(&timet, &tm);
+            batch.records.push_back(wigle_record{ts, sourcemac, device, (int) channel, signal, 
+                    lat, lon, alt});
+        }
 
-                ts << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
+        return batch;
+    };
 
-                cached = new cache_obj{ts.str(), name, crypt};
+    unsigned long n_logs = 0;
+    unsigned long n_saved = 0;
+    unsigned long n_discarded_logs_rate = 0;
+    unsigned long n_discarded_logs_zones = 0;
+    unsigned long n_division = (n_packets_db / 20);
 
-                device_cache_map[sourcemac] = cached;
+    if (n_division <= 0)
+        n_division = 1;
 
-            } catch (const std::exception& e) {
-                std::cerr << 
-                    fmt::format("WARNING:  Could not process device info for {}/{}, skipping", sourcemac, phy) << std::endl;
-            }
-        }
+    // Last record time per device, for rate limiting; batches are merged in log order
+    std::unordered_map<std::string, uint64_t> last_time_map;
 
-        if (cached == nullptr)
-            continue;
+    // Rate limit and write each batch in order on this thread
+    auto write_batch = [&](wigle_batch& batch) {
+        auto prev_division = n_logs / n_division;
 
-        // Rate throttle
-        if (rate_limit != 0 && cached->last_time_sec != 0) {
-            if (cached->last_time_sec + rate_limit < ts) {
-                n_discarded_logs_rate++;
-                continue;
-            }
-        } 
-        cached->last_time_sec = ts;
+        n_logs += batch.n_logs;
+        n_discarded_logs_zones += batch.n_discarded_zones;
+
+        for (const auto& r : batch.records) {
+            // Rate throttle
+            auto& last_time_sec = last_time_map[r.sourcemac];
+
+            if (rate_limit != 0 && last_time_sec != 0) {
+                if (last_time_sec + rate_limit < r.ts) {
+                    n_discarded_logs_rate++;
+                    continue;
+                }
+            } 
+            last_time_sec = r.ts;
+
+            // printf("MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,AltitudeMeters,AccuracyMeters,Type\n");
+
+            fmt::print(ofile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
+                    r.sourcemac,
+                    r.device->name,
+                    r.device->crypto,
+                    r.device->first_time,
+                    r.channel,
+                    r.signal,
+                    r.lat, r.lon, r.alt,
+                    "WIFI");
+
+            n_saved++;
+        }
+
+        if (verbose && n_logs / n_division != prev_division)
+            std::cerr << 
+                fmt::format("* {}%% processed {} records, {} discarded from rate limiting, {} discarded from exclusion zones, {} cached",
+                    (int) (((float) n_logs / (float) n_packets_db) * 100) + 1, 
+                    n_logs, n_discarded_logs_rate, n_discarded_logs_zones, device_cache.size()) << std::endl;
+    };
 
-        if (phy == "IEEE802.11")
-            channel = FrequencyToWifiChannel(channel);
+    try {
+        auto ranges = kismetdb_split_ranges(db, "packets", 10000);
 
-        // printf("MAC,SSID,AuthMode,FirstSeen,Channel,RSSI,CurrentLatitude,CurrentLongitude,AltitudeMeters,AccuracyMeters,Type\n");
+        kismetdb_parallel_map<wigle_batch>(in_fname, ranges, n_threads, read_range, write_batch);
+    } catch (const std::exception& e) {
+        fmt::print(stderr, "ERROR:  Could not process packets from '{}': {}\n", in_fname, e.what());
 
-        fmt::print(ofile, "{},{},{},{},{},{},{:3.10f},{:3.10f},{:f},0,{}\n",
-                sourcemac,
-                cached->name,
-                cached->crypto,
-                cached->first_time,
-                (int) channel,
-                signal,
-                lat, lon, alt,
-                "WIFI");
+        if (ofile != stdout) {
+            fclose(ofile);
+            unlink(out_fname.c_str());
+        }
 
-        n_saved++;
+        sqlite3_close(db);
+        exit(1);
     }
 
     if (ofile != stdout) {
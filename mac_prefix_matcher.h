@@ -0,0 +1,115 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __MAC_PREFIX_MATCHER_H__
+#define __MAC_PREFIX_MATCHER_H__
+
+#include "config.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "macaddr.h"
+
+// Compiled lookup of masked MAC addresses, such as OUI or full-address filter rules.
+//
+// Rules are bucketed by mask length, and each bucket is a hash of the masked
+// addresses, so matching an address costs one hash lookup per distinct mask length
+// in use - normally one or two - no matter how many rules there are.  Buckets are
+// searched from the longest mask to the shortest, so the most specific rule for an
+// address is found first.
+//
+// A matcher is built once and then only read; callers rebuild it when the rules
+// change and swap it in whole, so lookups need no locking.
+
+template<typename T>
+class mac_prefix_matcher {
+public:
+    void insert(const mac_addr& in_mac, const T& value) {
+        auto mask = maskbits_to_mask(in_mac.maskbits);
+
+        auto bi = std::find_if(buckets.begin(), buckets.end(),
+                [mask](const bucket& b) { return b.mask == mask; });
+
+        if (bi == buckets.end()) {
+            buckets.push_back(bucket{mask, {}});
+
+            // Longer masks are numerically larger
+            std::sort(buckets.begin(), buckets.end(),
+                    [](const bucket& a, const bucket& b) { return a.mask > b.mask; });
+
+            bi = std::find_if(buckets.begin(), buckets.end(),
+                    [mask](const bucket& b) { return b.mask == mask; });
+        }
+
+        bi->entries[in_mac.longmac & mask] = value;
+    }
+
+    bool empty() const {
+        return buckets.size() == 0;
+    }
+
+    // Most specific value matching an address, or nullptr
+    const T *find(const mac_addr& in_mac) const {
+        for (const auto& b : buckets) {
+            auto ei = b.entries.find(in_mac.longmac & b.mask);
+
+            if (ei != b.entries.end())
+                return &ei->second;
+        }
+
+        return nullptr;
+    }
+
+    // Call fn with every value matching an address, most specific first, until fn
+    // returns true
+    template<typename F>
+    void match_all(const mac_addr& in_mac, F fn) const {
+        for (const auto& b : buckets) {
+            auto ei = b.entries.find(in_mac.longmac & b.mask);
+
+            if (ei != b.entries.end() && fn(ei->second))
+                return;
+        }
+    }
+
+    // Mask covering the leading bits of an address; rules are keyed by the address
+    // under this mask
+    static uint64_t maskbits_to_mask(unsigned int bits) {
+        if (bits == 0)
+            return 0;
+
+        if (bits >= 64)
+            return (uint64_t) -1;
+
+        return ((uint64_t) -1) << (64 - bits);
+    }
+
+protected:
+
+    struct bucket {
+        uint64_t mask;
+        std::unordered_map<uint64_t, T> entries;
+    };
+
+    std::vector<bucket> buckets;
+};
+
+#endif
+
@@ -35,6 +35,7 @@
 
 #include "eventbus.h"
 #include "globalregistry.h"
+#include "kis_atom.h"
 #include "macaddr.h"
 #include "packet_ieee80211.h"
 #include "trackedelement.h"
@@ -312,7 +313,7 @@ public:
         phyid = -1;
         error = 0;
         datasize = 0;
-        channel = "0";
+        channel = kis_atom::from_uint(0);
         freq_khz = 0;
         basic_crypt_set = 0;
 
@@ -341,8 +342,8 @@ public:
     uint32_t basic_crypt_set;
     // Phy-specific numeric channel, freq is held in l1info.  Channel is
     // represented as a string to carry whatever special attributes, ie
-    // 6HT20 or 6HT40+ for wifi
-    std::string channel;
+    // 6HT20 or 6HT40+ for wifi, and interned
+    kis_atom channel;
     // Frequency in khz
     double freq_khz;
 };
@@ -447,7 +448,7 @@ public:
         datarate = 0;
         freq_khz = 0;
         accuracy = 0;
-        channel = "0";
+        channel = kis_atom::from_uint(0);
     }
 
     // How "accurate" are we?  Higher == better.  Nothing uses this yet
@@ -458,7 +459,7 @@ public:
     double freq_khz;
 
     // Logical channel
-    std::string channel;
+    kis_atom channel;
 
     // Connection info
     kis_layer1_packinfo_signal_type signal_type;
@@ -490,7 +491,8 @@ public:
         self_destruct = 1;
     }
 
-    std::string type;
+    // Record type, interned
+    kis_atom type;
     std::string json_string;
 };
 
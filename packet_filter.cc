@@ -213,6 +213,8 @@ packet_filter_mac_addr::packet_filter_mac_addr(const std::string& in_id, const s
 
     auto packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
     pack_comp_common = packetchain->register_packet_component("COMMON");
+
+    compiled_filters = std::make_shared<compiled_phy_map>();
 }
 
 packet_filter_mac_addr::~packet_filter_mac_addr() {
@@ -249,6 +251,54 @@ void packet_filter_mac_addr::update_phy_map(std::shared_ptr<eventbus_event> evt)
     // Copy the filter-engine code over to the new one
     phy_mac_filter_map[phy->fetch_phy_id()] = unknown_key->second;
     unknown_phy_mac_filter_map.erase(unknown_key);
+
+    compile_filters();
+}
+
+void packet_filter_mac_addr::compile_filters() {
+    auto compiled = std::make_shared<compiled_phy_map>();
+
+    for (const auto& pi : phy_mac_filter_map) {
+        // Merge the blocks by masked address
+        std::map<std::pair<uint64_t, uint8_t>, std::pair<mac_addr, compiled_rule>> merged;
+
+        auto merge_block = [&merged](const std::map<mac_addr, bool>& block, filter_block b) {
+            for (const auto& fi : block) {
+                // Keyed the same way as the matcher, so addresses which only differ 
+                // in the masked-off bits merge into one rule
+                auto key = std::make_pair(fi.first.longmac & 
+                        mac_prefix_matcher<compiled_rule>::maskbits_to_mask(fi.first.maskbits),
+                        fi.first.maskbits);
+                auto mi = merged.find(key);
+
+                if (mi == merged.end()) {
+                    compiled_rule rule;
+                    for (unsigned int i = 0; i < block_max; i++)
+                        rule.value[i] = -1;
+
+                    mi = merged.insert(std::make_pair(key, std::make_pair(fi.first, rule))).first;
+                }
+
+                mi->second.second.value[b] = fi.second;
+            }
+        };
+
+        merge_block(pi.second.filter_source, block_source);
+        merge_block(pi.second.filter_dest, block_dest);
+        merge_block(pi.second.filter_network, block_network);
+        merge_block(pi.second.filter_other, block_other);
+        merge_block(pi.second.filter_any, block_any);
+
+        if (merged.size() == 0)
+            continue;
+
+        auto& matcher = (*compiled)[pi.first];
+
+        for (const auto& mi : merged)
+            matcher.insert(mi.second.first, mi.second.second);
+    }
+
+    std::atomic_store(&compiled_filters, compiled);
 }
 
 void packet_filter_mac_addr::set_filter(mac_addr in_mac, const std::string& in_phy, const std::string& in_block, bool value) {
@@ -340,6 +390,8 @@ void packet_filter_mac_addr::set_filter(mac_addr in_mac, const std::string& in_p
         phy_mac_filter_map[phy->fetch_phy_id()].filter_other[in_mac] = value;
     else if (in_block == "any")
         phy_mac_filter_map[phy->fetch_phy_id()].filter_any[in_mac] = value;
+
+    compile_filters();
 }
 
 void packet_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& in_phy, const std::string& in_block) {
@@ -433,6 +485,8 @@ void packet_filter_mac_addr::remove_filter(mac_addr in_mac, const std::string& i
         if (k != phy_mac_filter_map[phy->fetch_phy_id()].filter_any.end())
             phy_mac_filter_map[phy->fetch_phy_id()].filter_any.erase(k);
     }
+
+    compile_filters();
 }
 
 unsigned int packet_filter_mac_addr::edit_endp_handler(std::ostream& stream, 
@@ -527,48 +581,48 @@ bool packet_filter_mac_addr::filter_packet(kis_packet *packet) {
     if (common == nullptr)
         return get_filter_default();
 
-    auto phy_filter_group =
-        phy_mac_filter_map.find(common->phyid);
+    auto compiled = std::atomic_load(&compiled_filters);
+
+    auto phy_matcher = compiled->find(common->phyid);
 
-    if (phy_filter_group == phy_mac_filter_map.end())
+    if (phy_matcher == compiled->end())
         return get_filter_default();
 
-    auto si = phy_filter_group->second.filter_source.find(common->source);
-    if (si != phy_filter_group->second.filter_source.end()) {
-        return si->second;
-    }
+    // Addresses in the order of the blocks which match them
+    const mac_addr *addrs[block_any] = {
+        &common->source, &common->dest, &common->network, &common->transmitter
+    };
 
-    auto di = phy_filter_group->second.filter_dest.find(common->dest);
-    if (di != phy_filter_group->second.filter_dest.end()) {
-        return di->second;
-    }
+    int8_t block_v[block_any];
+    int8_t any_v[block_any];
 
-    auto ni = phy_filter_group->second.filter_network.find(common->network);
-    if (ni != phy_filter_group->second.filter_network.end()) {
-        return ni->second;
-    }
+    for (unsigned int i = 0; i < block_any; i++) {
+        block_v[i] = -1;
+        any_v[i] = -1;
 
-    auto oi = phy_filter_group->second.filter_other.find(common->transmitter);
-    if (oi != phy_filter_group->second.filter_other.end()) {
-        return oi->second;
-    }
+        // Most specific rule of the address block and of the any block
+        phy_matcher->second.match_all(*addrs[i], 
+                [&block_v, &any_v, i](const compiled_rule& rule) -> bool {
+                    if (block_v[i] < 0)
+                        block_v[i] = rule.value[i];
 
-    auto ai = phy_filter_group->second.filter_any.find(common->source);
+                    if (any_v[i] < 0)
+                        any_v[i] = rule.value[block_any];
 
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->dest);
+                    return block_v[i] >= 0 && any_v[i] >= 0;
+                });
+    }
 
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->network);
-    
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->transmitter);
-   
-    if (ai == phy_filter_group->second.filter_any.end())
-        ai = phy_filter_group->second.filter_any.find(common->dest);
-
-    if (ai != phy_filter_group->second.filter_any.end())
-        return ai->second;
+    // Specific blocks take priority over the any block
+    for (unsigned int i = 0; i < block_any; i++) {
+        if (block_v[i] >= 0)
+            return block_v[i];
+    }
+
+    for (unsigned int i = 0; i < block_any; i++) {
+        if (any_v[i] >= 0)
+            return any_v[i];
+    }
 
     return get_filter_default();
 }
@@ -18,6 +18,9 @@
 
 #include "config.h"
 
+#include <unordered_map>
+
+#include "mac_prefix_matcher.h"
 #include "packetchain.h"
 #include "packet.h"
 #include "trackedcomponent.h"
@@ -168,6 +171,24 @@ protected:
 	// Internal unknown phy map for filters registered before we had a phy ID
 	std::map<std::string, struct phy_filter_group> unknown_phy_mac_filter_map;
 
+    // Filter blocks compiled into a single matcher per phy, so each address of a 
+    // packet is looked up once for all blocks.  A compiled rule holds the rule value in
+    // each block, or -1 if the address isn't in that block.
+    enum filter_block { block_source = 0, block_dest = 1, block_network = 2, 
+        block_other = 3, block_any = 4, block_max = 5 };
+
+    struct compiled_rule {
+        int8_t value[block_max];
+    };
+
+    using compiled_phy_map = std::unordered_map<int, mac_prefix_matcher<compiled_rule>>;
+
+    // Replaced whole when the filters change, and read without locking
+    std::shared_ptr<compiled_phy_map> compiled_filters;
+
+    // Rebuild the compiled filters from the known phy map; mutex must be held
+    void compile_filters();
+
     // Address management endpoint keyed on path
     std::shared_ptr<kis_net_httpd_path_post_endpoint> macaddr_edit_endp;
     unsigned int edit_endp_handler(std::ostream& stream, const std::vector<std::string>& path, 
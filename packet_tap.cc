@@ -0,0 +1,216 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+
+#include <algorithm>
+
+#include "devicetracker_component.h"
+#include "kis_datasource.h"
+#include "packet.h"
+#include "packet_tap.h"
+
+packet_tap::packet_tap() :
+    lifetime_global(),
+    next_id{1} {
+
+    mutex.set_name("packet_tap");
+
+    index = std::make_shared<sub_index>();
+
+    packetchain = Globalreg::fetch_mandatory_global_as<packet_chain>();
+
+    pack_comp_device = packetchain->register_packet_component("DEVICE");
+    pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
+    pack_comp_common = packetchain->register_packet_component("COMMON");
+
+    packethandler_id = packetchain->register_handler([this](kis_packet *packet) {
+            return handle_packet(packet);
+        }, CHAINPOS_LOGGING, -100, "packet_tap");
+}
+
+packet_tap::~packet_tap() {
+    Globalreg::globalreg->remove_global(global_name());
+
+    auto chain = Globalreg::fetch_global_as<packet_chain>();
+    if (chain != nullptr)
+        chain->remove_handler(packethandler_id, CHAINPOS_LOGGING);
+}
+
+int packet_tap::subscribe(const packet_tap_match& in_match,
+        std::function<bool (kis_packet *)> accept_cb, tap_cb in_cb) {
+    local_locker l(&mutex);
+
+    auto sub = std::make_shared<subscription>(next_id++, in_match);
+    sub->accept_cb = accept_cb;
+    sub->cb = in_cb;
+
+    subscriptions[sub->id] = sub;
+
+    rebuild_index();
+
+    return sub->id;
+}
+
+void packet_tap::unsubscribe(int in_id, bool wait) {
+    std::shared_ptr<subscription> sub;
+
+    {
+        local_locker l(&mutex);
+
+        auto si = subscriptions.find(in_id);
+
+        if (si == subscriptions.end())
+            return;
+
+        sub = si->second;
+
+        // Deliveries from an older copy of the index check this before calling back
+        sub->active = false;
+
+        // Without waiting, the subscription is only dropped from the index; it stays
+        // listed so that a later waiting unsubscribe of the same id can still wait out
+        // a delivery in progress before the caller frees what the callback uses
+        if (wait)
+            subscriptions.erase(si);
+
+        rebuild_index();
+    }
+
+    // Wait out any delivery already in progress
+    if (wait)
+        local_locker sl(&sub->mutex);
+}
+
+void packet_tap::rebuild_index() {
+    auto new_index = std::make_shared<sub_index>();
+
+    for (const auto& si : subscriptions) {
+        if (!si.second->active)
+            continue;
+
+        const auto& m = si.second->match;
+
+        switch (m.type) {
+            case packet_tap_match::match_type::all:
+                new_index->all.push_back(si.second);
+                break;
+            case packet_tap_match::match_type::device_key:
+                new_index->by_device[m.key].push_back(si.second);
+                break;
+            case packet_tap_match::match_type::datasource:
+                new_index->by_datasource[m.source_number].push_back(si.second);
+                break;
+            case packet_tap_match::match_type::mac:
+                new_index->by_mac[m.mac.longmac].push_back(si.second);
+                break;
+        }
+    }
+
+    std::atomic_store(&index, new_index);
+}
+
+void packet_tap::deliver(const std::shared_ptr<subscription>& sub, kis_packet *in_packet) {
+    local_locker l(&sub->mutex);
+
+    if (!sub->active)
+        return;
+
+    if (sub->accept_cb != nullptr && !sub->accept_cb(in_packet))
+        return;
+
+    sub->cb(in_packet);
+}
+
+int packet_tap::handle_packet(kis_packet *in_packet) {
+    auto idx = std::atomic_load(&index);
+
+    for (const auto& s : idx->all)
+        deliver(s, in_packet);
+
+    if (idx->by_datasource.size() != 0) {
+        auto datasrcinfo = in_packet->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+
+        if (datasrcinfo != nullptr && datasrcinfo->ref_source != nullptr) {
+            auto di = idx->by_datasource.find(datasrcinfo->ref_source->get_source_number());
+
+            if (di != idx->by_datasource.end()) {
+                for (const auto& s : di->second)
+                    deliver(s, in_packet);
+            }
+        }
+    }
+
+    if (idx->by_device.size() != 0) {
+        auto devinfo = in_packet->fetch<kis_tracked_device_info>(pack_comp_device);
+
+        if (devinfo != nullptr) {
+            // A packet may reference the same device more than once
+            std::vector<subscription *> matched;
+
+            for (const auto& dri : devinfo->devrefs) {
+                auto di = idx->by_device.find(dri.second->get_key());
+
+                if (di == idx->by_device.end())
+                    continue;
+
+                for (const auto& s : di->second) {
+                    if (std::find(matched.begin(), matched.end(), s.get()) != matched.end())
+                        continue;
+
+                    matched.push_back(s.get());
+                    deliver(s, in_packet);
+                }
+            }
+        }
+    }
+
+    if (idx->by_mac.size() != 0) {
+        auto common = in_packet->fetch<kis_common_info>(pack_comp_common);
+
+        if (common != nullptr) {
+            uint64_t addrs[4] = {
+                common->source.longmac, common->dest.longmac,
+                common->network.longmac, common->transmitter.longmac
+            };
+
+            for (unsigned int i = 0; i < 4; i++) {
+                // Don't deliver twice when a packet repeats an address
+                bool dupe = false;
+                for (unsigned int j = 0; j < i; j++) {
+                    if (addrs[j] == addrs[i])
+                        dupe = true;
+                }
+
+                if (dupe)
+                    continue;
+
+                auto mi = idx->by_mac.find(addrs[i]);
+
+                if (mi == idx->by_mac.end())
+                    continue;
+
+                for (const auto& s : mi->second)
+                    deliver(s, in_packet);
+            }
+        }
+    }
+
+    return 1;
+}
+
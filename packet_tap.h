@@ -0,0 +1,167 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __PACKET_TAP_H__
+#define __PACKET_TAP_H__
+
+#include "config.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "globalregistry.h"
+#include "kis_mutex.h"
+#include "macaddr.h"
+#include "packetchain.h"
+#include "trackedelement.h"
+
+// Shared packet tap for streams which follow a device, datasource, or address.
+//
+// The tap registers a single packet chain handler and indexes the subscriptions by
+// what they match, so each packet is handed only to the subscriptions which match it
+// instead of every open stream testing every packet.  A subscription may also carry
+// an accept function, which is only called for packets its index key matched.
+//
+// The subscription index is rebuilt when subscriptions change and swapped in whole;
+// the packet path only takes the lock of each matched subscription.
+
+class packet_tap_match {
+public:
+    enum class match_type {
+        all, device_key, datasource, mac
+    };
+
+    // Every packet
+    static packet_tap_match all() {
+        return packet_tap_match(match_type::all);
+    }
+
+    // Packets linked to a device
+    static packet_tap_match by_device(const device_key& in_key) {
+        auto m = packet_tap_match(match_type::device_key);
+        m.key = in_key;
+        return m;
+    }
+
+    // Packets from a datasource, by source number
+    static packet_tap_match by_datasource(unsigned int in_source_number) {
+        auto m = packet_tap_match(match_type::datasource);
+        m.source_number = in_source_number;
+        return m;
+    }
+
+    // Packets with a source, destination, network, or transmitter address
+    static packet_tap_match by_mac(const mac_addr& in_mac) {
+        auto m = packet_tap_match(match_type::mac);
+        m.mac = in_mac;
+        return m;
+    }
+
+    match_type type;
+    device_key key;
+    unsigned int source_number;
+    mac_addr mac;
+
+protected:
+    packet_tap_match(match_type in_type) :
+        type{in_type},
+        source_number{0} { }
+};
+
+class packet_tap : public lifetime_global {
+public:
+    static std::string global_name() { return "PACKETTAP"; }
+
+    static std::shared_ptr<packet_tap> create_packettap() {
+        std::shared_ptr<packet_tap> mon(new packet_tap());
+        Globalreg::globalreg->register_lifetime_global(mon);
+        Globalreg::globalreg->insert_global(global_name(), mon);
+        return mon;
+    }
+
+private:
+    packet_tap();
+
+public:
+    virtual ~packet_tap();
+
+    using tap_cb = std::function<void (kis_packet *)>;
+
+    // Add a subscription; returns the subscription id.  accept_cb, if present, is
+    // called for packets which match the subscription to further filter them.
+    int subscribe(const packet_tap_match& in_match, std::function<bool (kis_packet *)> accept_cb,
+            tap_cb in_cb);
+
+    // Remove a subscription; the callback will not be called again.  If wait is set,
+    // a callback already running on another thread has also finished when this returns;
+    // callers inside the locking chain of the stream a callback writes to should not
+    // wait, but must unsubscribe again with wait set before freeing anything the
+    // callback uses.
+    void unsubscribe(int in_id, bool wait = true);
+
+protected:
+    struct subscription {
+        int id;
+        packet_tap_match match;
+        std::function<bool (kis_packet *)> accept_cb;
+        tap_cb cb;
+
+        // Held while the callback runs
+        kis_recursive_timed_mutex mutex;
+        std::atomic<bool> active;
+
+        subscription(int in_id, const packet_tap_match& in_match) :
+            id{in_id},
+            match{in_match},
+            active{true} { }
+    };
+
+    using sub_vec = std::vector<std::shared_ptr<subscription>>;
+
+    struct sub_index {
+        sub_vec all;
+        std::unordered_map<device_key, sub_vec> by_device;
+        std::unordered_map<unsigned int, sub_vec> by_datasource;
+        std::unordered_map<uint64_t, sub_vec> by_mac;
+    };
+
+    kis_recursive_timed_mutex mutex;
+
+    int next_id;
+    std::unordered_map<int, std::shared_ptr<subscription>> subscriptions;
+
+    // Replaced whole when subscriptions change, read without locking
+    std::shared_ptr<sub_index> index;
+
+    // Rebuild the index from the subscriptions; mutex must be held
+    void rebuild_index();
+
+    std::shared_ptr<packet_chain> packetchain;
+    int pack_comp_device, pack_comp_datasrc, pack_comp_common;
+    int packethandler_id;
+
+    int handle_packet(kis_packet *in_packet);
+
+    void deliver(const std::shared_ptr<subscription>& sub, kis_packet *in_packet);
+};
+
+#endif
+
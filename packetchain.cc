@@ -18,6 +18,8 @@
 
 #include "config.h"
 
+#include <algorithm>
+
 #ifdef HAVE_STDINT_H
 #include <stdint.h>
 #endif
@@ -27,9 +29,12 @@
 
 #include <pthread.h>
 
+#include <chrono>
+
 #include "alertracker.h"
 #include "configfile.h"
 #include "globalregistry.h"
+#include "kis_datasource.h"
 #include "messagebus.h"
 #include "packet.h"
 #include "packetchain.h"
@@ -58,6 +63,15 @@ packet_chain::packet_chain() {
     packet_queue_drop =
         Globalreg::globalreg->kismet_config->fetch_opt_uint("packet_backlog_limit", 8192);
 
+    time_handlers = 
+        Globalreg::globalreg->kismet_config->fetch_opt_bool("packet_chain_handler_timing", false);
+
+    if (time_handlers)
+        _MSG_INFO("Timing packet chain handlers; see /packetchain/handler_timing.json");
+
+    timetracker =
+        Globalreg::fetch_mandatory_global_as<time_tracker>();
+
     auto entrytracker = 
         Globalreg::fetch_mandatory_global_as<entry_tracker>();
 
@@ -134,7 +148,36 @@ packet_chain::packet_chain() {
         std::make_shared<kis_net_httpd_simple_tracked_endpoint>("/packetchain/packet_processed", 
                 packet_processed_rrd, nullptr);
 
+    handler_timing_endpoint =
+        std::make_shared<kis_net_httpd_simple_tracked_endpoint>("/packetchain/handler_timing", 
+                [this]() -> std::shared_ptr<tracker_element> {
+                    auto ret = std::make_shared<tracker_element_vector>();
+
+                    for (const auto& t : fetch_handler_timing()) {
+                        auto h = std::make_shared<packet_chain_handler_stats>();
+
+                        h->set_handler_id(t.id);
+                        h->set_name(t.name);
+                        h->set_chain(t.chain);
+                        h->set_priority(t.priority);
+                        h->set_num_calls(t.num_calls);
+                        h->set_total_ns(t.total_ns);
+                        h->set_mean_ns(t.num_calls > 0 ? (double) t.total_ns / t.num_calls : 0);
+                        h->set_max_ns(t.max_ns);
+
+                        for (auto b : t.hist)
+                            h->get_histogram()->push_back(b);
+
+                        ret->push_back(h);
+                    }
+
+                    return ret;
+                });
+
     packetchain_shutdown = false;
+    packet_queue_sz = 0;
+
+    pack_comp_datasrc = register_packet_component("KISDATASRC");
 
     packet_thread = std::thread([this]() {
             thread_set_process_name("packethandler");
@@ -145,9 +188,18 @@ packet_chain::packet_chain() {
 packet_chain::~packet_chain() {
     {
         // Tell the packet thread we're dying and unlock it
-        packetchain_shutdown = true;
-        packet_queue.enqueue(nullptr);
+        {
+            std::lock_guard<std::mutex> lk(packet_queue_mutex);
+            packetchain_shutdown = true;
+        }
+        packet_queue_cv.notify_all();
         packet_thread.join();
+
+        // Discard anything still queued
+        for (const auto& sqi : source_queues) {
+            for (auto p : sqi.second->packets)
+                destroy_packet(p);
+        }
     }
 
     {
@@ -244,6 +296,82 @@ kis_packet *packet_chain::generate_packet() {
     return newpack;
 }
 
+kis_packet *packet_chain::dequeue_packet() {
+    std::unique_lock<std::mutex> lk(packet_queue_mutex);
+
+    packet_queue_cv.wait(lk, [this]() {
+            return packetchain_shutdown || !active_queues.empty();
+            });
+
+    if (packetchain_shutdown)
+        return nullptr;
+
+    auto sq = active_queues.front();
+
+    // Start a new turn for this source
+    if (sq->credit == 0)
+        sq->credit = sq->priority;
+
+    auto packet = sq->packets.front();
+    sq->packets.pop_front();
+    sq->credit--;
+    packet_queue_sz--;
+
+    if (sq->packets.empty()) {
+        queue_emptied(sq);
+    } else if (sq->credit == 0) {
+        // Turn used up, go to the back of the line
+        active_queues.pop_front();
+        active_queues.push_back(sq);
+    }
+
+    return packet;
+}
+
+void packet_chain::queue_emptied(source_queue *sq) {
+    // Idle sources start a fresh turn when they next queue a packet
+    sq->active = false;
+    sq->credit = 0;
+
+    auto aqi = std::find(active_queues.begin(), active_queues.end(), sq);
+    if (aqi != active_queues.end())
+        active_queues.erase(aqi);
+
+    if (sq->closed)
+        source_queues.erase(sq->source_number);
+}
+
+void packet_chain::remove_source_queue(uint64_t in_source_number) {
+    std::lock_guard<std::mutex> lk(packet_queue_mutex);
+
+    auto sqi = source_queues.find(in_source_number);
+
+    if (sqi == source_queues.end())
+        return;
+
+    if (sqi->second->packets.empty())
+        source_queues.erase(sqi);
+    else
+        sqi->second->closed = true;
+}
+
+bool packet_chain::fetch_source_queue_stats(uint64_t in_source_number, 
+        source_queue_stats& ret) {
+    std::lock_guard<std::mutex> lk(packet_queue_mutex);
+
+    auto sqi = source_queues.find(in_source_number);
+
+    if (sqi == source_queues.end())
+        return false;
+
+    ret.priority = sqi->second->priority;
+    ret.depth = sqi->second->packets.size();
+    ret.queued = sqi->second->queued;
+    ret.dropped = sqi->second->dropped;
+
+    return true;
+}
+
 void packet_chain::packet_queue_processor() {
     kis_packet *packet = NULL;
 
@@ -252,7 +380,7 @@ void packet_chain::packet_queue_processor() {
             !Globalreg::globalreg->fatal_condition &&
             !Globalreg::globalreg->complete) {
 
-        packet_queue.wait_dequeue(packet);
+        packet = dequeue_packet();
 
         if (packet == nullptr)
             break;
@@ -263,75 +391,178 @@ void packet_chain::packet_queue_processor() {
         // These can only be perturbed inside a sync, which can only occur when
         // the worker thread is in the sync block above, so we shouldn't
         // need to worry about the integrity of these vectors while running
+        run_chain(packet, nullptr);
 
-        for (const auto& pcl : postcap_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+        if (packet->error)
+            packet_error_rrd->add_sample(1, server_sec());
 
-        for (const auto& pcl : llcdissect_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+        if (packet->duplicate)
+            packet_dupe_rrd->add_sample(1, server_sec());
 
-        for (const auto& pcl : decrypt_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+        packet_processed_rrd->add_sample(1, server_sec());
 
-        for (const auto& pcl : datadissect_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+        destroy_packet(packet);
 
-        for (const auto& pcl : classifier_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+        continue;
+    }
+}
 
-        for (const auto& pcl : tracker_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+static inline void call_link(packet_chain::pc_link *pcl, kis_packet *in_pack) {
+    if (pcl->callback != NULL)
+        pcl->callback(Globalreg::globalreg, pcl->auxdata, in_pack);
+    else if (pcl->l_callback != NULL)
+        pcl->l_callback(in_pack);
+}
 
-        for (const auto& pcl : logging_chain) {
-            if (pcl->callback != NULL)
-                pcl->callback(Globalreg::globalreg, pcl->auxdata, packet);
-            else if (pcl->l_callback != NULL)
-                pcl->l_callback(packet);
-        }
+static inline void time_link(packet_chain::pc_link *pcl, kis_packet *in_pack) {
+    auto start_tm = std::chrono::steady_clock::now();
 
-        if (packet->error)
-            packet_error_rrd->add_sample(1, time(0));
+    call_link(pcl, in_pack);
 
-        if (packet->duplicate)
-            packet_dupe_rrd->add_sample(1, time(0));
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_tm).count();
 
-        packet_processed_rrd->add_sample(1, time(0));
+    pcl->num_calls++;
+    pcl->total_ns += ns;
 
-        destroy_packet(packet);
+    if (ns > pcl->max_ns)
+        pcl->max_ns = ns;
 
-        continue;
+    // log2 bucket; 0ns lands in bucket 0
+    unsigned int b = 0;
+    while (ns != 0 && b < packet_chain::handler_hist_buckets - 1) {
+        ns >>= 1;
+        b++;
     }
+
+    pcl->hist[b]++;
+}
+
+void packet_chain::run_chain(kis_packet *in_pack, uint64_t *stage_ns) {
+    const std::vector<pc_link *> *chains[] = {
+        &postcap_chain, &llcdissect_chain, &decrypt_chain, &datadissect_chain,
+        &classifier_chain, &tracker_chain, &logging_chain
+    };
+
+    bool timing = time_handlers;
+
+    for (unsigned int c = 0; c < chain_stages; c++) {
+        std::chrono::steady_clock::time_point start_tm;
+
+        if (stage_ns != nullptr)
+            start_tm = std::chrono::steady_clock::now();
+
+        if (timing) {
+            for (const auto& pcl : *chains[c])
+                time_link(pcl, in_pack);
+        } else {
+            for (const auto& pcl : *chains[c])
+                call_link(pcl, in_pack);
+        }
+
+        if (stage_ns != nullptr)
+            stage_ns[c] += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_tm).count();
+    }
+}
+
+void packet_chain::process_packet_inline(kis_packet *in_pack, uint64_t *stage_ns) {
+    {
+        local_locker chainl(&packetchain_mutex, "packet_chain::process_packet_inline");
+        run_chain(in_pack, stage_ns);
+    }
+
+    destroy_packet(in_pack);
+}
+
+std::string packet_chain::chain_stage_name(unsigned int in_stage) {
+    static const char *names[] = {
+        "postcap", "llcdissect", "decrypt", "datadissect",
+        "classifier", "tracker", "logging"
+    };
+
+    if (in_stage >= chain_stages)
+        return "unknown";
+
+    return names[in_stage];
 }
 
 int packet_chain::process_packet(kis_packet *in_pack) {
     // Total packet rate always gets added, even when we drop, so we can compare
-    packet_rate_rrd->add_sample(1, time(0));
+    packet_rate_rrd->add_sample(1, server_sec());
+
+    uint64_t source_number = 0;
+    unsigned int priority = 1;
+
+    auto datasrc = in_pack->fetch<packetchain_comp_datasource>(pack_comp_datasrc);
+    if (datasrc != nullptr && datasrc->ref_source != nullptr) {
+        source_number = datasrc->ref_source->get_source_number();
+        priority = datasrc->ref_source->get_queue_priority();
+    }
+
+    kis_packet *drop_pack = nullptr;
+    size_t queue_sz;
+
+    {
+        std::lock_guard<std::mutex> lk(packet_queue_mutex);
+
+        auto& sqp = source_queues[source_number];
+
+        if (sqp == nullptr) {
+            sqp.reset(new source_queue());
+            sqp->source_number = source_number;
+            sqp->credit = 0;
+            sqp->active = false;
+            sqp->closed = false;
+            sqp->queued = 0;
+            sqp->dropped = 0;
+        }
+
+        auto sq = sqp.get();
+        sq->priority = priority;
+
+        // A source which closed and re-opened before its queue drained keeps it
+        sq->closed = false;
+
+        if (packet_queue_drop != 0 && packet_queue_sz >= packet_queue_drop) {
+            // Drop from whichever source has the longest backlog, so that a source
+            // flooding the queue doesn't cost the other sources their packets
+            source_queue *longest = sq;
+
+            for (auto aq : active_queues) {
+                if (aq->packets.size() > longest->packets.size())
+                    longest = aq;
+            }
+
+            longest->dropped++;
+
+            if (longest == sq) {
+                drop_pack = in_pack;
+            } else {
+                drop_pack = longest->packets.front();
+                longest->packets.pop_front();
+                packet_queue_sz--;
+
+                if (longest->packets.empty())
+                    queue_emptied(longest);
+            }
+        }
+
+        if (drop_pack != in_pack) {
+            sq->packets.push_back(in_pack);
+            sq->queued++;
+            packet_queue_sz++;
+
+            if (!sq->active) {
+                sq->active = true;
+                active_queues.push_back(sq);
+            }
+        }
+
+        queue_sz = packet_queue_sz;
+    }
 
-    if (packet_queue_drop != 0 && packet_queue.size_approx() > packet_queue_drop) {
+    if (drop_pack != nullptr) {
         time_t offt = time(0) - last_packet_drop_user_warning;
 
         if (offt > 30) {
@@ -341,20 +572,22 @@ int packet_chain::process_packet(kis_packet *in_pack) {
                 Globalreg::fetch_mandatory_global_as<alert_tracker>();
             alertracker->raise_one_shot("PACKETLOST", 
                     fmt::format("The packet queue has exceeded the maximum size of {}; Kismet "
-                        "will start dropping packets.  Your system may not have enough CPU to keep "
+                        "will start dropping packets from the data sources with the largest "
+                        "backlog.  Your system may not have enough CPU to keep "
                         "up with the packet rate in your environment or other processes may be "
                         "taking up the CPU.  You can increase the packet backlog with the "
                         "packet_backlog_limit configuration parameter.", packet_queue_drop), -1);
         }
 
-        destroy_packet(in_pack);
-
-        packet_drop_rrd->add_sample(1, time(0));
+        destroy_packet(drop_pack);
 
-        return 1;
+        packet_drop_rrd->add_sample(1, server_sec());
     }
 
-    if (packet_queue.size_approx() > packet_queue_warning && packet_queue_warning != 0) {
+    if (drop_pack != in_pack)
+        packet_queue_cv.notify_one();
+
+    if (queue_sz > packet_queue_warning && packet_queue_warning != 0) {
         time_t offt = time(0) - last_packet_queue_user_warning;
 
         if (offt > 30) {
@@ -370,15 +603,17 @@ int packet_chain::process_packet(kis_packet *in_pack) {
         }
     }
 
-
-    // Queue the packet
-    packet_queue.enqueue(in_pack);
-
-    packet_queue_rrd->add_sample(packet_queue.size_approx(), time(0));
+    packet_queue_rrd->add_sample(queue_sz, server_sec());
 
     return 1;
 }
 
+time_t packet_chain::server_sec() {
+    struct timeval tv;
+    timetracker->now(&tv);
+    return tv.tv_sec;
+}
+
 void packet_chain::destroy_packet(kis_packet *in_pack) {
 
 	delete in_pack;
@@ -386,7 +621,7 @@ void packet_chain::destroy_packet(kis_packet *in_pack) {
 
 int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
         std::function<int (kis_packet *)> in_l_cb, 
-        int in_chain, int in_prio) {
+        int in_chain, int in_prio, const std::string& in_name) {
 
     local_locker l(&packetchain_mutex);
 
@@ -400,6 +635,16 @@ int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
     link->auxdata = in_aux;
     link->id = next_handlerid++;
 
+    if (in_name.length() > 0)
+        link->name = in_name;
+    else
+        link->name = fmt::format("{}_{}", chain_stage_name(in_chain - CHAINPOS_POSTCAP), link->id);
+
+    link->num_calls = 0;
+    link->total_ns = 0;
+    link->max_ns = 0;
+    memset(link->hist, 0, sizeof(link->hist));
+
     switch (in_chain) {
         case CHAINPOS_POSTCAP:
             postcap_chain.push_back(link);
@@ -452,12 +697,63 @@ int packet_chain::register_int_handler(pc_callback in_cb, void *in_aux,
     return link->id;
 }
 
-int packet_chain::register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio) {
-    return register_int_handler(in_cb, in_aux, NULL, in_chain, in_prio);
+int packet_chain::register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio,
+        const std::string& in_name) {
+    return register_int_handler(in_cb, in_aux, NULL, in_chain, in_prio, in_name);
 }
 
-int packet_chain::register_handler(std::function<int (kis_packet *)> in_cb, int in_chain, int in_prio) {
-    return register_int_handler(NULL, NULL, in_cb, in_chain, in_prio);
+int packet_chain::register_handler(std::function<int (kis_packet *)> in_cb, int in_chain, int in_prio,
+        const std::string& in_name) {
+    return register_int_handler(NULL, NULL, in_cb, in_chain, in_prio, in_name);
+}
+
+void packet_chain::set_handler_timing(bool in_enable) {
+    local_locker l(&packetchain_mutex, "packet_chain::set_handler_timing");
+
+    if (in_enable && !time_handlers) {
+        for (auto chain : { &postcap_chain, &llcdissect_chain, &decrypt_chain, &datadissect_chain,
+                &classifier_chain, &tracker_chain, &logging_chain }) {
+            for (auto pcl : *chain) {
+                pcl->num_calls = 0;
+                pcl->total_ns = 0;
+                pcl->max_ns = 0;
+                memset(pcl->hist, 0, sizeof(pcl->hist));
+            }
+        }
+    }
+
+    time_handlers = in_enable;
+}
+
+std::vector<packet_chain::handler_timing> packet_chain::fetch_handler_timing() {
+    std::vector<handler_timing> ret;
+
+    // The chain is stalled while the counters are copied
+    local_locker l(&packetchain_mutex, "packet_chain::fetch_handler_timing");
+
+    const std::vector<pc_link *> *chains[] = {
+        &postcap_chain, &llcdissect_chain, &decrypt_chain, &datadissect_chain,
+        &classifier_chain, &tracker_chain, &logging_chain
+    };
+
+    for (unsigned int c = 0; c < chain_stages; c++) {
+        for (auto pcl : *chains[c]) {
+            handler_timing t;
+
+            t.id = pcl->id;
+            t.name = pcl->name;
+            t.chain = chain_stage_name(c);
+            t.priority = pcl->priority;
+            t.num_calls = pcl->num_calls;
+            t.total_ns = pcl->total_ns;
+            t.max_ns = pcl->max_ns;
+            t.hist.assign(pcl->hist, pcl->hist + handler_hist_buckets);
+
+            ret.push_back(t);
+        }
+    }
+
+    return ret;
 }
 
 int packet_chain::remove_handler(int in_id, int in_chain) {
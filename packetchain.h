@@ -29,21 +29,27 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
 #include <functional>
 #include <queue>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <unordered_map>
 
 #include "globalregistry.h"
 #include "kis_mutex.h"
 #include "kis_net_microhttpd.h"
+#include "timetracker.h"
+#include "trackedcomponent.h"
 #include "trackedelement.h"
 #include "trackedrrd.h"
 
-#include "moodycamel/blockingconcurrentqueue.h"
-
 /* Packets are added to the packet queue from any thread (including the main 
  * thread).
  *
@@ -117,7 +123,35 @@ public:
     int process_packet(kis_packet *in_pack);
     // Destroy a packet at the end of its life
     void destroy_packet(kis_packet *in_pack);
+
+    // Run a packet through every chain on the calling thread, bypassing the packet
+    // queue, and destroy it.  If stage_ns is not null, the time spent in each chain
+    // stage is added to stage_ns[0 .. chain_stages - 1].  Used by the benchmark
+    // harness; datasources should always use process_packet.
+    static const unsigned int chain_stages = 7;
+    void process_packet_inline(kis_packet *in_pack, uint64_t *stage_ns = nullptr);
+    static std::string chain_stage_name(unsigned int in_stage);
+
+    // Queue state of a single datasource
+    struct source_queue_stats {
+        unsigned int priority;
+        size_t depth;
+        uint64_t queued;
+        uint64_t dropped;
+    };
+
+    // Fetch the queue state of a datasource by source number; returns false if the
+    // source has never queued a packet
+    bool fetch_source_queue_stats(uint64_t in_source_number, source_queue_stats& ret);
+
+    // Release the queue of a closed datasource; a queue still holding packets is
+    // released once they have been processed
+    void remove_source_queue(uint64_t in_source_number);
  
+    // Handler timing histograms are log2 buckets of nanoseconds; bucket n counts
+    // calls which took [2^(n-1), 2^n) ns, and the last bucket everything longer
+    static const unsigned int handler_hist_buckets = 32;
+
     // Callback and information 
     typedef int (*pc_callback)(CHAINCALL_PARMS);
     typedef struct {
@@ -126,21 +160,57 @@ public:
         std::function<int (kis_packet *)> l_callback;
         void *auxdata;
 		int id;
+        std::string name;
+
+        // Timing, when enabled; only modified with the chain mutex held
+        uint64_t num_calls;
+        uint64_t total_ns;
+        uint64_t max_ns;
+        uint64_t hist[handler_hist_buckets];
     } pc_link;
 
-    // Register a callback, aux data, a chain to put it in, and the priority 
-    int register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio);
-    int register_handler(std::function<int (kis_packet *)> in_cb, int in_chain, int in_prio);
+    // Register a callback, aux data, a chain to put it in, and the priority.  The
+    // name identifies the handler in the timing stats; unnamed handlers are reported
+    // by chain and handler id.
+    int register_handler(pc_callback in_cb, void *in_aux, int in_chain, int in_prio,
+            const std::string& in_name = "");
+    int register_handler(std::function<int (kis_packet *)> in_cb, int in_chain, int in_prio,
+            const std::string& in_name = "");
     int remove_handler(pc_callback in_cb, int in_chain);
 	int remove_handler(int in_id, int in_chain);
 
+    // Timing of a single handler
+    struct handler_timing {
+        int id;
+        std::string name;
+        std::string chain;
+        int priority;
+        uint64_t num_calls;
+        uint64_t total_ns;
+        uint64_t max_ns;
+        std::vector<uint64_t> hist;
+    };
+
+    // Per-handler timing is off unless packet_chain_handler_timing is set in the
+    // config, or it is turned on here; turning it on clears the previous timing
+    void set_handler_timing(bool in_enable);
+    bool get_handler_timing() { return time_handlers; }
+
+    // Timing of every handler, in chain order
+    std::vector<handler_timing> fetch_handler_timing();
+
 protected:
     void packet_queue_processor();
 
+    // Call every handler of every chain, in chain order
+    void run_chain(kis_packet *in_pack, uint64_t *stage_ns);
+
+    std::atomic<bool> time_handlers;
+
     // Common function for both insertion methods
     int register_int_handler(pc_callback in_cb, void *in_aux, 
             std::function<int (kis_packet *)> in_l_cb, 
-            int in_chain, int in_prio);
+            int in_chain, int in_prio, const std::string& in_name);
 
     int next_componentid, next_handlerid;
 
@@ -164,13 +234,57 @@ protected:
 
     std::thread packet_thread;
 
-    moodycamel::BlockingConcurrentQueue<kis_packet *> packet_queue;
     bool packetchain_shutdown;
 
+    // Packets are queued per datasource and dequeued by weighted round robin, so
+    // that a busy source can't starve a quiet one:  each turn, a source may have up
+    // to its priority in packets processed before moving on to the next source with
+    // queued packets.  When the backlog limit is reached the packet dropped comes
+    // from the source with the longest queue.
+    //
+    // Packets without a datasource are queued as source 0.
+    struct source_queue {
+        uint64_t source_number;
+        unsigned int priority;
+        std::deque<kis_packet *> packets;
+
+        // Packets left in the current turn
+        unsigned int credit;
+        // In the list of queues with packets
+        bool active;
+        // Source has closed; the queue is removed when it empties
+        bool closed;
+
+        uint64_t queued;
+        uint64_t dropped;
+    };
+
+    std::mutex packet_queue_mutex;
+    std::condition_variable packet_queue_cv;
+    std::unordered_map<uint64_t, std::unique_ptr<source_queue>> source_queues;
+    std::deque<source_queue *> active_queues;
+    size_t packet_queue_sz;
+
+    // Take a queue which has just emptied out of the active list, and release it if
+    // its source has closed; packet_queue_mutex must be held
+    void queue_emptied(source_queue *sq);
+
+    int pack_comp_datasrc;
+
+    // Wait for the next packet in the scheduling order; returns nullptr when the
+    // chain is shutting down
+    kis_packet *dequeue_packet();
+
     // Warning and discard levels for packet queue being full
     unsigned int packet_queue_warning, packet_queue_drop;
     time_t last_packet_queue_user_warning, last_packet_drop_user_warning;
 
+    // Current server time for the rrds, which follows the virtual clock during replay
+    // so the packet rates line up with the replayed packets; the warning intervals
+    // stay on the system clock
+    std::shared_ptr<time_tracker> timetracker;
+    time_t server_sec();
+
     std::shared_ptr<kis_tracked_rrd<>> packet_rate_rrd;
     int packet_rate_rrd_id;
 
@@ -198,6 +312,97 @@ protected:
     std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> packet_queue_endpoint;
     std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> packet_drop_endpoint;
     std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> packet_processed_endpoint;
+    std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> handler_timing_endpoint;
+};
+
+// Timing of a packet chain handler, for the REST interface
+class packet_chain_handler_stats : public tracker_component {
+public:
+    packet_chain_handler_stats() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    packet_chain_handler_stats(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    packet_chain_handler_stats(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    packet_chain_handler_stats(const packet_chain_handler_stats *p) :
+        tracker_component{p} {
+
+        __ImportField(handler_id, p);
+        __ImportField(name, p);
+        __ImportField(chain, p);
+        __ImportField(priority, p);
+        __ImportField(num_calls, p);
+        __ImportField(total_ns, p);
+        __ImportField(mean_ns, p);
+        __ImportField(max_ns, p);
+        __ImportField(histogram, p);
+
+        reserve_fields(nullptr);
+    }
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("packet_chain_handler_stats");
+    }
+
+    virtual std::unique_ptr<tracker_element> clone_type() override {
+        using this_t = std::remove_pointer<decltype(this)>::type;
+        auto dup = std::unique_ptr<this_t>(new this_t(this));
+        return std::move(dup);
+    }
+
+    __Proxy(handler_id, int64_t, int64_t, int64_t, handler_id);
+    __Proxy(name, std::string, std::string, std::string, name);
+    __Proxy(chain, std::string, std::string, std::string, chain);
+    __Proxy(priority, int64_t, int64_t, int64_t, priority);
+    __Proxy(num_calls, uint64_t, uint64_t, uint64_t, num_calls);
+    __Proxy(total_ns, uint64_t, uint64_t, uint64_t, total_ns);
+    __Proxy(mean_ns, double, double, double, mean_ns);
+    __Proxy(max_ns, uint64_t, uint64_t, uint64_t, max_ns);
+
+    std::shared_ptr<tracker_element_vector_double> get_histogram() { return histogram; }
+
+protected:
+    virtual void register_fields() override {
+        tracker_component::register_fields();
+
+        register_field("kismet.packetchain.handler.id", "handler id", &handler_id);
+        register_field("kismet.packetchain.handler.name", "handler name", &name);
+        register_field("kismet.packetchain.handler.chain", "packet chain stage", &chain);
+        register_field("kismet.packetchain.handler.priority", "priority within the chain stage",
+                &priority);
+        register_field("kismet.packetchain.handler.calls", "timed calls", &num_calls);
+        register_field("kismet.packetchain.handler.total_ns", "total time, in nanoseconds",
+                &total_ns);
+        register_field("kismet.packetchain.handler.mean_ns", "mean time per call, in nanoseconds",
+                &mean_ns);
+        register_field("kismet.packetchain.handler.max_ns", "longest call, in nanoseconds",
+                &max_ns);
+        register_field("kismet.packetchain.handler.histogram",
+                "calls per log2 nanosecond bucket; bucket n counts calls of [2^(n-1), 2^n) ns",
+                &histogram);
+    }
+
+    std::shared_ptr<tracker_element_int64> handler_id;
+    std::shared_ptr<tracker_element_string> name;
+    std::shared_ptr<tracker_element_string> chain;
+    std::shared_ptr<tracker_element_int64> priority;
+    std::shared_ptr<tracker_element_uint64> num_calls;
+    std::shared_ptr<tracker_element_uint64> total_ns;
+    std::shared_ptr<tracker_element_double> mean_ns;
+    std::shared_ptr<tracker_element_uint64> max_ns;
+    std::shared_ptr<tracker_element_vector_double> histogram;
 };
 
 #endif
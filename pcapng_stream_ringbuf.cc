@@ -567,27 +567,36 @@ pcap_stream_packetchain::pcap_stream_packetchain(global_registry *in_globalreg,
         std::shared_ptr<buffer_handler_generic> in_handler,
         std::function<bool (kis_packet *)> accept_filter,
         std::function<kis_datachunk * (kis_packet *)> data_selector) :
-    pcap_stream_ringbuf(in_globalreg, in_handler, accept_filter, data_selector, false) {
+    pcap_stream_packetchain(in_globalreg, in_handler, packet_tap_match::all(), 
+            accept_filter, data_selector) { }
 
-    packethandler_id = packetchain->register_handler([this](kis_packet *packet) {
+pcap_stream_packetchain::pcap_stream_packetchain(global_registry *in_globalreg,
+        std::shared_ptr<buffer_handler_generic> in_handler,
+        const packet_tap_match& tap_match,
+        std::function<bool (kis_packet *)> accept_filter,
+        std::function<kis_datachunk * (kis_packet *)> data_selector) :
+    pcap_stream_ringbuf(in_globalreg, in_handler, nullptr, data_selector, false) {
+
+    packettap = Globalreg::fetch_mandatory_global_as<packet_tap>();
+
+    // The tap applies the accept filter after matching, so it is only called for
+    // packets this stream could want
+    tap_id = packettap->subscribe(tap_match, accept_filter, [this](kis_packet *packet) {
             handle_packet(packet);
-            return 1;
-        }, CHAINPOS_LOGGING, -100);
+        });
 }
 
 pcap_stream_packetchain::~pcap_stream_packetchain() {
-    packetchain->remove_handler(packethandler_id, CHAINPOS_LOGGING);
+    packettap->unsubscribe(tap_id);
     handler->protocol_error();
 }
 
 void pcap_stream_packetchain::stop_stream(std::string in_reason) {
-    // We have to spawn a thread to deal with this because we're inside the locking
-    // chain of the buffer handler when we get a stream stop event, sometimes
-    std::thread t([this]() {
-            packetchain->remove_handler(packethandler_id, CHAINPOS_LOGGING);
-            });
+    // We're sometimes inside the locking chain of the buffer handler when we get a 
+    // stream stop event, so don't wait for a packet being written to finish; the
+    // destructor waits for it before the stream is freed
+    packettap->unsubscribe(tap_id, false);
 
     pcap_stream_ringbuf::stop_stream(in_reason);
-    t.join();
 }
 
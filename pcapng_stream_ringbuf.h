@@ -37,6 +37,7 @@
 #include "globalregistry.h"
 #include "packetchain.h"
 #include "kis_datasource.h"
+#include "packet_tap.h"
 #include "streamtracker.h"
 #include "pcapng.h"
 
@@ -127,6 +128,9 @@ protected:
     kis_recursive_timed_mutex required_bytes_mutex;
 };
 
+// Stream fed from the shared packet tap; streams which follow a single device, 
+// datasource, or address should pass a tap match so that they only see the packets
+// which match, and use the accept filter only to refine it.
 class pcap_stream_packetchain : public pcap_stream_ringbuf {
 public:
     pcap_stream_packetchain(global_registry *in_globalreg, 
@@ -134,12 +138,19 @@ public:
             std::function<bool (kis_packet *)> accept_filter,
             std::function<kis_datachunk * (kis_packet *)> data_selector);
 
+    pcap_stream_packetchain(global_registry *in_globalreg, 
+            std::shared_ptr<buffer_handler_generic> in_handler,
+            const packet_tap_match& tap_match,
+            std::function<bool (kis_packet *)> accept_filter,
+            std::function<kis_datachunk * (kis_packet *)> data_selector);
+
     virtual ~pcap_stream_packetchain();
 
     virtual void stop_stream(std::string in_reason) override;
 
 protected:
-    int packethandler_id;
+    std::shared_ptr<packet_tap> packettap;
+    int tap_id;
 
 };
 
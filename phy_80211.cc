@@ -54,11 +54,17 @@
 #include "kis_httpd_registry.h"
 
 #include "boost_like_hash.h"
+#include "json_fields.h"
 
 #ifdef HAVE_LIBPCRE
 #include <pcre.h>
 #endif
 
+// Fields of the Wi-Fi scan report JSON used by the classifier
+static const kis_json_fields::key_set dot11_scan_json_fields {
+    "bssid", "ssid", "ietags", "chanwidth", "capabilities", "centerfreq0", "centerfreq1"
+};
+
 // static std::atomic<int> packetnum {0};
 
 // Convert the beacon interval to # of packets per second
@@ -112,13 +118,13 @@ kis_80211_phy::kis_80211_phy(global_registry *in_globalreg, int in_phyid) :
 
         // Packet classifier - makes basic records plus dot11 data
         packetchain->register_handler(&packet_dot11_common_classifier, this,
-                CHAINPOS_CLASSIFIER, -100);
+                CHAINPOS_CLASSIFIER, -100, "dot11_classifier");
         packetchain->register_handler(&packet_dot11_scan_json_classifier, this,
-                CHAINPOS_CLASSIFIER, -99);
+                CHAINPOS_CLASSIFIER, -99, "dot11_scan_classifier");
         packetchain->register_handler(&phydot11_packethook_wep, this,
-                CHAINPOS_DECRYPT, -100);
+                CHAINPOS_DECRYPT, -100, "dot11_wep_decrypt");
         packetchain->register_handler(&phydot11_packethook_dot11, this,
-                CHAINPOS_LLCDISSECT, -100);
+                CHAINPOS_LLCDISSECT, -100, "dot11_dissector");
 
         // If we haven't registered packet components yet, do so.  We have to
         // co-exist with the old tracker core for some time
@@ -970,7 +976,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
         d11phy->alertracker->raise_alert(d11phy->alert_tooloud_ref, in_pack, 
                 dot11info->bssid_mac, dot11info->source_mac, 
                 dot11info->dest_mac, dot11info->other_mac, 
-                dot11info->channel, ss.str());
+                dot11info->channel.str(), ss.str());
     }
 
     // Do nothing if it's corrupt
@@ -1077,7 +1083,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
 
             bssid_dot11->set_last_bssid(bssid_dev->get_macaddr());
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 bssid_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != bssid_dev->get_frequency() ||
                     bssid_dev->get_channel() == "")) {
@@ -1164,7 +1170,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                                 in_pack,
                                 dot11info->bssid_mac, dot11info->source_mac,
                                 dot11info->dest_mac, dot11info->other_mac,
-                                dot11info->channel,
+                                dot11info->channel.str(),
                                 fmt::format("Network {} BSS timestamp fluctuating.  This may indicate "
                                     "an 'evil twin' style attack where the BSSID of a legitimate AP "
                                     "is being spoofed.", bssid_dev->get_macaddr()));
@@ -1222,7 +1228,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 source_dot11->set_last_bssid(mac_addr());
             }
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 source_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != source_dev->get_frequency() ||
                     source_dev->get_channel() == "")) {
@@ -1282,7 +1288,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                     return d11phy->devicetracker->get_cached_devicetype("Wi-Fi Client");
                     }, KIS_DEVICE_BASICTYPE_AP);
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 dest_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != dest_dev->get_frequency() ||
                     dest_dev->get_channel() == "")) {
@@ -1333,7 +1339,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                         d11phy->alertracker->raise_alert(d11phy->alert_deauthflood_ref, in_pack,
                             dot11info->bssid_mac, dot11info->source_mac,
                             dot11info->dest_mac, dot11info->other_mac,
-                            dot11info->channel, al);
+                            dot11info->channel.str(), al);
                     }
 
                     bssid_dot11->set_client_disconnects(1);
@@ -1354,7 +1360,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 d11phy->alertracker->raise_alert(d11phy->alert_bcastdcon_ref, in_pack, 
                         dot11info->bssid_mac, dot11info->source_mac, 
                         dot11info->dest_mac, dot11info->other_mac, 
-                        dot11info->channel, al);
+                        dot11info->channel.str(), al);
             }
         }
     } else if (dot11info->type == packet_phy) {
@@ -1450,7 +1456,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
 
             bssid_dot11->set_last_bssid(bssid_dev->get_macaddr());
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 bssid_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != bssid_dev->get_frequency() ||
                     bssid_dev->get_channel() == "")) {
@@ -1485,7 +1491,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                     d11phy->alertracker->raise_alert(d11phy->alert_adhoc_ref, in_pack,
                             dot11info->bssid_mac, dot11info->source_mac,
                             dot11info->dest_mac, dot11info->other_mac,
-                            dot11info->channel, al);
+                            dot11info->channel.str(), al);
                 }
             }
 
@@ -1528,7 +1534,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
             else
                 source_dot11->set_last_bssid(mac_addr());
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 source_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != source_dev->get_frequency() ||
                     source_dev->get_channel() == "")) {
@@ -1604,7 +1610,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                                 in_pack, 
                                 dot11info->bssid_mac, dot11info->source_mac, 
                                 dot11info->dest_mac, dot11info->other_mac, 
-                                dot11info->channel, al);
+                                dot11info->channel.str(), al);
                     }
 
                     source_dot11->set_wps_m3_count(1);
@@ -1631,7 +1637,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 dot11info->new_device = true;
             }
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 dest_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != dest_dev->get_frequency() ||
                     dest_dev->get_channel() == "")) {
@@ -1693,7 +1699,7 @@ int kis_80211_phy::packet_dot11_common_classifier(CHAINCALL_PARMS) {
                 dot11info->new_device = true;
             }
 
-            if (dot11info->channel != "0" && dot11info->channel != "") {
+            if (kis_atom_channel_known(dot11info->channel)) {
                 other_dev->set_channel(dot11info->channel);
             } else if (pack_l1info != NULL && (pack_l1info->freq_khz != other_dev->get_frequency() ||
                     other_dev->get_channel() == "")) {
@@ -1785,9 +1791,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
     // "centerfreq1": Center frequency 1
 
     try {
-        std::stringstream ss(pack_json->json_string);
-        Json::Value json;
-        ss >> json;
+        kis_json_fields json(pack_json->json_string, dot11_scan_json_fields);
 
         auto bssid_j = json["bssid"];
         auto ssid_j = json["ssid"];
@@ -1859,7 +1863,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
 
         bssid_dot11->set_last_bssid(bssid_dev->get_macaddr());
 
-        if (pack_l1info->channel != "" && pack_l1info->channel != "0") {
+        if (kis_atom_channel_known(pack_l1info->channel)) {
             bssid_dev->set_channel(pack_l1info->channel);
         } else if (pack_l1info->freq_khz != bssid_dev->get_frequency() ||
                 bssid_dev->get_channel() == "") {
@@ -2004,7 +2008,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
                 d11phy->alertracker->raise_alert(d11phy->alert_airjackssid_ref, in_pack, 
                         commoninfo->network, commoninfo->source,
                         commoninfo->dest, commoninfo->transmitter,
-                        commoninfo->channel, al);
+                        commoninfo->channel.str(), al);
             }
 
             if (ssid->get_ssid() != "") {
@@ -2032,7 +2036,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
                                 commoninfo->source,
                                 commoninfo->dest,
                                 commoninfo->transmitter,
-                                commoninfo->channel, al);
+                                commoninfo->channel.str(), al);
                         break;
                     }
                 }
@@ -2067,7 +2071,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
                 d11phy->alertracker->raise_alert(d11phy->alert_wepflap_ref, in_pack, 
                         commoninfo->network, commoninfo->source, 
                         commoninfo->dest, commoninfo->transmitter, 
-                        commoninfo->channel, al);
+                        commoninfo->channel.str(), al);
             } else if (ssid->get_crypt_set() != cryptset &&
                     d11phy->alertracker->potential_alert(d11phy->alert_cryptchange_ref)) {
 
@@ -2080,15 +2084,15 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
                 d11phy->alertracker->raise_alert(d11phy->alert_cryptchange_ref, in_pack, 
                         commoninfo->network, commoninfo->source, 
                         commoninfo->dest, commoninfo->transmitter, 
-                        commoninfo->channel, al);
+                        commoninfo->channel.str(), al);
             }
 
             ssid->set_crypt_set(cryptset);
             bssid_dev->set_crypt_string(crypt_to_simple_string(cryptset));
         }
 
-        if (ssid->get_channel().length() > 0 &&
-                ssid->get_channel() != commoninfo->channel && commoninfo->channel != "0") {
+        if (!ssid->get_channel_atom().empty() &&
+                ssid->get_channel_atom() != commoninfo->channel && commoninfo->channel != kis_atom::from_uint(0)) {
 
             auto al = 
                 fmt::format("IEEE80211 Access Point BSSID {} SSID \"{}\" changed advertised "
@@ -2100,7 +2104,7 @@ int kis_80211_phy::packet_dot11_scan_json_classifier(CHAINCALL_PARMS) {
             d11phy->alertracker->raise_alert(d11phy->alert_chan_ref, in_pack, 
                         commoninfo->network, commoninfo->source, 
                         commoninfo->dest, commoninfo->transmitter, 
-                        commoninfo->channel, al);
+                        commoninfo->channel.str(), al);
 
             ssid->set_channel(commoninfo->channel); 
         }
@@ -2215,7 +2219,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
 
     }
 
-    if (dot11info->channel != "0" && dot11info->channel != "") {
+    if (kis_atom_channel_known(dot11info->channel)) {
         basedev->set_channel(dot11info->channel);
     }
 
@@ -2379,7 +2383,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             alertracker->raise_alert(alert_airjackssid_ref, in_pack, 
                     dot11info->bssid_mac, dot11info->source_mac, 
                     dot11info->dest_mac, dot11info->other_mac, 
-                    dot11info->channel, al);
+                    dot11info->channel.str(), al);
         }
 
         if (ssid->get_ssid() != "") {
@@ -2412,7 +2416,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
                             dot11info->source_mac, 
                             dot11info->dest_mac, 
                             dot11info->other_mac, 
-                            dot11info->channel, al);
+                            dot11info->channel.str(), al);
                     break;
                 }
             }
@@ -2568,7 +2572,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
                 alertracker->raise_alert(alert_l33t_ref, in_pack, 
                         dot11info->bssid_mac, dot11info->source_mac, 
                         dot11info->dest_mac, dot11info->other_mac, 
-                        dot11info->channel, al);
+                        dot11info->channel.str(), al);
             }
 
         }
@@ -2589,7 +2593,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             alertracker->raise_alert(alert_wepflap_ref, in_pack, 
                     dot11info->bssid_mac, dot11info->source_mac, 
                     dot11info->dest_mac, dot11info->other_mac, 
-                    dot11info->channel, al);
+                    dot11info->channel.str(), al);
         } else if (ssid->get_crypt_set() != dot11info->cryptset &&
                 alertracker->potential_alert(alert_cryptchange_ref)) {
 
@@ -2601,15 +2605,15 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             alertracker->raise_alert(alert_cryptchange_ref, in_pack, 
                     dot11info->bssid_mac, dot11info->source_mac, 
                     dot11info->dest_mac, dot11info->other_mac, 
-                    dot11info->channel, al);
+                    dot11info->channel.str(), al);
         }
 
         ssid->set_crypt_set(dot11info->cryptset);
         basedev->set_crypt_string(crypt_to_simple_string(dot11info->cryptset));
     }
 
-    if (ssid->get_channel().length() > 0 &&
-            ssid->get_channel() != dot11info->channel && dot11info->channel != "0") {
+    if (!ssid->get_channel_atom().empty() &&
+            ssid->get_channel_atom() != dot11info->channel && dot11info->channel != kis_atom::from_uint(0)) {
 
         if (dot11info->subtype == packet_sub_beacon) {
             auto al = 
@@ -2621,7 +2625,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             alertracker->raise_alert(alert_chan_ref, in_pack, 
                     dot11info->bssid_mac, dot11info->source_mac, 
                     dot11info->dest_mac, dot11info->other_mac, 
-                    dot11info->channel, al);
+                    dot11info->channel.str(), al);
 
             ssid->set_channel(dot11info->channel); 
         } else if (dot11info->subtype == packet_sub_probe_resp) {
@@ -2634,7 +2638,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             alertracker->raise_alert(alert_probechan_ref, in_pack,
                     dot11info->bssid_mac, dot11info->source_mac, 
                     dot11info->dest_mac, dot11info->other_mac, 
-                    dot11info->channel, al);
+                    dot11info->channel.str(), al);
         }
     }
 
@@ -2679,7 +2683,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
                 alertracker->raise_alert(alert_dot11d_ref, in_pack, 
                         dot11info->bssid_mac, dot11info->source_mac, 
                         dot11info->dest_mac, dot11info->other_mac, 
-                        dot11info->channel, al);
+                        dot11info->channel.str(), al);
 
             }
         }
@@ -2721,7 +2725,7 @@ void kis_80211_phy::handle_ssid(std::shared_ptr<kis_tracked_device_base> basedev
             alertracker->raise_alert(alert_beaconrate_ref, in_pack, 
                     dot11info->bssid_mac, dot11info->source_mac, 
                     dot11info->dest_mac, dot11info->other_mac, 
-                    dot11info->channel, al);
+                    dot11info->channel.str(), al);
         }
 
         ssid->set_beaconrate(Ieee80211Interval2NSecs(dot11info->beacon_interval));
@@ -2979,7 +2983,7 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
                     alertracker->raise_alert(alert_noclientmfp_ref, in_pack,
                             dot11info->bssid_mac, dot11info->source_mac,
                             dot11info->dest_mac, dot11info->other_mac,
-                            dot11info->channel, al);
+                            dot11info->channel.str(), al);
                 }
             }
 
@@ -3015,7 +3019,7 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
                         alertracker->raise_alert(alert_dhcpos_ref, in_pack,
                                 dot11info->bssid_mac, dot11info->source_mac,
                                 dot11info->dest_mac, dot11info->other_mac,
-                                dot11info->channel, al);
+                                dot11info->channel.str(), al);
                     }
 
                     client_record->set_dhcp_vendor(pack_datainfo->discover_vendor);
@@ -3037,7 +3041,7 @@ void kis_80211_phy::process_client(std::shared_ptr<kis_tracked_device_base> bssi
                         alertracker->raise_alert(alert_dhcpname_ref, in_pack,
                                 dot11info->bssid_mac, dot11info->source_mac,
                                 dot11info->dest_mac, dot11info->other_mac,
-                                dot11info->channel, al);
+                                dot11info->channel.str(), al);
                     }
 
                     client_record->set_dhcp_host(pack_datainfo->discover_host);
@@ -3247,7 +3251,7 @@ void kis_80211_phy::process_wpa_handshake(std::shared_ptr<kis_tracked_device_bas
                 alertracker->raise_alert(alert_nonce_duplicate_ref, in_pack,
                         dot11info->bssid_mac, dot11info->source_mac, 
                         dot11info->dest_mac, dot11info->other_mac,
-                        dot11info->channel,
+                        dot11info->channel.str(),
                         "WPA EAPOL RSN frame seen with a previously used nonce; "
                         "this may indicate a KRACK-style WPA attack (nonce: " + 
                         ss.str() + ")");
@@ -3316,7 +3320,7 @@ void kis_80211_phy::process_wpa_handshake(std::shared_ptr<kis_tracked_device_bas
                 alertracker->raise_alert(alert_nonce_duplicate_ref, in_pack,
                         dot11info->bssid_mac, dot11info->source_mac, 
                         dot11info->dest_mac, dot11info->other_mac,
-                        dot11info->channel,
+                        dot11info->channel.str(),
                         "WPA EAPOL RSN frame seen with a previously used anonce; "
                         "this may indicate a KRACK-style WPA attack (anonce: " +
                         ss.str() + ")");
@@ -125,7 +125,7 @@ class dot11_packinfo : public packet_component {
             fmsweak = 0;
             ess = 0;
             ibss = 0;
-            channel = "0";
+            channel = kis_atom::from_uint(0);
             encrypted = 0;
             timestamp = 0;
             sequence_number = 0;
@@ -202,7 +202,7 @@ class dot11_packinfo : public packet_component {
         int ibss;
 
         // What channel does it report
-        std::string channel;
+        kis_atom channel;
 
         // Is this encrypted?
         int encrypted;
@@ -262,11 +262,11 @@ class dot11_packinfo : public packet_component {
 
         double maxrate;
         // 11g rates
-        std::vector<std::string> basic_rates;
-        std::vector<std::string> extended_rates;
+        std::vector<kis_atom> basic_rates;
+        std::vector<kis_atom> extended_rates;
 
         // 11n MCS rates
-        std::vector<std::string> mcs_rates;
+        std::vector<kis_atom> mcs_rates;
 
         unsigned int ccx_txpower;
         bool cisco_client_mfp;
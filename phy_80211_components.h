@@ -649,7 +649,26 @@ public:
     __Proxy(ssid_beacon, uint8_t, bool, bool, ssid_beacon);
     __Proxy(ssid_probe_response, uint8_t, bool, bool, ssid_probe_response);
 
-    __Proxy(channel, std::string, std::string, std::string, channel);
+    __ProxyGet(channel, std::string, std::string, channel);
+
+    // Advertised channels arrive as packet atoms, and are compared against the
+    // channel of every beacon
+    const kis_atom& get_channel_atom() {
+        if (channel_atom.empty() && channel->get().length() > 0)
+            channel_atom = kis_atom(channel->get());
+        return channel_atom;
+    }
+    void set_channel(const kis_atom& in_channel) {
+        if (in_channel == channel_atom)
+            return;
+
+        channel_atom = in_channel;
+        channel->set(in_channel.str());
+    }
+    void set_channel(const std::string& in_channel) {
+        set_channel(kis_atom(in_channel));
+    }
+
     __Proxy(ht_mode, std::string, std::string, std::string, ht_mode);
     __Proxy(ht_center_1, uint64_t, uint64_t, uint64_t, ht_center_1);
     __Proxy(ht_center_2, uint64_t, uint64_t, uint64_t, ht_center_2);
@@ -754,6 +773,7 @@ protected:
 
     // Channel and optional HT center/second center
     std::shared_ptr<tracker_element_string> channel;
+    kis_atom channel_atom;
     std::shared_ptr<tracker_element_string> ht_mode;
     std::shared_ptr<tracker_element_uint64> ht_center_1;
     std::shared_ptr<tracker_element_uint64> ht_center_2;
@@ -111,6 +111,138 @@ const double mcs_table[][4] = {
 };
 const int MCS_MAX = 32;
 
+// Names of the basic rate bytes
+static const char *dot11_basic_rate_name(uint8_t r) {
+    switch (r) {
+        case 0x02:
+            return "1";
+        case 0x03:
+            return "1.5";
+        case 0x04:
+            return "2";
+        case 0x05:
+            return "2.5";
+        case 0x06:
+            return "3";
+        case 0x09:
+            return "4.5";
+        case 0x0B:
+            return "5.5";
+        case 0x0C:
+            return "6";
+        case 0x12:
+            return "9";
+        case 0x16:
+            return "11";
+        case 0x18:
+            return "12";
+        case 0x1B:
+            return "13.5";
+        case 0x24:
+            return "18";
+        case 0x2C:
+            return "22";
+        case 0x30:
+            return "24";
+        case 0x36:
+            return "27";
+        case 0x42:
+            return "33";
+        case 0x48:
+            return "36";
+        case 0x60:
+            return "48";
+        case 0x6C:
+            return "54";
+        case 0x82:
+            return "1B";
+        case 0x83:
+            return "1.5B";
+        case 0x84:
+            return "2B";
+        case 0x85:
+            return "2.5B";
+        case 0x86:
+            return "3B";
+        case 0x89:
+            return "4.5B";
+        case 0x8B:
+            return "5.5B";
+        case 0x8C:
+            return "6B";
+        case 0x92:
+            return "9B";
+        case 0x96:
+            return "11B";
+        case 0x98:
+            return "12B";
+        case 0x9B:
+            return "13.5B";
+        case 0xA4:
+            return "18B";
+        case 0xAC:
+            return "22B";
+        case 0xB0:
+            return "24B";
+        case 0xB6:
+            return "27B";
+        case 0xC2:
+            return "33B";
+        case 0xC8:
+            return "36B";
+        case 0xE0:
+            return "48B";
+        case 0xEC:
+            return "54B";
+        case 0xFF:
+            return "HT";
+        default:
+            return "UNK";
+    }
+}
+
+struct dot11_basic_rate {
+    kis_atom name;
+    // 0 for rates without a speed, such as the HT membership selector
+    double mbit;
+};
+
+// Every basic rate byte, interned with its speed the first time it's needed
+static const std::vector<dot11_basic_rate>& dot11_basic_rate_table() {
+    static const std::vector<dot11_basic_rate> table = []() {
+        std::vector<dot11_basic_rate> t(256);
+
+        for (unsigned int r = 0; r < 256; r++) {
+            auto name = dot11_basic_rate_name(r);
+
+            t[r].name = kis_atom(name);
+
+            if (sscanf(name, "%lf", &t[r].mbit) != 1)
+                t[r].mbit = 0;
+        }
+
+        return t;
+    }();
+
+    return table;
+}
+
+// HT MCS names by index; MCS 32 is only advertised as a 40MHz duplicate
+static const std::vector<kis_atom>& dot11_mcs_name_table() {
+    static const std::vector<kis_atom> table = []() {
+        std::vector<kis_atom> t;
+
+        for (int i = 0; i < MCS_MAX; i++)
+            t.push_back(kis_atom(fmt::format("MCS{}", i)));
+
+        t.push_back(kis_atom(fmt::format("MCS{}(HTDUP)", MCS_MAX)));
+
+        return t;
+    }();
+
+    return table;
+}
+
 // Indexed by VHT MCS index; contains base rates + extended vht
 // rates ordered as 0-9 per stream
 
@@ -781,7 +913,7 @@ int kis_80211_phy::packet_dot11_dissector(kis_packet *in_pack) {
                                     alertracker->raise_alert(alert_11kneighborchan_ref, in_pack, 
                                             packinfo->bssid_mac, packinfo->source_mac, 
                                             packinfo->dest_mac, packinfo->other_mac, 
-                                            packinfo->channel, ss.str());
+                                            packinfo->channel.str(), ss.str());
                                 }
 
                             } catch (const std::exception& e) {
@@ -1448,149 +1580,18 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 return -1;
             }
 
-            std::vector<std::string> basicrates;
-            for (uint8_t r : ie_tag->tag_data()) {
-                std::string rate;
+            packinfo->basic_rates.clear();
+            packinfo->basic_rates.reserve(ie_tag->tag_data().length());
 
-                switch (r) {
-                    case 0x02:
-                        rate = "1";
-                        break;
-                    case 0x03:
-                        rate = "1.5";
-                        break;
-                    case 0x04:
-                        rate = "2";
-                        break;
-                    case 0x05:
-                        rate = "2.5";
-                        break;
-                    case 0x06:
-                        rate = "3";
-                        break;
-                    case 0x09:
-                        rate = "4.5";
-                        break;
-                    case 0x0B:
-                        rate = "5.5";
-                        break;
-                    case 0x0C:
-                        rate = "6";
-                        break;
-                    case 0x12:
-                        rate = "9";
-                        break;
-                    case 0x16:
-                        rate = "11";
-                        break;
-                    case 0x18:
-                        rate = "12";
-                        break;
-                    case 0x1B:
-                        rate = "13.5";
-                        break;
-                    case 0x24:
-                        rate = "18";
-                        break;
-                    case 0x2C:
-                        rate = "22";
-                        break;
-                    case 0x30:
-                        rate = "24";
-                        break;
-                    case 0x36:
-                        rate = "27";
-                        break;
-                    case 0x42:
-                        rate = "33";
-                        break;
-                    case 0x48:
-                        rate = "36";
-                        break;
-                    case 0x60:
-                        rate = "48";
-                        break;
-                    case 0x6C:
-                        rate = "54";
-                        break;
-                    case 0x82:
-                        rate = "1B";
-                        break;
-                    case 0x83:
-                        rate = "1.5B";
-                        break;
-                    case 0x84:
-                        rate = "2B";
-                        break;
-                    case 0x85:
-                        rate = "2.5B";
-                        break;
-                    case 0x86:
-                        rate = "3B";
-                        break;
-                    case 0x89:
-                        rate = "4.5B";
-                        break;
-                    case 0x8B:
-                        rate = "5.5B";
-                        break;
-                    case 0x8C:
-                        rate = "6B";
-                        break;
-                    case 0x92:
-                        rate = "9B";
-                        break;
-                    case 0x96:
-                        rate = "11B";
-                        break;
-                    case 0x98:
-                        rate = "12B";
-                        break;
-                    case 0x9B:
-                        rate = "13.5B";
-                        break;
-                    case 0xA4:
-                        rate = "18B";
-                        break;
-                    case 0xAC:
-                        rate = "22B";
-                        break;
-                    case 0xB0:
-                        rate = "24B";
-                        break;
-                    case 0xB6:
-                        rate = "27B";
-                        break;
-                    case 0xC2:
-                        rate = "33B";
-                        break;
-                    case 0xC8:
-                        rate = "36B";
-                        break;
-                    case 0xE0:
-                        rate = "48B";
-                        break;
-                    case 0xEC:
-                        rate = "54B";
-                        break;
-                    case 0xFF:
-                        rate = "HT";
-                        break;
-                    default:
-                        rate = "UNK";
-                        break;
-                }
+            const auto& rate_table = dot11_basic_rate_table();
+            for (uint8_t r : ie_tag->tag_data()) {
+                const auto& rate = rate_table[r];
 
-                double m;
-                if (sscanf(rate.c_str(), "%lf", &m) == 1) {
-                    if (packinfo->maxrate < m)
-                        packinfo->maxrate = m;
-                }
+                if (packinfo->maxrate < rate.mbit)
+                    packinfo->maxrate = rate.mbit;
 
-                basicrates.push_back(rate);
+                packinfo->basic_rates.push_back(rate.name);
             }
-
-            packinfo->basic_rates = basicrates;
             continue;
         }
 
@@ -1607,12 +1608,12 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 alertracker->raise_alert(alert_bad_fixlen_ie, in_pack, 
                         packinfo->bssid_mac, packinfo->source_mac, 
                         packinfo->dest_mac, packinfo->other_mac, 
-                        packinfo->channel, al);
+                        packinfo->channel.str(), al);
                 packinfo->corrupt = 1;
                 return -1;
             }
                 
-            packinfo->channel = fmt::format("{}", (uint8_t) (ie_tag->tag_data()[0]));
+            packinfo->channel = kis_atom::from_uint((uint8_t) ie_tag->tag_data()[0]);
             continue;
         }
 
@@ -1688,14 +1689,13 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
 
             seen_mcsrates = true;
 
-            std::vector<std::string> mcsrates;
+            std::vector<kis_atom> mcsrates;
+            const auto& mcs_names = dot11_mcs_name_table();
 
             try {
                 std::shared_ptr<dot11_ie_45_ht_cap> ht(new dot11_ie_45_ht_cap());
                 ht->parse(ie_tag->tag_data_stream());
 
-                std::stringstream mcsstream;
-
                 // See if we support 40mhz channels and aren't 40mhz intolerant
                 bool ch40 = (ht->ht_cap_40mhz_channel() && !ht->ht_cap_40mhz_intolerant());
 
@@ -1714,21 +1714,14 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                                 continue;
 
                             if (mcsindex == 32) {
-                                if (ch40) {
-                                    mcsstream.str("");
-                                    mcsstream << "MCS" << mcsindex << "(" <<
-                                        "HTDUP" << ")";
-                                    mcsrates.push_back(mcsstream.str());
-                                }
+                                if (ch40)
+                                    mcsrates.push_back(mcs_names[mcsindex]);
 
                                 continue;
                             }
 
                             double rate;
 
-                            mcsstream.str("");
-                            mcsstream << "MCS" << mcsindex;
-
                             if (ch40 && gi40) {
                                 rate = mcs_table[mcsindex][CH40GI400];
                             } else if (ch40) {
@@ -1742,7 +1735,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                             if (packinfo->maxrate < rate)
                                 packinfo->maxrate = rate;
 
-                            mcsrates.push_back(mcsstream.str());
+                            mcsrates.push_back(mcs_names[mcsindex]);
                         }
                     }
 
@@ -1814,7 +1807,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                                 in_pack,
                                 packinfo->bssid_mac, packinfo->source_mac, 
                                 packinfo->dest_mac, packinfo->other_mac,
-                                packinfo->channel,
+                                packinfo->channel.str(),
                                 "Invalid 802.11i RSN IE seen with extremely "
                                 "large number of pairwise ciphers; this may "
                                 "be an attack against Atheros drivers per "
@@ -1883,7 +1876,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                 alertracker->raise_alert(alert_qcom_extended_ref, in_pack, 
                         packinfo->bssid_mac, packinfo->source_mac, 
                         packinfo->dest_mac, packinfo->other_mac, 
-                        packinfo->channel, al);
+                        packinfo->channel.str(), al);
 
             }
         }
@@ -2022,7 +2015,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                     alertracker->raise_alert(alert_wmm_ref, in_pack, 
                             packinfo->bssid_mac, packinfo->source_mac, 
                             packinfo->dest_mac, packinfo->other_mac, 
-                            packinfo->channel, al);
+                            packinfo->channel.str(), al);
                 }
 
                 // Count wmmtspec frames; per
@@ -2052,7 +2045,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                     alertracker->raise_alert(alert_atheros_wmmtspec_ref, in_pack, 
                             packinfo->bssid_mac, packinfo->source_mac, 
                             packinfo->dest_mac, packinfo->other_mac, 
-                            packinfo->channel, al);
+                            packinfo->channel.str(), al);
                 }
 
                 // Look for DJI DroneID OUIs
@@ -2136,7 +2129,7 @@ int kis_80211_phy::packet_dot11_ie_dissector(kis_packet *in_pack, dot11_packinfo
                                     alertracker->raise_alert(alert_rtlwifi_p2p_ref, in_pack,
                                             packinfo->bssid_mac, packinfo->source_mac, 
                                             packinfo->dest_mac, packinfo->other_mac,
-                                            packinfo->channel,
+                                            packinfo->channel.str(),
                                             "A Wi-Fi Direct P2P packet with an over-long Notification of Absence report "
                                             "seen.  This may indicate an attempt to exploit a bug "
                                             "in the Linux RTLWIFI drivers as detailed in CVE-2019-17666");
@@ -2733,7 +2726,7 @@ std::shared_ptr<dot11_tracked_eapol>
                     alertracker->raise_alert(alert_nonce_zero_ref, in_pack,
                             packinfo->bssid_mac, packinfo->source_mac, 
                             packinfo->dest_mac, packinfo->other_mac,
-                            packinfo->channel,
+                            packinfo->channel.str(),
                             "WPA EAPOL RSN frame seen with an empty key and zero nonce; "
                             "this may indicate a WPA degradation attack such as the "
                             "vanhoefm attack against OpenBSD Wi-Fi supplicants.");
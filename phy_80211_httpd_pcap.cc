@@ -139,9 +139,9 @@ KIS_MHD_RETURN phy_80211_httpd_pcap::httpd_create_stream_response(kis_net_httpd
     kis_net_httpd_buffer_stream_aux *saux = 
         (kis_net_httpd_buffer_stream_aux *) connection->custom_extension;
       
-    // Filter based on the device key
+    // Tap packets with the BSSID in any address, and filter to the BSSID
     auto *psrb = new pcap_stream_packetchain(Globalreg::globalreg,
-            saux->get_rbhandler(), 
+            saux->get_rbhandler(), packet_tap_match::by_mac(dmac),
             [dmac, pack_comp_dot11](kis_packet *packet) -> bool {
                 dot11_packinfo *dot11info =
                     (dot11_packinfo *) packet->fetch(pack_comp_dot11);
@@ -34,6 +34,13 @@
 #include "kis_httpd_registry.h"
 #include "devicetracker.h"
 #include "alertracker.h"
+#include "json_fields.h"
+
+// Fields of the bluetooth scan report JSON used by the classifier
+static const kis_json_fields::key_set bluetooth_scan_json_fields {
+    "btaddr", "name", "devicetype", "txpowerlevel", "pathloss", "signal",
+    "scan_data", "service_data"
+};
 
 kis_bluetooth_phy::kis_bluetooth_phy(global_registry *in_globalreg, int in_phyid) : 
     kis_phy_handler(in_globalreg, in_phyid) {
@@ -54,9 +61,12 @@ kis_bluetooth_phy::kis_bluetooth_phy(global_registry *in_globalreg, int in_phyid
                 tracker_element_factory<bluetooth_tracked_device>(),
                 "Bluetooth device");
 
-    packetchain->register_handler(&common_classifier_bluetooth, this, CHAINPOS_CLASSIFIER, -100);
-    packetchain->register_handler(&packet_tracker_bluetooth, this, CHAINPOS_TRACKER, -100);
-    packetchain->register_handler(&packet_bluetooth_scan_json_classifier, this, CHAINPOS_CLASSIFIER, -99);
+    packetchain->register_handler(&common_classifier_bluetooth, this, CHAINPOS_CLASSIFIER, -100,
+            "bluetooth_classifier");
+    packetchain->register_handler(&packet_tracker_bluetooth, this, CHAINPOS_TRACKER, -100,
+            "bluetooth_tracker");
+    packetchain->register_handler(&packet_bluetooth_scan_json_classifier, this, CHAINPOS_CLASSIFIER, -99,
+            "bluetooth_scan_classifier");
     
     pack_comp_btdevice = packetchain->register_packet_component("BTDEVICE");
 	pack_comp_common = packetchain->register_packet_component("COMMON");
@@ -64,6 +74,8 @@ kis_bluetooth_phy::kis_bluetooth_phy(global_registry *in_globalreg, int in_phyid
     pack_comp_meta = packetchain->register_packet_component("METABLOB");
     pack_comp_json = packetchain->register_packet_component("JSON");
 
+    fhss_channel = kis_atom("FHSS");
+
     // Register js module for UI
     auto httpregistry = 
         Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
@@ -97,7 +109,7 @@ int kis_bluetooth_phy::common_classifier_bluetooth(CHAINCALL_PARMS) {
     ci->direction = packet_direction_from;
     ci->source = btpi->address;
     ci->transmitter = btpi->address;
-    ci->channel = "FHSS";
+    ci->channel = btphy->fhss_channel;
     ci->freq_khz = 2400000;
 
     return 0;
@@ -126,9 +138,7 @@ int kis_bluetooth_phy::packet_bluetooth_scan_json_classifier(CHAINCALL_PARMS) {
 
     try {
         std::stringstream newdevstr;
-        std::stringstream ss(pack_json->json_string);
-        Json::Value json;
-        ss >> json;
+        kis_json_fields json(pack_json->json_string, bluetooth_scan_json_fields);
 
         auto btaddr_j = json["btaddr"];
 
@@ -144,7 +154,7 @@ int kis_bluetooth_phy::packet_bluetooth_scan_json_classifier(CHAINCALL_PARMS) {
         commoninfo->type = packet_basic_mgmt;
         commoninfo->source = btaddr_mac;
         commoninfo->transmitter = btaddr_mac;
-        commoninfo->channel = "FHSS";
+        commoninfo->channel = btphy->fhss_channel;
         commoninfo->freq_khz = 2400000;
 
         in_pack->insert(btphy->pack_comp_common, commoninfo);
@@ -213,8 +223,9 @@ int kis_bluetooth_phy::packet_bluetooth_scan_json_classifier(CHAINCALL_PARMS) {
             btdev_bluetooth->set_scan_data_from_hex(scan_bytes_j.asString());
 
         if (service_bytes_map_j.isObject()) {
-            for (const auto& u : service_bytes_map_j.getMemberNames()) {
-                auto v = service_bytes_map_j[u];
+            for (const auto& m : service_bytes_map_j.members()) {
+                const auto& u = m.first;
+                const auto& v = m.second;
 
                 if (!v.isString())
                     throw std::runtime_error("expected string in service_data map");
@@ -185,6 +185,8 @@ protected:
 
 	// Packet components
 	int pack_comp_btdevice, pack_comp_common, pack_comp_l1info, pack_comp_meta, pack_comp_json;
+
+    kis_atom fhss_channel;
 };
 
 #endif
@@ -180,8 +180,8 @@ kis_btle_phy::kis_btle_phy(global_registry *in_globalreg, int in_phyid) :
     pack_comp_decap = packetchain->register_packet_component("DECAP");
     pack_comp_btle = packetchain->register_packet_component("BTLE");
 
-    packetchain->register_handler(&dissector, this, CHAINPOS_LLCDISSECT, -100);
-    packetchain->register_handler(&common_classifier, this, CHAINPOS_CLASSIFIER, -100);
+    packetchain->register_handler(&dissector, this, CHAINPOS_LLCDISSECT, -100, "btle_dissector");
+    packetchain->register_handler(&common_classifier, this, CHAINPOS_CLASSIFIER, -100, "btle_classifier");
 
     btle_device_id = 
         entrytracker->register_field("btle.device",
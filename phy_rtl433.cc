@@ -27,6 +27,17 @@
 #include "manuf.h"
 #include "messagebus.h"
 
+// Top-level fields of the rtl_433 JSON records used by the phy
+static const kis_json_fields::key_set rtl433_json_fields {
+    "model", "id", "device", "channel", "battery",
+    "direction_deg", "windstrength", "winddirection", "speed", "wind_avg_km_h",
+    "gust", "rain", "uv_index", "lux",
+    "humidity", "moisture", "temperature_F", "temperature_C",
+    "type", "pressure_bar", "pressure_kPa", "flags", "mic", "state", "code",
+    "strike_count", "storm_dist", "active", "rfi",
+    "switch*"
+};
+
 Kis_RTL433_Phy::Kis_RTL433_Phy(global_registry *in_globalreg, int in_phyid) :
     kis_phy_handler(in_globalreg, in_phyid) {
 
@@ -43,6 +54,11 @@ Kis_RTL433_Phy::Kis_RTL433_Phy(global_registry *in_globalreg, int in_phyid) :
 		packetchain->register_packet_component("COMMON");
     pack_comp_json = 
         packetchain->register_packet_component("JSON");
+    json_type = kis_atom("RTL433");
+
+    // Some sensors name their channel with a letter instead of a number
+    for (char c = 'A'; c <= 'Z'; c++)
+        kis_atom(std::string(1, c));
     pack_comp_meta =
         packetchain->register_packet_component("METABLOB");
 
@@ -89,7 +105,7 @@ Kis_RTL433_Phy::Kis_RTL433_Phy(global_registry *in_globalreg, int in_phyid) :
         Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_rtl433", "js/kismet.ui.rtl433.js");
 
-	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100);
+	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100, "rtl433_classifier");
 }
 
 Kis_RTL433_Phy::~Kis_RTL433_Phy() {
@@ -100,7 +116,7 @@ double Kis_RTL433_Phy::f_to_c(double f) {
     return (f - 32) / (double) 1.8f;
 }
 
-mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
+mac_addr Kis_RTL433_Phy::json_to_mac(const kis_json_fields& json) {
     // Derive a mac addr from the model and device id data
     //
     // We turn the model string into 4 bytes using the adler32 checksum,
@@ -117,7 +133,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     std::string smodel = "unk";
 
     if (json.isMember("model")) {
-        Json::Value m = json["model"];
+        auto m = json["model"];
         if (m.isString()) {
             smodel = m.asString();
         }
@@ -127,7 +143,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
 
     bool set_model = false;
     if (json.isMember("id")) {
-        Json::Value i = json["id"];
+        auto i = json["id"];
         if (i.isNumeric()) {
             *model = kis_hton16((uint16_t) i.asUInt());
             set_model = true;
@@ -135,7 +151,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     }
 
     if (!set_model && json.isMember("device")) {
-        Json::Value d = json["device"];
+        auto d = json["device"];
         if (d.isNumeric()) {
             *model = kis_hton16((uint16_t) d.asUInt());
             set_model = true;
@@ -152,7 +168,7 @@ mac_addr Kis_RTL433_Phy::json_to_mac(Json::Value json) {
     return mac_addr(bytes, 6);
 }
 
-bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, kis_packet *packet) {
+bool Kis_RTL433_Phy::json_to_rtl(const kis_json_fields& json, kis_packet *packet) {
     std::string err;
     std::string v;
 
@@ -177,11 +193,14 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, kis_packet *packet) {
 
     // If this json record has a channel
     if (json.isMember("channel")) {
-        Json::Value c = json["channel"];
+        auto c = json["channel"];
+        // Channels are matched against the interned channel numbers and names instead 
+        // of being interned, so arbitrary values from the radio can't grow the atom table
         if (c.isNumeric()) {
-            common->channel = int_to_string(c.asInt());
+            if (c.asInt() >= 0 && c.asInt() < 256)
+                common->channel = kis_atom::from_uint(c.asInt());
         } else if (c.isString()) {
-            common->channel = munge_to_printable(c.asString());
+            common->channel = kis_atom::find(c.asString());
         }
     }
 
@@ -229,7 +248,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, kis_packet *packet) {
 
         bool set_id = false;
         if (json.isMember("id")) {
-            Json::Value id_j = json["id"];
+            auto id_j = json["id"];
             if (id_j.isNumeric()) {
                 std::stringstream ss;
                 ss << id_j.asUInt64();
@@ -242,7 +261,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, kis_packet *packet) {
         }
 
         if (!set_id && json.isMember("device")) {
-            Json::Value device_j = json["device"];
+            auto device_j = json["device"];
             if (device_j.isNumeric()) {
                 std::stringstream ss;
                 ss << device_j.asUInt64();
@@ -307,7 +326,7 @@ bool Kis_RTL433_Phy::json_to_rtl(Json::Value json, kis_packet *packet) {
     return true;
 }
 
-bool Kis_RTL433_Phy::is_weather_station(Json::Value json) {
+bool Kis_RTL433_Phy::is_weather_station(const kis_json_fields& json) {
     auto direction_j = json["direction_deg"];
     auto windstrength_j = json["windstrength"];
     auto winddirection_j = json["winddirection"];
@@ -326,7 +345,7 @@ bool Kis_RTL433_Phy::is_weather_station(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_thermometer(Json::Value json) {
+bool Kis_RTL433_Phy::is_thermometer(const kis_json_fields& json) {
     auto humidity_j = json["humidity"];
     auto moisture_j = json["moisture"];
     auto temp_f_j = json["temperature_F"];
@@ -339,7 +358,7 @@ bool Kis_RTL433_Phy::is_thermometer(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_tpms(Json::Value json) {
+bool Kis_RTL433_Phy::is_tpms(const kis_json_fields& json) {
     auto type_j = json["type"];
 
     if (type_j.isString() && type_j.asString() == "TPMS")
@@ -348,7 +367,7 @@ bool Kis_RTL433_Phy::is_tpms(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_switch(Json::Value json) {
+bool Kis_RTL433_Phy::is_switch(const kis_json_fields& json) {
     auto sw0_j = json["switch0"];
     auto sw1_j = json["switch1"];
 
@@ -358,7 +377,7 @@ bool Kis_RTL433_Phy::is_switch(Json::Value json) {
     return false;
 }
 
-bool Kis_RTL433_Phy::is_lightning(Json::Value json) {
+bool Kis_RTL433_Phy::is_lightning(const kis_json_fields& json) {
     auto strike_j = json["strike_count"];
     auto storm_j = json["storm_dist"];
     auto active_j = json["active"];
@@ -370,7 +389,7 @@ bool Kis_RTL433_Phy::is_lightning(Json::Value json) {
     return true;
 }
 
-void Kis_RTL433_Phy::add_weather_station(Json::Value json, 
+void Kis_RTL433_Phy::add_weather_station(const kis_json_fields& json, 
         std::shared_ptr<tracker_element_map> rtlholder) {
     auto direction_j = json["direction_deg"];
     auto windstrength_j = json["windstrength"];
@@ -444,7 +463,7 @@ void Kis_RTL433_Phy::add_weather_station(Json::Value json,
     }
 }
 
-void Kis_RTL433_Phy::add_thermometer(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_thermometer(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder) {
     auto humidity_j = json["humidity"];
     auto moisture_j = json["moisture"];
     auto temp_f_j = json["temperature_F"];
@@ -478,7 +497,7 @@ void Kis_RTL433_Phy::add_thermometer(Json::Value json, std::shared_ptr<tracker_e
     }
 }
 
-void Kis_RTL433_Phy::add_tpms(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_tpms(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder) {
     auto type_j = json["type"];
     auto pressure_j = json["pressure_bar"];
     auto pressurekpa_j = json["pressure_kPa"];
@@ -525,7 +544,7 @@ void Kis_RTL433_Phy::add_tpms(Json::Value json, std::shared_ptr<tracker_element_
 
 }
 
-void Kis_RTL433_Phy::add_switch(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_switch(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder) {
     auto sw0_j = json["switch0"];
     auto sw1_j = json["switch1"];
 
@@ -576,7 +595,7 @@ void Kis_RTL433_Phy::add_switch(Json::Value json, std::shared_ptr<tracker_elemen
     }
 }
 
-void Kis_RTL433_Phy::add_lightning(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder) {
+void Kis_RTL433_Phy::add_lightning(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder) {
     // {"time" : "2019-02-24 22:12:13", "model" : "Acurite Lightning 6045M", "id" : 15580, "channel" : "B", "temperature_F" : 38.300, "humidity" : 53, "strike_count" : 1, "storm_dist" : 8, "active" : 1, "rfi" : 0, "ussb1" : 0, "battery" : "OK", "exception" : 0, "raw_msg" : "bcdc6f354edb81886e"}
     auto strike_j = json["strike_count"];
     auto storm_j = json["storm_dist"];
@@ -618,14 +637,11 @@ int Kis_RTL433_Phy::PacketHandler(CHAINCALL_PARMS) {
     if (json == NULL)
         return 0;
 
-    if (json->type != "RTL433")
+    if (json->type != rtl433->json_type)
         return 0;
 
-    std::stringstream ss(json->json_string);
-    Json::Value device_json;
-
     try {
-        ss >> device_json;
+        kis_json_fields device_json(json->json_string, rtl433_json_fields);
 
         // Copy the JSON as the meta field for logging, if it's valid
         if (rtl433->json_to_rtl(device_json, in_pack)) {
@@ -25,6 +25,7 @@
 #include "kis_net_microhttpd.h"
 #include "trackedelement.h"
 #include "devicetracker_component.h"
+#include "json_fields.h"
 #include "phyhandler.h"
 
 /* Similar to the extreme aggregator, a temperature aggregator which ignores empty
@@ -550,23 +551,23 @@ public:
 
 protected:
     // Convert a JSON record to a RTL-based device key
-    mac_addr json_to_mac(Json::Value in_json);
+    mac_addr json_to_mac(const kis_json_fields& in_json);
 
     // convert to a device record & push into device tracker, return false
     // if we can't do anything with it
-    bool json_to_rtl(Json::Value in_json, kis_packet *packet);
+    bool json_to_rtl(const kis_json_fields& in_json, kis_packet *packet);
 
-    bool is_weather_station(Json::Value json);
-    bool is_thermometer(Json::Value json);
-    bool is_tpms(Json::Value json);
-    bool is_switch(Json::Value json);
-    bool is_lightning(Json::Value json);
+    bool is_weather_station(const kis_json_fields& json);
+    bool is_thermometer(const kis_json_fields& json);
+    bool is_tpms(const kis_json_fields& json);
+    bool is_switch(const kis_json_fields& json);
+    bool is_lightning(const kis_json_fields& json);
 
-    void add_weather_station(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_thermometer(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_tpms(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_switch(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
-    void add_lightning(Json::Value json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_weather_station(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_thermometer(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_tpms(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_switch(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder);
+    void add_lightning(const kis_json_fields& json, std::shared_ptr<tracker_element_map> rtlholder);
 
     double f_to_c(double f);
 
@@ -582,6 +583,9 @@ protected:
 
     int pack_comp_common, pack_comp_json, pack_comp_meta;
 
+    // JSON record type handled by this phy
+    kis_atom json_type;
+
     std::shared_ptr<tracker_element_string> rtl_manuf;
 
 };
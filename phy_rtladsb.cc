@@ -27,6 +27,12 @@
 #include "manuf.h"
 #include "messagebus.h"
 
+// Top-level fields of the rtladsb JSON records used by the phy
+static const kis_json_fields::key_set rtladsb_json_fields {
+    "icao", "crc_valid", "channel", "callsign", "altitude", "speed", "heading",
+    "gsas", "raw_lat", "raw_lon", "coordpair_even"
+};
+
 kis_rtladsb_phy::kis_rtladsb_phy(global_registry *in_globalreg, int in_phyid) :
     kis_phy_handler(in_globalreg, in_phyid) {
 
@@ -43,6 +49,7 @@ kis_rtladsb_phy::kis_rtladsb_phy(global_registry *in_globalreg, int in_phyid) :
         packetchain->register_packet_component("COMMON");
     pack_comp_json = 
         packetchain->register_packet_component("JSON");
+    json_type = kis_atom("RTLadsb");
     pack_comp_meta =
         packetchain->register_packet_component("METABLOB");
 	pack_comp_gps =
@@ -61,7 +68,7 @@ kis_rtladsb_phy::kis_rtladsb_phy(global_registry *in_globalreg, int in_phyid) :
         Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_rtladsb", "js/kismet.ui.rtladsb.js");
 
-	packetchain->register_handler(&packet_handler, this, CHAINPOS_CLASSIFIER, -100);
+	packetchain->register_handler(&packet_handler, this, CHAINPOS_CLASSIFIER, -100, "rtladsb_classifier");
 
     adsb_map_endp = 
         std::make_shared<kis_net_httpd_simple_tracked_endpoint>(
@@ -77,7 +84,7 @@ kis_rtladsb_phy::~kis_rtladsb_phy() {
     packetchain->remove_handler(&packet_handler, CHAINPOS_CLASSIFIER);
 }
 
-mac_addr kis_rtladsb_phy::json_to_mac(Json::Value json) {
+mac_addr kis_rtladsb_phy::json_to_mac(const kis_json_fields& json) {
     // Derive a mac addr from the model and device id data
     //
     // We turn the model string into 4 bytes using the adler32 checksum,
@@ -94,7 +101,7 @@ mac_addr kis_rtladsb_phy::json_to_mac(Json::Value json) {
     std::string smodel = "unk";
 
     if (json.isMember("icao")) {
-        Json::Value m = json["icao"];
+        auto m = json["icao"];
         if (m.isString()) {
             smodel = m.asString();
         }
@@ -105,7 +112,7 @@ mac_addr kis_rtladsb_phy::json_to_mac(Json::Value json) {
     bool set_model = false;
 
     if (json.isMember("icao")) {
-        Json::Value i = json["icao"];
+        auto i = json["icao"];
         if (i.isString()) {
 	    std::string icaotmp = i.asString();
 	    int icaoint = std::stoi(icaotmp, 0, 16);
@@ -124,7 +131,7 @@ mac_addr kis_rtladsb_phy::json_to_mac(Json::Value json) {
     return mac_addr(bytes, 6);
 }
 
-bool kis_rtladsb_phy::json_to_rtl(Json::Value json, kis_packet *packet) {
+bool kis_rtladsb_phy::json_to_rtl(const kis_json_fields& json, kis_packet *packet) {
     std::string err;
     std::string v;
 
@@ -156,11 +163,14 @@ bool kis_rtladsb_phy::json_to_rtl(Json::Value json, kis_packet *packet) {
 
     // If this json record has a channel
     if (json.isMember("channel")) {
-        Json::Value c = json["channel"];
+        auto c = json["channel"];
+        // Channels are matched against the interned channel numbers and names instead 
+        // of being interned, so arbitrary values from the radio can't grow the atom table
         if (c.isNumeric()) {
-            common->channel = int_to_string(c.asInt());
+            if (c.asInt() >= 0 && c.asInt() < 256)
+                common->channel = kis_atom::from_uint(c.asInt());
         } else if (c.isString()) {
-            common->channel = munge_to_printable(c.asString());
+            common->channel = kis_atom::find(c.asString());
         }
     }
 
@@ -263,7 +273,7 @@ bool kis_rtladsb_phy::json_to_rtl(Json::Value json, kis_packet *packet) {
     return true;
 }
 
-bool kis_rtladsb_phy::is_adsb(Json::Value json) {
+bool kis_rtladsb_phy::is_adsb(const kis_json_fields& json) {
 
     //fprintf(stderr, "RTLADSB: checking to see if it is a adsb\n");
     auto icao_j = json["icao"];
@@ -276,7 +286,7 @@ bool kis_rtladsb_phy::is_adsb(Json::Value json) {
 }
 
 std::shared_ptr<rtladsb_tracked_adsb> kis_rtladsb_phy::add_adsb(kis_packet *packet,
-        Json::Value json, std::shared_ptr<kis_tracked_device_base> rtlholder) {
+        const kis_json_fields& json, std::shared_ptr<kis_tracked_device_base> rtlholder) {
     auto icao_j = json["icao"];
     bool new_adsb = false;
     std::stringstream new_ss;
@@ -409,14 +419,11 @@ int kis_rtladsb_phy::packet_handler(CHAINCALL_PARMS) {
     //std::fprintf(stderr, "RTLADSB: json type: %s\n", json->type.c_str());
     
 
-    if (json->type != "RTLadsb")
+    if (json->type != rtladsb->json_type)
         return 0;
 
-    std::stringstream ss(json->json_string);
-    Json::Value device_json;
-
     try {
-        ss >> device_json;
+        kis_json_fields device_json(json->json_string, rtladsb_json_fields);
 
         // Copy the JSON as the meta field for logging, if it's valid
         if (rtladsb->json_to_rtl(device_json, in_pack)) {
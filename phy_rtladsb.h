@@ -27,6 +27,7 @@
 #include "devicetracker_component.h"
 #include "globalregistry.h"
 #include "kis_net_microhttpd.h"
+#include "json_fields.h"
 #include "phyhandler.h"
 #include "trackedelement.h"
 
@@ -161,16 +162,16 @@ protected:
     int pack_comp_gps;
 
     // Convert a JSON record to a RTL-based device key
-    mac_addr json_to_mac(Json::Value in_json);
+    mac_addr json_to_mac(const kis_json_fields& in_json);
 
     // convert to a device record & push into device tracker, return false
     // if we can't do anything with it
-    bool json_to_rtl(Json::Value in_json, kis_packet *packet);
+    bool json_to_rtl(const kis_json_fields& in_json, kis_packet *packet);
 
-    bool is_adsb(Json::Value json);
+    bool is_adsb(const kis_json_fields& json);
 
     std::shared_ptr<rtladsb_tracked_adsb> add_adsb(kis_packet *packet, 
-            Json::Value json, std::shared_ptr<kis_tracked_device_base> rtlholder);
+            const kis_json_fields& json, std::shared_ptr<kis_tracked_device_base> rtlholder);
 
     double f_to_c(double f);
 
@@ -188,6 +189,9 @@ protected:
 
     int pack_comp_common, pack_comp_json, pack_comp_meta;
 
+    // JSON record type handled by this phy
+    kis_atom json_type;
+
     std::shared_ptr<tracker_element_string> rtl_manuf;
 
     std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> adsb_map_endp;
@@ -27,6 +27,11 @@
 #include "manuf.h"
 #include "messagebus.h"
 
+// Top-level fields of the rtlamr JSON records used by the phy
+static const kis_json_fields::key_set rtlamr_json_fields {
+    "model", "meterid", "metertype", "phytamper", "endptamper", "consumption", "valid"
+};
+
 kis_rtlamr_phy::kis_rtlamr_phy(global_registry *in_globalreg, int in_phyid) :
     kis_phy_handler(in_globalreg, in_phyid) {
 
@@ -43,6 +48,7 @@ kis_rtlamr_phy::kis_rtlamr_phy(global_registry *in_globalreg, int in_phyid) :
 		packetchain->register_packet_component("COMMON");
     pack_comp_json = 
         packetchain->register_packet_component("JSON");
+    json_type = kis_atom("RTLamr");
     pack_comp_meta =
         packetchain->register_packet_component("METABLOB");
 
@@ -58,7 +64,7 @@ kis_rtlamr_phy::kis_rtlamr_phy(global_registry *in_globalreg, int in_phyid) :
     auto httpregistry = Globalreg::fetch_mandatory_global_as<kis_httpd_registry>();
     httpregistry->register_js_module("kismet_ui_rtlamr", "js/kismet.ui.rtlamr.js");
 
-	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100);
+	packetchain->register_handler(&PacketHandler, this, CHAINPOS_CLASSIFIER, -100, "rtlamr_classifier");
 }
 
 kis_rtlamr_phy::~kis_rtlamr_phy() {
@@ -66,7 +72,7 @@ kis_rtlamr_phy::~kis_rtlamr_phy() {
 }
 
 
-mac_addr kis_rtlamr_phy::json_to_mac(Json::Value json) {
+mac_addr kis_rtlamr_phy::json_to_mac(const kis_json_fields& json) {
     // Derive a mac addr from the model and device id data
     //
     // We turn the model string into 4 bytes using the adler32 checksum,
@@ -95,7 +101,7 @@ mac_addr kis_rtlamr_phy::json_to_mac(Json::Value json) {
     return mac_addr(bytes, 6);
 }
 
-bool kis_rtlamr_phy::json_to_rtl(Json::Value json, kis_packet *packet) {
+bool kis_rtlamr_phy::json_to_rtl(const kis_json_fields& json, kis_packet *packet) {
     std::string err;
     std::string v;
 
@@ -215,14 +221,11 @@ int kis_rtlamr_phy::PacketHandler(CHAINCALL_PARMS) {
     if (json == NULL)
         return 0;
 
-    if (json->type != "RTLamr")
+    if (json->type != rtlamr->json_type)
         return 0;
 
-    std::stringstream ss(json->json_string);
-    Json::Value device_json;
-
     try {
-        ss >> device_json;
+        kis_json_fields device_json(json->json_string, rtlamr_json_fields);
 
         if (rtlamr->json_to_rtl(device_json, in_pack)) {
             packet_metablob *metablob = in_pack->fetch<packet_metablob>(rtlamr->pack_comp_meta);
@@ -25,6 +25,7 @@
 #include "kis_net_microhttpd.h"
 #include "trackedelement.h"
 #include "devicetracker_component.h"
+#include "json_fields.h"
 #include "phyhandler.h"
 
 /* Similar to the extreme aggregator, a consumption aggregator which ignores empty
@@ -190,15 +191,15 @@ public:
 
 protected:
     // Convert a JSON record to a RTL-based device key
-    mac_addr json_to_mac(Json::Value in_json);
+    mac_addr json_to_mac(const kis_json_fields& in_json);
 
     // convert to a device record & push into device tracker, return false
     // if we can't do anything with it
-    bool json_to_rtl(Json::Value in_json, kis_packet *packet);
+    bool json_to_rtl(const kis_json_fields& in_json, kis_packet *packet);
 
-    bool is_amr_meter(Json::Value json);
+    bool is_amr_meter(const kis_json_fields& json);
 
-    void add_amr_meter(Json::Value json, std::shared_ptr<kis_tracked_device_base> rtlholder);
+    void add_amr_meter(const kis_json_fields& json, std::shared_ptr<kis_tracked_device_base> rtlholder);
 
 protected:
     std::shared_ptr<packet_chain> packetchain;
@@ -209,6 +210,9 @@ protected:
 
     int pack_comp_common, pack_comp_json, pack_comp_meta, pack_comp_radiodata;
 
+    // JSON record type handled by this phy
+    kis_atom json_type;
+
     std::shared_ptr<tracker_element_string> rtl_manuf;
 
 };
@@ -0,0 +1,580 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "config.h"
+#include "rtladsb_demod.h"
+
+/* Per-bit checksum contribution, from dump1090; short messages use the last 56
+ * entries.  The parity bits themselves contribute nothing. */
+static const uint32_t modes_checksum_table[ADSB_LONG_FRAME] = {
+    0x3935ea, 0x1c9af5, 0xf1b77e, 0x78dbbf, 0xc397db, 0x9e31e9,
+    0xb0e2f0, 0x587178, 0x2c38bc, 0x161c5e, 0x0b0e2f, 0xfa7d13,
+    0x82c48d, 0xbe9842, 0x5f4c21, 0xd05c14, 0x682e0a, 0x341705,
+    0xe5f186, 0x72f8c3, 0xc68665, 0x9cb936, 0x4e5c9b, 0xd8d449,
+    0x939020, 0x49c810, 0x24e408, 0x127204, 0x093902, 0x049c81,
+    0xfdb444, 0x7eda22, 0x3f6d11, 0xe04c8c, 0x702646, 0x381323,
+    0xe3f395, 0x8e03ce, 0x4701e7, 0xdc7af7, 0x91c77f, 0xb719bb,
+    0xa476d9, 0xadc168, 0x56e0b4, 0x2b705a, 0x15b82d, 0xf52612,
+    0x7a9309, 0xc2b380, 0x6159c0, 0x30ace0, 0x185670, 0x0c2b38,
+    0x06159c, 0x030ace, 0x018567, 0xff38b7, 0x80665f, 0xbfc92b,
+    0xa01e91, 0xaff54c, 0x57faa6, 0x2bfd53, 0xea04ad, 0x8af852,
+    0x457c29, 0xdd4410, 0x6ea208, 0x375104, 0x1ba882, 0x0dd441,
+    0xf91024, 0x7c8812, 0x3e4409, 0xe0d800, 0x706c00, 0x383600,
+    0x1c1b00, 0x0e0d80, 0x0706c0, 0x038360, 0x01c1b0, 0x00e0d8,
+    0x00706c, 0x003836, 0x001c1b, 0xfff409, 0x000000, 0x000000,
+    0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
+    0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
+    0x000000, 0x000000, 0x000000, 0x000000, 0x000000, 0x000000,
+    0x000000, 0x000000, 0x000000, 0x000000
+};
+
+/* Checksum contribution of every value of every message byte, so the checksum is
+ * one lookup per byte instead of one per bit */
+static uint32_t modes_byte_table[ADSB_LONG_FRAME_B][256];
+
+/* Checksum syndrome of flipping each single bit, sorted by syndrome */
+typedef struct {
+    uint32_t syndrome;
+    int bit;
+} adsb_syndrome_t;
+
+static adsb_syndrome_t long_syndromes[ADSB_LONG_FRAME];
+static adsb_syndrome_t short_syndromes[ADSB_SHORT_FRAME];
+
+static pthread_once_t adsb_tables_once = PTHREAD_ONCE_INIT;
+
+static int syndrome_cmp(const void *a, const void *b) {
+    const adsb_syndrome_t *sa = (const adsb_syndrome_t *) a;
+    const adsb_syndrome_t *sb = (const adsb_syndrome_t *) b;
+
+    if (sa->syndrome != sb->syndrome)
+        return sa->syndrome < sb->syndrome ? -1 : 1;
+
+    return sa->bit - sb->bit;
+}
+
+static void build_syndromes(adsb_syndrome_t *syndromes, unsigned int bits) {
+    unsigned int offset = ADSB_LONG_FRAME - bits;
+    unsigned int j;
+
+    for (j = 0; j < bits; j++) {
+        syndromes[j].bit = j;
+
+        /* Flipping a data bit changes the computed checksum; flipping a parity
+         * bit changes the received one */
+        if (j < bits - 24)
+            syndromes[j].syndrome = modes_checksum_table[j + offset];
+        else
+            syndromes[j].syndrome = 1 << (bits - 1 - j);
+    }
+
+    qsort(syndromes, bits, sizeof(adsb_syndrome_t), syndrome_cmp);
+}
+
+static void build_tables(void) {
+    unsigned int byte, val, bit;
+
+    for (byte = 0; byte < ADSB_LONG_FRAME_B; byte++) {
+        for (val = 0; val < 256; val++) {
+            uint32_t crc = 0;
+
+            for (bit = 0; bit < 8; bit++) {
+                if (val & (1 << (7 - bit)))
+                    crc ^= modes_checksum_table[(byte * 8) + bit];
+            }
+
+            modes_byte_table[byte][val] = crc;
+        }
+    }
+
+    build_syndromes(long_syndromes, ADSB_LONG_FRAME);
+    build_syndromes(short_syndromes, ADSB_SHORT_FRAME);
+}
+
+int rtladsb_demod_init(rtladsb_demod_t *demod, size_t max_iq_len) {
+    size_t max_samples = (max_iq_len / 2) + ADSB_MSG_SPAN;
+
+    pthread_once(&adsb_tables_once, build_tables);
+
+    memset(demod, 0, sizeof(rtladsb_demod_t));
+
+    demod->max_iq_len = max_iq_len;
+
+    demod->magnitude = (uint16_t *) malloc(sizeof(uint16_t) * max_samples);
+    demod->candidates = (uint8_t *) malloc(max_samples);
+
+    if (demod->magnitude == NULL || demod->candidates == NULL) {
+        rtladsb_demod_free(demod);
+        return -1;
+    }
+
+    return 1;
+}
+
+void rtladsb_demod_free(rtladsb_demod_t *demod) {
+    free(demod->magnitude);
+    free(demod->candidates);
+
+    demod->magnitude = NULL;
+    demod->candidates = NULL;
+}
+
+void rtladsb_demod_reset(rtladsb_demod_t *demod) {
+    demod->carry = 0;
+    demod->resume = 0;
+}
+
+/* Magnitude of each IQ pair, |127 - i|^2 + |127 - q|^2, which is at most 32768 */
+static void iq_magnitude(const uint8_t *iq, size_t samples, uint16_t *out) {
+    size_t s = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(127);
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i sign16 = _mm_set1_epi16((short) 0x8000);
+
+    for (; s + 8 <= samples; s += 8) {
+        __m128i raw = _mm_loadu_si128((const __m128i *) (iq + (s * 2)));
+
+        __m128i lo = _mm_sub_epi16(_mm_unpacklo_epi8(raw, zero), bias);
+        __m128i hi = _mm_sub_epi16(_mm_unpackhi_epi8(raw, zero), bias);
+
+        /* i*i + q*q of each pair as 32 bit */
+        __m128i mlo = _mm_madd_epi16(lo, lo);
+        __m128i mhi = _mm_madd_epi16(hi, hi);
+
+        /* Signed saturating pack of the biased values is exact for 0..32768 */
+        __m128i packed = _mm_packs_epi32(_mm_sub_epi32(mlo, bias32),
+                _mm_sub_epi32(mhi, bias32));
+
+        _mm_storeu_si128((__m128i *) (out + s), _mm_xor_si128(packed, sign16));
+    }
+#endif
+
+    for (; s < samples; s++) {
+        int i = (int) iq[s * 2] - 127;
+        int q = (int) iq[(s * 2) + 1] - 127;
+
+        out[s] = (uint16_t) ((i * i) + (q * q));
+    }
+}
+
+/* Flag every sample which starts a valid preamble, using the rtl_adsb test:  each of
+ * the high pulses (0, 2, 7, 9) must exceed the low samples which follow it.
+ *
+ * The test is written without branches so that the loop can be vectorized, and the
+ * flags are then searched with memchr. */
+static void flag_preambles(const uint16_t *m, size_t len, uint8_t *flags) {
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        const uint16_t *p = m + i;
+
+        unsigned int ok =
+            (p[0] > p[1]) & (p[2] > p[1]) &
+            (p[2] > p[3]) & (p[2] > p[4]) & (p[2] > p[5]) & (p[2] > p[6]) &
+            (p[7] > p[6]) & (p[7] > p[8]) & (p[9] > p[8]) &
+            (p[9] > p[10]) & (p[9] > p[11]) & (p[9] > p[12]) &
+            (p[9] > p[13]) & (p[9] > p[14]) & (p[9] > p[15]);
+
+        flags[i] = (uint8_t) ok;
+    }
+}
+
+/* Manchester decode the bits following the preamble at pos.
+ *
+ * Returns the sample position after the decoded bits, and fills frame if a full
+ * long frame was decoded. */
+static size_t decode_frame(const uint16_t *m, size_t pos, uint8_t *frame, int *complete) {
+    unsigned int a = m[pos];
+    unsigned int b = m[pos + 1];
+    unsigned int errors = 0;
+    unsigned int nbits = 0;
+    size_t ix = pos + ADSB_PREAMBLE_LEN;
+    size_t end = ix;
+
+    *complete = 0;
+
+    memset(frame, 0, ADSB_LONG_FRAME_B);
+
+    for (; nbits < ADSB_LONG_FRAME; ix += 2) {
+        unsigned int c = m[ix];
+        unsigned int d = m[ix + 1];
+        int bit_p = a > b;
+        int bit_c = c > d;
+        int bit = -1;
+
+        end = ix + 1;
+
+        if (bit_c && bit_p && c > b)
+            bit = 1;
+        else if (bit_c && !bit_p && d < b)
+            bit = 1;
+        else if (!bit_c && bit_p && d > b)
+            bit = 0;
+        else if (!bit_c && !bit_p && c < b)
+            bit = 0;
+
+        a = c;
+        b = d;
+
+        if (bit < 0) {
+            if (++errors > ADSB_ALLOWED_ERRORS)
+                return end;
+
+            bit = a > b;
+            a = 0;
+            b = 65535;
+        }
+
+        if (bit)
+            frame[nbits / 8] |= 1 << (7 - (nbits % 8));
+
+        nbits++;
+    }
+
+    /* Only long frames, which always have the high bit of the format set, are
+     * reported */
+    if (frame[0] & 0x80)
+        *complete = 1;
+
+    return end;
+}
+
+void rtladsb_demod_iq(rtladsb_demod_t *demod, const uint8_t *iq, size_t iq_len,
+        rtladsb_frame_cb cb, void *ctx) {
+    uint8_t frame[ADSB_LONG_FRAME_B];
+    size_t samples, total, limit, pos;
+    int complete;
+
+    if (iq_len > demod->max_iq_len)
+        iq_len = demod->max_iq_len;
+
+    samples = iq_len / 2;
+
+    iq_magnitude(iq, samples, demod->magnitude + demod->carry);
+
+    total = demod->carry + samples;
+
+    if (total < ADSB_MSG_SPAN) {
+        demod->carry = total;
+        return;
+    }
+
+    /* Any preamble before the limit has a complete message span in the block */
+    limit = total - ADSB_MSG_SPAN;
+
+    flag_preambles(demod->magnitude, limit, demod->candidates);
+
+    pos = demod->resume;
+
+    while (pos < limit) {
+        const uint8_t *c = (const uint8_t *) memchr(demod->candidates + pos, 1, limit - pos);
+
+        if (c == NULL)
+            break;
+
+        pos = c - demod->candidates;
+
+        pos = decode_frame(demod->magnitude, pos, frame, &complete);
+
+        if (complete) {
+            demod->frames++;
+            (*cb)(ctx, frame);
+        }
+    }
+
+    /* Carry the unsearched tail into the next block */
+    memmove(demod->magnitude, demod->magnitude + limit,
+            sizeof(uint16_t) * (total - limit));
+
+    demod->carry = total - limit;
+    demod->resume = pos > limit ? pos - limit : 0;
+}
+
+unsigned int rtladsb_len_by_type(unsigned int type) {
+    if (type == 16 || type == 17 || type == 19 || type == 20 || type == 21)
+        return ADSB_LONG_FRAME;
+
+    return ADSB_SHORT_FRAME;
+}
+
+uint32_t rtladsb_crc(const uint8_t *msg, unsigned int bits) {
+    unsigned int offset = (ADSB_LONG_FRAME - bits) / 8;
+    unsigned int nbytes = (bits / 8) - 3;
+    unsigned int i;
+    uint32_t crc = 0;
+
+    pthread_once(&adsb_tables_once, build_tables);
+
+    for (i = 0; i < nbytes; i++)
+        crc ^= modes_byte_table[i + offset][msg[i]];
+
+    return crc & 0x00FFFFFF;
+}
+
+uint32_t rtladsb_msg_crc(const uint8_t *msg, unsigned int bits) {
+    unsigned int n = bits / 8;
+
+    return ((uint32_t) msg[n - 3] << 16) | ((uint32_t) msg[n - 2] << 8) | msg[n - 1];
+}
+
+int rtladsb_fix_single_bit(uint8_t *msg, unsigned int bits) {
+    adsb_syndrome_t key, *found;
+    adsb_syndrome_t *syndromes;
+
+    pthread_once(&adsb_tables_once, build_tables);
+
+    if (bits == ADSB_LONG_FRAME)
+        syndromes = long_syndromes;
+    else
+        syndromes = short_syndromes;
+
+    key.syndrome = rtladsb_crc(msg, bits) ^ rtladsb_msg_crc(msg, bits);
+    key.bit = -1;
+
+    if (key.syndrome == 0)
+        return -1;
+
+    /* Lower bound, so a syndrome shared by several bits fixes the first one */
+    found = NULL;
+    {
+        size_t lo = 0, hi = bits;
+
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+
+            if (syndrome_cmp(&syndromes[mid], &key) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        if (lo < bits && syndromes[lo].syndrome == key.syndrome)
+            found = &syndromes[lo];
+    }
+
+    if (found == NULL)
+        return -1;
+
+    msg[found->bit / 8] ^= 1 << (7 - (found->bit % 8));
+
+    return found->bit;
+}
+
+static int adsb_ac13_altitude(const uint8_t *data) {
+    int m_bit = data[3] & (1 << 6);
+    int q_bit = data[3] & (1 << 4);
+
+    if (!m_bit && q_bit) {
+        /* N is the 11 bit integer resulting in the removal of bit q and m */
+        int n = (data[2] & 31) << 6;
+        n |= (data[3] & 0x80) >> 2;
+        n |= (data[3] & 0x20) >> 1;
+        n |= (data[3] & 0x15);
+
+        return n * 25 - 1000;
+    }
+
+    return 0;
+}
+
+static int adsb_ac12_altitude(const uint8_t *data) {
+    if (data[5] & 1) {
+        /* N is the 11 bit integer resulting from the removal of bit Q */
+        int n = (data[5] >> 1) << 4;
+        n |= (data[6] & 0xF0) >> 4;
+
+        return n * 25 - 1000;
+    }
+
+    return 0;
+}
+
+static void adsb_flight(const uint8_t *data, char *flight) {
+    static const char *ais_charset =
+        "?ABCDEFGHIJKLMNOPQRSTUVWXYZ????? ???????????????0123456789??????";
+    char raw[9];
+    size_t start = 0, end = 8;
+
+    raw[0] = ais_charset[data[5] >> 2];
+    raw[1] = ais_charset[((data[5] & 3) << 4) | (data[6] >> 4)];
+    raw[2] = ais_charset[((data[6] & 15) << 2) | (data[7] >> 6)];
+    raw[3] = ais_charset[data[7] & 63];
+    raw[4] = ais_charset[data[8] >> 2];
+    raw[5] = ais_charset[((data[8] & 3) << 4) | (data[9] >> 4)];
+    raw[6] = ais_charset[((data[9] & 15) << 2) | (data[10] >> 6)];
+    raw[7] = ais_charset[data[10] & 63];
+    raw[8] = 0;
+
+    while (start < end && raw[start] == ' ')
+        start++;
+    while (end > start && raw[end - 1] == ' ')
+        end--;
+
+    memcpy(flight, raw + start, end - start);
+    flight[end - start] = 0;
+}
+
+static void adsb_airborne_position(const uint8_t *data, int *even,
+        unsigned int *lat, unsigned int *lon) {
+    *even = (data[6] & (1 << 2)) == 0;
+
+    *lat = (data[6] & 3) << 15;
+    *lat |= data[7] << 7;
+    *lat |= data[8] >> 1;
+
+    *lon = (data[8] & 1) << 16;
+    *lon |= data[9] << 8;
+    *lon |= data[10];
+}
+
+static void adsb_airborne_velocity(const uint8_t *data, double *velocity, double *heading) {
+    int ew_dir = (data[5] & 4) >> 2;
+    int ew_velocity = ((data[5] & 3) << 8) | data[6];
+    int ns_dir = (data[7] & 0x80) >> 7;
+    int ns_velocity = ((data[7] & 0x7f) << 3) | ((data[8] & 0xe0) >> 5);
+    int ewv = ew_dir ? -ew_velocity : ew_velocity;
+    int nsv = ns_dir ? -ns_velocity : ns_velocity;
+
+    *velocity = sqrt((double) (ns_velocity * ns_velocity) + (ew_velocity * ew_velocity));
+
+    *heading = atan2(ewv, nsv) * 360 / (M_PI * 2);
+
+    if (*heading < 0)
+        *heading += 360;
+}
+
+static int adsb_sub3_heading(const uint8_t *data, double *heading) {
+    int h = ((data[5] & 3) << 5) | (data[6] >> 3);
+
+    *heading = h * (360.0 / 128);
+
+    return (data[5] & (1 << 2)) != 0;
+}
+
+static size_t hex_str(const uint8_t *data, size_t len, char *out) {
+    static const char *hex = "0123456789abcdef";
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        out[i * 2] = hex[data[i] >> 4];
+        out[(i * 2) + 1] = hex[data[i] & 0xF];
+    }
+
+    out[len * 2] = 0;
+
+    return len * 2;
+}
+
+size_t rtladsb_msg_json(const uint8_t *frame, char *json, size_t json_sz) {
+    uint8_t msg[ADSB_LONG_FRAME_B];
+    char raw_hex[(ADSB_LONG_FRAME_B * 2) + 1];
+    char msg_hex[(ADSB_LONG_FRAME_B * 2) + 1];
+    char icao_hex[7];
+    char flight[9];
+    unsigned int type, bits;
+    int crc_valid = 0, crc_recovered = 0;
+    size_t len;
+
+#define JSON_APPEND(...) \
+    do { \
+        if (len < json_sz) \
+            len += snprintf(json + len, json_sz - len, __VA_ARGS__); \
+    } while (0)
+
+    memcpy(msg, frame, ADSB_LONG_FRAME_B);
+
+    type = msg[0] >> 3;
+    bits = rtladsb_len_by_type(type);
+
+    hex_str(frame, ADSB_LONG_FRAME_B, raw_hex);
+
+    if (rtladsb_crc(msg, bits) == rtladsb_msg_crc(msg, bits)) {
+        crc_valid = 1;
+    } else if (type == 11 || type == 17) {
+        if (rtladsb_fix_single_bit(msg, bits) >= 0) {
+            crc_valid = 1;
+            crc_recovered = 1;
+        }
+    }
+
+    len = 0;
+
+    JSON_APPEND("{\"adsb_msg_type\": %u, \"adsb_raw_msg\": \"%s\", \"crc_valid\": %s",
+            type, raw_hex, crc_valid ? "true" : "false");
+
+    if (crc_recovered)
+        JSON_APPEND(", \"crc_recovered\": 1");
+
+    if (crc_valid) {
+        hex_str(msg, ADSB_LONG_FRAME_B, msg_hex);
+        hex_str(msg + 1, 3, icao_hex);
+
+        JSON_APPEND(", \"adsb_msg\": \"%s\", \"icao\": \"%s\"", msg_hex, icao_hex);
+
+        if (type == 17) {
+            unsigned int me = msg[4] >> 3;
+            unsigned int subme = msg[4] & 7;
+
+            if (me >= 1 && me <= 4) {
+                adsb_flight(msg, flight);
+                JSON_APPEND(", \"callsign\": \"%s\"", flight);
+            } else if (me >= 9 && me <= 18) {
+                int even;
+                unsigned int lat, lon;
+
+                adsb_airborne_position(msg, &even, &lat, &lon);
+
+                JSON_APPEND(", \"altitude\": %d, \"coordpair_even\": %s, "
+                        "\"raw_lat\": %u, \"raw_lon\": %u",
+                        adsb_ac12_altitude(msg), even ? "true" : "false", lat, lon);
+            } else if (me == 19 && (subme == 1 || subme == 2)) {
+                double velocity, heading;
+
+                adsb_airborne_velocity(msg, &velocity, &heading);
+
+                JSON_APPEND(", \"speed\": %f, \"heading\": %f", velocity, heading);
+            } else if (me == 19 && (subme == 3 || subme == 4)) {
+                double heading;
+
+                if (adsb_sub3_heading(msg, &heading))
+                    JSON_APPEND(", \"heading\": %f", heading);
+            }
+        } else if (type == 0 || type == 4 || type == 16 || type == 20) {
+            JSON_APPEND(", \"altitude\": %d", adsb_ac13_altitude(msg));
+        }
+    }
+
+    JSON_APPEND("}");
+
+#undef JSON_APPEND
+
+    return len < json_sz ? len : json_sz - 1;
+}
+
@@ -0,0 +1,117 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+      but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifndef __RTLADSB_DEMOD_H__
+#define __RTLADSB_DEMOD_H__
+
+/* Pure-C Mode S / ADSB demodulator for 8-bit unsigned IQ at 2Msps, as produced by
+ * rtlsdr radios and recorded by rtl_sdr.
+ *
+ * The demodulator follows the rtl_adsb / dump1090 logic used by the python
+ * rtladsb capture helper, but processes IQ in blocks:  the magnitude is computed
+ * with SSE2 where available, preamble candidates are flagged in a single
+ * branch-free pass over the block, and only the candidates are manchester decoded.
+ * CRC computation is table driven per message byte, and single-bit error
+ * correction is a lookup of the CRC syndrome.
+ *
+ * Messages which straddle two blocks are decoded; the tail of each block is
+ * carried over to the next one.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define ADSB_RATE           2000000
+#define ADSB_FREQ           1090000000
+
+#define ADSB_PREAMBLE_LEN   16
+#define ADSB_LONG_FRAME     112
+#define ADSB_SHORT_FRAME    56
+#define ADSB_LONG_FRAME_B   (ADSB_LONG_FRAME / 8)
+#define ADSB_SHORT_FRAME_B  (ADSB_SHORT_FRAME / 8)
+
+#define ADSB_ALLOWED_ERRORS 5
+
+/* Samples needed past the start of a preamble to decode a long frame */
+#define ADSB_MSG_SPAN       (ADSB_PREAMBLE_LEN + (ADSB_LONG_FRAME * 2))
+
+/* Maximum length of a JSON record from rtladsb_msg_json, including the NUL */
+#define ADSB_JSON_MAX       512
+
+/* Called for each long frame demodulated from the IQ stream */
+typedef void (*rtladsb_frame_cb)(void *ctx, const uint8_t *frame);
+
+typedef struct {
+    /* Magnitude of the current block, prefixed by the carry from the previous block */
+    uint16_t *magnitude;
+    /* Preamble candidate flags for the current block */
+    uint8_t *candidates;
+
+    /* Maximum IQ bytes per block */
+    size_t max_iq_len;
+
+    /* Samples carried over from the previous block */
+    size_t carry;
+    /* Offset into the carry where searching resumes */
+    size_t resume;
+
+    /* Frame statistics */
+    unsigned long frames;
+} rtladsb_demod_t;
+
+/* Allocate a demodulator for blocks of up to max_iq_len bytes of IQ.
+ *
+ * Returns:
+ * -1   Error
+ *  1   Success
+ */
+int rtladsb_demod_init(rtladsb_demod_t *demod, size_t max_iq_len);
+
+void rtladsb_demod_free(rtladsb_demod_t *demod);
+
+/* Drop any carried-over samples, for a discontinuity in the IQ stream */
+void rtladsb_demod_reset(rtladsb_demod_t *demod);
+
+/* Demodulate a block of interleaved IQ bytes; a trailing odd byte is ignored.
+ * cb is called with each long (112 bit) frame, in order. */
+void rtladsb_demod_iq(rtladsb_demod_t *demod, const uint8_t *iq, size_t iq_len,
+        rtladsb_frame_cb cb, void *ctx);
+
+/* Expected message length, in bits, for a downlink format */
+unsigned int rtladsb_len_by_type(unsigned int type);
+
+/* Checksum a message should have, over the leading bits - 24 bits */
+uint32_t rtladsb_crc(const uint8_t *msg, unsigned int bits);
+
+/* Checksum encoded in the last 24 bits of a message */
+uint32_t rtladsb_msg_crc(const uint8_t *msg, unsigned int bits);
+
+/* Correct a single bit error in place using the checksum syndrome.
+ *
+ * Returns:
+ * -1   No single bit error explains the checksum
+ *  N   Index of the bit which was corrected
+ */
+int rtladsb_fix_single_bit(uint8_t *msg, unsigned int bits);
+
+/* Decode a long frame into the JSON record sent to the rtladsb phy, with the same
+ * fields as the python capture helper.  Returns the length of the record. */
+size_t rtladsb_msg_json(const uint8_t *frame, char *json, size_t json_sz);
+
+#endif
+
@@ -405,7 +405,10 @@ namespace kissqlite3 {
 
             sqlite3_stmt *stmt_raw;
             auto str = os.str();
-            r = sqlite3_prepare(db, str.c_str(), os.str().length(), &stmt_raw, &pz);
+
+            // prepare_v2 lets SQLite re-plan with the bound values, which it needs before
+            // it will use an index for a LIKE comparison against a bound pattern
+            r = sqlite3_prepare_v2(db, str.c_str(), os.str().length(), &stmt_raw, &pz);
 
             if (r != SQLITE_OK)
                 throw std::runtime_error("Failed to prepare statement: " + os.str() + " " + 
@@ -133,6 +133,40 @@ Systemmonitor::Systemmonitor() :
                 return tse;
             });
 
+    lock_contention_endp =
+        std::make_shared<kis_net_httpd_simple_tracked_endpoint>("/system/lock_contention",
+            [this](void) -> std::shared_ptr<tracker_element> {
+                auto ret = std::make_shared<tracker_element_vector>();
+
+                for (const auto& s : kis_lock_profile_collect()) {
+                    auto l = std::make_shared<tracked_lock_contention>();
+                    l->set_from_stats(s);
+                    ret->push_back(l);
+                }
+
+                return ret;
+            });
+
+    // Turn lock profiling on or off and optionally clear the profile
+    lock_profile_endp =
+        std::make_shared<kis_net_httpd_simple_post_endpoint>("/system/lock_contention/configure",
+            [](std::ostream& stream, const std::string& uri, const Json::Value& json,
+                kis_net_httpd_connection::variable_cache_map& variable_cache) -> unsigned int {
+                try {
+                    if (json.isMember("enable"))
+                        kis_lock_profiling = json["enable"].asBool();
+
+                    if (json.get("reset", false).asBool())
+                        kis_lock_profile_reset();
+                } catch (const std::exception& e) {
+                    stream << "Invalid request: " << e.what() << "\n";
+                    return 500;
+                }
+
+                stream << "Lock profiling " << (kis_lock_profiling ? "enabled" : "disabled") << "\n";
+                return 200;
+            });
+
     if (Globalreg::globalreg->kismet_config->fetch_opt_bool("kis_log_system_status", true)) {
         auto snap_time_s = 
             Globalreg::globalreg->kismet_config->fetch_opt_as<unsigned int>("kis_log_system_status_rate", 30);
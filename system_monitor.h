@@ -131,6 +131,106 @@ protected:
     std::shared_ptr<tracker_element_uint64> num_components;
 };
 
+// Lock contention profile of one mutex taken by one locker, see kis_mutex.h
+class tracked_lock_contention : public tracker_component {
+public:
+    tracked_lock_contention() :
+        tracker_component() {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    tracked_lock_contention(int in_id) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(NULL);
+    }
+
+    tracked_lock_contention(int in_id, std::shared_ptr<tracker_element_map> e) :
+        tracker_component(in_id) {
+        register_fields();
+        reserve_fields(e);
+    }
+
+    tracked_lock_contention(const tracked_lock_contention *p) :
+        tracker_component{p} {
+
+        __ImportField(mutex_name, p);
+        __ImportField(locker_name, p);
+        __ImportField(shared, p);
+        __ImportField(num_locks, p);
+        __ImportField(num_contended, p);
+        __ImportField(wait_ns, p);
+        __ImportField(max_wait_ns, p);
+        __ImportField(hold_ns, p);
+        __ImportField(max_hold_ns, p);
+
+        reserve_fields(nullptr);
+    }
+
+    virtual uint32_t get_signature() const override {
+        return adler32_checksum("tracked_lock_contention");
+    }
+
+    virtual std::unique_ptr<tracker_element> clone_type() override {
+        using this_t = std::remove_pointer<decltype(this)>::type;
+        auto dup = std::unique_ptr<this_t>(new this_t(this));
+        return std::move(dup);
+    }
+
+    void set_from_stats(const kis_lock_profile_stats& s) {
+        set_mutex_name(s.mutex_name);
+        set_locker_name(s.locker_name);
+        set_shared(s.shared);
+        set_num_locks(s.count);
+        set_num_contended(s.contended);
+        set_wait_ns(s.wait_ns);
+        set_max_wait_ns(s.max_wait_ns);
+        set_hold_ns(s.hold_ns);
+        set_max_hold_ns(s.max_hold_ns);
+    }
+
+    __Proxy(mutex_name, std::string, std::string, std::string, mutex_name);
+    __Proxy(locker_name, std::string, std::string, std::string, locker_name);
+    __Proxy(shared, uint8_t, bool, bool, shared);
+    __Proxy(num_locks, uint64_t, uint64_t, uint64_t, num_locks);
+    __Proxy(num_contended, uint64_t, uint64_t, uint64_t, num_contended);
+    __Proxy(wait_ns, uint64_t, uint64_t, uint64_t, wait_ns);
+    __Proxy(max_wait_ns, uint64_t, uint64_t, uint64_t, max_wait_ns);
+    __Proxy(hold_ns, uint64_t, uint64_t, uint64_t, hold_ns);
+    __Proxy(max_hold_ns, uint64_t, uint64_t, uint64_t, max_hold_ns);
+
+protected:
+    virtual void register_fields() override {
+        tracker_component::register_fields();
+
+        register_field("kismet.system.lock.mutex", "mutex name", &mutex_name);
+        register_field("kismet.system.lock.locker", "locker name", &locker_name);
+        register_field("kismet.system.lock.shared", "shared (read) lock", &shared);
+        register_field("kismet.system.lock.count", "number of locks", &num_locks);
+        register_field("kismet.system.lock.contended", "number of locks which waited", 
+                &num_contended);
+        register_field("kismet.system.lock.wait_ns", "total wait for the lock, in nanoseconds",
+                &wait_ns);
+        register_field("kismet.system.lock.max_wait_ns", "longest wait, in nanoseconds",
+                &max_wait_ns);
+        register_field("kismet.system.lock.hold_ns", "total time held, in nanoseconds",
+                &hold_ns);
+        register_field("kismet.system.lock.max_hold_ns", "longest hold, in nanoseconds",
+                &max_hold_ns);
+    }
+
+    std::shared_ptr<tracker_element_string> mutex_name;
+    std::shared_ptr<tracker_element_string> locker_name;
+    std::shared_ptr<tracker_element_uint8> shared;
+    std::shared_ptr<tracker_element_uint64> num_locks;
+    std::shared_ptr<tracker_element_uint64> num_contended;
+    std::shared_ptr<tracker_element_uint64> wait_ns;
+    std::shared_ptr<tracker_element_uint64> max_wait_ns;
+    std::shared_ptr<tracker_element_uint64> hold_ns;
+    std::shared_ptr<tracker_element_uint64> max_hold_ns;
+};
+
 class Systemmonitor : public lifetime_global, public time_tracker_event {
 public:
     static std::string global_name() { return "SYSTEMMONITOR"; }
@@ -161,6 +261,9 @@ protected:
     std::shared_ptr<kis_net_httpd_simple_unauth_tracked_endpoint> user_monitor_endp;
     std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> timestamp_endp;
 
+    std::shared_ptr<kis_net_httpd_simple_tracked_endpoint> lock_contention_endp;
+    std::shared_ptr<kis_net_httpd_simple_post_endpoint> lock_profile_endp;
+
     std::shared_ptr<device_tracker> devicetracker;
 
     std::shared_ptr<tracked_system_status> status;
@@ -38,6 +38,12 @@ time_tracker::time_tracker() {
 
     shutdown = false;
 
+    virtual_clock = false;
+    pending_switch = clock_switch::none;
+    virtual_users = 0;
+    virtual_base_usec = 0;
+    virtual_scale = 1;
+
     /*
     time_dispatch_t =
         std::thread([this]() {
@@ -74,11 +80,13 @@ time_tracker::~time_tracker() {
 }
 
 void time_tracker::tick() {
+    apply_clock_switch();
+
     local_demand_locker lock(&time_mutex);
 
     // Handle scheduled events
     struct timeval cur_tm;
-    gettimeofday(&cur_tm, NULL);
+    now(&cur_tm);
     Globalreg::globalreg->timestamp.tv_sec = cur_tm.tv_sec;
     Globalreg::globalreg->timestamp.tv_usec = cur_tm.tv_usec;
 
@@ -165,15 +173,17 @@ void time_tracker::tick() {
 
 void time_tracker::time_dispatcher() {
     while (!shutdown && !Globalreg::globalreg->spindown && !Globalreg::globalreg->fatal_condition) {
+        apply_clock_switch();
+
         local_demand_locker lock(&time_mutex, "timetracker::time_dispatcher");
 
         // Calculate the next tick
         auto start = std::chrono::system_clock::now();
-        auto end = start + std::chrono::milliseconds(1000 / SERVER_TIMESLICES_SEC);
+        auto end = start + tick_interval();
 
         // Handle scheduled events
         struct timeval cur_tm;
-        gettimeofday(&cur_tm, NULL);
+        now(&cur_tm);
         Globalreg::globalreg->timestamp.tv_sec = cur_tm.tv_sec;
         Globalreg::globalreg->timestamp.tv_usec = cur_tm.tv_usec;
 
@@ -278,7 +288,7 @@ int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
     timer_event *evt = new timer_event;
 
     evt->timer_id = next_timer_id++;
-    gettimeofday(&(evt->schedule_tm), NULL);
+    now(&(evt->schedule_tm));
 
     if (in_trigger != NULL) {
         evt->trigger_tm.tv_sec = in_trigger->tv_sec;
@@ -313,7 +323,7 @@ int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
     evt->timer_cancelled = false;
     evt->timer_id = next_timer_id++;
 
-    gettimeofday(&(evt->schedule_tm), NULL);
+    now(&(evt->schedule_tm));
 
     if (in_trigger != NULL) {
         evt->trigger_tm.tv_sec = in_trigger->tv_sec;
@@ -357,7 +367,7 @@ int time_tracker::register_timer(int in_timeslices, struct timeval *in_trigger,
     evt->timer_cancelled = false;
     evt->timer_id = next_timer_id++;
 
-    gettimeofday(&(evt->schedule_tm), NULL);
+    now(&(evt->schedule_tm));
 
     if (in_trigger != NULL) {
         evt->trigger_tm.tv_sec = in_trigger->tv_sec;
@@ -402,7 +412,7 @@ int time_tracker::register_timer(const slice& in_timeslices,
     timer_event *evt = new timer_event;
 
     evt->timer_id = next_timer_id++;
-    gettimeofday(&(evt->schedule_tm), NULL);
+    now(&(evt->schedule_tm));
 
     evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + (in_timeslices.count() / 10);
     evt->trigger_tm.tv_usec = evt->schedule_tm.tv_usec + (in_timeslices.count() % 10);
@@ -436,7 +446,7 @@ int time_tracker::register_timer(const slice& in_timeslices,
     evt->timer_cancelled = false;
     evt->timer_id = next_timer_id++;
 
-    gettimeofday(&(evt->schedule_tm), NULL);
+    now(&(evt->schedule_tm));
 
     evt->trigger_tm.tv_sec = evt->schedule_tm.tv_sec + 
         (in_timeslices.count() / SERVER_TIMESLICES_SEC);
@@ -486,3 +496,140 @@ int time_tracker::remove_timer(int in_timerid) {
     return 1;
 }
 
+void time_tracker::now(struct timeval *tv) {
+    if (!virtual_clock) {
+        gettimeofday(tv, NULL);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(clock_mutex);
+
+    if (!virtual_clock) {
+        gettimeofday(tv, NULL);
+        return;
+    }
+
+    auto usec = virtual_now_usec();
+
+    tv->tv_sec = usec / 1000000L;
+    tv->tv_usec = usec % 1000000L;
+}
+
+int64_t time_tracker::virtual_now_usec() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - virtual_base_real).count();
+
+    return virtual_base_usec + (int64_t) (elapsed * virtual_scale);
+}
+
+void time_tracker::begin_virtual_time() {
+    std::lock_guard<std::mutex> lk(clock_mutex);
+    virtual_users++;
+
+    // A new replay before the last one's switch back applied stays on the virtual clock
+    if (pending_switch == clock_switch::leave)
+        pending_switch = clock_switch::none;
+}
+
+void time_tracker::end_virtual_time() {
+    std::lock_guard<std::mutex> lk(clock_mutex);
+
+    if (virtual_users == 0)
+        return;
+
+    if (--virtual_users > 0)
+        return;
+
+    if (pending_switch == clock_switch::enter)
+        pending_switch = clock_switch::none;
+    else if (virtual_clock)
+        pending_switch = clock_switch::leave;
+}
+
+void time_tracker::advance_virtual_time(const struct timeval& in_tv, double in_scale) {
+    auto in_usec = (int64_t) in_tv.tv_sec * 1000000L + in_tv.tv_usec;
+
+    if (in_scale <= 0)
+        in_scale = 1;
+
+    std::lock_guard<std::mutex> lk(clock_mutex);
+
+    if (!virtual_clock && pending_switch != clock_switch::enter) {
+        if (virtual_users == 0)
+            return;
+
+        // The timers are moved into the capture time by the next tick
+        virtual_base_usec = in_usec;
+        virtual_base_real = std::chrono::steady_clock::now();
+        virtual_scale = in_scale;
+
+        pending_switch = clock_switch::enter;
+
+        return;
+    }
+
+    // Between packets the clock runs ahead at the replay speed; a packet only moves it
+    // if the clock has fallen behind the capture
+    auto cur_usec = virtual_now_usec();
+
+    virtual_base_usec = std::max(cur_usec, in_usec);
+    virtual_base_real = std::chrono::steady_clock::now();
+    virtual_scale = in_scale;
+}
+
+void time_tracker::apply_clock_switch() {
+    if (pending_switch == clock_switch::none)
+        return;
+
+    local_locker l(&time_mutex);
+    std::lock_guard<std::mutex> lk(clock_mutex);
+
+    struct timeval real_tm;
+    gettimeofday(&real_tm, NULL);
+
+    auto real_usec = (int64_t) real_tm.tv_sec * 1000000L + real_tm.tv_usec;
+
+    if (pending_switch == clock_switch::enter) {
+        shift_timers(virtual_now_usec() - real_usec);
+        virtual_clock = true;
+    } else if (pending_switch == clock_switch::leave) {
+        shift_timers(real_usec - virtual_now_usec());
+        virtual_clock = false;
+    }
+
+    pending_switch = clock_switch::none;
+}
+
+void time_tracker::shift_timers(int64_t in_usec) {
+    auto shift_tv = [in_usec](struct timeval& tv) {
+        auto usec = (int64_t) tv.tv_sec * 1000000L + tv.tv_usec + in_usec;
+        tv.tv_sec = usec / 1000000L;
+        tv.tv_usec = usec % 1000000L;
+    };
+
+    for (auto t : timer_map) {
+        shift_tv(t.second->schedule_tm);
+        shift_tv(t.second->trigger_tm);
+    }
+}
+
+std::chrono::microseconds time_tracker::tick_interval() {
+    auto base = std::chrono::microseconds(1000000L / SERVER_TIMESLICES_SEC);
+
+    if (!virtual_clock)
+        return base;
+
+    double scale;
+
+    {
+        std::lock_guard<std::mutex> lk(clock_mutex);
+        scale = virtual_scale;
+    }
+
+    // Keep a timeslice of virtual time per tick, down to a 1ms floor
+    if (scale <= 1)
+        return base;
+
+    return std::max(std::chrono::microseconds(1000), 
+            std::chrono::microseconds((int64_t) (base.count() / scale)));
+}
@@ -25,6 +25,7 @@
 #include <chrono>
 #include <list>
 #include <map>
+#include <mutex>
 #include <stdio.h>
 #include <string>
 #include <time.h>
@@ -131,6 +132,23 @@ public:
 
     void spawn_timetracker_thread();
 
+    // Current server time.  While a replay source is driving the virtual clock, this
+    // is the capture time of the replay, advancing at the replay speed between packets;
+    // timers, globalreg->timestamp, and everything keyed from them follow it.
+    void now(struct timeval *tv);
+
+    // Replay sources register for the virtual clock when they start injecting time
+    // and release it when they close; the server returns to the system clock when
+    // the last one is released.  Pending timers are moved across each switch so they
+    // keep their remaining delay.  Switches take effect at the start of the next
+    // timer tick, so that no timer is fired or rescheduled across a switch.
+    void begin_virtual_time();
+    void end_virtual_time();
+
+    // Move the virtual clock forward to a capture timestamp and set how fast it runs
+    // between packets.  The virtual clock never moves backwards.
+    void advance_virtual_time(const struct timeval& in_tv, double in_scale);
+
 protected:
     kis_recursive_timed_mutex time_mutex;
 
@@ -150,6 +168,32 @@ protected:
 
     std::thread time_dispatch_t;
     std::atomic<bool> shutdown;
+
+    // Virtual clock; set once a replay source has injected a timestamp.  Lock order
+    // is time_mutex, then clock_mutex.
+    std::atomic<bool> virtual_clock;
+
+    // Clock switch requested by the replay sources, applied by the tick between firing
+    // timers.  While entering is pending the virtual base is already maintained.
+    enum class clock_switch { none, enter, leave };
+    std::atomic<clock_switch> pending_switch;
+    std::mutex clock_mutex;
+    unsigned int virtual_users;
+    int64_t virtual_base_usec;
+    std::chrono::steady_clock::time_point virtual_base_real;
+    double virtual_scale;
+
+    // Virtual time now, in usec; clock_mutex must be held
+    int64_t virtual_now_usec();
+
+    // Move every pending timer by an offset; time_mutex must be held
+    void shift_timers(int64_t in_usec);
+
+    // Apply a pending clock switch; only called by the tick, before it reads the time
+    void apply_clock_switch();
+
+    // Time between dispatcher ticks, shortened while the virtual clock runs fast
+    std::chrono::microseconds tick_interval();
 };
 
 class time_tracker_event {
@@ -0,0 +1,1040 @@
+/*
+    This file is part of Kismet
+
+    Kismet is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    Kismet is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Kismet; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+ * Packet chain benchmark.
+ *
+ * Builds the global registry, phys, and trackers the same way the server does, but
+ * without starting the webserver, datasources, or the timer thread, and runs a
+ * workload of packets through the packet chain on the calling thread.  The workload
+ * is either read from pcap files or generated as a mix of 802.11 beacons, probe
+ * requests, and data frames from a fixed population of devices.
+ *
+ * Reports the time spent per packet in each chain stage, C++ heap allocations per
+ * packet, and the heap held by the device table once the workload has run.
+ *
+ * Every packet is processed to completion before the next, so the results measure
+ * the cost of the chain handlers, not the packet queue or lock contention.
+ *
+ * With --locks, instead compares the mutex implementations in kis_mutex.h under the
+ * same locker classes the rest of Kismet uses, uncontended and across threads.
+ *
+ * With --components, instead builds device records with and without their fixed
+ * fields packed into a slab, and compares the allocations and heap per record.
+ */
+
+#include "config.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <pcap.h>
+
+#include "getopt.h"
+#include "fmt.h"
+#include "util.h"
+
+#include "globalregistry.h"
+#include "configfile.h"
+#include "messagebus.h"
+#include "entrytracker.h"
+#include "eventbus.h"
+#include "json_adapter.h"
+#include "manuf.h"
+#include "timetracker.h"
+#include "alertracker.h"
+
+#include "kis_net_microhttpd.h"
+#include "kis_httpd_websession.h"
+#include "kis_httpd_registry.h"
+#include "ipctracker_v2.h"
+#include "streamtracker.h"
+
+#include "packet.h"
+#include "packetchain.h"
+#include "packet_tap.h"
+#include "dlttracker.h"
+#include "antennatracker.h"
+#include "kis_datasource.h"
+#include "datasourcetracker.h"
+#include "datasource_virtual.h"
+#include "channeltracker2.h"
+
+#include "kis_dlt_ppi.h"
+#include "kis_dlt_radiotap.h"
+#include "kis_dlt_btle_ll_radio.h"
+#include "kis_dissector_ipdata.h"
+
+#include "devicetracker.h"
+#include "phy_80211.h"
+#include "phy_rtl433.h"
+#include "phy_rtlamr.h"
+#include "phy_rtladsb.h"
+#include "phy_zwave.h"
+#include "phy_bluetooth.h"
+#include "phy_uav_drone.h"
+#include "phy_nrf_mousejack.h"
+#include "phy_btle.h"
+
+#include "gpstracker.h"
+#include "logtracker.h"
+#include "kis_databaselogfile.h"
+
+#ifndef exec_name
+char *exec_name;
+#endif
+
+// C++ heap accounting.  Every allocation carries a header with its size so that the
+// live heap can be tracked without depending on the allocator.
+namespace {
+    std::atomic<uint64_t> bench_allocs{0};
+    std::atomic<uint64_t> bench_alloc_bytes{0};
+    std::atomic<int64_t> bench_live_bytes{0};
+
+    const size_t bench_alloc_hdr = alignof(std::max_align_t) > sizeof(size_t) ?
+        alignof(std::max_align_t) : sizeof(size_t);
+
+    void *bench_alloc(size_t sz) {
+        auto p = static_cast<uint8_t *>(malloc(sz + bench_alloc_hdr));
+
+        if (p == nullptr)
+            return nullptr;
+
+        *reinterpret_cast<size_t *>(p) = sz;
+
+        bench_allocs.fetch_add(1, std::memory_order_relaxed);
+        bench_alloc_bytes.fetch_add(sz, std::memory_order_relaxed);
+        bench_live_bytes.fetch_add(sz, std::memory_order_relaxed);
+
+        return p + bench_alloc_hdr;
+    }
+
+    void bench_free(void *ptr) {
+        if (ptr == nullptr)
+            return;
+
+        auto p = static_cast<uint8_t *>(ptr) - bench_alloc_hdr;
+
+        bench_live_bytes.fetch_sub(*reinterpret_cast<size_t *>(p), std::memory_order_relaxed);
+
+        free(p);
+    }
+}
+
+void *operator new(size_t sz) {
+    auto p = bench_alloc(sz);
+
+    if (p == nullptr)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void *operator new[](size_t sz) {
+    return operator new(sz);
+}
+
+void *operator new(size_t sz, const std::nothrow_t&) noexcept {
+    return bench_alloc(sz);
+}
+
+void *operator new[](size_t sz, const std::nothrow_t&) noexcept {
+    return bench_alloc(sz);
+}
+
+void operator delete(void *ptr) noexcept {
+    bench_free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    bench_free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    bench_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    bench_free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t&) noexcept {
+    bench_free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t&) noexcept {
+    bench_free(ptr);
+}
+
+class bench_message_client : public message_client {
+public:
+    bench_message_client(global_registry *in_globalreg, bool in_verbose) :
+        message_client(in_globalreg, nullptr),
+        verbose{in_verbose} { }
+    virtual ~bench_message_client() { }
+
+    void process_message(std::string in_msg, int in_flags) override {
+        if (in_flags & (MSGFLAG_ERROR | MSGFLAG_FATAL))
+            fprintf(stderr, "%s: %s\n", (in_flags & MSGFLAG_FATAL) ? "FATAL" : "ERROR",
+                    in_msg.c_str());
+        else if (verbose)
+            fprintf(stderr, "%s\n", in_msg.c_str());
+    }
+
+protected:
+    bool verbose;
+};
+
+// A frame of the workload, held in memory so that reading the workload isn't measured
+struct bench_frame {
+    struct timeval ts;
+    int dlt;
+    std::vector<uint8_t> data;
+};
+
+void load_pcap(const std::string& in_fname, std::vector<bench_frame>& frames) {
+    char errstr[PCAP_ERRBUF_SIZE] = "";
+
+    auto pd = pcap_open_offline(in_fname.c_str(), errstr);
+
+    if (pd == nullptr)
+        throw std::runtime_error(fmt::format("unable to open pcap '{}': {}", in_fname, errstr));
+
+    auto dlt = pcap_datalink(pd);
+
+    struct pcap_pkthdr *hdr;
+    const u_char *data;
+    int r;
+
+    while ((r = pcap_next_ex(pd, &hdr, &data)) == 1) {
+        bench_frame f;
+
+        f.ts = hdr->ts;
+        f.dlt = dlt;
+        f.data.assign(data, data + hdr->caplen);
+
+        frames.push_back(std::move(f));
+    }
+
+    if (r == -1) {
+        auto err = fmt::format("error reading pcap '{}': {}", in_fname, pcap_geterr(pd));
+        pcap_close(pd);
+        throw std::runtime_error(err);
+    }
+
+    pcap_close(pd);
+}
+
+// Synthetic 802.11 frames, without radiotap headers or an FCS
+namespace synthetic {
+    const int dlt_ieee80211 = 105;
+
+    void put_mac(std::vector<uint8_t>& d, uint8_t in_kind, unsigned int in_n) {
+        // Locally administered addresses, numbered per kind of device
+        d.push_back(0x02);
+        d.push_back(in_kind);
+        d.push_back((in_n >> 24) & 0xFF);
+        d.push_back((in_n >> 16) & 0xFF);
+        d.push_back((in_n >> 8) & 0xFF);
+        d.push_back(in_n & 0xFF);
+    }
+
+    void put_bcast(std::vector<uint8_t>& d) {
+        d.insert(d.end(), 6, 0xFF);
+    }
+
+    void put_seq(std::vector<uint8_t>& d, unsigned int in_seq) {
+        d.push_back((in_seq << 4) & 0xF0);
+        d.push_back((in_seq >> 4) & 0xFF);
+    }
+
+    void put_rates(std::vector<uint8_t>& d) {
+        const uint8_t rates[] = { 0x01, 0x08, 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24 };
+        d.insert(d.end(), rates, rates + sizeof(rates));
+    }
+
+    void put_ssid(std::vector<uint8_t>& d, const std::string& in_ssid) {
+        d.push_back(0x00);
+        d.push_back(in_ssid.length());
+        d.insert(d.end(), in_ssid.begin(), in_ssid.end());
+    }
+
+    std::string ap_ssid(unsigned int in_ap) {
+        return fmt::format("bench-{}", in_ap);
+    }
+
+    unsigned int ap_channel(unsigned int in_ap) {
+        const unsigned int channels[] = { 1, 6, 11, 36, 44, 149 };
+        return channels[in_ap % 6];
+    }
+
+    std::vector<uint8_t> beacon(unsigned int in_ap, unsigned int in_seq, uint64_t in_tsf) {
+        std::vector<uint8_t> d = { 0x80, 0x00, 0x00, 0x00 };
+
+        put_bcast(d);
+        put_mac(d, 0x00, in_ap);
+        put_mac(d, 0x00, in_ap);
+        put_seq(d, in_seq);
+
+        for (unsigned int i = 0; i < 8; i++)
+            d.push_back((in_tsf >> (i * 8)) & 0xFF);
+
+        // 100TU interval, ESS and short slot
+        d.push_back(0x64);
+        d.push_back(0x00);
+        d.push_back(0x01);
+        d.push_back(0x04);
+
+        put_ssid(d, ap_ssid(in_ap));
+        put_rates(d);
+
+        d.push_back(0x03);
+        d.push_back(0x01);
+        d.push_back(ap_channel(in_ap));
+
+        return d;
+    }
+
+    std::vector<uint8_t> probe_req(unsigned int in_client, unsigned int in_seq, int in_ap) {
+        std::vector<uint8_t> d = { 0x40, 0x00, 0x00, 0x00 };
+
+        put_bcast(d);
+        put_mac(d, 0x01, in_client);
+        put_bcast(d);
+        put_seq(d, in_seq);
+
+        // Directed probe if a network is given, otherwise wildcard
+        put_ssid(d, in_ap < 0 ? "" : ap_ssid(in_ap));
+        put_rates(d);
+
+        return d;
+    }
+
+    std::vector<uint8_t> data(unsigned int in_client, unsigned int in_ap, unsigned int in_seq) {
+        // To-DS data from a client through its network
+        std::vector<uint8_t> d = { 0x08, 0x01, 0x00, 0x00 };
+
+        put_mac(d, 0x00, in_ap);
+        put_mac(d, 0x01, in_client);
+        put_mac(d, 0x00, in_ap);
+        put_seq(d, in_seq);
+
+        // LLC/SNAP, IPv4
+        const uint8_t llc[] = { 0xaa, 0xaa, 0x03, 0x00, 0x00, 0x00, 0x08, 0x00 };
+        d.insert(d.end(), llc, llc + sizeof(llc));
+
+        const unsigned int payload_len = 32;
+        const unsigned int udp_len = 8 + payload_len;
+        const unsigned int ip_len = 20 + udp_len;
+
+        const uint8_t ip[] = {
+            0x45, 0x00, (uint8_t) (ip_len >> 8), (uint8_t) ip_len,
+            (uint8_t) (in_seq >> 8), (uint8_t) in_seq, 0x00, 0x00,
+            0x40, 0x11, 0x00, 0x00,
+            10, (uint8_t) (in_client >> 16), (uint8_t) (in_client >> 8), (uint8_t) in_client,
+            10, 0, 0, 1
+        };
+        d.insert(d.end(), ip, ip + sizeof(ip));
+
+        const uint8_t udp[] = {
+            (uint8_t) ((1024 + in_client % 60000) >> 8), (uint8_t) (1024 + in_client % 60000),
+            0x00, 0x35,
+            (uint8_t) (udp_len >> 8), (uint8_t) udp_len, 0x00, 0x00
+        };
+        d.insert(d.end(), udp, udp + sizeof(udp));
+
+        d.insert(d.end(), payload_len, 0x00);
+
+        return d;
+    }
+
+    // Generate in_packets frames from in_devices devices, a quarter of them access
+    // points, with beacons, probes, and data in the weights given
+    void generate(std::vector<bench_frame>& frames, unsigned long in_packets,
+            unsigned int in_devices, unsigned int in_w_beacon, unsigned int in_w_probe,
+            unsigned int in_w_data, unsigned int in_seed) {
+
+        auto n_aps = std::max(1U, in_devices / 4);
+        auto n_clients = std::max(1U, in_devices - std::min(in_devices, n_aps));
+
+        std::mt19937 rng(in_seed);
+        std::discrete_distribution<int> kind({ (double) in_w_beacon, (double) in_w_probe,
+                (double) in_w_data });
+        std::uniform_int_distribution<unsigned int> pick_ap(0, n_aps - 1);
+        std::uniform_int_distribution<unsigned int> pick_client(0, n_clients - 1);
+
+        struct timeval ts;
+        gettimeofday(&ts, nullptr);
+
+        frames.reserve(frames.size() + in_packets);
+
+        for (unsigned long i = 0; i < in_packets; i++) {
+            bench_frame f;
+
+            // 10,000 packets a second
+            f.ts.tv_sec = ts.tv_sec + (i / 10000);
+            f.ts.tv_usec = (i % 10000) * 100;
+            f.dlt = dlt_ieee80211;
+
+            switch (kind(rng)) {
+                case 0:
+                    f.data = beacon(i % n_aps, i, (uint64_t) i * 100);
+                    break;
+                case 1: {
+                    auto c = pick_client(rng);
+                    f.data = probe_req(c, i, (c % 2) ? (int) (c % n_aps) : -1);
+                    break;
+                }
+                default: {
+                    auto c = pick_client(rng);
+                    f.data = data(c, c % n_aps, i);
+                    break;
+                }
+            }
+
+            frames.push_back(std::move(f));
+        }
+    }
+}
+
+// Mutex benchmark
+namespace lockbench {
+    enum class workload { exclusive, recursive, shared, mixed };
+
+    // Run n_ops locks on each of n_threads threads; returns the wall time per lock, in
+    // nanoseconds, across all threads
+    template<typename M>
+    double run(workload w, unsigned int n_threads, unsigned long n_ops) {
+        typedef kis_basic_local_locker<M> locker_t;
+        typedef kis_basic_local_shared_locker<M> shared_locker_t;
+
+        M mutex;
+        mutex.set_name("kismet_bench");
+
+        uint64_t value = 0;
+        std::atomic<uint64_t> sink{0};
+        std::atomic<unsigned int> ready{0};
+        std::atomic<bool> go{false};
+
+        auto worker = [&](unsigned int t) {
+            uint64_t local = 0;
+
+            ready++;
+            while (!go)
+                std::this_thread::yield();
+
+            switch (w) {
+                case workload::exclusive:
+                    for (unsigned long i = 0; i < n_ops; i++) {
+                        locker_t l(&mutex, "bench_exclusive");
+                        value++;
+                    }
+                    break;
+
+                case workload::recursive: {
+                    locker_t outer(&mutex, "bench_outer");
+
+                    for (unsigned long i = 0; i < n_ops; i++) {
+                        locker_t l(&mutex, "bench_recursive");
+                        value++;
+                    }
+                    break;
+                }
+
+                case workload::shared:
+                    for (unsigned long i = 0; i < n_ops; i++) {
+                        shared_locker_t l(&mutex, "bench_shared");
+                        local += value;
+                    }
+                    break;
+
+                case workload::mixed:
+                    // One write per ten locks
+                    for (unsigned long i = 0; i < n_ops; i++) {
+                        if ((i + t) % 10 == 0) {
+                            locker_t l(&mutex, "bench_mixed_write");
+                            value++;
+                        } else {
+                            shared_locker_t l(&mutex, "bench_mixed_read");
+                            local += value;
+                        }
+                    }
+                    break;
+            }
+
+            sink += local;
+        };
+
+        std::vector<std::thread> threads;
+
+        for (unsigned int t = 0; t < n_threads; t++)
+            threads.push_back(std::thread(worker, t));
+
+        while (ready < n_threads)
+            std::this_thread::yield();
+
+        auto start_tm = std::chrono::steady_clock::now();
+
+        go = true;
+
+        for (auto& t : threads)
+            t.join();
+
+        auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_tm).count();
+
+        return (double) elapsed_ns / (n_ops * n_threads);
+    }
+
+    void compare(const char *name, workload w, unsigned int n_threads, unsigned long n_ops) {
+        auto legacy_ns = run<kis_legacy_recursive_timed_mutex>(w, n_threads, n_ops);
+        auto shared_ns = run<kis_recursive_shared_mutex>(w, n_threads, n_ops);
+
+        printf("%-28s %8u %14.1f %14.1f %9.2fx\n", name, n_threads,
+                legacy_ns, shared_ns, shared_ns > 0 ? legacy_ns / shared_ns : 0);
+    }
+
+    void run_all(unsigned int n_threads, unsigned long n_ops) {
+        printf("Mutex benchmark, %lu locks per thread, wall time per lock across all threads\n",
+                n_ops);
+        printf("  legacy: kis_legacy_recursive_timed_mutex\n");
+        printf("  shared: kis_recursive_shared_mutex\n");
+        printf("  Kismet is using: %s\n\n",
+                std::is_same<kis_recursive_timed_mutex, kis_recursive_shared_mutex>::value ?
+                "shared" : "legacy");
+
+        printf("%-28s %8s %14s %14s %10s\n", "workload", "threads", "legacy ns", "shared ns",
+                "speedup");
+
+        compare("exclusive, uncontended", workload::exclusive, 1, n_ops);
+        compare("exclusive, recursive", workload::recursive, 1, n_ops);
+        compare("shared, uncontended", workload::shared, 1, n_ops);
+
+        if (n_threads > 1) {
+            compare("exclusive, contended", workload::exclusive, n_threads, n_ops);
+            compare("shared, concurrent", workload::shared, n_threads, n_ops);
+            compare("mixed 90% shared", workload::mixed, n_threads, n_ops);
+        }
+    }
+}
+
+// Component memory benchmark
+namespace componentbench {
+    struct result {
+        double allocs;
+        double alloc_bytes;
+        double live_bytes;
+    };
+
+    // Build n_components instances of component C, with or without field slabs, and
+    // return the allocations, bytes allocated, and heap held per instance
+    template<typename C>
+    result measure(int in_id, unsigned long n_components, bool in_slabs) {
+        Globalreg::globalreg->entrytracker->set_field_slabs(in_slabs);
+
+        std::vector<std::shared_ptr<C>> components;
+        components.reserve(n_components);
+
+        // Build one first so that anything registered on first use isn't counted
+        std::make_shared<C>(in_id);
+
+        auto allocs_start = bench_allocs.load();
+        auto alloc_bytes_start = bench_alloc_bytes.load();
+        auto live_start = bench_live_bytes.load();
+
+        for (unsigned long i = 0; i < n_components; i++)
+            components.push_back(std::make_shared<C>(in_id));
+
+        result r{ (double) (bench_allocs.load() - allocs_start) / n_components,
+            (double) (bench_alloc_bytes.load() - alloc_bytes_start) / n_components,
+            (double) (bench_live_bytes.load() - live_start) / n_components };
+
+        Globalreg::globalreg->entrytracker->set_field_slabs(true);
+
+        return r;
+    }
+
+    template<typename C>
+    void compare(const char *name, const std::string& in_field, unsigned long n_components) {
+        auto id = Globalreg::globalreg->entrytracker->get_field_id(in_field);
+
+        if (id < 0) {
+            fprintf(stderr, "ERROR: Field %s is not registered\n", in_field.c_str());
+            return;
+        }
+
+        auto unpacked = measure<C>(id, n_components, false);
+        auto packed = measure<C>(id, n_components, true);
+
+        printf("%-24s %10s %12.1f %12.1f %12.0f\n", name, "unpacked",
+                unpacked.allocs, unpacked.alloc_bytes, unpacked.live_bytes);
+        printf("%-24s %10s %12.1f %12.1f %12.0f\n", "", "slab",
+                packed.allocs, packed.alloc_bytes, packed.live_bytes);
+
+        if (unpacked.live_bytes > 0)
+            printf("%-24s %10s %12.1f %12.1f %11.1f%%\n", "", "saved",
+                    unpacked.allocs - packed.allocs, unpacked.alloc_bytes - packed.alloc_bytes,
+                    (unpacked.live_bytes - packed.live_bytes) * 100 / unpacked.live_bytes);
+    }
+
+    void run_all(unsigned long n_components) {
+        printf("Component memory, %lu records each, per record\n\n", n_components);
+
+        printf("%-24s %10s %12s %12s %12s\n", "component", "fields", "allocs", "bytes alloc",
+                "heap bytes");
+
+        compare<kis_tracked_device_base>("kismet.device.base", "kismet.device.base",
+                n_components);
+        compare<dot11_tracked_device>("dot11.device", "dot11.device", n_components);
+    }
+}
+
+void print_help(char *argv) {
+    printf("Kismet packet chain benchmark\n");
+    printf("Runs pcap files or a generated 802.11 workload through the Kismet packet\n"
+           "chain and reports the time per packet in each stage, allocations per packet,\n"
+           "and device table memory.\n");
+    printf("usage: %s [OPTION]\n", argv);
+    printf(" -f, --config-file [file]     Use an alternate Kismet config file\n"
+           " -r, --pcap [file]            Read the workload from a pcap file; may be\n"
+           "                              repeated.  Without a pcap, a workload is generated.\n"
+           " -n, --packets [count]        Number of packets to generate, defaults to 100000\n"
+           " -d, --devices [count]        Number of devices to generate packets from, defaults\n"
+           "                              to 1000; a quarter of them are access points\n"
+           " -m, --mix [b:p:d]            Relative weights of beacon, probe request, and data\n"
+           "                              frames in the generated workload, defaults to 60:20:20\n"
+           " -s, --seed [seed]            Random seed of the generated workload\n"
+           " -l, --loops [count]          Run the workload this many times, defaults to 1\n"
+           " -w, --warmup [count]         Packets to run before measuring, defaults to 0\n"
+           " -k, --kismetdb [prefix]      Log to a kismetdb file in [prefix] while running\n"
+           " -t, --handlers               Time each packet chain handler\n"
+           " -L, --locks [threads]        Benchmark the mutex implementations instead of the\n"
+           "                              packet chain, using up to [threads] threads; -n sets\n"
+           "                              the number of locks per thread\n"
+           " -C, --components [count]     Measure the heap used by [count] device records with\n"
+           "                              and without field slabs instead of running packets\n"
+           " -v, --verbose                Show Kismet messages while running\n");
+}
+
+int main(int argc, char *argv[]) {
+    static struct option longopt[] = {
+        { "config-file", required_argument, 0, 'f' },
+        { "pcap", required_argument, 0, 'r' },
+        { "packets", required_argument, 0, 'n' },
+        { "devices", required_argument, 0, 'd' },
+        { "mix", required_argument, 0, 'm' },
+        { "seed", required_argument, 0, 's' },
+        { "loops", required_argument, 0, 'l' },
+        { "warmup", required_argument, 0, 'w' },
+        { "kismetdb", required_argument, 0, 'k' },
+        { "handlers", no_argument, 0, 't' },
+        { "locks", required_argument, 0, 'L' },
+        { "components", required_argument, 0, 'C' },
+        { "verbose", no_argument, 0, 'v' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 }
+    };
+    int option_idx = 0;
+
+    exec_name = argv[0];
+
+    std::string configfilename;
+    std::vector<std::string> pcap_fnames;
+    unsigned long n_packets = 100000;
+    unsigned int n_devices = 1000;
+    unsigned int w_beacon = 60, w_probe = 20, w_data = 20;
+    unsigned int seed = 1;
+    unsigned int loops = 1;
+    unsigned long warmup = 0;
+    std::string log_prefix;
+    bool time_handlers = false;
+    unsigned int lock_threads = 0;
+    unsigned long n_components = 0;
+    bool verbose = false;
+
+    while (1) {
+        int r = getopt_long(argc, argv, "f:r:n:d:m:s:l:w:k:tL:C:vh", longopt, &option_idx);
+
+        if (r < 0)
+            break;
+
+        if (r == 'h') {
+            print_help(argv[0]);
+            exit(0);
+        } else if (r == 'f') {
+            configfilename = std::string(optarg);
+        } else if (r == 'r') {
+            pcap_fnames.push_back(std::string(optarg));
+        } else if (r == 'n') {
+            if (sscanf(optarg, "%lu", &n_packets) != 1 || n_packets == 0) {
+                fprintf(stderr, "ERROR: Expected a number of packets\n");
+                exit(1);
+            }
+        } else if (r == 'd') {
+            if (sscanf(optarg, "%u", &n_devices) != 1 || n_devices == 0) {
+                fprintf(stderr, "ERROR: Expected a number of devices\n");
+                exit(1);
+            }
+        } else if (r == 'm') {
+            if (sscanf(optarg, "%u:%u:%u", &w_beacon, &w_probe, &w_data) != 3 ||
+                    w_beacon + w_probe + w_data == 0) {
+                fprintf(stderr, "ERROR: Expected a mix of beacon:probe:data, such as 60:20:20\n");
+                exit(1);
+            }
+        } else if (r == 's') {
+            if (sscanf(optarg, "%u", &seed) != 1) {
+                fprintf(stderr, "ERROR: Expected a random seed\n");
+                exit(1);
+            }
+        } else if (r == 'l') {
+            if (sscanf(optarg, "%u", &loops) != 1 || loops == 0) {
+                fprintf(stderr, "ERROR: Expected a number of loops\n");
+                exit(1);
+            }
+        } else if (r == 'w') {
+            if (sscanf(optarg, "%lu", &warmup) != 1) {
+                fprintf(stderr, "ERROR: Expected a number of warmup packets\n");
+                exit(1);
+            }
+        } else if (r == 'k') {
+            log_prefix = std::string(optarg);
+        } else if (r == 't') {
+            time_handlers = true;
+        } else if (r == 'L') {
+            if (sscanf(optarg, "%u", &lock_threads) != 1 || lock_threads == 0) {
+                fprintf(stderr, "ERROR: Expected a number of threads\n");
+                exit(1);
+            }
+        } else if (r == 'C') {
+            if (sscanf(optarg, "%lu", &n_components) != 1 || n_components == 0) {
+                fprintf(stderr, "ERROR: Expected a number of components\n");
+                exit(1);
+            }
+        } else if (r == 'v') {
+            verbose = true;
+        } else {
+            print_help(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (lock_threads > 0) {
+        lockbench::run_all(lock_threads, n_packets);
+        exit(0);
+    }
+
+    std::vector<bench_frame> frames;
+
+    if (n_components == 0) {
+        try {
+            if (pcap_fnames.size() > 0) {
+                for (const auto& f : pcap_fnames)
+                    load_pcap(f, frames);
+            } else {
+                synthetic::generate(frames, n_packets, n_devices, w_beacon, w_probe, w_data, seed);
+            }
+        } catch (const std::exception& e) {
+            fprintf(stderr, "ERROR: %s\n", e.what());
+            exit(1);
+        }
+
+        if (frames.size() == 0) {
+            fprintf(stderr, "ERROR: No packets in the workload\n");
+            exit(1);
+        }
+    }
+
+    Globalreg::globalreg = new global_registry;
+    auto globalregistry = Globalreg::globalreg;
+
+    // Components which parse the command line at startup see only the logging
+    // options, never the benchmark options
+    std::vector<std::string> kis_args = { argv[0] };
+
+    if (log_prefix.length() > 0) {
+        kis_args.insert(kis_args.end(), { "--log-types", "kismet", "--log-prefix", log_prefix,
+                "--log-title", "kismet_bench" });
+    } else {
+        kis_args.push_back("--no-logging");
+    }
+
+    std::vector<char *> kis_argv;
+    for (auto& a : kis_args)
+        kis_argv.push_back(&a[0]);
+    kis_argv.push_back(nullptr);
+
+    globalregistry->argc = kis_args.size();
+    globalregistry->argv = kis_argv.data();
+
+    auto entrytracker = entry_tracker::create_entrytracker();
+    event_bus::create_eventbus();
+    message_bus::create_messagebus(globalregistry);
+
+    auto msgcli = new bench_message_client(globalregistry, verbose);
+    globalregistry->messagebus->register_client(msgcli, MSGFLAG_ALL);
+
+    if (configfilename == "") {
+        configfilename = fmt::format("{}/kismet.conf",
+                getenv("KISMET_CONF") != NULL ? getenv("KISMET_CONF") : SYSCONF_LOC);
+    }
+
+    auto conf = new config_file(globalregistry);
+
+    if (conf->parse_config(configfilename) < 0) {
+        fprintf(stderr, "ERROR: Could not read config file '%s'\n", configfilename.c_str());
+        exit(1);
+    }
+
+    globalregistry->kismet_config = conf;
+
+    // Nothing but the benchmark source may capture, and nothing may listen
+    conf->set_opt_vec("source", std::vector<std::string>{}, 0);
+    conf->set_opt_vec("gps", std::vector<std::string>{}, 0);
+    conf->set_opt("remote_capture_listen", std::string(""), 0);
+
+    auto etcdir = conf->expand_log_path("%E", "", "", 0, 1);
+    setenv("KISMET_ETC", etcdir.c_str(), 1);
+
+    uuid server_uuid;
+    server_uuid.generate_time_uuid((uint8_t *) "KISMET");
+    globalregistry->server_uuid = server_uuid;
+    globalregistry->server_uuid_hash = server_uuid.hash;
+
+    auto timetracker = time_tracker::create_timetracker();
+
+    // Endpoints are registered as usual, but the server is never started
+    kis_net_httpd::create_httpd();
+
+    globalregistry->manufdb = new kis_manuf();
+
+    entrytracker->register_serializer("json", std::make_shared<json_adapter::serializer>());
+    entrytracker->register_serializer("storagejson", std::make_shared<storage_json_adapter::serializer>());
+
+    ipc_tracker_v2::create_ipctracker();
+    stream_tracker::create_streamtracker(globalregistry);
+    kis_httpd_websession::create_websession();
+    kis_httpd_registry::create_http_registry(globalregistry);
+
+    auto packetchain = packet_chain::create_packetchain();
+    packet_tap::create_packettap();
+    dlt_tracker::create_dltt();
+    Antennatracker::create_at();
+    auto datasourcetracker = datasource_tracker::create_dst();
+    alert_tracker::create_alertracker();
+    auto devicetracker = device_tracker::create_device_tracker();
+    channel_tracker_v2::create_channeltracker(globalregistry);
+
+    kis_dlt_ppi::create_dlt();
+    kis_dlt_radiotap::create_dlt();
+    kis_dlt_btle_ll_radio::create_dlt();
+
+    new kis_dissector_ip_data(globalregistry);
+
+    devicetracker->register_phy_handler(new kis_80211_phy(globalregistry));
+    devicetracker->register_phy_handler(new Kis_RTL433_Phy(globalregistry));
+    devicetracker->register_phy_handler(new Kis_Zwave_Phy(globalregistry));
+    devicetracker->register_phy_handler(new kis_bluetooth_phy(globalregistry));
+    devicetracker->register_phy_handler(new Kis_UAV_Phy(globalregistry));
+    devicetracker->register_phy_handler(new Kis_Mousejack_Phy(globalregistry));
+    devicetracker->register_phy_handler(new kis_btle_phy(globalregistry));
+    devicetracker->register_phy_handler(new kis_rtlamr_phy(globalregistry));
+    devicetracker->register_phy_handler(new kis_rtladsb_phy(globalregistry));
+
+    auto virtual_builder = datasource_virtual_builder::create_virtualbuilder();
+
+    kis_database_logfile::create_kisdatabaselog();
+
+    auto logtracker = log_tracker::create_logtracker();
+    logtracker->register_log(shared_log_builder(new kis_database_logfile_builder()));
+
+    gps_tracker::create_gpsmanager();
+
+    globalregistry->start_deferred();
+
+    if (globalregistry->fatal_condition) {
+        fprintf(stderr, "FATAL: Kismet failed to start; run with --verbose for details\n");
+        exit(1);
+    }
+
+    if (n_components > 0) {
+        componentbench::run_all(n_components);
+
+        globalregistry->shutdown_deferred();
+        globalregistry->spindown = 1;
+        globalregistry->delete_lifetime_globals();
+        globalregistry->complete = true;
+
+        return 0;
+    }
+
+    // Packets are attributed to a virtual source the same way scan reports are
+    auto bench_source = virtual_builder->build_datasource(virtual_builder);
+    std::static_pointer_cast<kis_datasource_virtual>(bench_source)->set_virtual_hardware("kismet_bench");
+
+    uuid source_uuid;
+    source_uuid.generate_random_time_uuid();
+    bench_source->set_source_uuid(source_uuid);
+    bench_source->set_source_key(adler32_checksum(source_uuid.uuid_to_string()));
+    bench_source->set_source_name("kismet_bench");
+
+    datasourcetracker->merge_source(bench_source);
+
+    auto pack_comp_linkframe = packetchain->register_packet_component("LINKFRAME");
+    auto pack_comp_datasrc = packetchain->register_packet_component("KISDATASRC");
+
+    // Shift the timestamps of each loop so that time keeps moving forward
+    struct timeval loop_span;
+    timersub(&frames.back().ts, &frames.front().ts, &loop_span);
+    loop_span.tv_sec += 1;
+
+    uint64_t stage_ns[packet_chain::chain_stages] = { 0 };
+    uint64_t warmup_ns[packet_chain::chain_stages] = { 0 };
+
+    auto inject = [&](const bench_frame& f, unsigned int loop, uint64_t *ns) {
+        auto packet = packetchain->generate_packet();
+
+        packet->ts.tv_sec = f.ts.tv_sec + loop_span.tv_sec * loop;
+        packet->ts.tv_usec = f.ts.tv_usec;
+
+        auto chunk = new kis_datachunk();
+        chunk->dlt = f.dlt;
+        chunk->copy_data(f.data.data(), f.data.size());
+        packet->insert(pack_comp_linkframe, chunk);
+
+        auto datasrcinfo = new packetchain_comp_datasource();
+        datasrcinfo->ref_source = bench_source.get();
+        packet->insert(pack_comp_datasrc, datasrcinfo);
+
+        packetchain->process_packet_inline(packet, ns);
+    };
+
+    // Timers run between packets, outside of the measurement, to keep the server
+    // clock and periodic work moving
+    const unsigned long tick_every = 4096;
+
+    unsigned long w = 0;
+    for (unsigned int loop = 0; w < warmup; loop++) {
+        for (size_t i = 0; i < frames.size() && w < warmup; i++, w++) {
+            inject(frames[i], loop, warmup_ns);
+
+            if ((w % tick_every) == 0)
+                timetracker->tick();
+        }
+    }
+
+    // Enabling timing clears anything timed during the warmup
+    packetchain->set_handler_timing(time_handlers);
+
+    auto devices_start = devicetracker->fetch_num_devices();
+    auto live_start = bench_live_bytes.load();
+    auto allocs_start = bench_allocs.load();
+    auto alloc_bytes_start = bench_alloc_bytes.load();
+
+    uint64_t tick_ns = 0;
+    unsigned long n = 0;
+
+    auto run_start = std::chrono::steady_clock::now();
+
+    for (unsigned int loop = 0; loop < loops; loop++) {
+        for (const auto& f : frames) {
+            inject(f, loop + (warmup / frames.size()) + 1, stage_ns);
+            n++;
+
+            if ((n % tick_every) == 0) {
+                auto tick_start = std::chrono::steady_clock::now();
+                timetracker->tick();
+                tick_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - tick_start).count();
+            }
+        }
+    }
+
+    uint64_t run_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - run_start).count() - tick_ns;
+
+    auto allocs = bench_allocs.load() - allocs_start;
+    auto alloc_bytes = bench_alloc_bytes.load() - alloc_bytes_start;
+    auto live_delta = bench_live_bytes.load() - live_start;
+    auto devices_end = devicetracker->fetch_num_devices();
+
+    uint64_t chain_ns = 0;
+    for (unsigned int s = 0; s < packet_chain::chain_stages; s++)
+        chain_ns += stage_ns[s];
+
+    if (pcap_fnames.size() > 0)
+        printf("Workload: %lu packets from %lu pcap file(s), %u loop(s)\n",
+                (unsigned long) frames.size(), (unsigned long) pcap_fnames.size(), loops);
+    else
+        printf("Workload: %lu generated packets from %u devices, mix %u:%u:%u, %u loop(s)\n",
+                (unsigned long) frames.size(), n_devices, w_beacon, w_probe, w_data, loops);
+
+    printf("Measured: %lu packets after %lu warmup\n\n", n, w);
+
+    printf("%-14s %12s %8s\n", "stage", "ns/packet", "share");
+    for (unsigned int s = 0; s < packet_chain::chain_stages; s++) {
+        printf("%-14s %12.1f %7.1f%%\n", packet_chain::chain_stage_name(s).c_str(),
+                (double) stage_ns[s] / n,
+                chain_ns > 0 ? (double) stage_ns[s] * 100 / chain_ns : 0);
+    }
+    printf("%-14s %12.1f\n", "chain total", (double) chain_ns / n);
+    printf("%-14s %12.1f\n\n", "per packet", (double) run_ns / n);
+
+    if (time_handlers) {
+        printf("%-14s %-28s %12s %12s %12s\n", "stage", "handler", "calls", "mean ns", "max ns");
+
+        for (const auto& t : packetchain->fetch_handler_timing()) {
+            printf("%-14s %-28s %12lu %12.1f %12lu\n", t.chain.c_str(), t.name.c_str(),
+                    (unsigned long) t.num_calls,
+                    t.num_calls > 0 ? (double) t.total_ns / t.num_calls : 0,
+                    (unsigned long) t.max_ns);
+        }
+
+        printf("\n");
+    }
+
+    printf("Throughput:          %.0f packets/sec\n", (double) n * 1000000000 / run_ns);
+    printf("Allocations/packet:  %.2f (%.1f bytes/packet)\n",
+            (double) allocs / n, (double) alloc_bytes / n);
+    printf("Devices:             %d (%d new)\n", devices_end, devices_end - devices_start);
+    printf("Heap growth:         %ld bytes", (long) live_delta);
+    if (devices_end - devices_start > 0)
+        printf(", %.0f bytes/new device", (double) live_delta / (devices_end - devices_start));
+    printf("\n");
+
+    globalregistry->shutdown_deferred();
+    globalregistry->spindown = 1;
+    globalregistry->delete_lifetime_globals();
+    globalregistry->complete = true;
+
+    return 0;
+}
+
@@ -50,18 +50,77 @@ void tracker_component::reserve_fields(std::shared_ptr<tracker_element_map> e) {
     if (registered_fields == nullptr)
         return;
 
-    for (auto& rf : *registered_fields) {
-        if (rf->assign != nullptr) {
-            // We use negative IDs to indicate dynamic to eke out 4 more bytes
-            if (rf->id < 0) {
-                // If the variable is dynamic set the assignment container to null so that
-                // proxydynamictrackable can fill it in;
-                *(rf->assign) = nullptr;
-                insert(abs(rf->id), std::shared_ptr<tracker_element>());
-            } else {
-                // otherwise generate a variable for the destination
-                *(rf->assign) = import_or_new(e, rf->id);
+    // Fixed fields which have to be built from scratch are packed into a single slab
+    // allocation; each is handed out as a shared_ptr aliasing the slab, so the proxy
+    // functions and serializers see normal elements, but a component costs one
+    // allocation for all of its scalar fields instead of an object and a control block
+    // per field.  Anything which can't be placed in a slab is built normally.
+    std::vector<tracker_element *> slab_builders(registered_fields->size(), nullptr);
+    size_t slab_len = 0;
+    bool pack_slabs = Globalreg::globalreg->entrytracker->get_field_slabs();
+
+    for (size_t i = 0; i < registered_fields->size(); i++) {
+        auto& rf = (*registered_fields)[i];
+
+        if (rf->assign == nullptr)
+            continue;
+
+        // We use negative IDs to indicate dynamic to eke out 4 more bytes
+        if (rf->id < 0) {
+            // If the variable is dynamic set the assignment container to null so that
+            // proxydynamictrackable can fill it in;
+            *(rf->assign) = nullptr;
+            insert(abs(rf->id), std::shared_ptr<tracker_element>());
+            continue;
+        } 
+
+        // Inherit from the imported map or a parent instance if we can
+        *(rf->assign) = import_existing(e, rf->id);
+
+        if (*(rf->assign) != nullptr)
+            continue;
+
+        auto builder = Globalreg::globalreg->entrytracker->get_builder(rf->id);
+
+        if (pack_slabs && builder != nullptr && builder->slab_size() > 0) {
+            slab_builders[i] = builder;
+            slab_len += slab_aligned(builder->slab_size());
+        } else {
+            // otherwise generate a variable for the destination
+            *(rf->assign) = import_or_new(nullptr, rf->id);
+        }
+    }
+
+    if (slab_len > 0) {
+        char *slab_mem = new char[slab_len];
+        size_t offt = 0;
+
+        // Construct everything in place, replacing the builder with the placed instance;
+        // if an element throws, the ones already placed are destroyed with the slab
+        try {
+            for (auto& b : slab_builders) {
+                if (b == nullptr)
+                    continue;
+
+                auto sz = slab_aligned(b->slab_size());
+                b = b->clone_type_at(slab_mem + offt);
+                offt += sz;
             }
+        } catch (...) {
+            field_slab_deleter{offt}(slab_mem);
+            throw;
+        }
+
+        // The shared_ptr releases the slab itself if it fails to allocate a control block
+        auto slab = std::shared_ptr<char>(slab_mem, field_slab_deleter{offt});
+
+        for (size_t i = 0; i < registered_fields->size(); i++) {
+            if (slab_builders[i] == nullptr)
+                continue;
+
+            auto& rf = (*registered_fields)[i];
+            *(rf->assign) = shared_tracker_element(slab, slab_builders[i]);
+            insert(*(rf->assign));
         }
     }
 
@@ -70,7 +129,19 @@ void tracker_component::reserve_fields(std::shared_ptr<tracker_element_map> e) {
     registered_fields = nullptr;
 }
 
-shared_tracker_element tracker_component::import_or_new(std::shared_ptr<tracker_element_map> e, int i) {
+void tracker_component::field_slab_deleter::operator()(char *slab) const {
+    size_t offt = 0;
+
+    while (offt < len) {
+        auto e = reinterpret_cast<tracker_element *>(slab + offt);
+        offt += slab_aligned(e->slab_size());
+        e->~tracker_element();
+    }
+
+    delete[] slab;
+}
+
+shared_tracker_element tracker_component::import_existing(std::shared_ptr<tracker_element_map> e, int i) {
     shared_tracker_element r;
 
     // Find the value of any known fields in the importer element; only try
@@ -95,6 +166,15 @@ shared_tracker_element tracker_component::import_or_new(std::shared_ptr<tracker_
     if (existing != end() && existing->second != nullptr)
         return existing->second;
 
+    return nullptr;
+}
+
+shared_tracker_element tracker_component::import_or_new(std::shared_ptr<tracker_element_map> e, int i) {
+    auto r = import_existing(e, i);
+
+    if (r != nullptr)
+        return r;
+
     // Build it
     r = Globalreg::globalreg->entrytracker->get_shared_instance(i);
 
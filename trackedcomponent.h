@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <cstddef>
 
 #include <string>
 #include <stdexcept>
@@ -305,6 +306,45 @@ class tracker_component : public tracker_element_map {
         set_tracker_value<ptype>(cvar, in); \
     } 
 
+// Lock-elided proxies, for callers which already hold the mutex protecting the 
+// component (such as update_common_device holding the device_mutex, or a datasource 
+// holding ext_mutex).  Defines non-virtual get_<name>_held and set_<name>_held which
+// access the element directly without taking a lock; when KIS_ASSERT_ELIDED_LOCKS is
+// enabled they verify that the calling thread holds <mutex>.  These are intended to
+// sit alongside the normal proxies for the hot paths, not to replace them.
+#define __ProxyGetHeld(name, ptype, rtype, cvar, mutex) \
+    inline rtype get_##name##_held() const { \
+        kis_assert_lock_held((kis_recursive_timed_mutex *) &mutex); \
+        return (rtype) cvar->get(); \
+    }
+#define __ProxySetHeld(name, ptype, itype, cvar, mutex) \
+    inline void set_##name##_held(const itype& in) { \
+        kis_assert_lock_held((kis_recursive_timed_mutex *) &mutex); \
+        cvar->set(static_cast<ptype>(in)); \
+    }
+#define __ProxyHeld(name, ptype, itype, rtype, cvar, mutex) \
+    __ProxyGetHeld(name, ptype, rtype, cvar, mutex) \
+    __ProxySetHeld(name, ptype, itype, cvar, mutex)
+
+// Lock-elided increment and decrement
+#define __ProxyIncDecHeld(name, ptype, rtype, cvar, mutex) \
+    inline void inc_##name##_held() { \
+        kis_assert_lock_held((kis_recursive_timed_mutex *) &mutex); \
+        (*cvar) += 1; \
+    } \
+    inline void inc_##name##_held(rtype i) { \
+        kis_assert_lock_held((kis_recursive_timed_mutex *) &mutex); \
+        (*cvar) += (ptype) i; \
+    } \
+    inline void dec_##name##_held() { \
+        kis_assert_lock_held((kis_recursive_timed_mutex *) &mutex); \
+        (*cvar) -= 1; \
+    } \
+    inline void dec_##name##_held(rtype i) { \
+        kis_assert_lock_held((kis_recursive_timed_mutex *) &mutex); \
+        (*cvar) -= (ptype) i; \
+    }
+
 // Proxy a split public/private get/set function; This is even funkier than the 
 // normal proxy macro and should only be used in a 'public' segment of the class.
 #define __ProxyPrivSplit(name, ptype, itype, rtype, cvar) \
@@ -858,6 +898,21 @@ protected:
     // Add imported or new field to our map for use tracking.
     virtual shared_tracker_element import_or_new(std::shared_ptr<tracker_element_map> e, int i);
 
+    // Inherit from an existing element, or from a field already present in our own map;
+    // returns nullptr if the field needs to be built.
+    shared_tracker_element import_existing(std::shared_ptr<tracker_element_map> e, int i);
+
+    // Slab entries are padded so that every in-place element is suitably aligned
+    static constexpr size_t slab_aligned(size_t sz) {
+        return (sz + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    }
+
+    // Destroys the elements constructed in a field slab, then releases the slab
+    struct field_slab_deleter {
+        size_t len;
+        void operator()(char *slab) const;
+    };
+
     std::vector<std::unique_ptr<registered_field>> *registered_fields;
 };
 
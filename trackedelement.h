@@ -29,6 +29,8 @@
 #include <arpa/inet.h>
 
 #include <functional>
+#include <new>
+#include <typeinfo>
 
 #include <string>
 #include <stdexcept>
@@ -229,6 +231,19 @@ public:
         return nullptr;
     }
 
+    // Fixed-size elements can be constructed in place inside a component slab (see 
+    // tracker_component::reserve_fields) instead of being allocated individually.  
+    // slab_size() returns the storage needed for an in-place clone, or 0 if this type
+    // can not be placed in a slab.  Subclasses which do not provide their own versions
+    // report 0 so they are never sliced into their parent type.
+    virtual size_t slab_size() const {
+        return 0;
+    }
+
+    virtual tracker_element *clone_type_at(void *mem) {
+        return nullptr;
+    }
+
     // Called prior to serialization output
     virtual void pre_serialize() { }
 
@@ -426,6 +441,24 @@ protected:
 
 };
 
+// Mixin for element types which can be placed in a component slab; T is the element
+// type being defined and B the class it would otherwise derive from.  Subclasses of T
+// which do not use the mixin themselves report a slab size of 0 and are allocated
+// normally, so they are never sliced into T.
+template <class T, class B>
+class tracker_element_slab_placed : public B {
+public:
+    using B::B;
+
+    virtual size_t slab_size() const override {
+        return typeid(*this) == typeid(T) ? sizeof(T) : 0;
+    }
+
+    virtual tracker_element *clone_type_at(void *mem) override {
+        return new (mem) T(static_cast<T *>(this));
+    }
+};
+
 // Superclass for generic components for pod-like scalar attributes, though
 // they don't need to be explicitly POD
 template <class P>
@@ -495,22 +528,23 @@ protected:
 
 };
 
-class tracker_element_string : public tracker_element_core_scalar<std::string> {
+class tracker_element_string : 
+    public tracker_element_slab_placed<tracker_element_string, tracker_element_core_scalar<std::string>> {
 public:
     tracker_element_string() :
-        tracker_element_core_scalar<std::string>() { }
+        tracker_element_slab_placed() { }
 
     tracker_element_string(int id) :
-        tracker_element_core_scalar<std::string>(id) { }
+        tracker_element_slab_placed(id) { }
 
     tracker_element_string(int id, const std::string& s) :
-        tracker_element_core_scalar<std::string>(id, s) { }
+        tracker_element_slab_placed(id, s) { }
 
     tracker_element_string(const std::string& s) :
-        tracker_element_core_scalar<std::string>(0, s) { }
+        tracker_element_slab_placed(0, s) { }
 
     tracker_element_string(const tracker_element_string *p) :
-        tracker_element_core_scalar{p} { }
+        tracker_element_slab_placed{p} { }
 
     virtual tracker_type get_type() const override {
         return tracker_type::tracker_string;
@@ -551,19 +585,20 @@ public:
 
 };
 
-class tracker_element_byte_array : public tracker_element_string {
+class tracker_element_byte_array : 
+    public tracker_element_slab_placed<tracker_element_byte_array, tracker_element_string> {
 public:
     tracker_element_byte_array() :
-        tracker_element_string() { }
+        tracker_element_slab_placed() { }
 
     tracker_element_byte_array(int id) :
-        tracker_element_string(id) { }
+        tracker_element_slab_placed(id) { }
 
     tracker_element_byte_array(int id, const std::string& s) :
-        tracker_element_string(id, s) { }
+        tracker_element_slab_placed(id, s) { }
 
     tracker_element_byte_array(const tracker_element_byte_array *p) :
-        tracker_element_string{p} { }
+        tracker_element_slab_placed{p} { }
 
     virtual tracker_type get_type() const override {
         return tracker_type::tracker_byte_array;
@@ -657,16 +692,17 @@ public:
 
 };
 
-class tracker_element_device_key : public tracker_element_core_scalar<device_key> {
+class tracker_element_device_key : 
+    public tracker_element_slab_placed<tracker_element_device_key, tracker_element_core_scalar<device_key>> {
 public:
     tracker_element_device_key() :
-        tracker_element_core_scalar<device_key>() { }
+        tracker_element_slab_placed() { }
 
     tracker_element_device_key(int id) :
-        tracker_element_core_scalar<device_key>(id) { }
+        tracker_element_slab_placed(id) { }
 
     tracker_element_device_key(const tracker_element_device_key *p) :
-        tracker_element_core_scalar<device_key>{p} { }
+        tracker_element_slab_placed{p} { }
 
     virtual tracker_type get_type() const override {
         return tracker_type::tracker_key;
@@ -708,19 +744,20 @@ public:
     }
 };
 
-class tracker_element_uuid : public tracker_element_core_scalar<uuid> {
+class tracker_element_uuid : 
+    public tracker_element_slab_placed<tracker_element_uuid, tracker_element_core_scalar<uuid>> {
 public:
     tracker_element_uuid() :
-        tracker_element_core_scalar<uuid>() { }
+        tracker_element_slab_placed() { }
 
     tracker_element_uuid(int id) :
-        tracker_element_core_scalar<uuid>(id) { }
+        tracker_element_slab_placed(id) { }
 
     tracker_element_uuid(int id, const uuid& u) :
-        tracker_element_core_scalar<uuid>(id, u) { }
+        tracker_element_slab_placed(id, u) { }
 
     tracker_element_uuid(const tracker_element_uuid *p) :
-        tracker_element_core_scalar<uuid>{p} { }
+        tracker_element_slab_placed{p} { }
 
     virtual tracker_type get_type() const override {
         return tracker_type::tracker_uuid;
@@ -753,22 +790,23 @@ public:
     }
 };
 
-class tracker_element_mac_addr : public tracker_element_core_scalar<mac_addr> {
+class tracker_element_mac_addr : 
+    public tracker_element_slab_placed<tracker_element_mac_addr, tracker_element_core_scalar<mac_addr>> {
 public:
     tracker_element_mac_addr() :
-        tracker_element_core_scalar<mac_addr>() { }
+        tracker_element_slab_placed() { }
 
     tracker_element_mac_addr(int id) :
-        tracker_element_core_scalar<mac_addr>(id) { }
+        tracker_element_slab_placed(id) { }
 
     tracker_element_mac_addr(int id, const std::string& s) :
-        tracker_element_core_scalar<mac_addr>(id, mac_addr(s)) { }
+        tracker_element_slab_placed(id, mac_addr(s)) { }
 
     tracker_element_mac_addr(int id, const mac_addr& m) :
-        tracker_element_core_scalar<mac_addr>(id, m) { }
+        tracker_element_slab_placed(id, m) { }
 
     tracker_element_mac_addr(const tracker_element_mac_addr *p) :
-        tracker_element_core_scalar<mac_addr>{p} { }
+        tracker_element_slab_placed{p} { }
 
     virtual tracker_type get_type() const override {
         return tracker_type::tracker_mac_addr;
@@ -801,16 +839,17 @@ public:
     }
 };
 
-class tracker_element_ipv4_addr : public tracker_element_core_scalar<uint32_t> {
+class tracker_element_ipv4_addr : 
+    public tracker_element_slab_placed<tracker_element_ipv4_addr, tracker_element_core_scalar<uint32_t>> {
 public:
     tracker_element_ipv4_addr() :
-        tracker_element_core_scalar<uint32_t>() { }
+        tracker_element_slab_placed() { }
 
     tracker_element_ipv4_addr(int id) :
-        tracker_element_core_scalar<uint32_t>(id) { }
+        tracker_element_slab_placed(id) { }
 
     tracker_element_ipv4_addr(int id, const std::string& s) :
-        tracker_element_core_scalar<uint32_t>(id) { 
+        tracker_element_slab_placed(id) { 
 
         struct in_addr addr;
 
@@ -821,13 +860,13 @@ public:
     }
 
     tracker_element_ipv4_addr(int id, struct in_addr addr) :
-        tracker_element_core_scalar<uint32_t>(id, addr.s_addr) { }
+        tracker_element_slab_placed(id, addr.s_addr) { }
 
     tracker_element_ipv4_addr(int id, struct in_addr *addr) :
-        tracker_element_core_scalar<uint32_t>(id, addr->s_addr) { }
+        tracker_element_slab_placed(id, addr->s_addr) { }
 
     tracker_element_ipv4_addr(tracker_element_ipv4_addr *p) :
-        tracker_element_core_scalar<uint32_t>{p} { }
+        tracker_element_slab_placed{p} { }
 
     virtual tracker_type get_type() const override {
         return tracker_type::tracker_ipv4_addr;
@@ -879,22 +918,23 @@ public:
 // Simplify numeric conversion w/ an interstitial scalar-like that holds all 
 // our numeric subclasses
 template<class N, tracker_type T = tracker_type::tracker_double, class S = numerical_string<N>>
-class tracker_element_core_numeric : public tracker_element {
+class tracker_element_core_numeric : 
+    public tracker_element_slab_placed<tracker_element_core_numeric<N, T, S>, tracker_element> {
 public:
     tracker_element_core_numeric() :
-        tracker_element(),
+        tracker_element_slab_placed<tracker_element_core_numeric<N, T, S>, tracker_element>(),
         value{0} { }
 
     tracker_element_core_numeric(int id) :
-        tracker_element(id),
+        tracker_element_slab_placed<tracker_element_core_numeric<N, T, S>, tracker_element>(id),
         value{0} { }
 
     tracker_element_core_numeric(int id, const N& v) :
-        tracker_element(id),
+        tracker_element_slab_placed<tracker_element_core_numeric<N, T, S>, tracker_element>(id),
         value(v) { }
 
     tracker_element_core_numeric(const tracker_element_core_numeric<N, T, S> *p) :
-        tracker_element{p},
+        tracker_element_slab_placed<tracker_element_core_numeric<N, T, S>, tracker_element>{p},
         value{0} { }
 
     virtual tracker_type get_type() const override {
@@ -1081,9 +1121,9 @@ public:
     inline bool less_than(const std::shared_ptr<tracker_element> rhs) const {
         if (get_type() != rhs->get_type())
             throw std::runtime_error(fmt::format("Attempted to compare two non-equal field types, "
-                        "{} < {}", get_type_as_string(), rhs->get_type_as_string()));
+                        "{} < {}", this->get_type_as_string(), rhs->get_type_as_string()));
 
-        return value < safe_cast_as<tracker_element_core_numeric<N, T, S>>(rhs)->value;
+        return value < tracker_element::safe_cast_as<tracker_element_core_numeric<N, T, S>>(rhs)->value;
     }
 
 protected: